@@ -250,6 +250,13 @@ void Java_org_deadc0de_apple2ix_Apple2View_nativeRender(JNIEnv *env, jclass cls)
     }
 #endif
 
+    bool written = false;
+    if (UNLIKELY(emulator_pollSaveState(&written)) && !written) {
+        char *saveFailed = "Save State Failed";
+        unsigned int cols = strlen(saveFailed);
+        video_backend->animation_showMessage(saveFailed, cols, 1);
+    }
+
     video_backend->render();
 }
 
@@ -348,6 +355,8 @@ void Java_org_deadc0de_apple2ix_Apple2Activity_nativeSaveState(JNIEnv *env, jobj
     assert(cpu_isPaused() && "considered dangerous to save state CPU thread is running");
 
     LOG(": (%s)", path);
+    // only the capture happens during the pause, the file is written in the background once emulation resumes (the
+    // outcome is reported from nativeRender())
     if (!emulator_saveState(path)) {
         LOG("OOPS, could not save emulator state");
     }
@@ -59,6 +59,8 @@ ENTRY(func)             push    {r0, EffectiveAddr, PC_Reg, /*SP_Reg, F_Reg, Y_R
 
 #define GLUE_C_READ(func) \
 ENTRY(func)             push    {EffectiveAddr, PC_Reg, /*SP_Reg, F_Reg, Y_Reg, X_Reg, A_Reg,*/ lr}; \
+                        SYM(r1, cpu65_io_pc); \
+                        strh    PC_Reg, [r1]; \
                         mov     r0, EffectiveAddr; \
                         bl      CALL(c_##func); \
                         pop     {EffectiveAddr, PC_Reg, /*SP_Reg, F_Reg, Y_Reg, X_Reg, A_Reg,*/ pc};
@@ -362,6 +362,25 @@ bool GetExitCodeThread(pthread_t thread, unsigned long *lpExitCode)
 
 //---------------------------------------------------------------------------
 
+#ifdef APPLE2IX
+// Timer1 underflow of the IRQ device is a timing event, so the IRQ is raised on the cycle it is due rather than at the
+// end of the execution period
+static void MB_TimerEvent(timing_event_t *event)
+{
+	MB_UpdateCycles();	// raises the IRQ and restarts/stops the timer
+}
+
+static timing_event_t g_mbTimerEvent = TIMING_EVENT_INITIALIZER(MB_TimerEvent);
+
+// The card state (and its timer event) is not per machine : the Mockingboard is only plugged into the default machine,
+// the slots 4 and 5 of the other machines are empty
+#if MACHINE_CONTEXT
+#   define MB_IsPlugged() (current_machine == &machine_default)
+#else
+#   define MB_IsPlugged() true
+#endif
+#endif
+
 static void StartTimer(SY6522_AY8910* pMB)
 {
 	if((pMB->nAY8910Number & 1) != SY6522_DEVICE_A)
@@ -382,12 +401,20 @@ static void StartTimer(SY6522_AY8910* pMB)
 
 	g_bMBTimerIrqActive = true;
 	g_nMBTimerDevice = pMB->nAY8910Number;
+
+#ifdef APPLE2IX
+	// TIMER1_COUNTER is current as of g_uLastCumulativeCycles and underflows (bit 15 set) after COUNTER+1 clocks
+	timing_scheduleEvent(&g_mbTimerEvent, g_uLastCumulativeCycles + pMB->sy6522.TIMER1_COUNTER.w + 1);
+#endif
 }
 
 //-----------------------------------------------------------------------------
 
 static void StopTimer(SY6522_AY8910* pMB)
 {
+#ifdef APPLE2IX
+	timing_cancelEvent(&g_mbTimerEvent);
+#endif
 	pMB->nTimerStatus = 0;
 	g_bMBTimerIrqActive = false;
 	g_nMBTimerDevice = TIMERDEVICE_INVALID;
@@ -1825,6 +1852,11 @@ GLUE_C_READ(MB_Read)
 static uint8_t MB_Read(uint16_t PC, uint16_t nAddr, uint8_t bWrite, uint8_t nValue, unsigned long nCyclesLeft)
 #endif
 {
+#ifdef APPLE2IX
+	if(!MB_IsPlugged())
+		return MemReadFloatingBus();
+#endif
+
 	MB_UpdateCycles();
 
 #ifdef _DEBUG
@@ -1903,6 +1935,11 @@ GLUE_C_WRITE(MB_Write)
 static uint8_t MB_Write(uint16_t PC, uint16_t nAddr, uint8_t bWrite, uint8_t nValue, unsigned long nCyclesLeft)
 #endif
 {
+#ifdef APPLE2IX
+	if(!MB_IsPlugged())
+		return;
+#endif
+
 	MB_UpdateCycles();
 
 #ifdef _DEBUG
@@ -2013,6 +2050,10 @@ SS_CARDTYPE g_Slot5 = CT_MockingboardC;
 
 void mb_io_initialize(unsigned int slot4, unsigned int slot5)
 {
+    if (!MB_IsPlugged())
+    {
+        return;
+    }
     MB_InitializeIO(NULL, slot4, slot5);
 }
 
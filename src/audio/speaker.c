@@ -502,7 +502,12 @@ GLUE_C_READ(speaker_toggle)
 #endif
 
     if (speaker_isAvailable) {
+        struct timespec t0;
+        const bool profiled = timing_profileDeviceBegin(&t0);
         _speaker_update(/*toggled:true*/);
+        if (UNLIKELY(profiled)) {
+            timing_profileDeviceEnd(&t0, TIMING_DEVICE_SPEAKER);
+        }
     }
 
     if (!is_fullspeed) {
@@ -0,0 +1,909 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+/*
+ * apple2ix-batch : headless batch runner
+ *
+ * Runs the jobs of a JSON manifest on a pool of worker threads, each job on its own machine (machine.h) at full speed
+ * with no video, audio or interface, and writes the results as JSON.  The assembly cores only have the default
+ * machine : the jobs then take turns on it (a single worker).
+ *
+ *      apple2ix-batch [-j workers] [-o results.json] [-v] manifest.json
+ *
+ * The manifest is an array of job objects :
+ *
+ *      [
+ *          { "name" : "dos33-boot", "disk" : "disks/testvm1.dsk.gz", "cycles" : 20000000,
+ *            "exit_sha" : "F8D6C781E0BB7B3DDBECD69B25E429D845506594" },
+ *          { "name" : "hello", "disk" : "images/hello.dsk", "keys" : "RUN HELLO\n", "keys_at" : 5000000,
+ *            "cycles" : 50000000, "exit_mem" : "0x1F33:FF" },
+ *          { "name" : "selftest", "disk" : "images/selftest.po", "cycles" : 100000000, "exit_pc" : "0x6010" },
+ *          { "name" : "session", "disk" : "images/game.dsk", "replay" : "game.a2replay", "cycles" : 300000000 }
+ *      ]
+ *
+ *      - name      : job name (defaults to the index of the job in the manifest)
+ *      - disk      : disk image inserted in drive 1 (a private copy, the image itself is never modified)
+ *      - readonly  : write protect the disk (default false)
+ *      - keys      : keystrokes typed whenever the keyboard strobe is clear (\n is typed as RETURN)
+ *      - keys_at   : cycle from which the keystrokes are typed (default 0)
+ *      - replay    : input recording (apple2ix --record) played back from power on, instead of typing keys
+ *      - cycles    : cycle budget (default BATCH_DEFAULT_CYCLES)
+ *      - exit_pc   : stop on the instruction at this address (e.g. a JMP * ending a test), halting the CPU through the
+ *                    debugger breakpoints (at most MAX_BRKPTS distinct addresses per manifest, and the assembly CPU
+ *                    core then single-steps)
+ *      - exit_mem  : stop when main memory holds the hex bytes at the address, "ADDR:BYTES"
+ *      - exit_sha  : stop when the SHA1 of the framebuffer matches (checked every BATCH_SHA_FRAMES video frames)
+ *
+ * Jobs start from a machine reset (power on for replay jobs).  The other exit conditions are checked at the end of each
+ * video frame.  The results array keeps the manifest order :
+ *
+ *      { "name" : ..., "status" : "exit"|"done"|"timeout"|"error", "condition" : "pc"|"mem"|"sha"|null,
+ *        "cycles" : ..., "pc" : ..., "sha" : ..., "msecs" : ..., "error" : ... }
+ *
+ * "done" is a job without exit condition that ran its budget, "timeout" a job whose exit condition was not met within
+ * its budget.  The exit status is non-zero when any job timed out or failed.
+ *
+ * Benchmark mode boots a disk image from a machine reset and runs it for a fixed number of cycles (no exit condition),
+ * then prints the emulated clock rate, the split of the host time between the CPU (cpu65_run()), the timing events, the
+ * skipping of idle loops, the disk/video/speaker (the costly part of their I/O, taken out of the CPU and events time)
+ * and the batch loop itself.  The C CPU core also counts the instructions it executes : the host time per instruction
+ * and the instruction mix are then reported as well.  With -o the report is also written as JSON (with the instruction
+ * counts of every opcode on the C core) :
+ *
+ *      apple2ix-batch --benchmark [--cycles N] [-o benchmark.json] disks/speedtest.dsk.gz
+ */
+
+#include "common.h"
+#include "json_parse.h"
+#include "test/sha1.h"
+
+#include <getopt.h>
+
+#define BATCH_FRAME_CYCLES 17030            // video frame (see timing.c)
+#define BATCH_SHA_FRAMES 6                  // framebuffer hashing is costly compared to emulating a frame
+#define BATCH_DEFAULT_CYCLES 100000000ULL   // ~98 seconds of emulated time
+#define BATCH_BENCHMARK_CYCLES 200000000ULL // ~196 seconds of emulated time
+#define BATCH_MIX_TOP 16                    // mnemonics printed in the benchmark instruction mix
+#define BATCH_COPY_SIZE 65536
+
+typedef enum batch_status_t {
+    BATCH_PENDING = 0,
+    BATCH_EXIT,
+    BATCH_DONE,
+    BATCH_TIMEOUT,
+    BATCH_ERROR,
+} batch_status_t;
+
+static const char *batch_status_names[] = {
+    [BATCH_PENDING] = "pending",
+    [BATCH_EXIT]    = "exit",
+    [BATCH_DONE]    = "done",
+    [BATCH_TIMEOUT] = "timeout",
+    [BATCH_ERROR]   = "error",
+};
+
+typedef struct batch_job_t {
+    // manifest
+    char *name;
+    char *disk;
+    bool readonly;
+    char *keys;
+    unsigned long long keys_at;
+    char *replay;
+    unsigned long long cycles;
+    long exit_pc;               // -1 when unused
+    long exit_addr;             // -1 when unused
+    uint8_t *exit_bytes;
+    size_t exit_len;
+    char *exit_sha;
+
+    // results
+    batch_status_t status;
+    const char *condition;
+    const char *error;
+    unsigned long long cycles_run;
+    uint16_t pc;
+    char sha[(SHA_DIGEST_LENGTH*2)+1];
+    long msecs;
+
+    // benchmark
+    timing_profile_t *profile;  // profiled when non-NULL
+    unsigned long long run_nsecs;
+} batch_job_t;
+
+static batch_job_t *jobs = NULL;
+static unsigned int job_count = 0;
+static unsigned int next_job = 0;
+
+// machine_create() initializes the tables shared by all machines
+static pthread_mutex_t machine_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// ----------------------------------------------------------------------------
+// Headless stubs (no video backend, audio, or interface)
+
+volatile unsigned long _backend_vid_dirty = 0;
+
+void video_driver_sync(void) {
+}
+
+void video_set_mode(a2_video_mode_t mode) {
+}
+
+uint8_t c_MB_Read(uint16_t addr) {
+    return 0x0;
+}
+
+void c_MB_Write(uint16_t addr, uint8_t byte) {
+}
+
+uint8_t c_PhasorIO(uint16_t addr) {
+    return 0x0;
+}
+
+void c_speaker_toggle(void) {
+}
+
+void c_interface_print(int x, int y, const int cs, const char *s) {
+}
+
+// ----------------------------------------------------------------------------
+// Manifest
+
+// copies a string token, resolving the JSON escapes
+static char *_batch_tokenString(const JSON_s *json, const jsmntok_t *tok) {
+    const char *src = &json->jsonString[tok->start];
+    const int len = tok->end - tok->start;
+    char *str = malloc(len+1);
+    int j = 0;
+    for (int i = 0; i < len; i++) {
+        char ch = src[i];
+        if ((ch == '\\') && (i+1 < len)) {
+            ch = src[++i];
+            switch (ch) {
+                case 'n': ch = '\n'; break;
+                case 'r': ch = '\r'; break;
+                case 't': ch = '\t'; break;
+                case 'b': ch = '\b'; break;
+                case 'f': ch = '\f'; break;
+                case 'u':
+                    if (i+4 < len) {
+                        char hex[5] = { src[i+1], src[i+2], src[i+3], src[i+4], '\0' };
+                        ch = (char)strtol(hex, NULL, /*base:*/16); // ASCII only
+                        i += 4;
+                    }
+                    break;
+                default: break; // \" \\ \/
+            }
+        }
+        str[j++] = ch;
+    }
+    str[j] = '\0';
+    return str;
+}
+
+static bool _batch_tokenNumber(const JSON_s *json, const jsmntok_t *tok, unsigned long long *val) {
+    char *str = _batch_tokenString(json, tok);
+    char *end = NULL;
+    errno = 0;
+    *val = strtoull(str, &end, /*base:*/0);
+    const bool ok = (errno == 0) && (end != str) && (*end == '\0');
+    FREE(str);
+    return ok;
+}
+
+// "ADDR:BYTES" (hex bytes)
+static bool _batch_parseMemPattern(const char *str, batch_job_t *job) {
+    char *end = NULL;
+    const unsigned long addr = strtoul(str, &end, /*base:*/16);
+    if ((end == str) || (*end != ':') || (addr > 0xFFFF)) {
+        return false;
+    }
+    const char *hex = end+1;
+    const size_t len = strlen(hex) / 2;
+    if (!len || (strlen(hex) & 1) || (addr + len > 0x10000)) {
+        return false;
+    }
+    job->exit_bytes = malloc(len);
+    for (size_t i = 0; i < len; i++) {
+        char byte[3] = { hex[i*2], hex[(i*2)+1], '\0' };
+        job->exit_bytes[i] = (uint8_t)strtol(byte, &end, /*base:*/16);
+        if (*end != '\0') {
+            FREE(job->exit_bytes);
+            return false;
+        }
+    }
+    job->exit_addr = (long)addr;
+    job->exit_len = len;
+    return true;
+}
+
+static bool _batch_parseJob(const JSON_s *json, int idx, unsigned int num, batch_job_t *job) {
+    const jsmntok_t *tokens = json->jsonTokens;
+
+    job->exit_pc = -1;
+    job->exit_addr = -1;
+    job->cycles = BATCH_DEFAULT_CYCLES;
+
+    const int keyCount = tokens[idx].size;
+    ++idx;
+    for (int k = 0; k < keyCount; k++, idx += 2) {
+        const jsmntok_t *key = &tokens[idx];
+        const jsmntok_t *val = &tokens[idx+1];
+        if ((key->type != JSMN_STRING) || (val->type == JSMN_OBJECT) || (val->type == JSMN_ARRAY)) {
+            ERRLOG("Job %u : expecting string keys with string/number values", num);
+            return false;
+        }
+
+        const char *name = &json->jsonString[key->start];
+        const size_t nameLen = key->end - key->start;
+#define KEY_IS(s) ((nameLen == sizeof(s)-1) && (strncmp(name, (s), nameLen) == 0))
+
+        bool ok = true;
+        if (KEY_IS("name")) {
+            job->name = _batch_tokenString(json, val);
+        } else if (KEY_IS("disk")) {
+            job->disk = _batch_tokenString(json, val);
+        } else if (KEY_IS("readonly")) {
+            job->readonly = (json->jsonString[val->start] == 't') || (json->jsonString[val->start] == '1');
+        } else if (KEY_IS("keys")) {
+            job->keys = _batch_tokenString(json, val);
+        } else if (KEY_IS("keys_at")) {
+            ok = _batch_tokenNumber(json, val, &job->keys_at);
+        } else if (KEY_IS("replay")) {
+            job->replay = _batch_tokenString(json, val);
+        } else if (KEY_IS("cycles")) {
+            ok = _batch_tokenNumber(json, val, &job->cycles);
+        } else if (KEY_IS("exit_pc")) {
+            unsigned long long pc = 0;
+            ok = _batch_tokenNumber(json, val, &pc) && (pc <= 0xFFFF);
+            job->exit_pc = (long)pc;
+        } else if (KEY_IS("exit_mem")) {
+            char *str = _batch_tokenString(json, val);
+            ok = _batch_parseMemPattern(str, job);
+            FREE(str);
+        } else if (KEY_IS("exit_sha")) {
+            job->exit_sha = _batch_tokenString(json, val);
+            ok = (strlen(job->exit_sha) == SHA_DIGEST_LENGTH*2);
+            for (char *p = job->exit_sha; *p; p++) {
+                *p = toupper(*p);
+            }
+        } else {
+            ERRLOG("Job %u : unknown key '%.*s'", num, (int)nameLen, name);
+            ok = false;
+        }
+#undef KEY_IS
+
+        if (!ok) {
+            ERRLOG("Job %u : bad value '%.*s'", num, val->end - val->start, &json->jsonString[val->start]);
+            return false;
+        }
+    }
+
+    if (job->replay && job->keys) {
+        ERRLOG("Job %u : keys and replay are exclusive", num);
+        return false;
+    }
+
+    if (!job->name) {
+        asprintf(&job->name, "%u", num);
+    }
+
+    return true;
+}
+
+static bool _batch_loadManifest(const char *path) {
+    JSON_s parsedData = { 0 };
+    int tokCount = json_createFromFile(path, &parsedData);
+    bool loaded = false;
+
+    do {
+        if (tokCount < 0) {
+            break;
+        }
+
+        if ((tokCount == 0) || (parsedData.jsonTokens[0].type != JSMN_ARRAY)) {
+            ERRLOG("Manifest must be an array of jobs");
+            break;
+        }
+
+        job_count = parsedData.jsonTokens[0].size;
+        jobs = calloc(job_count ? job_count : 1, sizeof(batch_job_t));
+
+        int idx = 1;
+        unsigned int num = 0;
+        for (; num < job_count; num++) {
+            if (parsedData.jsonTokens[idx].type != JSMN_OBJECT) {
+                ERRLOG("Job %u : expecting an object", num);
+                break;
+            }
+            if (!_batch_parseJob(&parsedData, idx, num, &jobs[num])) {
+                break;
+            }
+            idx += 1 + (parsedData.jsonTokens[idx].size * 2);
+        }
+
+        loaded = (num == job_count);
+    } while (0);
+
+    if (tokCount >= 0) {
+        json_destroy(&parsedData);
+    }
+
+    return loaded;
+}
+
+// ----------------------------------------------------------------------------
+// Jobs
+
+// disk images are inflated in place and compressed again on eject, so each job works on a private copy
+static bool _batch_copyImage(const char *src, char **dir, char **dst) {
+    const char *tmpdir = getenv("TMPDIR");
+    asprintf(dir, "%s/apple2ix-batch.XXXXXX", tmpdir ? tmpdir : "/tmp");
+    if (!mkdtemp(*dir)) {
+        ERRLOG("OOPS, could not create a directory for %s", src);
+        FREE(*dir);
+        return false;
+    }
+
+    const char *base = strrchr(src, '/');
+    asprintf(dst, "%s/%s", *dir, base ? base+1 : src);
+
+    int in = -1;
+    int out = -1;
+    bool copied = false;
+    uint8_t *buf = malloc(BATCH_COPY_SIZE);
+    do {
+        TEMP_FAILURE_RETRY(in = open(src, O_RDONLY));
+        if (in < 0) {
+            ERRLOG("OOPS, could not open %s", src);
+            break;
+        }
+        TEMP_FAILURE_RETRY(out = open(*dst, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR));
+        if (out < 0) {
+            ERRLOG("OOPS, could not create %s", *dst);
+            break;
+        }
+
+        ssize_t len = 0;
+        do {
+            TEMP_FAILURE_RETRY(len = read(in, buf, BATCH_COPY_SIZE));
+            ssize_t written = 0;
+            while ((len > 0) && (written < len)) {
+                ssize_t w = 0;
+                TEMP_FAILURE_RETRY(w = write(out, buf+written, len-written));
+                if (w <= 0) {
+                    len = -1;
+                    break;
+                }
+                written += w;
+            }
+        } while (len > 0);
+
+        copied = (len == 0);
+        if (!copied) {
+            ERRLOG("OOPS, could not copy %s", src);
+        }
+    } while (0);
+
+    FREE(buf);
+    if (in >= 0) {
+        TEMP_FAILURE_RETRY(close(in));
+    }
+    if (out >= 0) {
+        TEMP_FAILURE_RETRY(close(out));
+    }
+
+    return copied;
+}
+
+static void _batch_removeImage(char *dir, char *image) {
+    // ejecting compresses the image (foo.dsk -> foo.dsk.gz)
+    char *gz = NULL;
+    asprintf(&gz, "%s.gz", image);
+    unlink(gz);
+    unlink(image);
+    const size_t len = strlen(image);
+    if ((len > 3) && (strcmp(image+len-3, ".gz") == 0)) {
+        image[len-3] = '\0';
+        unlink(image);
+    }
+    rmdir(dir);
+    FREE(gz);
+}
+
+static void _batch_framebufferSHA(char *buf) {
+    uint8_t md[SHA_DIGEST_LENGTH];
+    video_rasterize();
+    SHA1(video_current_framebuffer(), SCANWIDTH*SCANHEIGHT, md);
+    int i = 0;
+    for (int j = 0; j < SHA_DIGEST_LENGTH; j++, i += 2) {
+        sprintf(buf+i, "%02X", md[j]);
+    }
+    buf[i] = '\0';
+}
+
+static const char *_batch_checkExit(batch_job_t *job, unsigned long frame) {
+    if ((job->exit_pc >= 0) && (cpu65_pc == job->exit_pc)) {
+        return "pc";
+    }
+    if ((job->exit_addr >= 0) && (memcmp(apple_ii_64k[0]+job->exit_addr, job->exit_bytes, job->exit_len) == 0)) {
+        return "mem";
+    }
+    if (job->exit_sha && ((frame % BATCH_SHA_FRAMES) == 0)) {
+        _batch_framebufferSHA(job->sha);
+        if (strcmp(job->sha, job->exit_sha) == 0) {
+            return "sha";
+        }
+    }
+    return NULL;
+}
+
+// The breakpoints are shared by all the machines : every job halts at the exit_pc of the others too, and carries on
+// running the frame when the PC is not its own
+static bool _batch_armExitPCs(void) {
+#ifdef DEBUGGER
+    extern int num_buffer_lines;
+    c_debugger_clear_haltpoints();
+    for (unsigned int i = 0; i < job_count; i++) {
+        const long pc = jobs[i].exit_pc;
+        if ((pc < 0) || ((halt_armed & HALT_EXEC) && HALT_MAP_TEST(halt_exec_map, pc))) {
+            continue;
+        }
+        const bool armed = c_debugger_set_breakpoint((uint16_t)pc);
+        num_buffer_lines = 0; // no debugger console to show the breakpoint listing
+        if (!armed) {
+            ERRLOG("Job %s : more than %d distinct exit_pc in the manifest", jobs[i].name, MAX_BRKPTS);
+            return false;
+        }
+    }
+    is_debugging = (halt_armed != 0);
+#else
+    for (unsigned int i = 0; i < job_count; i++) {
+        if (jobs[i].exit_pc >= 0) {
+            ERRLOG("Job %s : exit_pc requires the debugger (built with --disable-debugger)", jobs[i].name);
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+static void _batch_runJob(batch_job_t *job) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+#if MACHINE_CONTEXT
+    pthread_mutex_lock(&machine_mutex);
+    machine_t *machine = machine_create();
+    pthread_mutex_unlock(&machine_mutex);
+    if (!machine) {
+        job->status = BATCH_ERROR;
+        job->error = "could not create machine";
+        return;
+    }
+    machine_t *prev = machine_select(machine);
+#else
+    // power on the default machine, as machine_create() does a new one
+    emul_reinitialize = 0;
+    timing_reinitializeMachine();
+#endif
+
+    char *dir = NULL;
+    char *image = NULL;
+    do {
+        if (job->disk) {
+            if (!_batch_copyImage(job->disk, &dir, &image)) {
+                job->status = BATCH_ERROR;
+                job->error = "could not copy disk image";
+                break;
+            }
+            const char *err = disk6_insert(0, image, job->readonly);
+            if (err) {
+                job->status = BATCH_ERROR;
+                job->error = err;
+                break;
+            }
+        }
+
+        if (job->replay) {
+            if (!replay_startPlayback(job->replay)) {
+                job->status = BATCH_ERROR;
+                job->error = "could not load input recording";
+                break;
+            }
+            // the recording starts at power on, with the disk already inserted
+            pthread_mutex_lock(&machine_mutex);
+            timing_reinitializeMachine();
+            pthread_mutex_unlock(&machine_mutex);
+        }
+
+        cpu65_interrupt(ResetSig);
+        timing_setProfile(job->profile);
+
+        struct timespec run0, run1;
+        clock_gettime(CLOCK_MONOTONIC, &run0);
+
+        const size_t keys_len = job->keys ? strlen(job->keys) : 0;
+        size_t typed = 0;
+        unsigned long frame = 0;
+        while (cycles_count_total < job->cycles) {
+            if ((typed < keys_len) && (cycles_count_total >= job->keys_at) &&
+                !((apple_ii_64k[0][0xC000] | apple_ii_64k[1][0xC000]) & 0x80))
+            {
+                uint8_t ch = (uint8_t)job->keys[typed++];
+                if (ch == '\n') {
+                    ch = '\r';
+                }
+                apple_ii_64k[0][0xC000] = ch | 0x80;
+                apple_ii_64k[1][0xC000] = ch | 0x80;
+            }
+
+            timing_runHeadless(BATCH_FRAME_CYCLES); // returns early on an exit_pc
+            ++frame;
+
+            if ((job->condition = _batch_checkExit(job, frame))) {
+                break;
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &run1);
+        bool negative = false;
+        struct timespec dt = timespec_diff(run0, run1, &negative);
+        job->run_nsecs = negative ? 0 : (dt.tv_sec * NANOSECONDS_PER_SECOND) + dt.tv_nsec;
+
+        if (job->condition) {
+            job->status = BATCH_EXIT;
+        } else if ((job->exit_pc >= 0) || (job->exit_addr >= 0) || job->exit_sha) {
+            job->status = BATCH_TIMEOUT;
+        } else {
+            job->status = BATCH_DONE;
+        }
+    } while (0);
+
+    job->cycles_run = cycles_count_total;
+    job->pc = cpu65_pc;
+    _batch_framebufferSHA(job->sha);
+
+    replay_stopPlayback();
+    timing_setProfile(NULL);
+#if MACHINE_CONTEXT
+    machine_select(prev);
+    machine_destroy(machine);
+#else
+    disk6_eject(0);
+    disk6_eject(1);
+#endif
+    if (image) {
+        _batch_removeImage(dir, image);
+    }
+    FREE(image);
+    FREE(dir);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    bool negative = false;
+    struct timespec dt = timespec_diff(t0, t1, &negative);
+    job->msecs = (dt.tv_sec * 1000) + (dt.tv_nsec / 1000000);
+}
+
+static void *_batch_worker(void *unused) {
+    do {
+        const unsigned int i = __sync_fetch_and_add(&next_job, 1);
+        if (i >= job_count) {
+            break;
+        }
+        _batch_runJob(&jobs[i]);
+        LOG("job %s : %s (%llu cycles, %ld ms)", jobs[i].name, batch_status_names[jobs[i].status], jobs[i].cycles_run, jobs[i].msecs);
+    } while (1);
+
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Results
+
+static void _batch_writeString(FILE *fp, const char *str) {
+    if (!str) {
+        fprintf(fp, "null");
+        return;
+    }
+    fputc('"', fp);
+    for (; *str; str++) {
+        const unsigned char ch = (unsigned char)*str;
+        if ((ch == '"') || (ch == '\\')) {
+            fprintf(fp, "\\%c", ch);
+        } else if (ch < 0x20) {
+            fprintf(fp, "\\u%04x", ch);
+        } else {
+            fputc(ch, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static void _batch_writeResults(FILE *fp) {
+    fprintf(fp, "[\n");
+    for (unsigned int i = 0; i < job_count; i++) {
+        const batch_job_t *job = &jobs[i];
+        fprintf(fp, "    { \"name\" : ");
+        _batch_writeString(fp, job->name);
+        fprintf(fp, ", \"status\" : \"%s\", \"condition\" : ", batch_status_names[job->status]);
+        _batch_writeString(fp, job->condition);
+        fprintf(fp, ", \"cycles\" : %llu, \"pc\" : \"0x%04X\", \"sha\" : \"%s\", \"msecs\" : %ld, \"error\" : ",
+                job->cycles_run, job->pc, job->sha, job->msecs);
+        _batch_writeString(fp, job->error);
+        fprintf(fp, " }%s\n", (i+1 < job_count) ? "," : "");
+    }
+    fprintf(fp, "]\n");
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark
+
+typedef struct batch_mix_t {
+    const char *mnemonic;
+    unsigned long long count;
+} batch_mix_t;
+
+typedef struct batch_benchmark_t {
+    double secs;
+    double mhz;                     // emulated clock rate ...
+    double realtime;                // ... as a multiple of the Apple //e clock
+    unsigned long long instructions;
+    double mips;
+    double nsecs_per_instruction;   // host time in cpu65_run() per instruction
+    unsigned long long harness_nsecs;
+    batch_mix_t mix[256];           // instructions per mnemonic, most executed first
+    unsigned int mix_count;
+} batch_benchmark_t;
+
+static int _batch_mixCompare(const void *a, const void *b) {
+    const unsigned long long ca = ((const batch_mix_t *)a)->count;
+    const unsigned long long cb = ((const batch_mix_t *)b)->count;
+    return (ca < cb) ? 1 : (ca > cb) ? -1 : 0;
+}
+
+static void _batch_benchmark(const batch_job_t *job, batch_benchmark_t *bench) {
+    const timing_profile_t *profile = job->profile;
+    memset(bench, 0x0, sizeof(*bench));
+
+    for (unsigned int op = 0; op < 256; op++) {
+        const unsigned long long count = profile->opcodes[op];
+        if (!count) {
+            continue;
+        }
+        bench->instructions += count;
+        unsigned int i = 0;
+        while ((i < bench->mix_count) && strcmp(bench->mix[i].mnemonic, opcodes_65c02[op].mnemonic)) {
+            ++i;
+        }
+        if (i == bench->mix_count) {
+            bench->mix[bench->mix_count++].mnemonic = opcodes_65c02[op].mnemonic;
+        }
+        bench->mix[i].count += count;
+    }
+    qsort(bench->mix, bench->mix_count, sizeof(batch_mix_t), _batch_mixCompare);
+
+    bench->secs = job->run_nsecs / (double)NANOSECONDS_PER_SECOND;
+    if (bench->secs > 0) {
+        bench->mhz = job->cycles_run / bench->secs / 1000000.0;
+        bench->realtime = job->cycles_run / bench->secs / CLK_6502;
+        bench->mips = bench->instructions / bench->secs / 1000000.0;
+    }
+    if (bench->instructions) {
+        bench->nsecs_per_instruction = profile->cpu_nsecs / (double)bench->instructions;
+    }
+    unsigned long long profiled = profile->cpu_nsecs + profile->events_nsecs + profile->idle_nsecs;
+    for (unsigned int i = 0; i < NUM_TIMING_DEVICES; i++) {
+        profiled += profile->device_nsecs[i];
+    }
+    bench->harness_nsecs = (job->run_nsecs > profiled) ? job->run_nsecs - profiled : 0;
+}
+
+static void _batch_printBenchmark(FILE *fp, const batch_job_t *job, const batch_benchmark_t *bench) {
+    const timing_profile_t *profile = job->profile;
+    const double run_nsecs = job->run_nsecs ? (double)job->run_nsecs : 1.0;
+#define PERCENT(n) (100.0 * (n) / run_nsecs)
+
+    fprintf(fp, "benchmark    : %s (%s)\n", job->disk, batch_status_names[job->status]);
+    fprintf(fp, "cycles       : %llu (%llu skipped in idle loops)\n", job->cycles_run, profile->idle_cycles);
+    fprintf(fp, "time         : %.3f secs\n", bench->secs);
+    fprintf(fp, "emulated     : %.2f MHz (%.1fx realtime)\n", bench->mhz, bench->realtime);
+#if CPU_C_CORE
+    fprintf(fp, "instructions : %llu (%.2f MIPS, %.2f ns/instruction)\n",
+            bench->instructions, bench->mips, bench->nsecs_per_instruction);
+#endif
+    fprintf(fp, "host time    : cpu %.1f%%, events %.1f%%, idle %.1f%%, disk %.1f%%, video %.1f%%, speaker %.1f%%, "
+            "harness %.1f%% (%llu runs)\n",
+            PERCENT(profile->cpu_nsecs), PERCENT(profile->events_nsecs), PERCENT(profile->idle_nsecs),
+            PERCENT(profile->device_nsecs[TIMING_DEVICE_DISK]), PERCENT(profile->device_nsecs[TIMING_DEVICE_VIDEO]),
+            PERCENT(profile->device_nsecs[TIMING_DEVICE_SPEAKER]), PERCENT(bench->harness_nsecs), profile->runs);
+#undef PERCENT
+
+#if CPU_C_CORE
+    fprintf(fp, "instruction mix :\n");
+    const double instructions = bench->instructions ? (double)bench->instructions : 1.0;
+    for (unsigned int i = 0; (i < bench->mix_count) && (i < BATCH_MIX_TOP); i++) {
+        fprintf(fp, "    %-4s %6.2f%%\n", bench->mix[i].mnemonic, 100.0 * bench->mix[i].count / instructions);
+    }
+#else
+    fprintf(fp, "instruction mix : not counted by the assembly CPU core\n");
+#endif
+}
+
+static void _batch_writeBenchmark(FILE *fp, const batch_job_t *job, const batch_benchmark_t *bench) {
+    const timing_profile_t *profile = job->profile;
+    fprintf(fp, "{\n    \"disk\" : ");
+    _batch_writeString(fp, job->disk);
+    fprintf(fp, ", \"status\" : \"%s\", \"error\" : ", batch_status_names[job->status]);
+    _batch_writeString(fp, job->error);
+    fprintf(fp, ",\n    \"cycles\" : %llu, \"idle_cycles\" : %llu, \"run_nsecs\" : %llu,\n",
+            job->cycles_run, profile->idle_cycles, job->run_nsecs);
+    fprintf(fp, "    \"mhz\" : %.3f, \"realtime\" : %.3f,\n", bench->mhz, bench->realtime);
+    fprintf(fp, "    \"cpu_nsecs\" : %llu, \"events_nsecs\" : %llu, \"idle_nsecs\" : %llu, \"disk_nsecs\" : %llu, "
+            "\"video_nsecs\" : %llu, \"speaker_nsecs\" : %llu, \"harness_nsecs\" : %llu, \"runs\" : %llu",
+            profile->cpu_nsecs, profile->events_nsecs, profile->idle_nsecs,
+            profile->device_nsecs[TIMING_DEVICE_DISK], profile->device_nsecs[TIMING_DEVICE_VIDEO],
+            profile->device_nsecs[TIMING_DEVICE_SPEAKER], bench->harness_nsecs, profile->runs);
+#if CPU_C_CORE
+    fprintf(fp, ",\n    \"instructions\" : %llu, \"mips\" : %.3f, \"nsecs_per_instruction\" : %.3f,\n",
+            bench->instructions, bench->mips, bench->nsecs_per_instruction);
+    fprintf(fp, "    \"opcodes\" : [");
+    for (unsigned int op = 0; op < 256; op++) {
+        fprintf(fp, "%s%s%llu", op ? "," : "", (op % 16) ? " " : "\n        ", profile->opcodes[op]);
+    }
+    fprintf(fp, "\n    ]");
+#endif
+    fprintf(fp, "\n}\n");
+}
+
+static int _batch_runBenchmark(const char *disk, unsigned long long cycles, const char *results_path) {
+    job_count = 1;
+    jobs = calloc(1, sizeof(batch_job_t));
+    batch_job_t *job = &jobs[0];
+    job->name = strdup("benchmark");
+    job->disk = strdup(disk);
+    job->cycles = cycles;
+    job->exit_pc = -1;
+    job->exit_addr = -1;
+    job->profile = calloc(1, sizeof(timing_profile_t));
+
+    _batch_runJob(job);
+    if (job->status == BATCH_ERROR) {
+        ERRLOG("Benchmark of %s failed : %s", disk, job->error);
+        return 2;
+    }
+
+    batch_benchmark_t bench;
+    _batch_benchmark(job, &bench);
+    _batch_printBenchmark(stdout, job, &bench);
+
+    if (results_path) {
+        FILE *fp = TEMP_FAILURE_RETRY_FOPEN(fopen(results_path, "w"));
+        if (!fp) {
+            ERRLOG("Could not open %s", results_path);
+            return 2;
+        }
+        _batch_writeBenchmark(fp, job, &bench);
+        fclose(fp);
+    }
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+static void _batch_usage(const char *name) {
+    fprintf(stderr, "usage: %s [-j workers] [-o results.json] [-v] manifest.json\n", name);
+    fprintf(stderr, "       %s --benchmark [--cycles N] [-o benchmark.json] [-v] disk-image\n", name);
+}
+
+int main(int _argc, char **_argv) {
+    argc = _argc;
+    argv = _argv;
+
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *results_path = NULL;
+    bool benchmark = false;
+    unsigned long long benchmark_cycles = BATCH_BENCHMARK_CYCLES;
+    do_logging = false;
+
+    static const struct option long_options[] = {
+        { "benchmark", no_argument, NULL, 'b' },
+        { "cycles", required_argument, NULL, 'c' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "bc:j:o:v", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'b':
+                benchmark = true;
+                break;
+            case 'c':
+                benchmark_cycles = strtoull(optarg, NULL, /*base:*/0);
+                break;
+            case 'j':
+                workers = strtol(optarg, NULL, /*base:*/10);
+                break;
+            case 'o':
+                results_path = optarg;
+                break;
+            case 'v':
+                do_logging = true;
+                break;
+            default:
+                _batch_usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind != argc-1) {
+        _batch_usage(argv[0]);
+        return 2;
+    }
+    if (workers < 1) {
+        workers = 1;
+    }
+
+    if (benchmark) {
+        if (!benchmark_cycles) {
+            _batch_usage(argv[0]);
+            return 2;
+        }
+        return _batch_runBenchmark(argv[optind], benchmark_cycles, results_path);
+    }
+
+    if (!_batch_loadManifest(argv[optind])) {
+        ERRLOG("Could not load manifest %s", argv[optind]);
+        return 2;
+    }
+    if (!_batch_armExitPCs()) {
+        return 2;
+    }
+    if (workers > job_count) {
+        workers = job_count ? job_count : 1;
+    }
+#if !MACHINE_CONTEXT
+    workers = 1; // jobs take turns on the default machine
+#endif
+
+    pthread_t *threads = calloc(workers, sizeof(pthread_t));
+    for (long i = 0; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, _batch_worker, NULL)) {
+            ERRLOG("OOPS, pthread_create failed");
+            return 2;
+        }
+    }
+    for (long i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    FREE(threads);
+
+    FILE *fp = stdout;
+    if (results_path) {
+        fp = TEMP_FAILURE_RETRY_FOPEN(fopen(results_path, "w"));
+        if (!fp) {
+            ERRLOG("Could not open %s", results_path);
+            return 2;
+        }
+    }
+    _batch_writeResults(fp);
+    if (fp != stdout) {
+        fclose(fp);
+    }
+
+    int status = 0;
+    for (unsigned int i = 0; i < job_count; i++) {
+        if ((jobs[i].status == BATCH_TIMEOUT) || (jobs[i].status == BATCH_ERROR)) {
+            status = 1;
+        }
+    }
+    return status;
+}
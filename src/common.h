@@ -77,6 +77,10 @@
 #include "glue.h"
 #include "prefs.h"
 #include "zlib-helpers.h"
+#include "replay.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "machine.h"
 
 #include "meta/trace.h"
 
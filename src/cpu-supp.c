@@ -21,7 +21,9 @@
 #endif
 
 #include "common.h"
+#include <sys/mman.h>
 
+#if !MACHINE_CONTEXT // see machine.h
 uint16_t cpu65_pc;
 uint8_t  cpu65_a;
 uint8_t  cpu65_f;
@@ -34,24 +36,36 @@ uint8_t  cpu65_d;
 uint8_t  cpu65_rw;
 uint8_t  cpu65_opcode;
 uint8_t  cpu65_opcycles;
+uint16_t cpu65_io_pc;
 
 uint8_t cpu65__signal = 0;
+unsigned long long *cpu65_opcode_counts = NULL;
+#endif
 
 static pthread_mutex_t irq_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 uint8_t cpu65_flags_encode[256] = { 0 };
 uint8_t cpu65_flags_decode[256] = { 0 };
 
+#if !MACHINE_CONTEXT
 void *cpu65_vmem_r[0x10000] = { 0 };
 void *cpu65_vmem_w[0x10000] = { 0 };
 
+uint8_t **cpu65_vmem_rpage[0x100] = { 0 };
+uint8_t **cpu65_vmem_wpage[0x100] = { 0 };
+#endif
+
 #if CPU_TRACING
 static int8_t opargs[3] = { 0 };
 static int8_t nargs = 0;
 static uint16_t current_pc = 0x0;
-static FILE *cpu_trace_fp = NULL;
+static int cpu_trace_fd = -1;
+static cpu65_trace_header_t *cpu_trace_header = NULL;
+static cpu65_trace_record_t *cpu_trace_ring = NULL;
+static size_t cpu_trace_len = 0;
 #endif
 
+#if !CPU_C_CORE
 // ----------------------------------------------------------------------------
 // 65c02 Opcode Jump Table
 
@@ -316,6 +330,11 @@ void *const cpu65__opcodes[256] = {
     op_BBS7_65c02
 };
 
+void cpu65_invalidate_blocks(void) {
+    // assembly cores do not cache decoded blocks
+}
+#endif // !CPU_C_CORE
+
 // ----------------------------------------------------------------------------
 // Base values for opcode cycle counts
 
@@ -651,12 +670,11 @@ void cpu65_reboot(void) {
     timing_initialize();
     video_reset();
     joy_button0 = 0xff; // OpenApple
-    cpu65_interrupt(ResetSig);
+    replay_hostReset();
 }
 
 bool cpu65_saveState(StateHelper_s *helper) {
     bool saved = false;
-    int fd = helper->fd;
 
     do {
         uint8_t serialized[4] = { 0 };
@@ -664,35 +682,35 @@ bool cpu65_saveState(StateHelper_s *helper) {
         // save CPU state
         serialized[0] = ((cpu65_pc & 0xFF00) >> 8);
         serialized[1] = ((cpu65_pc & 0xFF  ) >> 0);
-        if (!helper->save(fd, serialized, sizeof(cpu65_pc))) {
+        if (!helper->save(helper, serialized, sizeof(cpu65_pc))) {
             break;
         }
         LOG("SAVE cpu65_pc = %04x", cpu65_pc);
 
         serialized[0] = ((cpu65_ea & 0xFF00) >> 8);
         serialized[1] = ((cpu65_ea & 0xFF  ) >> 0);
-        if (!helper->save(fd, serialized, sizeof(cpu65_ea))) {
+        if (!helper->save(helper, serialized, sizeof(cpu65_ea))) {
             break;
         }
         LOG("SAVE cpu65_ea = %04x", cpu65_ea);
 
-        if (!helper->save(fd, &cpu65_a, sizeof(cpu65_a))) {
+        if (!helper->save(helper, &cpu65_a, sizeof(cpu65_a))) {
             break;
         }
         LOG("SAVE cpu65_a = %02x", cpu65_a);
-        if (!helper->save(fd, &cpu65_f, sizeof(cpu65_f))) {
+        if (!helper->save(helper, &cpu65_f, sizeof(cpu65_f))) {
             break;
         }
         LOG("SAVE cpu65_f = %02x", cpu65_f);
-        if (!helper->save(fd, &cpu65_x, sizeof(cpu65_x))) {
+        if (!helper->save(helper, &cpu65_x, sizeof(cpu65_x))) {
             break;
         }
         LOG("SAVE cpu65_x = %02x", cpu65_x);
-        if (!helper->save(fd, &cpu65_y, sizeof(cpu65_y))) {
+        if (!helper->save(helper, &cpu65_y, sizeof(cpu65_y))) {
             break;
         }
         LOG("SAVE cpu65_y = %02x", cpu65_y);
-        if (!helper->save(fd, &cpu65_sp, sizeof(cpu65_sp))) {
+        if (!helper->save(helper, &cpu65_sp, sizeof(cpu65_sp))) {
             break;
         }
         LOG("SAVE cpu65_sp = %02x", cpu65_sp);
@@ -705,44 +723,43 @@ bool cpu65_saveState(StateHelper_s *helper) {
 
 bool cpu65_loadState(StateHelper_s *helper) {
     bool loaded = false;
-    int fd = helper->fd;
 
     do {
 
         uint8_t serialized[4] = { 0 };
 
         // load CPU state
-        if (!helper->load(fd, serialized, sizeof(uint16_t))) {
+        if (!helper->load(helper, serialized, sizeof(uint16_t))) {
             break;
         }
         cpu65_pc  = (serialized[0] << 8);
         cpu65_pc |=  serialized[1];
         LOG("LOAD cpu65_pc = %04x", cpu65_pc);
 
-        if (!helper->load(fd, serialized, sizeof(uint16_t))) {
+        if (!helper->load(helper, serialized, sizeof(uint16_t))) {
             break;
         }
         cpu65_ea  = (serialized[0] << 8);
         cpu65_ea |=  serialized[1];
         LOG("LOAD cpu65_ea = %04x", cpu65_ea);
 
-        if (!helper->load(fd, &cpu65_a, sizeof(cpu65_a))) {
+        if (!helper->load(helper, &cpu65_a, sizeof(cpu65_a))) {
             break;
         }
         LOG("LOAD cpu65_a = %02x", cpu65_a);
-        if (!helper->load(fd, &cpu65_f, sizeof(cpu65_f))) {
+        if (!helper->load(helper, &cpu65_f, sizeof(cpu65_f))) {
             break;
         }
         LOG("LOAD cpu65_f = %02x", cpu65_f);
-        if (!helper->load(fd, &cpu65_x, sizeof(cpu65_x))) {
+        if (!helper->load(helper, &cpu65_x, sizeof(cpu65_x))) {
             break;
         }
         LOG("LOAD cpu65_x = %02x", cpu65_x);
-        if (!helper->load(fd, &cpu65_y, sizeof(cpu65_y))) {
+        if (!helper->load(helper, &cpu65_y, sizeof(cpu65_y))) {
             break;
         }
         LOG("LOAD cpu65_y = %02x", cpu65_y);
-        if (!helper->load(fd, &cpu65_sp, sizeof(cpu65_sp))) {
+        if (!helper->load(helper, &cpu65_sp, sizeof(cpu65_sp))) {
             break;
         }
         LOG("LOAD cpu65_sp = %02x", cpu65_sp);
@@ -759,28 +776,76 @@ bool cpu65_loadState(StateHelper_s *helper) {
     CPU Tracing routines
    ------------------------------------------------------------------------- */
 
-void cpu65_trace_begin(const char *trace_file) {
-    if (trace_file) {
-        cpu_trace_fp = fopen(trace_file, "w");
+void cpu65_trace_begin(const char *trace_file, unsigned long records) {
+    if (!trace_file) {
+        return;
+    }
+    if (!records) {
+        records = CPU_TRACE_DEFAULT_RECORDS;
+    }
+
+    do {
+        TEMP_FAILURE_RETRY(cpu_trace_fd = open(trace_file, O_RDWR|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR));
+        if (cpu_trace_fd < 0) {
+            ERRLOG("OOPS, could not open CPU trace file %s", trace_file);
+            break;
+        }
+
+        cpu_trace_len = sizeof(cpu65_trace_header_t) + (records * sizeof(cpu65_trace_record_t));
+        if (ftruncate(cpu_trace_fd, cpu_trace_len)) {
+            ERRLOG("OOPS, could not size CPU trace file %s", trace_file);
+            break;
+        }
+
+        // shared mapping : the kernel writes the ring back to the file even if the emulator dies
+        void *map = mmap(NULL, cpu_trace_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FILE, cpu_trace_fd, /*offset:*/0);
+        if (map == MAP_FAILED) {
+            ERRLOG("OOPS, could not mmap CPU trace file %s", trace_file);
+            break;
+        }
+
+        cpu_trace_header = (cpu65_trace_header_t *)map;
+        cpu_trace_ring = (cpu65_trace_record_t *)(cpu_trace_header+1);
+        memcpy(cpu_trace_header->magic, CPU_TRACE_MAGIC, sizeof(cpu_trace_header->magic));
+        cpu_trace_header->version = CPU_TRACE_VERSION;
+        cpu_trace_header->record_size = sizeof(cpu65_trace_record_t);
+        cpu_trace_header->capacity = records;
+        cpu_trace_header->count = 0;
+    } while (0);
+
+    if (!cpu_trace_header && (cpu_trace_fd >= 0)) {
+        TEMP_FAILURE_RETRY(close(cpu_trace_fd));
+        cpu_trace_fd = -1;
     }
 }
 
 void cpu65_trace_end(void) {
-    if (cpu_trace_fp) {
-        fflush(cpu_trace_fp);
-        fclose(cpu_trace_fp);
-        cpu_trace_fp = NULL;
+    if (cpu_trace_header) {
+        TEMP_FAILURE_RETRY(munmap(cpu_trace_header, cpu_trace_len));
+        TEMP_FAILURE_RETRY(close(cpu_trace_fd));
+        cpu_trace_header = NULL;
+        cpu_trace_ring = NULL;
+        cpu_trace_fd = -1;
     }
 }
 
+bool cpu65_trace_is_enabled(void) {
+    return cpu_trace_header != NULL;
+}
+
 void cpu65_trace_toggle(const char *trace_file) {
-    if (cpu_trace_fp) {
+    if (cpu_trace_header) {
         cpu65_trace_end();
     } else {
-        cpu65_trace_begin(trace_file);
+        cpu65_trace_begin(trace_file, 0);
     }
 }
 
+static inline cpu65_trace_record_t *_trace_next_record(void) {
+    const uint64_t count = cpu_trace_header->count++;
+    return &cpu_trace_ring[count % cpu_trace_header->capacity];
+}
+
 GLUE_C_WRITE(cpu65_trace_prologue)
 {
     nargs = 0;
@@ -809,10 +874,7 @@ GLUE_C_WRITE(cpu65_trace_arg2)
 
 GLUE_C_WRITE(cpu65_trace_epilogue)
 {
-    int8_t arg1 = opargs[1];
-    int8_t arg2 = opargs[2];
-
-    if (!cpu_trace_fp) {
+    if (!cpu_trace_header) {
         return;
     }
 
@@ -822,109 +884,26 @@ GLUE_C_WRITE(cpu65_trace_epilogue)
         assert(false && "OOPS, most likely some cpu.S routine is not properly setting the arg value");
     }
 
-    switch (opcodes_65c02[cpu65_opcode].mode) {
-        case addr_implied:
-        case addr_accumulator:
-            fprintf(cpu_trace_fp, "%04X:%02X    ", current_pc, cpu65_opcode);
-            break;
-        case addr_immediate:
-        case addr_zeropage:
-        case addr_zeropage_x:
-        case addr_zeropage_y:
-        case addr_indirect:
-        case addr_indirect_x:
-        case addr_indirect_y:
-        case addr_relative:
-            fprintf(cpu_trace_fp, "%04X:%02X%02X  ", current_pc, cpu65_opcode, (uint8_t)arg1);
-            break;
-        case addr_absolute:
-        case addr_absolute_x:
-        case addr_absolute_y:
-        case addr_j_indirect:
-        case addr_j_indirect_x:
-            fprintf(cpu_trace_fp, "%04X:%02X%02X%02X", current_pc, cpu65_opcode, (uint8_t)arg2, (uint8_t)arg1);
-            break;
-        default:
-            fprintf(cpu_trace_fp, "invalid opcode mode");
-            break;
-    }
-
-    fprintf(cpu_trace_fp, " SP:%02X X:%02X Y:%02X A:%02X", cpu65_sp, cpu65_x, cpu65_y, cpu65_a);
-
-#define FLAGS_BUFSZ 9
-    char flags_buf[FLAGS_BUFSZ];
-    memset(flags_buf, '-', FLAGS_BUFSZ);
-    if (cpu65_f & C_Flag_6502) {
-        flags_buf[0]='C';
-    }
-    if (cpu65_f & X_Flag_6502) {
-        flags_buf[1]='X';
-    }
-    if (cpu65_f & I_Flag_6502) {
-        flags_buf[2]='I';
-    }
-    if (cpu65_f & V_Flag_6502) {
-        flags_buf[3]='V';
-    }
-    if (cpu65_f & B_Flag_6502) {
-        flags_buf[4]='B';
-    }
-    if (cpu65_f & D_Flag_6502) {
-        flags_buf[5]='D';
-    }
-    if (cpu65_f & Z_Flag_6502) {
-        flags_buf[6]='Z';
-    }
-    if (cpu65_f & N_Flag_6502) {
-        flags_buf[7]='N';
-    }
-    flags_buf[8] = '\0';
-
-    fprintf(cpu_trace_fp, " %s CYC:%u EA:%04X", flags_buf, cpu65_opcycles, cpu65_ea);
-
-    char fmt[64];
-    sprintf(fmt, " %s %s", opcodes_65c02[cpu65_opcode].mnemonic, disasm_templates[opcodes_65c02[cpu65_opcode].mode]);
-
-    switch (opcodes_65c02[cpu65_opcode].mode) {
-        case addr_implied:
-        case addr_accumulator:
-            fprintf(cpu_trace_fp, "%s", fmt);
-            break;
-        case addr_immediate:
-        case addr_zeropage:
-        case addr_zeropage_x:
-        case addr_zeropage_y:
-        case addr_indirect:
-        case addr_indirect_x:
-        case addr_indirect_y:
-            fprintf(cpu_trace_fp, fmt, (uint8_t)arg1);
-            break;
-        case addr_absolute:
-        case addr_absolute_x:
-        case addr_absolute_y:
-        case addr_j_indirect:
-        case addr_j_indirect_x:
-            fprintf(cpu_trace_fp, fmt, (uint8_t)arg1, (uint8_t)arg2);
-            break;
-        case addr_relative:
-            if (arg1 < 0) {
-                fprintf(cpu_trace_fp, fmt, current_pc + arg1 + 2, '-', (uint8_t)(-arg1));
-            } else {
-                fprintf(cpu_trace_fp, fmt, current_pc + arg1 + 2, '+', (uint8_t)arg1);
-            }
-            break;
-        default:
-            break;
-    }
-
-    fprintf(cpu_trace_fp, "%s", "\n");
-    fflush(cpu_trace_fp);
+    cpu65_trace_record_t *rec = _trace_next_record();
+    rec->insn.kind = CPU_TRACE_INSN;
+    rec->insn.opcode = cpu65_opcode;
+    rec->insn.pc = current_pc;
+    rec->insn.ea = cpu65_ea;
+    rec->insn.arg1 = (uint8_t)opargs[1];
+    rec->insn.arg2 = (uint8_t)opargs[2];
+    rec->insn.a = cpu65_a;
+    rec->insn.x = cpu65_x;
+    rec->insn.y = cpu65_y;
+    rec->insn.sp = cpu65_sp;
+    rec->insn.f = cpu65_f;
+    rec->insn.cycles = cpu65_opcycles;
 }
 
 void cpu65_trace_checkpoint(void) {
-    if (cpu_trace_fp) {
-        fprintf(cpu_trace_fp, "---TOTAL CYC:%lu\n",cycles_count_total);
-        fflush(cpu_trace_fp);
+    if (cpu_trace_header) {
+        cpu65_trace_record_t *rec = _trace_next_record();
+        rec->checkpoint.kind = CPU_TRACE_CHECKPOINT;
+        rec->checkpoint.cycles_total = cycles_count_total;
     }
 }
 
@@ -0,0 +1,3133 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+/*
+ * Portable 65c02 CPU core.
+ *
+ * This is a C rendition of the x86 assembly core (src/x86/cpu.S) for architectures that lack an assembly core (or
+ * when configured with --enable-c-cpu).  It shares the cpu65_* registers, cpu65_vmem_* tables, cycle tables and
+ * softswitch glue with the rest of the emulator.  Opcodes are dispatched with computed gotos ("labels as values"
+ * GCC/Clang extension) and each opcode handler is threaded directly into the next.
+ *
+ * NOTE : host flags (C_Flag, etc) are in 6502 bit order when CPU_C_CORE is enabled
+ */
+
+#include "common.h"
+
+#if CPU_C_CORE
+
+#if CPU_JIT
+#include "x86/jit.h"
+#endif
+
+extern uint8_t cpu65__opcycles[256];
+
+extern uint8_t debug_illegal_bcd(uint16_t ea);
+
+typedef uint8_t (*VMemRead)(uint16_t ea);
+typedef void (*VMemWrite)(uint16_t ea, uint8_t b);
+
+#if CPU_TRACING
+extern void c_cpu65_trace_prologue(uint16_t ea, uint8_t b);
+extern void c_cpu65_trace_arg(uint16_t ea, uint8_t b);
+extern void c_cpu65_trace_arg1(uint16_t ea, uint8_t b);
+extern void c_cpu65_trace_arg2(uint16_t ea, uint8_t b);
+extern void c_cpu65_trace_epilogue(uint16_t ea, uint8_t b);
+#endif
+
+/* -------------------------------------------------------------------------
+    Basic-block cache
+
+    Straight-line runs of instructions are decoded once (opcode, operands, base cycles) and replayed without fetching
+    them through the vmem tables again.  Cycles are accounted once at the end of the block, or just before an I/O
+    access so that softswitch/peripheral handlers still see exact cycle counts (the block ends after such an access).
+
+    Blocks are keyed by PC and the bank backing the PC page, so softswitch bank changes select different blocks.
+    Writes to a page holding decoded blocks invalidate all blocks decoded from that page.  Code that writes to
+    emulated memory without going through the CPU must call cpu65_invalidate_blocks().
+
+    With CPU_JIT, blocks executed JIT_HOT_THRESHOLD times are compiled to native code (src/x86/jit.c).  Pages that
+    keep being rewritten by the emulated program (self-modifying code) are left to the interpreter.
+   ------------------------------------------------------------------------- */
+
+#define BLOCK_HASH(pc) (((pc) ^ ((pc) >> 12)) & (BLOCK_CACHE_SIZE-1))
+
+#define FETCH_NONE  0x0
+#define FETCH_IMM   0x1
+#define FETCH_B     0x2
+#define FETCH_W     0x3
+#define FETCH_MASK  0x3
+#define BLOCK_END   0x4 // instruction changes PC (or the interrupt disable flag) and ends a block
+
+// per-machine block cache (machine.h)
+#define blocks (current_machine->blocks)
+#define block_page_gen (current_machine->block_page_gen)
+#define block_pages (current_machine->block_pages)
+
+#if CPU_JIT
+#define JIT_HOT_THRESHOLD 16
+#define JIT_SMC_LIMIT 8 // invalidations by emulated writes before a page is left to the interpreter
+
+#define block_page_smc (current_machine->block_page_smc)
+#endif
+
+static const uint8_t block_opinfo[256] = {
+    FETCH_NONE|BLOCK_END,       // 00
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // 08
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // 10
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // 18
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_W|BLOCK_END,          // 20
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE|BLOCK_END,       // 28
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // 30
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // 38
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE|BLOCK_END,       // 40
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // 48
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W|BLOCK_END,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // 50
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE|BLOCK_END,       // 58
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE|BLOCK_END,       // 60
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // 68
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W|BLOCK_END,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // 70
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // 78
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W|BLOCK_END,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // 80
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // 88
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // 90
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // 98
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_IMM,                  // A0
+    FETCH_B,
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // A8
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // B0
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // B8
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_IMM,                  // C0
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // C8
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // D0
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // D8
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_IMM,                  // E0
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // E8
+    FETCH_IMM,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_B|BLOCK_END,          // F0
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_B,
+    FETCH_B,
+    FETCH_NONE,
+    FETCH_NONE,                 // F8
+    FETCH_W,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_NONE,
+    FETCH_W,
+    FETCH_W,
+    FETCH_NONE
+};
+
+static inline void _block_invalidate_page(uint8_t page) {
+    block_pages[page] = 0;
+    ++block_page_gen[page];
+}
+
+static void _block_decode(block_t *blk, uint16_t addr, uint8_t *bank, void *const bodies[256]) {
+    const uint8_t page = addr >> 8;
+    unsigned int pc = addr;
+    unsigned int count = 0;
+    unsigned int cycles = 0;
+
+    blk->pc = addr;
+    blk->bank = bank;
+    blk->gen = block_page_gen[page];
+    block_pages[page] = 1;
+#if CPU_JIT
+    blk->hits = 0;
+    blk->jit = NULL;
+#endif
+
+    while (count < BLOCK_MAX_INSNS) {
+        const uint8_t opcode = bank[pc];
+        const uint8_t fetch = block_opinfo[opcode] & FETCH_MASK;
+        const unsigned int len = (fetch == FETCH_NONE) ? 1 : (fetch == FETCH_W) ? 3 : 2;
+        if (((pc + len - 1) >> 8) != page) {
+            break; // instruction crosses into the next page
+        }
+
+        block_insn_t *insn = &blk->insns[count++];
+        insn->body = bodies[opcode];
+        insn->opcode = opcode;
+        insn->cycles = cycles;
+        insn->pc = pc + len;
+        insn->ea = (fetch == FETCH_NONE) ? pc : pc + 1;
+        insn->operand = (fetch == FETCH_NONE) ? 0 : bank[pc + 1];
+        if (fetch == FETCH_W) {
+            insn->operand |= bank[pc + 2] << 8;
+        }
+
+        cycles += cpu65__opcycles[opcode];
+        pc += len;
+
+        if (block_opinfo[opcode] & BLOCK_END) {
+            break;
+        }
+    }
+
+    blk->count = count;
+    blk->insns[count].cycles = cycles;
+    blk->max_cycles = cycles + (2 * count);
+}
+
+#if CPU_JIT
+static void *_block_compile(block_t *blk) {
+    if (block_page_smc[blk->pc >> 8] >= JIT_SMC_LIMIT) {
+        return NULL;
+    }
+    if (!jit65_init(block_pages)) {
+        return NULL;
+    }
+
+    bool full = false;
+    void *code = jit65_compile(blk->pc, blk->bank, blk->count, &full);
+    if (full) {
+        for (unsigned int i = 0; i < BLOCK_CACHE_SIZE; i++) {
+            blocks[i].jit = NULL;
+            blocks[i].hits = 0;
+        }
+        jit65_flush();
+        code = jit65_compile(blk->pc, blk->bank, blk->count, &full);
+    }
+    return code;
+}
+#endif
+
+/* -------------------------------------------------------------------------
+    CPU (6502) Helper Routines
+   ------------------------------------------------------------------------- */
+
+#define CommonSaveCPUState() \
+    cpu65_ea = ea; \
+    cpu65_a = a; \
+    cpu65_f = cpu65_flags_encode[f]; \
+    cpu65_x = x; \
+    cpu65_y = y; \
+    cpu65_sp = sp;
+
+#if CPU_TRACING
+#   define TRACE_PROLOGUE() \
+    cpu65_pc = pc; \
+    c_cpu65_trace_prologue(ea, 0);
+#   define TRACE_ARG(v)     c_cpu65_trace_arg(ea, (v));
+#   define TRACE_ARG1(v)    c_cpu65_trace_arg1(ea, (v));
+#   define TRACE_ARG2(v)    c_cpu65_trace_arg2(ea, (v));
+#   define TRACE_EPILOGUE(cycles) \
+    CommonSaveCPUState(); \
+    c_cpu65_trace_epilogue(ea, (cycles));
+#else
+#   define TRACE_PROLOGUE()
+#   define TRACE_ARG(v)
+#   define TRACE_ARG1(v)
+#   define TRACE_ARG2(v)
+#   define TRACE_EPILOGUE(cycles)
+#endif
+
+#define CommitCycles(n) \
+    cpu65_cycle_count += (n); \
+    cpu65_cycles_to_execute -= (n);
+
+/* Bring the cycle counters up to date for an I/O access from within a block, and end the block after the current
+   instruction (the access may switch banks or raise a signal) */
+#define BlockSync \
+    if (blk) { \
+        blk_cycles = ins->cycles + xcycles - committed; \
+        committed += blk_cycles; \
+        CommitCycles(blk_cycles) \
+        blk_break = true; \
+    }
+
+/* Plain RAM/ROM pages are accessed through their bank pointer, everything else calls the per-address handler */
+#define VMemRead(addr) \
+    ({ \
+        uint8_t **_bank = cpu65_vmem_rpage[(addr)>>8]; \
+        uint8_t _v; \
+        if (LIKELY(_bank != NULL)) { \
+            _v = (*_bank)[(addr)]; \
+        } else { \
+            BlockSync \
+            cpu65_io_pc = pc; \
+            _v = ((VMemRead)cpu65_vmem_r[(addr)])((addr)); \
+        } \
+        _v; \
+    })
+
+#if CPU_JIT
+#   define BlockSMC(page) \
+    if (block_page_smc[(page)] < JIT_SMC_LIMIT) { \
+        ++block_page_smc[(page)]; \
+    }
+#else
+#   define BlockSMC(page)
+#endif
+
+#define VMemWrite(addr, v) \
+    do { \
+        if (UNLIKELY(block_pages[(addr)>>8])) { \
+            _block_invalidate_page((addr)>>8); \
+            BlockSMC((addr)>>8) \
+            blk_break = true; \
+        } \
+        uint8_t **_bank = cpu65_vmem_wpage[(addr)>>8]; \
+        uint8_t *_base; \
+        if (LIKELY((_bank != NULL) && ((_base = *_bank) != NULL))) { \
+            _base[(addr)] = (v); \
+        } else { \
+            BlockSync \
+            ((VMemWrite)cpu65_vmem_w[(addr)])((addr), (v)); \
+        } \
+    } while (0)
+
+#define GetFromPC_B(v) \
+    ea = pc; \
+    ++pc; \
+    v = VMemRead(ea); \
+    TRACE_ARG(v)
+
+#define GetFromPC_W(w) \
+    ea = pc + 1; \
+    pc += 2; \
+    hi = VMemRead(ea); \
+    --ea; \
+    TRACE_ARG2(hi) \
+    b = VMemRead(ea); \
+    TRACE_ARG1(b) \
+    w = (hi << 8) | b;
+
+#define CountOpcode(op) \
+    if (UNLIKELY(opcode_counts != NULL)) { \
+        ++opcode_counts[op]; \
+    }
+
+#define JumpNextInstruction \
+    TRACE_PROLOGUE() \
+    GetFromPC_B(opcode) \
+    cpu65_opcode = opcode; \
+    CountOpcode(opcode) \
+    cpu65_opcycles = 0; \
+    cpu65_rw = 0; \
+    goto *opcodes[opcode];
+
+#define GetFromEA_B(v) \
+    cpu65_rw |= MEM_READ_FLAG; \
+    v = VMemRead(ea);
+
+#define GetFromEA_W(w) \
+    ++ea; \
+    hi = VMemRead(ea); \
+    --ea; \
+    b = VMemRead(ea); \
+    w = (hi << 8) | b;
+
+#define PutToEA_B(v) \
+    cpu65_rw |= MEM_WRITE_FLAG; \
+    cpu65_d = (v); \
+    VMemWrite(ea, (v));
+
+#define GetFromMem_B(addr, v) \
+    ea = (addr); \
+    v = VMemRead(ea);
+
+#define GetFromMem_W(addr, w) \
+    ea = (addr); \
+    GetFromEA_W(w)
+
+#define BlockDispatch \
+    opcode = ins->opcode; \
+    cpu65_opcode = opcode; \
+    CountOpcode(opcode) \
+    cpu65_opcycles = 0; \
+    cpu65_rw = 0; \
+    pc = ins->pc; \
+    ea = ins->ea; \
+    w = ins->operand; \
+    b = (uint8_t)w; \
+    goto *ins->body;
+
+/* Keep executing until we've executed >= cpu65_cycles_to_execute */
+#define Continue \
+    if (blk) { \
+        xcycles += cpu65_opcycles; \
+        ++ins; \
+        if (LIKELY(ins != blk_end && !blk_break)) { \
+            BlockDispatch \
+        } \
+        goto block_exit; \
+    } \
+    cycles = cpu65__opcycles[opcode] + cpu65_opcycles; \
+    cpu65_opcycles = cycles; \
+    TRACE_EPILOGUE(cycles) \
+    CommitCycles(cycles) \
+    if (UNLIKELY(cpu65_cycles_to_execute <= 0)) { \
+        goto exit_cpu65_run; \
+    } \
+    if (UNLIKELY(cpu65__signal)) { \
+        goto exception; \
+    } \
+    goto next_instruction;
+
+#define BranchXCycles \
+    ++cpu65_opcycles; /* +1 branch taken */ \
+    w = pc + (int8_t)b; \
+    if ((w ^ pc) & 0xFF00) { \
+        ++cpu65_opcycles; /* +1 branch new page */ \
+    } \
+    pc = w;
+
+#define FlagZ(v) \
+    f = (f & ~Z_Flag) | ((uint8_t)(v) ? 0 : Z_Flag);
+
+#define FlagNZ(v) \
+    f = (f & ~(N_Flag|Z_Flag)) | (((v) & 0x80) ? N_Flag : 0) | ((uint8_t)(v) ? 0 : Z_Flag);
+
+#define FlagNZC(v, carry) \
+    f = (f & ~(N_Flag|Z_Flag|C_Flag)) | (((v) & 0x80) ? N_Flag : 0) | ((uint8_t)(v) ? 0 : Z_Flag) | ((carry) ? C_Flag : 0);
+
+#define Push(v) \
+    base_stackzp[0x100 | sp] = (v); \
+    --sp;
+
+#define Pop(v) \
+    ++sp; \
+    v = base_stackzp[0x100 | sp];
+
+/* Operand fetch - each opcode handler is split into an operand fetch (op_*) and the instruction proper (blk_*), so
+   that decoded blocks can enter past the fetch with pc/ea/b/w already set up. */
+#if CPU_TRACING
+#define FetchOperand_Imm \
+    ea = pc; \
+    ++pc; \
+    b = VMemRead(ea); \
+    TRACE_ARG(b)
+#else
+#define FetchOperand_Imm \
+    ea = pc; \
+    ++pc;
+#endif
+
+#define FetchOperand_B \
+    GetFromPC_B(b)
+
+#define FetchOperand_W \
+    GetFromPC_W(w)
+
+/* Immediate Addressing - the operand is contained in the second byte of the
+   instruction.  (EA already points to it) */
+#define GetImm
+
+/* Absolute Addressing - the second byte of the instruction is the low
+   order address, and the third byte is the high order byte. */
+#define GetAbs \
+    ea = w;
+
+/* Zero Page Addressing - the second byte of the instruction is an
+   address on the zero page */
+#define GetZPage \
+    ea = b;
+
+/* Zero Page Indexed Addressing - The effective address is calculated by
+   adding the second byte to the contents of the index register.  Due
+   to the zero page addressing nature of this mode, no carry is added
+   to the high address byte, and the crossing of page boundaries does
+   not occur. */
+#define GetZPage_X \
+    ea = (uint8_t)(b + x);
+
+#define GetZPage_Y \
+    ea = (uint8_t)(b + y);
+
+/* Absolute Indexed Addressing - The effective address is formed by
+   adding the contents of X or Y to the address contained in the
+   second and third bytes of the instruction. */
+#define GetAbs_X \
+    if ((uint8_t)w + x > 0xFF) { \
+        ++cpu65_opcycles; /* +1 cycle on page boundary */ \
+    } \
+    ea = w + x;
+
+#define GetAbs_X_STx \
+    ea = w + x;
+
+#define GetAbs_Y \
+    if ((uint8_t)w + y > 0xFF) { \
+        ++cpu65_opcycles; /* +1 cycle on page boundary */ \
+    } \
+    ea = w + y;
+
+#define GetAbs_Y_STA \
+    ea = w + y;
+
+/* Zero Page Indirect Addressing (65c02) - The second byte of the
+   instruction points to a memory location on page zero containing the
+   low order byte of the effective address.  The next location on page
+   zero contains the high order byte of the address. */
+#define _GetIndZPage(zp) \
+    ea = (uint8_t)((zp) + 1); \
+    GetFromEA_B(hi) \
+    ea = (uint8_t)(ea - 1); \
+    GetFromEA_B(b) \
+    w = (hi << 8) | b;
+
+#define GetIndZPage \
+    _GetIndZPage(b) \
+    ea = w;
+
+/* Zero Page Indexed Indirect Addressing - The second byte is added to
+   the contents of the X index register; the carry is discarded.  The
+   result of this addition points to a memory location on page zero
+   whose contents is the low order byte of the effective address.  The
+   next memory location in page zero contains the high-order byte of
+   the effective address.  Both memory locations specifying the high
+   and low-order bytes must be in page zero. */
+#define GetIndZPage_X \
+    _GetIndZPage(b + x) \
+    ea = w;
+
+/* Indirect Indexed Addressing - The second byte of the instruction
+   points to a memory location in page zero.  The contents of this
+   memory location are added to the contents of the Y index register,
+   the result being the low order byte of the effective address.  The
+   carry from this addition is added to the contents of the next page
+   zero memory location, the result being the high order byte of the
+   effective address. */
+#define GetIndZPage_Y \
+    _GetIndZPage(b) \
+    if ((uint8_t)w + y > 0xFF) { \
+        ++cpu65_opcycles; /* +1 cycle on page boundary */ \
+    } \
+    ea = w + y;
+
+#define GetIndZPage_Y_STA \
+    _GetIndZPage(b) \
+    ea = w + y;
+
+#ifndef NDEBUG
+#define DebugBCDCheck(v) \
+    if (((a & 0x80) && (a & 0x60)) || ((a & 0x08) && (a & 0x06)) || \
+        (((v) & 0x80) && ((v) & 0x60)) || (((v) & 0x08) && ((v) & 0x06))) \
+    { \
+        debug_illegal_bcd(ea); \
+    }
+#else
+#define DebugBCDCheck(v)
+#endif
+
+#define _DoADC(v) \
+    w = a + (v) + (f & C_Flag); \
+    f &= ~(N_Flag|V_Flag|Z_Flag|C_Flag); \
+    if (~(a ^ (v)) & (a ^ w) & 0x80) { \
+        f |= V_Flag; \
+    } \
+    a = (uint8_t)w; \
+    FlagNZC(a, w & 0x100)
+
+#define DoADC_b \
+    GetFromEA_B(b) \
+    _DoADC(b)
+
+#define DoAND \
+    GetFromEA_B(b) \
+    a &= b; \
+    FlagNZ(a)
+
+#define _DoASL(v) \
+    FlagNZC((uint8_t)((v) << 1), (v) & 0x80) \
+    v <<= 1;
+
+#define DoASL \
+    GetFromEA_B(b) \
+    _DoASL(b) \
+    PutToEA_B(b)
+
+#define DoBIT \
+    GetFromEA_B(b) \
+    f = (f & ~(N_Flag|V_Flag|Z_Flag)) | ((b & 0x80) ? N_Flag : 0) | ((b & 0x40) ? V_Flag : 0) | ((a & b) ? 0 : Z_Flag);
+
+#define _DoCMP(r) \
+    GetFromEA_B(b) \
+    FlagNZC((uint8_t)((r) - b), (r) >= b)
+
+#define DoCMP _DoCMP(a)
+#define DoCPX _DoCMP(x)
+#define DoCPY _DoCMP(y)
+
+#define _DoDEC(v) \
+    --v; \
+    FlagNZ(v)
+
+#define DoDEC \
+    GetFromEA_B(b) \
+    _DoDEC(b) \
+    PutToEA_B(b)
+
+#define DoEOR \
+    GetFromEA_B(b) \
+    a ^= b; \
+    FlagNZ(a)
+
+#define _DoINC(v) \
+    ++v; \
+    FlagNZ(v)
+
+#define DoINC \
+    GetFromEA_B(b) \
+    _DoINC(b) \
+    PutToEA_B(b)
+
+#define DoLDA \
+    GetFromEA_B(a) \
+    FlagNZ(a)
+
+#define DoLDX \
+    GetFromEA_B(x) \
+    FlagNZ(x)
+
+#define DoLDY \
+    GetFromEA_B(y) \
+    FlagNZ(y)
+
+#define _DoLSR(v) \
+    FlagNZC((v) >> 1, (v) & 0x01) \
+    v >>= 1;
+
+#define DoLSR \
+    GetFromEA_B(b) \
+    _DoLSR(b) \
+    PutToEA_B(b)
+
+#define DoORA \
+    GetFromEA_B(b) \
+    a |= b; \
+    FlagNZ(a)
+
+#define _DoROL(v) \
+    hi = (uint8_t)(((v) << 1) | (f & C_Flag)); \
+    FlagNZC(hi, (v) & 0x80) \
+    v = hi;
+
+#define DoROL \
+    GetFromEA_B(b) \
+    _DoROL(b) \
+    PutToEA_B(b)
+
+#define _DoROR(v) \
+    hi = (uint8_t)(((v) >> 1) | ((f & C_Flag) ? 0x80 : 0)); \
+    FlagNZC(hi, (v) & 0x01) \
+    v = hi;
+
+#define DoROR \
+    GetFromEA_B(b) \
+    _DoROR(b) \
+    PutToEA_B(b)
+
+#define DoSBC_b \
+    GetFromEA_B(b) \
+    b = ~b; \
+    _DoADC(b)
+
+#define DoSTA \
+    PutToEA_B(a)
+
+#define DoSTX \
+    PutToEA_B(x)
+
+#define DoSTY \
+    PutToEA_B(y)
+
+#define DoSTZ \
+    PutToEA_B(0x0)
+
+#define DoTRB \
+    GetFromEA_B(b) \
+    FlagZ(a & b) \
+    b &= ~a; \
+    PutToEA_B(b)
+
+#define DoTSB \
+    GetFromEA_B(b) \
+    FlagZ(a & b) \
+    b |= a; \
+    PutToEA_B(b)
+
+#define maybe_DoADC_d \
+    if (f & D_Flag) { /* Decimal mode? */ \
+        goto op_ADC_dec; /* Yes, jump to decimal version */ \
+    }
+
+#define maybe_DoSBC_d \
+    if (f & D_Flag) { /* Decimal mode? */ \
+        goto op_SBC_dec; /* Yes, jump to decimal version */ \
+    }
+
+/* -------------------------------------------------------------------------
+    65c02 CPU processing loop entry point
+   ------------------------------------------------------------------------- */
+
+void cpu65_run(void) {
+
+    static void *const opcodes[256] = {
+        &&op_BRK,            // 00
+        &&op_ORA_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_TSB_zpage,
+        &&op_ORA_zpage,
+        &&op_ASL_zpage,
+        &&op_RMB0_65c02,
+        &&op_PHP,            // 08
+        &&op_ORA_imm,
+        &&op_ASL_acc,
+        &&op_UNK_65c02,
+        &&op_TSB_abs,
+        &&op_ORA_abs,
+        &&op_ASL_abs,
+        &&op_BBR0_65c02,
+        &&op_BPL,            // 10
+        &&op_ORA_ind_y,
+        &&op_ORA_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_TRB_zpage,
+        &&op_ORA_zpage_x,
+        &&op_ASL_zpage_x,
+        &&op_RMB1_65c02,
+        &&op_CLC,            // 18
+        &&op_ORA_abs_y,
+        &&op_INA,
+        &&op_UNK_65c02,
+        &&op_TRB_abs,
+        &&op_ORA_abs_x,
+        &&op_ASL_abs_x,
+        &&op_BBR1_65c02,
+        &&op_JSR,            // 20
+        &&op_AND_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_BIT_zpage,
+        &&op_AND_zpage,
+        &&op_ROL_zpage,
+        &&op_RMB2_65c02,
+        &&op_PLP,            // 28
+        &&op_AND_imm,
+        &&op_ROL_acc,
+        &&op_UNK_65c02,
+        &&op_BIT_abs,
+        &&op_AND_abs,
+        &&op_ROL_abs,
+        &&op_BBR2_65c02,
+        &&op_BMI,            // 30
+        &&op_AND_ind_y,
+        &&op_AND_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_BIT_zpage_x,
+        &&op_AND_zpage_x,
+        &&op_ROL_zpage_x,
+        &&op_RMB3_65c02,
+        &&op_SEC,            // 38
+        &&op_AND_abs_y,
+        &&op_DEA,
+        &&op_UNK_65c02,
+        &&op_BIT_abs_x,
+        &&op_AND_abs_x,
+        &&op_ROL_abs_x,
+        &&op_BBR3_65c02,
+        &&op_RTI,            // 40
+        &&op_EOR_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_EOR_zpage,
+        &&op_LSR_zpage,
+        &&op_RMB4_65c02,
+        &&op_PHA,            // 48
+        &&op_EOR_imm,
+        &&op_LSR_acc,
+        &&op_UNK_65c02,
+        &&op_JMP_abs,
+        &&op_EOR_abs,
+        &&op_LSR_abs,
+        &&op_BBR4_65c02,
+        &&op_BVC,            // 50
+        &&op_EOR_ind_y,
+        &&op_EOR_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_EOR_zpage_x,
+        &&op_LSR_zpage_x,
+        &&op_RMB5_65c02,
+        &&op_CLI,            // 58
+        &&op_EOR_abs_y,
+        &&op_PHY,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_EOR_abs_x,
+        &&op_LSR_abs_x,
+        &&op_BBR5_65c02,
+        &&op_RTS,            // 60
+        &&op_ADC_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_STZ_zpage,
+        &&op_ADC_zpage,
+        &&op_ROR_zpage,
+        &&op_RMB6_65c02,
+        &&op_PLA,            // 68
+        &&op_ADC_imm,
+        &&op_ROR_acc,
+        &&op_UNK_65c02,
+        &&op_JMP_ind,
+        &&op_ADC_abs,
+        &&op_ROR_abs,
+        &&op_BBR6_65c02,
+        &&op_BVS,            // 70
+        &&op_ADC_ind_y,
+        &&op_ADC_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_STZ_zpage_x,
+        &&op_ADC_zpage_x,
+        &&op_ROR_zpage_x,
+        &&op_RMB7_65c02,
+        &&op_SEI,            // 78
+        &&op_ADC_abs_y,
+        &&op_PLY,
+        &&op_UNK_65c02,
+        &&op_JMP_abs_ind_x,
+        &&op_ADC_abs_x,
+        &&op_ROR_abs_x,
+        &&op_BBR7_65c02,
+        &&op_BRA,            // 80
+        &&op_STA_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_STY_zpage,
+        &&op_STA_zpage,
+        &&op_STX_zpage,
+        &&op_SMB0_65c02,
+        &&op_DEY,            // 88
+        &&op_BIT_imm,
+        &&op_TXA,
+        &&op_UNK_65c02,
+        &&op_STY_abs,
+        &&op_STA_abs,
+        &&op_STX_abs,
+        &&op_BBS0_65c02,
+        &&op_BCC,            // 90
+        &&op_STA_ind_y,
+        &&op_STA_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_STY_zpage_x,
+        &&op_STA_zpage_x,
+        &&op_STX_zpage_y,
+        &&op_SMB1_65c02,
+        &&op_TYA,            // 98
+        &&op_STA_abs_y,
+        &&op_TXS,
+        &&op_UNK_65c02,
+        &&op_STZ_abs,
+        &&op_STA_abs_x,
+        &&op_STZ_abs_x,
+        &&op_BBS1_65c02,
+        &&op_LDY_imm,        // A0
+        &&op_LDA_ind_x,
+        &&op_LDX_imm,
+        &&op_UNK_65c02,
+        &&op_LDY_zpage,
+        &&op_LDA_zpage,
+        &&op_LDX_zpage,
+        &&op_SMB2_65c02,
+        &&op_TAY,            // A8
+        &&op_LDA_imm,
+        &&op_TAX,
+        &&op_UNK_65c02,
+        &&op_LDY_abs,
+        &&op_LDA_abs,
+        &&op_LDX_abs,
+        &&op_BBS2_65c02,
+        &&op_BCS,            // B0
+        &&op_LDA_ind_y,
+        &&op_LDA_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_LDY_zpage_x,
+        &&op_LDA_zpage_x,
+        &&op_LDX_zpage_y,
+        &&op_SMB3_65c02,
+        &&op_CLV,            // B8
+        &&op_LDA_abs_y,
+        &&op_TSX,
+        &&op_UNK_65c02,
+        &&op_LDY_abs_x,
+        &&op_LDA_abs_x,
+        &&op_LDX_abs_y,
+        &&op_BBS3_65c02,
+        &&op_CPY_imm,        // C0
+        &&op_CMP_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_CPY_zpage,
+        &&op_CMP_zpage,
+        &&op_DEC_zpage,
+        &&op_SMB4_65c02,
+        &&op_INY,            // C8
+        &&op_CMP_imm,
+        &&op_DEX,
+        &&op_WAI_65c02,
+        &&op_CPY_abs,
+        &&op_CMP_abs,
+        &&op_DEC_abs,
+        &&op_BBS4_65c02,
+        &&op_BNE,            // D0
+        &&op_CMP_ind_y,
+        &&op_CMP_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_CMP_zpage_x,
+        &&op_DEC_zpage_x,
+        &&op_SMB5_65c02,
+        &&op_CLD,            // D8
+        &&op_CMP_abs_y,
+        &&op_PHX,
+        &&op_STP_65c02,
+        &&op_UNK_65c02,
+        &&op_CMP_abs_x,
+        &&op_DEC_abs_x,
+        &&op_BBS5_65c02,
+        &&op_CPX_imm,        // E0
+        &&op_SBC_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_CPX_zpage,
+        &&op_SBC_zpage,
+        &&op_INC_zpage,
+        &&op_SMB6_65c02,
+        &&op_INX,            // E8
+        &&op_SBC_imm,
+        &&op_NOP,
+        &&op_UNK_65c02,
+        &&op_CPX_abs,
+        &&op_SBC_abs,
+        &&op_INC_abs,
+        &&op_BBS6_65c02,
+        &&op_BEQ,            // F0
+        &&op_SBC_ind_y,
+        &&op_SBC_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_SBC_zpage_x,
+        &&op_INC_zpage_x,
+        &&op_SMB7_65c02,
+        &&op_SED,            // F8
+        &&op_SBC_abs_y,
+        &&op_PLX,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_SBC_abs_x,
+        &&op_INC_abs_x,
+        &&op_BBS7_65c02
+    };
+
+    static void *const blk_opcodes[256] = {
+        &&op_BRK,            // 00
+        &&blk_ORA_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_TSB_zpage,
+        &&blk_ORA_zpage,
+        &&blk_ASL_zpage,
+        &&op_RMB0_65c02,
+        &&op_PHP,            // 08
+        &&blk_ORA_imm,
+        &&op_ASL_acc,
+        &&op_UNK_65c02,
+        &&blk_TSB_abs,
+        &&blk_ORA_abs,
+        &&blk_ASL_abs,
+        &&op_BBR0_65c02,
+        &&blk_BPL,           // 10
+        &&blk_ORA_ind_y,
+        &&blk_ORA_ind_zpage,
+        &&op_UNK_65c02,
+        &&blk_TRB_zpage,
+        &&blk_ORA_zpage_x,
+        &&blk_ASL_zpage_x,
+        &&op_RMB1_65c02,
+        &&op_CLC,            // 18
+        &&blk_ORA_abs_y,
+        &&op_INA,
+        &&op_UNK_65c02,
+        &&blk_TRB_abs,
+        &&blk_ORA_abs_x,
+        &&blk_ASL_abs_x,
+        &&op_BBR1_65c02,
+        &&blk_JSR,           // 20
+        &&blk_AND_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_BIT_zpage,
+        &&blk_AND_zpage,
+        &&blk_ROL_zpage,
+        &&op_RMB2_65c02,
+        &&op_PLP,            // 28
+        &&blk_AND_imm,
+        &&op_ROL_acc,
+        &&op_UNK_65c02,
+        &&blk_BIT_abs,
+        &&blk_AND_abs,
+        &&blk_ROL_abs,
+        &&op_BBR2_65c02,
+        &&blk_BMI,           // 30
+        &&blk_AND_ind_y,
+        &&blk_AND_ind_zpage,
+        &&op_UNK_65c02,
+        &&blk_BIT_zpage_x,
+        &&blk_AND_zpage_x,
+        &&blk_ROL_zpage_x,
+        &&op_RMB3_65c02,
+        &&op_SEC,            // 38
+        &&blk_AND_abs_y,
+        &&op_DEA,
+        &&op_UNK_65c02,
+        &&blk_BIT_abs_x,
+        &&blk_AND_abs_x,
+        &&blk_ROL_abs_x,
+        &&op_BBR3_65c02,
+        &&op_RTI,            // 40
+        &&blk_EOR_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_EOR_zpage,
+        &&blk_LSR_zpage,
+        &&op_RMB4_65c02,
+        &&op_PHA,            // 48
+        &&blk_EOR_imm,
+        &&op_LSR_acc,
+        &&op_UNK_65c02,
+        &&blk_JMP_abs,
+        &&blk_EOR_abs,
+        &&blk_LSR_abs,
+        &&op_BBR4_65c02,
+        &&blk_BVC,           // 50
+        &&blk_EOR_ind_y,
+        &&blk_EOR_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_EOR_zpage_x,
+        &&blk_LSR_zpage_x,
+        &&op_RMB5_65c02,
+        &&op_CLI,            // 58
+        &&blk_EOR_abs_y,
+        &&op_PHY,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_EOR_abs_x,
+        &&blk_LSR_abs_x,
+        &&op_BBR5_65c02,
+        &&op_RTS,            // 60
+        &&blk_ADC_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_STZ_zpage,
+        &&blk_ADC_zpage,
+        &&blk_ROR_zpage,
+        &&op_RMB6_65c02,
+        &&op_PLA,            // 68
+        &&blk_ADC_imm,
+        &&op_ROR_acc,
+        &&op_UNK_65c02,
+        &&blk_JMP_ind,
+        &&blk_ADC_abs,
+        &&blk_ROR_abs,
+        &&op_BBR6_65c02,
+        &&blk_BVS,           // 70
+        &&blk_ADC_ind_y,
+        &&blk_ADC_ind_zpage,
+        &&op_UNK_65c02,
+        &&blk_STZ_zpage_x,
+        &&blk_ADC_zpage_x,
+        &&blk_ROR_zpage_x,
+        &&op_RMB7_65c02,
+        &&op_SEI,            // 78
+        &&blk_ADC_abs_y,
+        &&op_PLY,
+        &&op_UNK_65c02,
+        &&blk_JMP_abs_ind_x,
+        &&blk_ADC_abs_x,
+        &&blk_ROR_abs_x,
+        &&op_BBR7_65c02,
+        &&blk_BRA,           // 80
+        &&blk_STA_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_STY_zpage,
+        &&blk_STA_zpage,
+        &&blk_STX_zpage,
+        &&op_SMB0_65c02,
+        &&op_DEY,            // 88
+        &&blk_BIT_imm,
+        &&op_TXA,
+        &&op_UNK_65c02,
+        &&blk_STY_abs,
+        &&blk_STA_abs,
+        &&blk_STX_abs,
+        &&op_BBS0_65c02,
+        &&blk_BCC,           // 90
+        &&blk_STA_ind_y,
+        &&blk_STA_ind_zpage,
+        &&op_UNK_65c02,
+        &&blk_STY_zpage_x,
+        &&blk_STA_zpage_x,
+        &&blk_STX_zpage_y,
+        &&op_SMB1_65c02,
+        &&op_TYA,            // 98
+        &&blk_STA_abs_y,
+        &&op_TXS,
+        &&op_UNK_65c02,
+        &&blk_STZ_abs,
+        &&blk_STA_abs_x,
+        &&blk_STZ_abs_x,
+        &&op_BBS1_65c02,
+        &&blk_LDY_imm,       // A0
+        &&blk_LDA_ind_x,
+        &&blk_LDX_imm,
+        &&op_UNK_65c02,
+        &&blk_LDY_zpage,
+        &&blk_LDA_zpage,
+        &&blk_LDX_zpage,
+        &&op_SMB2_65c02,
+        &&op_TAY,            // A8
+        &&blk_LDA_imm,
+        &&op_TAX,
+        &&op_UNK_65c02,
+        &&blk_LDY_abs,
+        &&blk_LDA_abs,
+        &&blk_LDX_abs,
+        &&op_BBS2_65c02,
+        &&blk_BCS,           // B0
+        &&blk_LDA_ind_y,
+        &&blk_LDA_ind_zpage,
+        &&op_UNK_65c02,
+        &&blk_LDY_zpage_x,
+        &&blk_LDA_zpage_x,
+        &&blk_LDX_zpage_y,
+        &&op_SMB3_65c02,
+        &&op_CLV,            // B8
+        &&blk_LDA_abs_y,
+        &&op_TSX,
+        &&op_UNK_65c02,
+        &&blk_LDY_abs_x,
+        &&blk_LDA_abs_x,
+        &&blk_LDX_abs_y,
+        &&op_BBS3_65c02,
+        &&blk_CPY_imm,       // C0
+        &&blk_CMP_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_CPY_zpage,
+        &&blk_CMP_zpage,
+        &&blk_DEC_zpage,
+        &&op_SMB4_65c02,
+        &&op_INY,            // C8
+        &&blk_CMP_imm,
+        &&op_DEX,
+        &&op_WAI_65c02,
+        &&blk_CPY_abs,
+        &&blk_CMP_abs,
+        &&blk_DEC_abs,
+        &&op_BBS4_65c02,
+        &&blk_BNE,           // D0
+        &&blk_CMP_ind_y,
+        &&blk_CMP_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_CMP_zpage_x,
+        &&blk_DEC_zpage_x,
+        &&op_SMB5_65c02,
+        &&op_CLD,            // D8
+        &&blk_CMP_abs_y,
+        &&op_PHX,
+        &&op_STP_65c02,
+        &&op_UNK_65c02,
+        &&blk_CMP_abs_x,
+        &&blk_DEC_abs_x,
+        &&op_BBS5_65c02,
+        &&blk_CPX_imm,       // E0
+        &&blk_SBC_ind_x,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_CPX_zpage,
+        &&blk_SBC_zpage,
+        &&blk_INC_zpage,
+        &&op_SMB6_65c02,
+        &&op_INX,            // E8
+        &&blk_SBC_imm,
+        &&op_NOP,
+        &&op_UNK_65c02,
+        &&blk_CPX_abs,
+        &&blk_SBC_abs,
+        &&blk_INC_abs,
+        &&op_BBS6_65c02,
+        &&blk_BEQ,           // F0
+        &&blk_SBC_ind_y,
+        &&blk_SBC_ind_zpage,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_SBC_zpage_x,
+        &&blk_INC_zpage_x,
+        &&op_SMB7_65c02,
+        &&op_SED,            // F8
+        &&blk_SBC_abs_y,
+        &&op_PLX,
+        &&op_UNK_65c02,
+        &&op_UNK_65c02,
+        &&blk_SBC_abs_x,
+        &&blk_INC_abs_x,
+        &&op_BBS7_65c02
+    };
+
+    // 6502 registers (restore CPU state when being called from C)
+    uint16_t pc = cpu65_pc;
+    uint16_t ea = cpu65_ea;
+    uint8_t a = cpu65_a;
+    uint8_t f = cpu65_flags_decode[cpu65_f];
+    uint8_t x = cpu65_x;
+    uint8_t y = cpu65_y;
+    uint8_t sp = cpu65_sp;
+
+    // scratch
+    uint8_t opcode = 0;
+    uint8_t cycles = 0;
+    uint8_t b = 0;
+    uint8_t hi = 0;
+    uint16_t w = 0;
+
+    // block cache state (blk is NULL when not executing a decoded block)
+    block_t *blk = NULL;
+    const block_insn_t *ins = NULL;
+    const block_insn_t *blk_end = NULL;
+    int xcycles = 0;   // extra cycles of the completed block instructions
+    int committed = 0; // block cycles already accounted
+    int blk_cycles = 0;
+    bool blk_break = false;
+#if CPU_JIT
+    bool jit_bypass = false; // run the next block in the interpreter (native block exited ahead of decimal mode)
+#endif
+#ifdef DEBUGGER
+    const int32_t halt_cycles = cpu65_cycles_to_execute;
+#endif
+    unsigned long long * const opcode_counts = cpu65_opcode_counts;
+
+    if (emul_reinitialize) {
+        emul_reinitialize = 0;
+        goto ex_reset;
+    }
+
+    if (cpu65__signal) {
+        goto exception;
+    }
+
+    goto next_instruction;
+
+/* ----------------------------------------------------------------------
+       Instruction dispatch
+   ---------------------------------------------------------------------- */
+
+block_exit:
+    cycles = cpu65__opcycles[opcode] + cpu65_opcycles;
+    cpu65_opcycles = cycles;
+    blk_cycles = ins->cycles + xcycles - committed;
+    blk = NULL;
+    CommitCycles(blk_cycles)
+    if (UNLIKELY(cpu65_cycles_to_execute <= 0)) {
+        goto exit_cpu65_run;
+    }
+    if (UNLIKELY(cpu65__signal)) {
+        goto exception;
+    }
+
+next_instruction:
+#ifdef DEBUGGER
+    if (UNLIKELY(halt_armed) && is_debugging) {
+        // stop ahead of a breakpoint (or following a watched access/opcode), but only once an instruction has run
+        if (cpu65_cycles_to_execute < halt_cycles && c_debugger_halt_hit(pc, ea, cpu65_rw, opcode)) {
+            goto exit_cpu65_run;
+        }
+    }
+#endif
+    if ((pc >> 8) > 0x01) { // NOTE : zpage/stack are written bypassing the vmem tables
+        uint8_t **bank = cpu65_vmem_rpage[pc >> 8];
+#if CPU_TRACING
+        if (cpu65_trace_is_enabled()) {
+            bank = NULL;
+        }
+#endif
+#ifdef DEBUGGER
+        // blocks do not pass through here between instructions, so interpret pages holding breakpoints (and
+        // everything while watching accesses or opcodes)
+        if (UNLIKELY(halt_armed) && is_debugging && ((halt_armed & ~HALT_EXEC) || halt_exec_pages[pc >> 8])) {
+            bank = NULL;
+        }
+#endif
+        if (bank) {
+            blk = &blocks[BLOCK_HASH(pc)];
+            if (UNLIKELY(blk->pc != pc || blk->bank != *bank || blk->gen != block_page_gen[pc >> 8])) {
+                _block_decode(blk, pc, *bank, blk_opcodes);
+            }
+            // only run the block if it cannot exhaust cpu65_cycles_to_execute before its end
+            if (LIKELY(blk->count && cpu65_cycles_to_execute > blk->max_cycles)) {
+#if CPU_JIT
+                if (LIKELY(!jit_bypass)) {
+                    if (UNLIKELY(!blk->jit) && blk->hits < JIT_HOT_THRESHOLD && ++blk->hits == JIT_HOT_THRESHOLD) {
+                        blk->jit = _block_compile(blk);
+                    }
+                    if (blk->jit) {
+                        goto jit_dispatch;
+                    }
+                }
+                jit_bypass = false;
+#endif
+                ins = blk->insns;
+                blk_end = ins + blk->count;
+                xcycles = 0;
+                committed = 0;
+                blk_break = false;
+                BlockDispatch
+            }
+            blk = NULL;
+        }
+    }
+    JumpNextInstruction
+
+#if CPU_JIT
+jit_dispatch:
+    jit65_state.pc = pc;
+    jit65_state.a = a;
+    jit65_state.x = x;
+    jit65_state.y = y;
+    jit65_state.f = f;
+    jit65_state.sp = sp;
+    jit65_state.d = cpu65_d;
+    jit65_state.xcycles = 0;
+    jit65_state.committed = 0;
+    jit65_run(blk->jit);
+    a = jit65_state.a;
+    x = jit65_state.x;
+    y = jit65_state.y;
+    f = jit65_state.f;
+    sp = jit65_state.sp;
+    pc = jit65_state.pc;
+    jit_bypass = jit65_state.side_exit;
+    if (UNLIKELY(jit65_state.last < 0)) {
+        blk = NULL;
+        goto next_instruction; // nothing executed
+    }
+    ea = jit65_state.ea;
+    cpu65_d = jit65_state.d;
+    ins = &blk->insns[jit65_state.last + 1];
+    if (UNLIKELY(opcode_counts != NULL)) {
+        for (const block_insn_t *done = blk->insns; done != ins; done++) {
+            ++opcode_counts[done->opcode];
+        }
+    }
+    opcode = ins[-1].opcode;
+    cpu65_opcode = opcode;
+    cpu65_opcycles = jit65_state.opcycles;
+    cpu65_rw = jit65_state.rw;
+    xcycles = jit65_state.xcycles;
+    committed = jit65_state.committed;
+    goto block_exit;
+#endif
+
+/* ----------------------------------------------------------------------
+       6502 routines and instructions
+   ---------------------------------------------------------------------- */
+
+/* ----------------------------------
+       ADC instructions
+       ADd memory to accumulator with Carry
+   ---------------------------------- */
+
+// Decimal mode
+op_ADC_dec:
+    {
+        ++cpu65_opcycles; // +1 cycle
+        GetFromEA_B(b)
+        DebugBCDCheck(b)
+
+        // DAA algorithm : http://www.ray.masmcode.com/BCDdaa.html
+        // CF_old = CF
+        // IF (al AND 0Fh > 9) or (the Auxiliary Flag is set)
+        //    al = al + 6
+        //    CF = CF (automagically) or CF_old
+        //    AF set (automagically)
+        // ENDIF
+        // IF (al > 99h) or (Carry Flag is set)
+        //    al = al + 60h
+        //    CF set
+        // ENDIF
+        const uint8_t carry = (f & C_Flag);
+        const bool aux = ((a & 0x0f) + (b & 0x0f) + carry) > 0x0f;
+        w = a + b + carry;
+        bool adjust_hi = (w > 0xff);
+        uint8_t al = (uint8_t)w;
+        f &= ~(N_Flag|V_Flag|Z_Flag|C_Flag);
+        if (((al & 0x0f) > 9) || aux) {
+            if (al >= 0xfa) {
+                adjust_hi = true; // adjust lo nybble carried
+            }
+            al += 6;
+        }
+        if (adjust_hi || (al > 0x99)) {
+            al += 0x60; // adjust hi nybble
+            f |= C_Flag;
+        }
+        a = al;
+        f |= (a & 0x80) ? N_Flag : 0;
+        f |= a ? 0 : Z_Flag;
+    }
+    Continue
+
+op_ADC_imm: // 0x69
+    FetchOperand_Imm
+blk_ADC_imm:
+    GetImm
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+op_ADC_zpage: // 0x65
+    FetchOperand_B
+blk_ADC_zpage:
+    GetZPage
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+op_ADC_zpage_x: // 0x75
+    FetchOperand_B
+blk_ADC_zpage_x:
+    GetZPage_X
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+op_ADC_abs: // 0x6d
+    FetchOperand_W
+blk_ADC_abs:
+    GetAbs
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+op_ADC_abs_x: // 0x7d
+    FetchOperand_W
+blk_ADC_abs_x:
+    GetAbs_X
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+op_ADC_abs_y: // 0x79
+    FetchOperand_W
+blk_ADC_abs_y:
+    GetAbs_Y
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+op_ADC_ind_x: // 0x61
+    FetchOperand_B
+blk_ADC_ind_x:
+    GetIndZPage_X
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+op_ADC_ind_y: // 0x71
+    FetchOperand_B
+blk_ADC_ind_y:
+    GetIndZPage_Y
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+// 65c02 : 0x72
+op_ADC_ind_zpage:
+    FetchOperand_B
+blk_ADC_ind_zpage:
+    GetIndZPage
+    maybe_DoADC_d
+    DoADC_b
+    Continue
+
+/* ----------------------------------
+       AND instructions
+       logical AND memory with accumulator
+   ---------------------------------- */
+
+op_AND_imm: // 0x29
+    FetchOperand_Imm
+blk_AND_imm:
+    GetImm
+    DoAND
+    Continue
+
+op_AND_zpage: // 0x25
+    FetchOperand_B
+blk_AND_zpage:
+    GetZPage
+    DoAND
+    Continue
+
+op_AND_zpage_x: // 0x35
+    FetchOperand_B
+blk_AND_zpage_x:
+    GetZPage_X
+    DoAND
+    Continue
+
+op_AND_abs: // 0x2d
+    FetchOperand_W
+blk_AND_abs:
+    GetAbs
+    DoAND
+    Continue
+
+op_AND_abs_x: // 0x3d
+    FetchOperand_W
+blk_AND_abs_x:
+    GetAbs_X
+    DoAND
+    Continue
+
+op_AND_abs_y: // 0x39
+    FetchOperand_W
+blk_AND_abs_y:
+    GetAbs_Y
+    DoAND
+    Continue
+
+op_AND_ind_x: // 0x21
+    FetchOperand_B
+blk_AND_ind_x:
+    GetIndZPage_X
+    DoAND
+    Continue
+
+op_AND_ind_y: // 0x31
+    FetchOperand_B
+blk_AND_ind_y:
+    GetIndZPage_Y
+    DoAND
+    Continue
+
+// 65c02 : 0x32
+op_AND_ind_zpage:
+    FetchOperand_B
+blk_AND_ind_zpage:
+    GetIndZPage
+    DoAND
+    Continue
+
+/* ----------------------------------
+       ASL instructions
+       Arithmetic Shift one bit Left, memory or accumulator
+   ---------------------------------- */
+
+op_ASL_acc: // 0x0a
+    _DoASL(a)
+    Continue
+
+op_ASL_zpage: // 0x06
+    FetchOperand_B
+blk_ASL_zpage:
+    GetZPage
+    DoASL
+    Continue
+
+op_ASL_zpage_x: // 0x16
+    FetchOperand_B
+blk_ASL_zpage_x:
+    GetZPage_X
+    DoASL
+    Continue
+
+op_ASL_abs: // 0x0e
+    FetchOperand_W
+blk_ASL_abs:
+    GetAbs
+    DoASL
+    Continue
+
+op_ASL_abs_x: // 0x1e
+    FetchOperand_W
+blk_ASL_abs_x:
+    GetAbs_X
+    DoASL
+    Continue
+
+/* ----------------------------------
+       BBRx/BBSx instructions
+       UNIMPLEMENTED : These are documented in the W65C02S datasheet ...
+       + 1 cycle  if branch within page
+       + 2 cycles if branch across page boundary
+   ---------------------------------- */
+
+op_BBR0_65c02:
+op_BBR1_65c02:
+op_BBR2_65c02:
+op_BBR3_65c02:
+op_BBR4_65c02:
+op_BBR5_65c02:
+op_BBR6_65c02:
+op_BBR7_65c02:
+op_BBS0_65c02:
+op_BBS1_65c02:
+op_BBS2_65c02:
+op_BBS3_65c02:
+op_BBS4_65c02:
+op_BBS5_65c02:
+op_BBS6_65c02:
+op_BBS7_65c02:
+    Continue
+
+/* ----------------------------------
+       Bxx branch instructions
+   ---------------------------------- */
+
+op_BCC: // 0x90
+    FetchOperand_B
+blk_BCC:
+    if (!(f & C_Flag)) {
+        BranchXCycles
+    }
+    Continue
+
+op_BCS: // 0xB0
+    FetchOperand_B
+blk_BCS:
+    if (f & C_Flag) {
+        BranchXCycles
+    }
+    Continue
+
+op_BEQ: // 0xF0
+    FetchOperand_B
+blk_BEQ:
+    if (f & Z_Flag) {
+        BranchXCycles
+    }
+    Continue
+
+op_BMI: // 0x30
+    FetchOperand_B
+blk_BMI:
+    if (f & N_Flag) {
+        BranchXCycles
+    }
+    Continue
+
+op_BNE: // 0xD0
+    FetchOperand_B
+blk_BNE:
+    if (!(f & Z_Flag)) {
+        BranchXCycles
+    }
+    Continue
+
+op_BPL: // 0x10
+    FetchOperand_B
+blk_BPL:
+    if (!(f & N_Flag)) {
+        BranchXCycles
+    }
+    Continue
+
+// 65c02 : 0x80
+op_BRA:
+    FetchOperand_B
+blk_BRA:
+    BranchXCycles
+    Continue
+
+op_BVC: // 0x50
+    FetchOperand_B
+blk_BVC:
+    if (!(f & V_Flag)) {
+        BranchXCycles
+    }
+    Continue
+
+op_BVS: // 0x70
+    FetchOperand_B
+blk_BVS:
+    if (f & V_Flag) {
+        BranchXCycles
+    }
+    Continue
+
+/* ----------------------------------
+       BIT instructions
+       BIt Test
+   ---------------------------------- */
+
+op_BIT_zpage: // 0x24
+    FetchOperand_B
+blk_BIT_zpage:
+    GetZPage
+    DoBIT
+    Continue
+
+op_BIT_abs: // 0x2c
+    FetchOperand_W
+blk_BIT_abs:
+    GetAbs
+    DoBIT
+    Continue
+
+// 65c02 : 0x34
+op_BIT_zpage_x:
+    FetchOperand_B
+blk_BIT_zpage_x:
+    GetZPage_X
+    DoBIT
+    Continue
+
+// 65c02 : 0x3C
+op_BIT_abs_x:
+    FetchOperand_W
+blk_BIT_abs_x:
+    GetAbs_X
+    DoBIT
+    Continue
+
+/* BIT immediate is anomalous in that it does not affect the
+ * N and V flags, unlike in other addressing modes.
+ */
+// 65c02 : 0x89
+op_BIT_imm:
+    FetchOperand_Imm
+blk_BIT_imm:
+    GetImm
+    GetFromEA_B(b)
+    FlagZ(a & b)
+    Continue
+
+/* ----------------------------------
+       BRK instruction
+   ---------------------------------- */
+
+op_BRK:
+    ++pc;
+    Push(pc >> 8)
+    Push(pc & 0xFF)
+    f |= (B_Flag|X_Flag);
+    Push(cpu65_flags_encode[f])
+    f |= I_Flag;
+    ea = 0xFFFE; // ROM interrupt vector
+    GetFromEA_W(pc)
+    Continue
+
+/* ----------------------------------
+       CLx/SEx instructions
+   ---------------------------------- */
+
+op_CLC: // 0x18
+    f &= ~C_Flag;
+    Continue
+
+op_CLD: // 0xd8
+    f &= ~D_Flag;
+    Continue
+
+op_CLI: // 0x58
+    f &= ~I_Flag;
+    Continue
+
+op_CLV: // 0xB8
+    f &= ~V_Flag;
+    Continue
+
+op_SEC: // 0x38
+    f |= C_Flag;
+    Continue
+
+op_SED: // 0xf8
+    f |= D_Flag;
+    Continue
+
+op_SEI: // 0x78
+    f |= I_Flag;
+    Continue
+
+/* ----------------------------------
+       CMP instructions
+       CoMPare memory and accumulator
+   ---------------------------------- */
+
+op_CMP_imm: // 0xc9
+    FetchOperand_Imm
+blk_CMP_imm:
+    GetImm
+    DoCMP
+    Continue
+
+op_CMP_zpage: // 0xc5
+    FetchOperand_B
+blk_CMP_zpage:
+    GetZPage
+    DoCMP
+    Continue
+
+op_CMP_zpage_x: // 0xd5
+    FetchOperand_B
+blk_CMP_zpage_x:
+    GetZPage_X
+    DoCMP
+    Continue
+
+op_CMP_abs: // 0xcd
+    FetchOperand_W
+blk_CMP_abs:
+    GetAbs
+    DoCMP
+    Continue
+
+op_CMP_abs_x: // 0xdd
+    FetchOperand_W
+blk_CMP_abs_x:
+    GetAbs_X
+    DoCMP
+    Continue
+
+op_CMP_abs_y: // 0xd9
+    FetchOperand_W
+blk_CMP_abs_y:
+    GetAbs_Y
+    DoCMP
+    Continue
+
+op_CMP_ind_x: // 0xc1
+    FetchOperand_B
+blk_CMP_ind_x:
+    GetIndZPage_X
+    DoCMP
+    Continue
+
+op_CMP_ind_y: // 0xd1
+    FetchOperand_B
+blk_CMP_ind_y:
+    GetIndZPage_Y
+    DoCMP
+    Continue
+
+// 65c02 : 0xD2
+op_CMP_ind_zpage:
+    FetchOperand_B
+blk_CMP_ind_zpage:
+    GetIndZPage
+    DoCMP
+    Continue
+
+/* ----------------------------------
+       CPX/CPY instructions
+       ComPare memory and X/Y register
+   ---------------------------------- */
+
+op_CPX_imm: // 0xe0
+    FetchOperand_Imm
+blk_CPX_imm:
+    GetImm
+    DoCPX
+    Continue
+
+op_CPX_zpage: // 0xe4
+    FetchOperand_B
+blk_CPX_zpage:
+    GetZPage
+    DoCPX
+    Continue
+
+op_CPX_abs: // 0xec
+    FetchOperand_W
+blk_CPX_abs:
+    GetAbs
+    DoCPX
+    Continue
+
+op_CPY_imm: // 0xc0
+    FetchOperand_Imm
+blk_CPY_imm:
+    GetImm
+    DoCPY
+    Continue
+
+op_CPY_zpage: // 0xc4
+    FetchOperand_B
+blk_CPY_zpage:
+    GetZPage
+    DoCPY
+    Continue
+
+op_CPY_abs: // 0xcc
+    FetchOperand_W
+blk_CPY_abs:
+    GetAbs
+    DoCPY
+    Continue
+
+/* ----------------------------------
+       DEC instructions
+       DECrement memory or register by one
+   ---------------------------------- */
+
+op_DEA: // 0x3A
+    _DoDEC(a)
+    Continue
+
+op_DEC_zpage: // 0xc6
+    FetchOperand_B
+blk_DEC_zpage:
+    GetZPage
+    DoDEC
+    Continue
+
+op_DEC_zpage_x: // 0xd6
+    FetchOperand_B
+blk_DEC_zpage_x:
+    GetZPage_X
+    DoDEC
+    Continue
+
+op_DEC_abs: // 0xce
+    FetchOperand_W
+blk_DEC_abs:
+    GetAbs
+    DoDEC
+    Continue
+
+op_DEC_abs_x: // 0xde
+    FetchOperand_W
+blk_DEC_abs_x:
+    GetAbs_X
+    DoDEC
+    Continue
+
+op_DEX: // 0xca
+    _DoDEC(x)
+    Continue
+
+op_DEY: // 0x88
+    _DoDEC(y)
+    Continue
+
+/* ----------------------------------
+       EOR instructions
+       Exclusive OR memory with accumulator
+   ---------------------------------- */
+
+op_EOR_imm: // 0x49
+    FetchOperand_Imm
+blk_EOR_imm:
+    GetImm
+    DoEOR
+    Continue
+
+op_EOR_zpage: // 0x45
+    FetchOperand_B
+blk_EOR_zpage:
+    GetZPage
+    DoEOR
+    Continue
+
+op_EOR_zpage_x: // 0x55
+    FetchOperand_B
+blk_EOR_zpage_x:
+    GetZPage_X
+    DoEOR
+    Continue
+
+op_EOR_abs: // 0x4d
+    FetchOperand_W
+blk_EOR_abs:
+    GetAbs
+    DoEOR
+    Continue
+
+op_EOR_abs_x: // 0x5d
+    FetchOperand_W
+blk_EOR_abs_x:
+    GetAbs_X
+    DoEOR
+    Continue
+
+op_EOR_abs_y: // 0x59
+    FetchOperand_W
+blk_EOR_abs_y:
+    GetAbs_Y
+    DoEOR
+    Continue
+
+op_EOR_ind_x: // 0x41
+    FetchOperand_B
+blk_EOR_ind_x:
+    GetIndZPage_X
+    DoEOR
+    Continue
+
+op_EOR_ind_y: // 0x51
+    FetchOperand_B
+blk_EOR_ind_y:
+    GetIndZPage_Y
+    DoEOR
+    Continue
+
+// 65c02 : 0x52
+op_EOR_ind_zpage:
+    FetchOperand_B
+blk_EOR_ind_zpage:
+    GetIndZPage
+    DoEOR
+    Continue
+
+/* ----------------------------------
+       INC instructions
+       INCrement memory or register by one
+   ---------------------------------- */
+
+op_INA: // 0x1A
+    _DoINC(a)
+    Continue
+
+op_INC_zpage: // 0xe6
+    FetchOperand_B
+blk_INC_zpage:
+    GetZPage
+    DoINC
+    Continue
+
+op_INC_zpage_x: // 0xf6
+    FetchOperand_B
+blk_INC_zpage_x:
+    GetZPage_X
+    DoINC
+    Continue
+
+op_INC_abs: // 0xee
+    FetchOperand_W
+blk_INC_abs:
+    GetAbs
+    DoINC
+    Continue
+
+op_INC_abs_x: // 0xfe
+    FetchOperand_W
+blk_INC_abs_x:
+    GetAbs_X
+    DoINC
+    Continue
+
+op_INX: // 0xe8
+    _DoINC(x)
+    Continue
+
+op_INY: // 0xc8
+    _DoINC(y)
+    Continue
+
+/* ----------------------------------
+       JMP instructions
+       JuMP to new location
+   ---------------------------------- */
+
+op_JMP_abs: // 0x4c
+    FetchOperand_W
+blk_JMP_abs:
+    GetAbs
+    pc = ea;
+    Continue
+
+op_JMP_ind: // 0x6c
+    FetchOperand_W
+blk_JMP_ind:
+    if ((w & 0xFF) == 0xFF) {
+        // see JMP indirect note in _Understanding the Apple IIe_ 4-25
+        GetFromMem_B(w & 0xFF00, hi)
+        GetFromMem_B(w, b)
+        pc = (hi << 8) | b;
+    } else {
+        GetFromMem_W(w, pc)
+    }
+    Continue
+
+// 65c02 : 0x7C
+op_JMP_abs_ind_x:
+    FetchOperand_W
+blk_JMP_abs_ind_x:
+    ea = w + x;
+    GetFromMem_W(ea, pc)
+    Continue
+
+/* ----------------------------------
+       JSR instruction
+   ---------------------------------- */
+
+op_JSR: // 0x20
+    FetchOperand_W
+blk_JSR:
+    GetAbs
+    w = pc - 1;
+    Push(w >> 8)
+    Push(w & 0xFF)
+    pc = ea;
+    Continue
+
+/* ----------------------------------
+       LDx instructions
+       LoaD register with memory
+   ---------------------------------- */
+
+op_LDA_imm: // 0xa9
+    FetchOperand_Imm
+blk_LDA_imm:
+    GetImm
+    DoLDA
+    Continue
+
+op_LDA_zpage: // 0xa5
+    FetchOperand_B
+blk_LDA_zpage:
+    GetZPage
+    DoLDA
+    Continue
+
+op_LDA_zpage_x: // 0xb5
+    FetchOperand_B
+blk_LDA_zpage_x:
+    GetZPage_X
+    DoLDA
+    Continue
+
+op_LDA_abs: // 0xad
+    FetchOperand_W
+blk_LDA_abs:
+    GetAbs
+    DoLDA
+    Continue
+
+op_LDA_abs_x: // 0xbd
+    FetchOperand_W
+blk_LDA_abs_x:
+    GetAbs_X
+    DoLDA
+    Continue
+
+op_LDA_abs_y: // 0xb9
+    FetchOperand_W
+blk_LDA_abs_y:
+    GetAbs_Y
+    DoLDA
+    Continue
+
+op_LDA_ind_x: // 0xa1
+    FetchOperand_B
+blk_LDA_ind_x:
+    GetIndZPage_X
+    DoLDA
+    Continue
+
+op_LDA_ind_y: // 0xb1
+    FetchOperand_B
+blk_LDA_ind_y:
+    GetIndZPage_Y
+    DoLDA
+    Continue
+
+// 65c02 : 0xB2
+op_LDA_ind_zpage:
+    FetchOperand_B
+blk_LDA_ind_zpage:
+    GetIndZPage
+    DoLDA
+    Continue
+
+op_LDX_imm: // 0xa2
+    FetchOperand_Imm
+blk_LDX_imm:
+    GetImm
+    DoLDX
+    Continue
+
+op_LDX_zpage: // 0xa6
+    FetchOperand_B
+blk_LDX_zpage:
+    GetZPage
+    DoLDX
+    Continue
+
+op_LDX_zpage_y: // 0xb6
+    FetchOperand_B
+blk_LDX_zpage_y:
+    GetZPage_Y
+    DoLDX
+    Continue
+
+op_LDX_abs: // 0xae
+    FetchOperand_W
+blk_LDX_abs:
+    GetAbs
+    DoLDX
+    Continue
+
+op_LDX_abs_y: // 0xbe
+    FetchOperand_W
+blk_LDX_abs_y:
+    GetAbs_Y
+    DoLDX
+    Continue
+
+op_LDY_imm: // 0xa0
+    FetchOperand_Imm
+blk_LDY_imm:
+    GetImm
+    DoLDY
+    Continue
+
+op_LDY_zpage: // 0xa4
+    FetchOperand_B
+blk_LDY_zpage:
+    GetZPage
+    DoLDY
+    Continue
+
+op_LDY_zpage_x: // 0xb4
+    FetchOperand_B
+blk_LDY_zpage_x:
+    GetZPage_X
+    DoLDY
+    Continue
+
+op_LDY_abs: // 0xac
+    FetchOperand_W
+blk_LDY_abs:
+    GetAbs
+    DoLDY
+    Continue
+
+op_LDY_abs_x: // 0xbc
+    FetchOperand_W
+blk_LDY_abs_x:
+    GetAbs_X
+    DoLDY
+    Continue
+
+/* ----------------------------------
+       LSR instructions
+       Logical Shift one bit Right, memory or accumulator
+   ---------------------------------- */
+
+op_LSR_acc: // 0x4a
+    _DoLSR(a)
+    Continue
+
+op_LSR_zpage: // 0x46
+    FetchOperand_B
+blk_LSR_zpage:
+    GetZPage
+    DoLSR
+    Continue
+
+op_LSR_zpage_x: // 0x56
+    FetchOperand_B
+blk_LSR_zpage_x:
+    GetZPage_X
+    DoLSR
+    Continue
+
+op_LSR_abs: // 0x4e
+    FetchOperand_W
+blk_LSR_abs:
+    GetAbs
+    DoLSR
+    Continue
+
+op_LSR_abs_x: // 0x5e
+    FetchOperand_W
+blk_LSR_abs_x:
+    GetAbs_X
+    DoLSR
+    Continue
+
+/* ----------------------------------
+       NOP instructions
+       ??? instruction - 65c02 : defined as NOPs by spec
+       RMBx/SMBx/STP/WAI - UNIMPLEMENTED : These are documented in the W65C02S datasheet ...
+   ---------------------------------- */
+
+op_NOP: // 0xea
+op_UNK_65c02:
+op_RMB0_65c02:
+op_RMB1_65c02:
+op_RMB2_65c02:
+op_RMB3_65c02:
+op_RMB4_65c02:
+op_RMB5_65c02:
+op_RMB6_65c02:
+op_RMB7_65c02:
+op_SMB0_65c02:
+op_SMB1_65c02:
+op_SMB2_65c02:
+op_SMB3_65c02:
+op_SMB4_65c02:
+op_SMB5_65c02:
+op_SMB6_65c02:
+op_SMB7_65c02:
+op_STP_65c02:
+op_WAI_65c02:
+    Continue
+
+/* ----------------------------------
+       ORA instructions
+       logical inclusive OR memory with accumulator
+   ---------------------------------- */
+
+op_ORA_imm: // 0x09
+    FetchOperand_Imm
+blk_ORA_imm:
+    GetImm
+    DoORA
+    Continue
+
+op_ORA_zpage: // 0x05
+    FetchOperand_B
+blk_ORA_zpage:
+    GetZPage
+    DoORA
+    Continue
+
+op_ORA_zpage_x: // 0x15
+    FetchOperand_B
+blk_ORA_zpage_x:
+    GetZPage_X
+    DoORA
+    Continue
+
+op_ORA_abs: // 0x0d
+    FetchOperand_W
+blk_ORA_abs:
+    GetAbs
+    DoORA
+    Continue
+
+op_ORA_abs_x: // 0x1d
+    FetchOperand_W
+blk_ORA_abs_x:
+    GetAbs_X
+    DoORA
+    Continue
+
+op_ORA_abs_y: // 0x19
+    FetchOperand_W
+blk_ORA_abs_y:
+    GetAbs_Y
+    DoORA
+    Continue
+
+op_ORA_ind_x: // 0x01
+    FetchOperand_B
+blk_ORA_ind_x:
+    GetIndZPage_X
+    DoORA
+    Continue
+
+op_ORA_ind_y: // 0x11
+    FetchOperand_B
+blk_ORA_ind_y:
+    GetIndZPage_Y
+    DoORA
+    Continue
+
+// 65c02 : 0x12
+op_ORA_ind_zpage:
+    FetchOperand_B
+blk_ORA_ind_zpage:
+    GetIndZPage
+    DoORA
+    Continue
+
+/* ----------------------------------
+       PHx/PLx instructions
+   ---------------------------------- */
+
+op_PHA: // 0x48
+    Push(a)
+    Continue
+
+op_PHP: // 0x08
+    Push(cpu65_flags_encode[f])
+    Continue
+
+// 65c02 : 0xDA
+op_PHX:
+    Push(x)
+    Continue
+
+// 65c02 : 0x5A
+op_PHY:
+    Push(y)
+    Continue
+
+op_PLA: // 0x68
+    Pop(a)
+    FlagNZ(a)
+    Continue
+
+op_PLP: // 0x28
+    Pop(b)
+    f = cpu65_flags_decode[b] | (B_Flag|X_Flag);
+    Continue
+
+// 65c02 : 0xFA
+op_PLX:
+    Pop(x)
+    FlagNZ(x)
+    Continue
+
+// 65c02 : 0x7A
+op_PLY:
+    Pop(y)
+    FlagNZ(y)
+    Continue
+
+/* ----------------------------------
+       ROL/ROR instructions
+       ROtate one bit Left/Right, memory or accumulator
+   ---------------------------------- */
+
+op_ROL_acc: // 0x2a
+    _DoROL(a)
+    Continue
+
+op_ROL_zpage: // 0x26
+    FetchOperand_B
+blk_ROL_zpage:
+    GetZPage
+    DoROL
+    Continue
+
+op_ROL_zpage_x: // 0x36
+    FetchOperand_B
+blk_ROL_zpage_x:
+    GetZPage_X
+    DoROL
+    Continue
+
+op_ROL_abs: // 0x2e
+    FetchOperand_W
+blk_ROL_abs:
+    GetAbs
+    DoROL
+    Continue
+
+op_ROL_abs_x: // 0x3e
+    FetchOperand_W
+blk_ROL_abs_x:
+    GetAbs_X
+    DoROL
+    Continue
+
+op_ROR_acc: // 0x6a
+    _DoROR(a)
+    Continue
+
+op_ROR_zpage: // 0x66
+    FetchOperand_B
+blk_ROR_zpage:
+    GetZPage
+    DoROR
+    Continue
+
+op_ROR_zpage_x: // 0x76
+    FetchOperand_B
+blk_ROR_zpage_x:
+    GetZPage_X
+    DoROR
+    Continue
+
+op_ROR_abs: // 0x6e
+    FetchOperand_W
+blk_ROR_abs:
+    GetAbs
+    DoROR
+    Continue
+
+op_ROR_abs_x: // 0x7e
+    FetchOperand_W
+blk_ROR_abs_x:
+    GetAbs_X
+    DoROR
+    Continue
+
+/* ----------------------------------
+       RTI/RTS instructions
+   ---------------------------------- */
+
+op_RTI: // 0x40
+    Pop(b)
+    f = cpu65_flags_decode[b] | (B_Flag|X_Flag);
+    Pop(b)
+    Pop(hi)
+    pc = (hi << 8) | b;
+    Continue
+
+op_RTS: // 0x60
+    Pop(b)
+    Pop(hi)
+    pc = ((hi << 8) | b) + 1;
+    Continue
+
+/* ----------------------------------
+       SBC instructions
+       SuBtract memory from accumulator with Borrow
+   ---------------------------------- */
+
+// Decimal mode
+op_SBC_dec:
+    {
+        ++cpu65_opcycles; // +1 cycle
+        GetFromEA_B(b)
+        DebugBCDCheck(b)
+
+        // DAS algorithm : http://www.ray.masmcode.com/BCDdas.html
+        // CF_old = CF
+        // IF (al AND 0Fh > 9) or (the Auxiliary Flag is set)
+        //    al = al - 6
+        //    CF = CF (automagically) or CF_old
+        //    AF set (automagically)
+        // ENDIF
+        // IF (al > 99h) or (Carry Flag is set)
+        //    al = al - 60h
+        //    ^CF set
+        // ENDIF
+        const uint8_t borrow = (f & C_Flag) ? 0 : 1;
+        const bool aux = (a & 0x0f) < ((b & 0x0f) + borrow);
+        bool adjust_hi = a < (b + borrow);
+        uint8_t al = (uint8_t)(a - b - borrow);
+        f &= ~(N_Flag|V_Flag|Z_Flag);
+        f |= C_Flag;
+        if (((al & 0x0f) > 9) || aux) {
+            if (al < 6) {
+                adjust_hi = true; // adjust lo nybble borrowed
+            }
+            al -= 6;
+        }
+        if (adjust_hi || (al > 0x99)) {
+            al -= 0x60; // adjust hi nybble
+            f &= ~C_Flag;
+        }
+        a = al;
+        f |= (a & 0x80) ? N_Flag : 0;
+        f |= a ? 0 : Z_Flag;
+    }
+    Continue
+
+op_SBC_imm: // 0xe9
+    FetchOperand_Imm
+blk_SBC_imm:
+    GetImm
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+op_SBC_zpage: // 0xe5
+    FetchOperand_B
+blk_SBC_zpage:
+    GetZPage
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+op_SBC_zpage_x: // 0xf5
+    FetchOperand_B
+blk_SBC_zpage_x:
+    GetZPage_X
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+op_SBC_abs: // 0xed
+    FetchOperand_W
+blk_SBC_abs:
+    GetAbs
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+op_SBC_abs_x: // 0xfd
+    FetchOperand_W
+blk_SBC_abs_x:
+    GetAbs_X
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+op_SBC_abs_y: // 0xf9
+    FetchOperand_W
+blk_SBC_abs_y:
+    GetAbs_Y
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+op_SBC_ind_x: // 0xe1
+    FetchOperand_B
+blk_SBC_ind_x:
+    GetIndZPage_X
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+op_SBC_ind_y: // 0xf1
+    FetchOperand_B
+blk_SBC_ind_y:
+    GetIndZPage_Y
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+// 65c02 : 0xF2
+op_SBC_ind_zpage:
+    FetchOperand_B
+blk_SBC_ind_zpage:
+    GetIndZPage
+    maybe_DoSBC_d
+    DoSBC_b
+    Continue
+
+/* ----------------------------------
+       STx instructions
+       STore register in memory
+   ---------------------------------- */
+
+op_STA_zpage: // 0x85
+    FetchOperand_B
+blk_STA_zpage:
+    GetZPage
+    DoSTA
+    Continue
+
+op_STA_zpage_x: // 0x95
+    FetchOperand_B
+blk_STA_zpage_x:
+    GetZPage_X
+    DoSTA
+    Continue
+
+op_STA_abs: // 0x8d
+    FetchOperand_W
+blk_STA_abs:
+    GetAbs
+    DoSTA
+    Continue
+
+op_STA_abs_x: // 0x9d
+    FetchOperand_W
+blk_STA_abs_x:
+    GetAbs_X_STx
+    DoSTA
+    Continue
+
+op_STA_abs_y: // 0x99
+    FetchOperand_W
+blk_STA_abs_y:
+    GetAbs_Y_STA
+    DoSTA
+    Continue
+
+op_STA_ind_x: // 0x81
+    FetchOperand_B
+blk_STA_ind_x:
+    GetIndZPage_X
+    DoSTA
+    Continue
+
+op_STA_ind_y: // 0x91
+    FetchOperand_B
+blk_STA_ind_y:
+    GetIndZPage_Y_STA
+    DoSTA
+    Continue
+
+// 65c02 : 0x92
+op_STA_ind_zpage:
+    FetchOperand_B
+blk_STA_ind_zpage:
+    GetIndZPage
+    DoSTA
+    Continue
+
+op_STX_zpage: // 0x86
+    FetchOperand_B
+blk_STX_zpage:
+    GetZPage
+    DoSTX
+    Continue
+
+op_STX_zpage_y: // 0x96
+    FetchOperand_B
+blk_STX_zpage_y:
+    GetZPage_Y
+    DoSTX
+    Continue
+
+op_STX_abs: // 0x8e
+    FetchOperand_W
+blk_STX_abs:
+    GetAbs
+    DoSTX
+    Continue
+
+op_STY_zpage: // 0x84
+    FetchOperand_B
+blk_STY_zpage:
+    GetZPage
+    DoSTY
+    Continue
+
+op_STY_zpage_x: // 0x94
+    FetchOperand_B
+blk_STY_zpage_x:
+    GetZPage_X
+    DoSTY
+    Continue
+
+op_STY_abs: // 0x8c
+    FetchOperand_W
+blk_STY_abs:
+    GetAbs
+    DoSTY
+    Continue
+
+// 65c02 : 0x64
+op_STZ_zpage:
+    FetchOperand_B
+blk_STZ_zpage:
+    GetZPage
+    DoSTZ
+    Continue
+
+// 65c02 : 0x74
+op_STZ_zpage_x:
+    FetchOperand_B
+blk_STZ_zpage_x:
+    GetZPage_X
+    DoSTZ
+    Continue
+
+// 65c02 : 0x9C
+op_STZ_abs:
+    FetchOperand_W
+blk_STZ_abs:
+    GetAbs
+    DoSTZ
+    Continue
+
+// 65c02 : 0x9E
+op_STZ_abs_x:
+    FetchOperand_W
+blk_STZ_abs_x:
+    GetAbs_X_STx
+    DoSTZ
+    Continue
+
+/* ----------------------------------
+       TRB/TSB instructions - 65c02 only
+   ---------------------------------- */
+
+// 65c02 : 0x1C
+op_TRB_abs:
+    FetchOperand_W
+blk_TRB_abs:
+    GetAbs
+    DoTRB
+    Continue
+
+// 65c02 : 0x14
+op_TRB_zpage:
+    FetchOperand_B
+blk_TRB_zpage:
+    GetZPage
+    DoTRB
+    Continue
+
+// 65c02 : 0x0C
+op_TSB_abs:
+    FetchOperand_W
+blk_TSB_abs:
+    GetAbs
+    DoTSB
+    Continue
+
+// 65c02 : 0x04
+op_TSB_zpage:
+    FetchOperand_B
+blk_TSB_zpage:
+    GetZPage
+    DoTSB
+    Continue
+
+/* ----------------------------------
+       Txx transfer instructions
+   ---------------------------------- */
+
+op_TAX: // 0xaa
+    x = a;
+    FlagNZ(x)
+    Continue
+
+op_TAY: // 0xa8
+    y = a;
+    FlagNZ(y)
+    Continue
+
+op_TSX: // 0xba
+    x = sp;
+    FlagNZ(x)
+    Continue
+
+op_TXA: // 0x8a
+    a = x;
+    FlagNZ(a)
+    Continue
+
+op_TXS: // 0x9a
+    sp = x;
+    Continue
+
+op_TYA: // 0x98
+    a = y;
+    FlagNZ(a)
+    Continue
+
+/* -------------------------------------------------------------------------
+        Exception handlers
+   ------------------------------------------------------------------------- */
+
+exception:
+    if (cpu65__signal & ResetSig) {
+        if (gc_button_0 || gc_button_1) { // OpenApple || ClosedApple
+            goto exit_reinit;
+        }
+        goto ex_reset;
+    }
+
+    // ex_irq
+    if (f & I_Flag) {
+        goto next_instruction; // Already interrupted (ignored) ...
+    }
+    Push(pc >> 8)
+    Push(pc & 0xFF)
+    f |= X_Flag;
+    Push(cpu65_flags_encode[f])
+    f |= (B_Flag|I_Flag);
+    //f &= ~D_Flag; // AppleWin clears Decimal bit?
+    ea = 0xFFFE;
+    GetFromEA_W(pc)
+    goto next_instruction;
+
+ex_reset:
+    cpu65__signal = 0;
+    ea = 0xFFFC; // ROM reset vector
+    GetFromEA_W(pc)
+    goto next_instruction;
+
+/* -------------------------------------------------------------------------
+        65c02 CPU processing loop exit point
+   ------------------------------------------------------------------------- */
+
+exit_cpu65_run:
+    // Save CPU state when returning from being called from C
+    cpu65_pc = pc;
+    CommonSaveCPUState();
+    return;
+
+exit_reinit:
+    cpu65__signal = 0;
+    emul_reinitialize = 1;
+}
+
+#if CPU_JIT
+/* -------------------------------------------------------------------------
+        Native block callouts (I/O pages, writes to pages holding decoded blocks)
+   ------------------------------------------------------------------------- */
+
+static void _jit65_sync(jit65_state_t *st, uint8_t rw) {
+    const int n = (st->cur & 0xFFFF) + st->xcycles - st->committed;
+    st->committed += n;
+    CommitCycles(n)
+    st->brk = 1;
+    cpu65_opcode = (st->cur >> 16) & 0xFF;
+    cpu65_rw = (st->cur >> 24) | rw;
+}
+
+uint8_t c_jit65_read(jit65_state_t *st, uint16_t ea) {
+    _jit65_sync(st, MEM_READ_FLAG);
+    cpu65_io_pc = (uint16_t)st->pc;
+    return ((VMemRead)cpu65_vmem_r[ea])(ea);
+}
+
+void c_jit65_write(jit65_state_t *st, uint16_t ea, uint8_t b) {
+    if (block_pages[ea >> 8]) {
+        _block_invalidate_page(ea >> 8);
+        BlockSMC(ea >> 8)
+        st->brk = 1;
+    }
+    uint8_t **bank = cpu65_vmem_wpage[ea >> 8];
+    uint8_t *base;
+    if (bank && (base = *bank)) {
+        base[ea] = b;
+    } else {
+        _jit65_sync(st, MEM_WRITE_FLAG);
+        cpu65_d = b;
+        ((VMemWrite)cpu65_vmem_w[ea])(ea, b);
+    }
+}
+#endif
+
+/* -------------------------------------------------------------------------
+        Debugger hooks
+   ------------------------------------------------------------------------- */
+
+void cpu65_direct_write(int ea, int data) {
+    ea &= 0xFFFF;
+    if (block_pages[ea >> 8]) {
+        _block_invalidate_page(ea >> 8);
+    }
+    ((VMemWrite)cpu65_vmem_w[ea])((uint16_t)ea, (uint8_t)data);
+}
+
+void cpu65_invalidate_blocks(void) {
+    for (unsigned int page = 0; page < 0x100; page++) {
+        _block_invalidate_page(page);
+    }
+}
+
+#endif // CPU_C_CORE
@@ -40,6 +40,10 @@ extern uint8_t  cpu65_d;        // Last data byte written
 extern uint8_t  cpu65_rw;       // MEM_READ_FLAG = read occured, MEM_WRITE_FLAG = write
 extern uint8_t  cpu65_opcode;   // Last opcode
 extern uint8_t  cpu65_opcycles; // Last opcode extra cycles
+extern uint16_t cpu65_io_pc;    // Address following the instruction performing the current softswitch read
+
+/* Instructions executed per opcode (C core), counted by cpu65_run() when non-NULL */
+extern unsigned long long *cpu65_opcode_counts;
 
 /* Set up the processor for a new run. Sets up opcode table. */
 extern void cpu65_init();
@@ -56,19 +60,110 @@ extern bool cpu65_loadState(StateHelper_s *helper);
 
 extern void cpu65_direct_write(int ea,int data);
 
+/* Drop decoded blocks (C core), needed after writing emulated memory without going through the CPU */
+extern void cpu65_invalidate_blocks(void);
+
 extern void *cpu65_vmem_r[65536];
 extern void *cpu65_vmem_w[65536];
 
+/* Page-granular dispatch : a non-NULL entry points at the base_* bank pointer backing the whole 256-byte page, so
+ * plain RAM/ROM accesses index memory directly instead of calling through cpu65_vmem_r/cpu65_vmem_w.  NULL entries
+ * (softswitches, slot I/O, video-hooked pages) use the per-address handlers.  Rebuilt by vm_initialize(). */
+extern uint8_t **cpu65_vmem_rpage[256];
+extern uint8_t **cpu65_vmem_wpage[256];
+
 extern unsigned char cpu65_flags_encode[256];
 extern unsigned char cpu65_flags_decode[256];
 
 extern int32_t cpu65_cycle_count;
+extern int32_t cpu65_cycles_to_execute;
+
+extern uint8_t cpu65__signal;
+
+#if CPU_C_CORE
+/* Basic-block cache of the C core (cpu.c) */
+#define BLOCK_CACHE_SIZE 4096 // power of 2
+#define BLOCK_MAX_INSNS 16
+
+typedef struct block_insn_t {
+    void *body;     // handler entry point past the operand fetch
+    uint16_t pc;    // PC after the operand fetch
+    uint16_t ea;    // EA after the operand fetch
+    uint16_t operand;
+    uint8_t opcode;
+    uint8_t cycles; // base cycles of the preceding instructions in the block
+} block_insn_t;
+
+typedef struct block_t {
+    uint8_t *bank;      // bank backing the page of the block when decoded
+    uint32_t gen;       // page generation when decoded
+    uint16_t pc;
+    uint8_t count;
+    uint8_t max_cycles; // worst case including page crossing, branches and decimal mode
+#if CPU_JIT
+    uint8_t hits;       // executions until JIT_HOT_THRESHOLD
+    void *jit;          // native code
+#endif
+    block_insn_t insns[BLOCK_MAX_INSNS+1]; // insns[count].cycles holds the block base cycles
+} block_t;
+#endif
 
 #if CPU_TRACING
-void cpu65_trace_begin(const char *trace_file);
+/*
+ * Binary CPU trace : a fixed-size record per instruction is stored into a ring buffer memory-mapped from the trace
+ * file, so the file holds the last instructions even if the emulator crashes.  Decode it offline with
+ * cpu65_trace_decode() (apple2ix-tracedump).
+ */
+#define CPU_TRACE_MAGIC "A2CPUTRC"
+#define CPU_TRACE_VERSION 1
+#define CPU_TRACE_DEFAULT_RECORDS (4*1024*1024) // 64MB
+
+#define CPU_TRACE_INSN 0
+#define CPU_TRACE_CHECKPOINT 1
+
+typedef struct cpu65_trace_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;          // records in the ring
+    uint64_t count;             // records written (the ring holds the last min(count, capacity) records)
+} cpu65_trace_header_t;
+
+typedef union cpu65_trace_record_t {
+    struct {
+        uint8_t kind;           // CPU_TRACE_INSN
+        uint8_t opcode;
+        uint16_t pc;
+        uint16_t ea;
+        uint8_t arg1;
+        uint8_t arg2;
+        uint8_t a;
+        uint8_t x;
+        uint8_t y;
+        uint8_t sp;
+        uint8_t f;
+        uint8_t cycles;
+    } insn;
+    struct {
+        uint8_t kind;           // CPU_TRACE_CHECKPOINT
+        uint8_t reserved[7];
+        uint64_t cycles_total;
+    } checkpoint;
+} cpu65_trace_record_t;
+
+/*
+ * Begin tracing into a ring of the given number of records (0 : CPU_TRACE_DEFAULT_RECORDS)
+ */
+void cpu65_trace_begin(const char *trace_file, unsigned long records);
 void cpu65_trace_end(void);
 void cpu65_trace_toggle(const char *trace_file);
+bool cpu65_trace_is_enabled(void);
 void cpu65_trace_checkpoint(void);
+
+/*
+ * Disassemble a binary trace file to text, oldest record first
+ */
+bool cpu65_trace_decode(const char *trace_file, FILE *out);
 #endif
 
 #endif /* !__ASSEMBLER__ */
@@ -80,11 +175,27 @@ void cpu65_trace_checkpoint(void);
 #define IRQMouse        0x40
 #define IRQGeneric      0x80
 
+#if defined(__aarch64__) && !CPU_C_CORE
+#   error aarch64 is only supported with the portable C CPU core (CPU_C_CORE)
+#endif
+
 /* Note: These are *not* the bit positions used for the flags in the P
  * register of a real 65c02. Rather, they have been distorted so that C,
  * N, Z, etc match the analogous flags in the host flags register.
  */
-#if defined(__i386__) || defined(__x86_64__)
+#if CPU_C_CORE
+/*
+ * Portable C core NOTE: no host flags register to match, so these are simply the 6502 bit positions
+ */
+#   define C_Flag          0x1             /* 6502 Carry              */
+#   define Z_Flag          0x2             /* 6502 Zero               */
+#   define I_Flag          0x4             /* 6502 Interrupt disable  */
+#   define D_Flag          0x8             /* 6502 Decimal mode       */
+#   define B_Flag          0x10            /* 6502 Break              */
+#   define X_Flag          0x20            /* 6502 Xtra               */
+#   define V_Flag          0x40            /* 6502 oVerflow           */
+#   define N_Flag          0x80            /* 6502 Negative           */
+#elif defined(__i386__) || defined(__x86_64__)
 /*
  * x86 NOTE: V matches the position of the overflow flag in the high byte
  * of the 80386 register.
@@ -114,8 +225,6 @@ void cpu65_trace_checkpoint(void);
 #   define D_Flag          0x80
 #   define BX_Flags        0x50
 #   define BI_Flags        0x60
-#elif defined(__aarch64__)
-#   error soon ...
 #else
 #   error unknown machine architecture
 #endif
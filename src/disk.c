@@ -28,12 +28,18 @@ static FILE *test_write_fp = NULL;
 
 extern uint8_t slot6_rom[256];
 
+#if MACHINE_CONTEXT
+#   define disk_a (current_machine->disk_a)
+#   define disk_b (current_machine->disk_b)
+#   define stepper_phases (current_machine->stepper_phases)
+#else
 drive_t disk6;
 
 static uint8_t disk_a[NIB_SIZE] = { 0 };
 static uint8_t disk_b[NIB_SIZE] = { 0 };
 
 static int stepper_phases = 0; // state bits for stepper magnet phases 0-3
+#endif
 static int skew_table_6_po[16] = { 0x00,0x08,0x01,0x09,0x02,0x0A,0x03,0x0B, 0x04,0x0C,0x05,0x0D,0x06,0x0E,0x07,0x0F }; // ProDOS order
 static int skew_table_6_do[16] = { 0x00,0x07,0x0E,0x06,0x0D,0x05,0x0C,0x04, 0x0B,0x03,0x0A,0x02,0x09,0x01,0x08,0x0F }; // DOS order
 
@@ -90,6 +96,8 @@ static void _init_disk6(void) {
     }
 }
 
+#define TRACK_BIT(trk) (1ULL << (trk))
+
 static inline bool is_nib(const char * const name) {
     size_t len = strlen(name);
     if (len <= _NIBLEN) {
@@ -251,7 +259,7 @@ static void denibblize_sector(const uint8_t * const src, uint8_t * const out) {
 #define CODE44A(a) ((((a)>> 1) & 0x55) | 0xAA)
 #define CODE44B(b) (((b) & 0x55) | 0xAA)
 
-static unsigned long nibblize_track(const uint8_t * const buf, int drive, uint8_t *output) {
+static unsigned long nibblize_track(const uint8_t * const buf, int drive, unsigned int track, uint8_t *output) {
     SCOPE_TRACE_DISK("nibblize_track");
 
     uint8_t * const begin_track = output;
@@ -283,7 +291,6 @@ static unsigned long nibblize_track(const uint8_t * const buf, int drive, uint8_
         *(output)++ = CODE44B(DSK_VOLUME);
 
         // Track    (4-and-4 encoded)
-        int track = (disk6.disk[drive].phase>>1);
         *(output)++ = CODE44A(track);
         *(output)++ = CODE44B(track);
 
@@ -341,17 +348,12 @@ static unsigned long nibblize_track(const uint8_t * const buf, int drive, uint8_
     return output - begin_track;
 }
 
-static void denibblize_track(const uint8_t * const src, int drive, uint8_t * const dst) {
+static void denibblize_track(const uint8_t * const src, const long track_width, const int * const skew_table, unsigned int track, uint8_t * const dst) {
     SCOPE_TRACE_DISK("denibblize_track");
 
     // Searches through the track data for each sector and decodes it
 
     const uint8_t * const trackimage = src;
-#if DISK_TRACING
-    if (test_write_fp) {
-        fprintf(test_write_fp, "DSK OUT:\n");
-    }
-#endif
 
     unsigned int offset = 0;
     int sector = -1;
@@ -368,7 +370,7 @@ static void denibblize_track(const uint8_t * const src, int drive, uint8_t * con
                 ++idx;
             }
             ++offset;
-            if (offset >= disk6.disk[drive].track_width) {
+            if (offset >= track_width) {
                 offset = 0;
             }
             if (idx >= 3) {
@@ -384,9 +386,9 @@ static void denibblize_track(const uint8_t * const src, int drive, uint8_t * con
         if (prologue[2] == 0x96) {
             // found header prologue : extract sector
             offset += SCTOFF;
-            if (offset >= disk6.disk[drive].track_width) {
+            if (offset >= track_width) {
                 RELEASE_LOG("WRAPPING PROLOGUE ...");
-                offset -= disk6.disk[drive].track_width;
+                offset -= track_width;
             }
             sector = ((trackimage[offset++] & 0x55) << 1);
             sector |= (trackimage[offset++] & 0x55);
@@ -403,31 +405,182 @@ static void denibblize_track(const uint8_t * const src, int drive, uint8_t * con
         for (unsigned int idx=0; idx<(NUM_SIXBIT_NIBS+1); idx++) {
             work_buf[idx] = trackimage[offset];
             ++offset;
-            if (offset >= disk6.disk[drive].track_width) {
+            if (offset >= track_width) {
                 offset = 0;
-                LOG("WARNING : wrapping trackimage ... trk:%d sct:%d [0]:0x%02X", (disk6.disk[drive].phase >> 1), sector, trackimage[offset]);
+                LOG("WARNING : wrapping trackimage ... trk:%u sct:%d [0]:0x%02X", track, sector, trackimage[offset]);
             }
         }
         assert(sector >= 0 && sector < 16 && "invalid previous nibblization");
-        int sec_off = 256 * disk6.disk[drive].skew_table[ sector ];
+        int sec_off = 256 * skew_table[ sector ];
         denibblize_sector(work_buf, dst+sec_off);
         sector = -1;
     }
 }
 
-static size_t load_track_data(int drive) {
+// ----------------------------------------------------------------------------
+// Track write-back
+//
+// Written tracks are denibblized into the image and synced to the file by a background thread, so the CPU thread does
+// not block on storage when the head steps.  The writer is shared by all machines and works on a copy of the track :
+// jobs do not refer to the machine context (current_machine is per-thread).  At most DISK_WRITEBACK_QUEUE tracks are
+// queued, the CPU thread waits for a free slot beyond that.
+
+#define DISK_WRITEBACK_QUEUE 8
+
+typedef struct disk_writeback_t {
+    diskette_t *disk;       // track_pending bit cleared once written
+    unsigned int trk;
+    uint8_t *dst;           // track in the mmap()ed image
+    size_t dst_len;
+    bool nibblized;         // NIB image : track written in place, only synced
+    long track_width;
+    int *skew_table;
+    uint8_t nibs[NIB_TRACK_SIZE];
+} disk_writeback_t;
+
+static disk_writeback_t writeback_queue[DISK_WRITEBACK_QUEUE];
+static unsigned int writeback_head = 0;
+static unsigned int writeback_count = 0;
+static bool writeback_running = false;
+static bool writeback_quit = false;
+static pthread_t writeback_thread;
+static pthread_mutex_t writeback_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writeback_cond = PTHREAD_COND_INITIALIZER; // job queued, job written, or quit
+
+static void _writeback_fill(disk_writeback_t *job, diskette_t *disk, unsigned int trk) {
+    job->disk = disk;
+    job->trk = trk;
+    job->nibblized = disk->nibblized;
+    job->track_width = disk->track_width;
+    job->skew_table = disk->skew_table;
+    if (disk->nibblized) {
+        job->dst = disk->mmap_image + NIB_TRACK_SIZE * trk;
+        job->dst_len = NIB_TRACK_SIZE;
+    } else {
+        job->dst = disk->mmap_image + DSK_TRACK_SIZE * trk;
+        job->dst_len = DSK_TRACK_SIZE;
+        memcpy(job->nibs, disk->whole_image + NIB_TRACK_SIZE * trk, disk->track_width);
+    }
+}
+
+static void _writeback_track(disk_writeback_t *job) {
+    if (!job->nibblized) {
+        denibblize_track(job->nibs, job->track_width, job->skew_table, job->trk, job->dst);
+    }
+
+    // msync() needs a page-aligned address (NIB tracks are not)
+    static long page_size = 0;
+    if (!page_size) {
+        page_size = sysconf(_SC_PAGESIZE);
+    }
+    uintptr_t begin = (uintptr_t)job->dst & ~(uintptr_t)(page_size-1);
+    int ret = -1;
+    TEMP_FAILURE_RETRY(ret = msync((void *)begin, (uintptr_t)job->dst + job->dst_len - begin, MS_SYNC));
+    if (ret) {
+        ERRLOG("Error syncing track %u", job->trk);
+    }
+}
+
+static void *_writeback_thread(void *ctx) {
+    pthread_mutex_lock(&writeback_mutex);
+    while (1) {
+        if (!writeback_count) {
+            if (writeback_quit) {
+                break;
+            }
+            pthread_cond_wait(&writeback_cond, &writeback_mutex);
+            continue;
+        }
+
+        // the slot stays owned by the writer until counted out below
+        disk_writeback_t *job = &writeback_queue[writeback_head];
+        pthread_mutex_unlock(&writeback_mutex);
+        _writeback_track(job);
+        pthread_mutex_lock(&writeback_mutex);
+
+        writeback_head = (writeback_head + 1) % DISK_WRITEBACK_QUEUE;
+        --writeback_count;
+
+        // the track may have been queued again meanwhile
+        bool queued = false;
+        for (unsigned int i = 0; i < writeback_count; i++) {
+            disk_writeback_t *next = &writeback_queue[(writeback_head + i) % DISK_WRITEBACK_QUEUE];
+            if (next->disk == job->disk && next->trk == job->trk) {
+                queued = true;
+                break;
+            }
+        }
+        if (!queued) {
+            job->disk->track_pending &= ~TRACK_BIT(job->trk);
+        }
+        pthread_cond_broadcast(&writeback_cond);
+    }
+    writeback_running = false;
+    pthread_mutex_unlock(&writeback_mutex);
+
+    return NULL;
+}
+
+// queue the (dirty) track of a disk for write-back
+static void _writeback_queue(diskette_t *disk, unsigned int trk) {
+    pthread_mutex_lock(&writeback_mutex);
+
+    if (!writeback_running) {
+        writeback_quit = false;
+        if (pthread_create(&writeback_thread, NULL, &_writeback_thread, NULL)) {
+            pthread_mutex_unlock(&writeback_mutex);
+            ERRLOG("OOPS, pthread_create failed, writing back track %u in place", trk);
+            disk_writeback_t *job = malloc(sizeof(disk_writeback_t));
+            if (job) {
+                _writeback_fill(job, disk, trk);
+                _writeback_track(job);
+                FREE(job);
+            }
+            return;
+        }
+        writeback_running = true;
+    }
+
+    while (writeback_count >= DISK_WRITEBACK_QUEUE) {
+        pthread_cond_wait(&writeback_cond, &writeback_mutex);
+    }
+
+    _writeback_fill(&writeback_queue[(writeback_head + writeback_count) % DISK_WRITEBACK_QUEUE], disk, trk);
+    disk->track_pending |= TRACK_BIT(trk);
+    ++writeback_count;
+
+    pthread_cond_broadcast(&writeback_cond);
+    pthread_mutex_unlock(&writeback_mutex);
+}
+
+// wait until the given tracks of a disk are written back
+static void _writeback_wait(diskette_t *disk, uint64_t tracks) {
+    pthread_mutex_lock(&writeback_mutex);
+    while (disk->track_pending & tracks) {
+        pthread_cond_wait(&writeback_cond, &writeback_mutex);
+    }
+    pthread_mutex_unlock(&writeback_mutex);
+}
+
+// ----------------------------------------------------------------------------
+
+// Tracks are nibblized into whole_image on first access and stay there (track_cached bit set) until written back
+static size_t load_track_data(int drive, unsigned int trk) {
     SCOPE_TRACE_DISK("load_track_data");
 
     size_t expected = 0;
 
     if (disk6.disk[drive].nibblized) {
         expected = NIB_TRACK_SIZE;
+    } else if (disk6.disk[drive].track_cached & TRACK_BIT(trk)) {
+        expected = disk6.disk[drive].track_width;
     } else {
         // .dsk, .do, .po images
-        unsigned int trk = (disk6.disk[drive].phase >> 1);
+        _writeback_wait(&disk6.disk[drive], TRACK_BIT(trk)); // the image is not up to date while a write is pending
         uintptr_t dskoff = DSK_TRACK_SIZE * trk;
         uintptr_t niboff = NIB_TRACK_SIZE * trk;
-        expected = nibblize_track(disk6.disk[drive].mmap_image+dskoff, drive, disk6.disk[drive].whole_image+niboff);
+        expected = nibblize_track(disk6.disk[drive].mmap_image+dskoff, drive, trk, disk6.disk[drive].whole_image+niboff);
+        disk6.disk[drive].track_cached |= TRACK_BIT(trk);
     }
 
     return expected;
@@ -437,28 +590,18 @@ static void save_track_data(int drive) {
     SCOPE_TRACE_DISK("save_track_data");
 
     unsigned int trk = (disk6.disk[drive].phase >> 1);
-    uintptr_t niboff = NIB_TRACK_SIZE * trk;
 
-    if (disk6.disk[drive].nibblized) {
-        /*
-        int ret = -1;
-        TEMP_FAILURE_RETRY(ret = msync(disk6.disk[drive].mmap_image+niboff, NIB_TRACK_SIZE, MS_SYNC));
-        if (ret) {
-            ERRLOG("Error syncing file %s", disk6.disk[drive].file_name);
-        }
-        */
-    } else {
-        // .dsk, .do, .po images
-        uintptr_t dskoff = DSK_TRACK_SIZE * trk;
-        denibblize_track(disk6.disk[drive].whole_image+niboff, drive, disk6.disk[drive].mmap_image+dskoff);
-        /*
-        int ret = -1;
-        TEMP_FAILURE_RETRY(ret = msync(disk6.disk[drive].mmap_image+dskoff, DSK_TRACK_SIZE, MS_SYNC));
-        if (ret) {
-            ERRLOG("Error syncing file %s", disk6.disk[drive].file_name);
-        }
-        */
+#if DISK_TRACING
+    if (test_write_fp && !disk6.disk[drive].nibblized) {
+        fprintf(test_write_fp, "DSK OUT:\n");
     }
+#endif
+
+    // denibblized (DSK/DO/PO) and synced in the background
+    _writeback_queue(&disk6.disk[drive], trk);
+
+    // renibblized from the image on the next access (the nibbles written are not necessarily the canonical ones)
+    disk6.disk[drive].track_cached &= ~TRACK_BIT(trk);
 
     disk6.disk[drive].track_dirty = false;
 }
@@ -494,10 +637,15 @@ GLUE_C_READ(disk_read_write_byte)
 
         if (!disk6.disk[disk6.drive].track_valid) {
             assert(!disk6.disk[disk6.drive].track_dirty);
-            // TODO FIXME ... methinks we shouldn't need to reload, but :
+            // NOTE : clean tracks are cached, but written tracks are renibblized after write-back :
             //  * testing shows different intermediate results (SIXBITNIBS, etc)
             //  * could be instability between the {de,}nibblize routines
-            size_t track_width = load_track_data(disk6.drive);
+            struct timespec t0;
+            const bool profiled = timing_profileDeviceBegin(&t0);
+            size_t track_width = load_track_data(disk6.drive, disk6.disk[disk6.drive].phase >> 1);
+            if (UNLIKELY(profiled)) {
+                timing_profileDeviceEnd(&t0, TIMING_DEVICE_DISK);
+            }
             if (track_width != disk6.disk[disk6.drive].track_width) {
                 ////ERRLOG_THROTTLE("OOPS, problem loading track data");
                 break;
@@ -614,7 +762,12 @@ GLUE_C_READ(disk_read_phase)
 
     if (direction) {
         if (disk6.disk[disk6.drive].track_dirty) {
+            struct timespec t0;
+            const bool profiled = timing_profileDeviceBegin(&t0);
             save_track_data(disk6.drive);
+            if (UNLIKELY(profiled)) {
+                timing_profileDeviceEnd(&t0, TIMING_DEVICE_DISK);
+            }
         }
         disk6.disk[disk6.drive].track_valid = false;
         disk6.disk[disk6.drive].phase += direction;
@@ -848,29 +1001,20 @@ const char *disk6_insert(int drive, const char * const raw_file_name, int readon
         if (!disk6.disk[drive].nibblized) {
             // DSK/DO/PO require nibblizing on read (and denibblizing on write) ...
 
-            disk6.disk[drive].whole_image = (drive==0) ? &disk_a[0] : &disk_b[0];
-            disk6.disk[drive].track_width = 0;
+            // ... tracks are nibblized lazily on first access, the first one here to get the track width (the same
+            // for all tracks)
 
-            for (unsigned int trk=0; trk<NUM_TRACKS; trk++) {
+            disk6.disk[drive].whole_image = (drive==0) ? &disk_a[0] : &disk_b[0];
+            disk6.disk[drive].track_cached = 0;
 
-                disk6.disk[drive].phase = (trk<<1); // HACK : load_track_data()/nibblize_track() expects this set properly
-                size_t track_width = load_track_data(drive);
-                if (disk6.disk[drive].nibblized) {
-                    assert(track_width == NIB_TRACK_SIZE);
-                } else {
-                    assert(track_width <= NIB_TRACK_SIZE);
+            size_t track_width = load_track_data(drive, 0);
+            assert(track_width <= NIB_TRACK_SIZE);
 #if CONFORMANT_TRACKS
-                    if (track_width != NI2_TRACK_SIZE) {
-                        ERRLOG("Invalid dsk image creation...");
-                    }
-#endif
-                    if (!disk6.disk[drive].track_width) {
-                        disk6.disk[drive].track_width = track_width;
-                    } else {
-                        assert((disk6.disk[drive].track_width == track_width) && "track width should match for all tracks");
-                    }
-                }
+            if (track_width != NI2_TRACK_SIZE) {
+                ERRLOG("Invalid dsk image creation...");
             }
+#endif
+            disk6.disk[drive].track_width = track_width;
         }
 
         // close disk image file if readonly
@@ -894,15 +1038,18 @@ void disk6_flush(int drive) {
         return;
     }
 
-    if (disk6.disk[drive].is_protected) {
-        return;
-    }
-
-    if (disk6.disk[drive].track_dirty) {
+    if (!disk6.disk[drive].is_protected && disk6.disk[drive].track_dirty) {
         LOG("WARNING : flushing previous session for drive (%d)...", drive+1);
         save_track_data(drive);
     }
 
+    // even when protected : a state load sets the protection of the drive before ejecting its disk
+    _writeback_wait(&disk6.disk[drive], ~0ULL);
+
+    if (disk6.disk[drive].is_protected) {
+        return;
+    }
+
     __sync_synchronize();
 
     int ret = -1;
@@ -912,33 +1059,55 @@ void disk6_flush(int drive) {
     }
 }
 
+void disk6_shutdown(void) {
+    disk6_flush(0);
+    disk6_flush(1);
+
+    pthread_mutex_lock(&writeback_mutex);
+    bool running = writeback_running;
+    writeback_quit = true;
+    pthread_cond_broadcast(&writeback_cond);
+    pthread_mutex_unlock(&writeback_mutex);
+
+    if (running && pthread_join(writeback_thread, NULL)) {
+        ERRLOG("OOPS: pthread_join of disk write-back thread ...");
+    }
+}
+
 bool disk6_saveState(StateHelper_s *helper) {
     bool saved = false;
-    int fd = helper->fd;
+
+    // the disk image files are part of the state : queue the dirty track of each drive for write-back, but keep its
+    // nibbles cached and the track dirty so that the running machine carries on unaffected
+    for (int i = 0; i < 2; i++) {
+        if ((disk6.disk[i].fd >= 0) && !disk6.disk[i].is_protected && disk6.disk[i].track_dirty) {
+            _writeback_queue(&disk6.disk[i], disk6.disk[i].phase >> 1);
+        }
+    }
 
     do {
         uint8_t state = 0x0;
 
         state = (uint8_t)disk6.motor_off;
-        if (!helper->save(fd, &state, 1)) {
+        if (!helper->save(helper, &state, 1)) {
             break;
         }
         LOG("SAVE motor_off = %02x", state);
 
         state = (uint8_t)disk6.drive;
-        if (!helper->save(fd, &state, 1)) {
+        if (!helper->save(helper, &state, 1)) {
             break;
         }
         LOG("SAVE drive = %02x", state);
 
         state = (uint8_t)disk6.ddrw;
-        if (!helper->save(fd, &state, 1)) {
+        if (!helper->save(helper, &state, 1)) {
             break;
         }
         LOG("SAVE ddrw = %02x", state);
 
         state = (uint8_t)disk6.disk_byte;
-        if (!helper->save(fd, &state, 1)) {
+        if (!helper->save(helper, &state, 1)) {
             break;
         }
         LOG("SAVE disk_byte = %02x", state);
@@ -953,7 +1122,7 @@ bool disk6_saveState(StateHelper_s *helper) {
             }
 
             state = (uint8_t)disk6.disk[i].is_protected;
-            if (!helper->save(fd, &state, 1)) {
+            if (!helper->save(helper, &state, 1)) {
                 break;
             }
             LOG("SAVE is_protected[%lu] = %02x", i, state);
@@ -966,44 +1135,44 @@ bool disk6_saveState(StateHelper_s *helper) {
                 serialized[1] = (uint8_t)((namelen & 0xFF0000  ) >> 16);
                 serialized[2] = (uint8_t)((namelen & 0xFF00    ) >>  8);
                 serialized[3] = (uint8_t)((namelen & 0xFF      ) >>  0);
-                if (!helper->save(fd, serialized, 4)) {
+                if (!helper->save(helper, serialized, 4)) {
                     break;
                 }
 
-                if (!helper->save(fd, disk6.disk[i].file_name, namelen)) {
+                if (!helper->save(helper, disk6.disk[i].file_name, namelen)) {
                     break;
                 }
 
                 LOG("SAVE disk[%lu] : (%u) %s", i, namelen, disk6.disk[i].file_name);
             } else {
                 memset(serialized, 0x0, sizeof(serialized));
-                if (!helper->save(fd, serialized, 4)) {
+                if (!helper->save(helper, serialized, 4)) {
                     break;
                 }
                 LOG("SAVE disk[%lu] (0) <NULL>", i);
             }
 
             state = (uint8_t)disk6.disk[i].track_valid;
-            if (!helper->save(fd, &state, 1)) {
+            if (!helper->save(helper, &state, 1)) {
                 break;
             }
             LOG("SAVE track_valid[%lu] = %02x", i, state);
 
             state = (uint8_t)disk6.disk[i].track_dirty;
-            if (!helper->save(fd, &state, 1)) {
+            if (!helper->save(helper, &state, 1)) {
                 break;
             }
             LOG("SAVE track_dirty[%lu] = %02x", i, state);
 
             state = (uint8_t)disk6.disk[i].phase;
-            if (!helper->save(fd, &state, 1)) {
+            if (!helper->save(helper, &state, 1)) {
                 break;
             }
             LOG("SAVE phase[%lu] = %02x", i, state);
 
             serialized[0] = (uint8_t)((disk6.disk[i].run_byte & 0xFF00) >>  8);
             serialized[1] = (uint8_t)((disk6.disk[i].run_byte & 0xFF  ) >>  0);
-            if (!helper->save(fd, serialized, 2)) {
+            if (!helper->save(helper, serialized, 2)) {
                 break;
             }
             LOG("SAVE run_byte[%lu] = %04x", i, disk6.disk[i].run_byte);
@@ -1019,32 +1188,61 @@ bool disk6_saveState(StateHelper_s *helper) {
     return saved;
 }
 
+void disk6_copyState(disk6_state_t *state) {
+    state->motor_off = disk6.motor_off;
+    state->drive = disk6.drive;
+    state->ddrw = disk6.ddrw;
+    state->disk_byte = disk6.disk_byte;
+    state->phases = stepper_phases;
+    for (unsigned int i = 0; i < 2; i++) {
+        state->phase[i] = disk6.disk[i].phase;
+        state->run_byte[i] = disk6.disk[i].run_byte;
+    }
+}
+
+void disk6_restoreState(const disk6_state_t *state) {
+    for (unsigned int i = 0; i < 2; i++) {
+        if (disk6.disk[i].phase != state->phase[i]) {
+            if (disk6.disk[i].track_dirty) {
+                save_track_data(i);
+            }
+            disk6.disk[i].track_valid = false;
+            disk6.disk[i].phase = state->phase[i];
+        }
+        disk6.disk[i].run_byte = state->run_byte[i];
+    }
+    disk6.motor_off = state->motor_off;
+    disk6.drive = state->drive;
+    disk6.ddrw = state->ddrw;
+    disk6.disk_byte = state->disk_byte;
+    stepper_phases = state->phases;
+}
+
 bool disk6_loadState(StateHelper_s *helper) {
     bool loaded = false;
-    int fd = helper->fd;
 
     do {
         uint8_t state = 0x0;
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         disk6.motor_off = state;
         LOG("LOAD motor_off = %02x", disk6.motor_off);
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         disk6.drive = state;
         LOG("LOAD drive = %02x", disk6.drive);
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         disk6.ddrw = state;
         LOG("LOAD ddrw = %02x", disk6.ddrw);
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         disk6.disk_byte = state;
@@ -1062,13 +1260,13 @@ bool disk6_loadState(StateHelper_s *helper) {
 
             uint8_t serialized[4] = { 0 };
 
-            if (!helper->load(fd, &state, 1)) {
+            if (!helper->load(helper, &state, 1)) {
                 break;
             }
             disk6.disk[i].is_protected = state;
             LOG("LOAD is_protected[%lu] = %02x", i, disk6.disk[i].is_protected);
 
-            if (!helper->load(fd, serialized, 4)) {
+            if (!helper->load(helper, serialized, 4)) {
                 break;
             }
             uint32_t namelen = 0x0;
@@ -1082,7 +1280,7 @@ bool disk6_loadState(StateHelper_s *helper) {
             if (namelen) {
                 unsigned long gzlen = (_GZLEN+1);
                 char *namebuf = malloc(namelen+gzlen+1);
-                if (!helper->load(fd, namebuf, namelen)) {
+                if (!helper->load(helper, namebuf, namelen)) {
                     FREE(namebuf);
                     break;
                 }
@@ -1095,25 +1293,29 @@ bool disk6_loadState(StateHelper_s *helper) {
                 FREE(namebuf);
             }
 
-            if (!helper->load(fd, &state, 1)) {
+            if (!helper->load(helper, &state, 1)) {
                 break;
             }
             disk6.disk[i].track_valid = state;
             LOG("LOAD track_valid[%lu] = %02x", i, disk6.disk[i].track_valid);
 
-            if (!helper->load(fd, &state, 1)) {
+            if (!helper->load(helper, &state, 1)) {
                 break;
             }
             disk6.disk[i].track_dirty = state;
             LOG("LOAD track_dirty[%lu] = %02x", i, disk6.disk[i].track_dirty);
 
-            if (!helper->load(fd, &state, 1)) {
+            if (!helper->load(helper, &state, 1)) {
                 break;
             }
             disk6.disk[i].phase = state;
             LOG("LOAD phase[%lu] = %02x", i, disk6.disk[i].phase);
 
-            if (!helper->load(fd, serialized, 2)) {
+            if (disk6.disk[i].track_valid && disk6.disk[i].fd >= 0) {
+                load_track_data(i, disk6.disk[i].phase >> 1);
+            }
+
+            if (!helper->load(helper, serialized, 2)) {
                 break;
             }
             disk6.disk[i].run_byte  = (uint32_t)(serialized[0] << 8);
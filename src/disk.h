@@ -54,6 +54,8 @@ typedef struct diskette_t {
     uint8_t *mmap_image;
     size_t whole_len;
     uint8_t *whole_image;
+    uint64_t track_cached;  // tracks nibblized into whole_image (bit per track, DSK/DO/PO images)
+    uint64_t track_pending; // tracks queued for write-back to the image file (bit per track)
     bool nibblized;
     bool is_protected;
     bool track_valid;
@@ -75,6 +77,17 @@ typedef struct drive_t {
 
 extern drive_t disk6;
 
+// controller and head state (not the disk contents), see rewind.h
+typedef struct disk6_state_t {
+    int motor_off;
+    int drive;
+    int ddrw;
+    int disk_byte;
+    int phases;                 // stepper magnet phases
+    int phase[2];
+    int run_byte[2];
+} disk6_state_t;
+
 // initialize emulated 5.25 Disk ][ module
 extern void disk6_init(void);
 
@@ -84,12 +97,19 @@ extern const char *disk6_insert(int drive, const char * const file_name, int rea
 // eject 5.25 disk image file
 extern const char *disk6_eject(int drive);
 
-// flush all I/O
+// flush all I/O (the written tracks are otherwise written back to the image file in the background)
 extern void disk6_flush(int drive);
 
+// flush both drives and stop the background track writer
+extern void disk6_shutdown(void);
+
 extern bool disk6_saveState(StateHelper_s *helper);
 extern bool disk6_loadState(StateHelper_s *helper);
 
+// copy/restore the controller and head state in memory (the head moves back flushing the current track)
+extern void disk6_copyState(disk6_state_t *state);
+extern void disk6_restoreState(const disk6_state_t *state);
+
 #if DISK_TRACING
 void c_toggle_disk_trace_6(const char *read_file, const char *write_file);
 void c_begin_disk_trace_6(const char *read_file, const char *write_file);
@@ -20,8 +20,23 @@
 #define DYNAMIC_SZ 11 // 7 pixels (as bytes) + 2pre + 2post
 
 // framebuffers
+#if MACHINE_CONTEXT
+#   define vga_mem_page_0 (current_machine->vga_mem_page_0)
+#   define vga_mem_page_1 (current_machine->vga_mem_page_1)
+#   define video__dirty (current_machine->video__dirty)
+#   define video__log (current_machine->video__log)
+#else
 static uint8_t vga_mem_page_0[SCANWIDTH*SCANHEIGHT] = { 0 };
 static uint8_t vga_mem_page_1[SCANWIDTH*SCANHEIGHT] = { 0 };
+static video_dirty_t video__dirty[2] = { { 0 } };
+static video_switch_log_t video__log = { 0 };
+#endif
+
+// display softswitches (logged per frame), and the ones that decide which bytes are marked dirty
+#define VIDEO_SWITCHES (SS_TEXT|SS_MIXED|SS_HIRES|SS_80COL|SS_DHIRES|SS_ALTCHAR|SS_SCREEN)
+#define VIDEO_MODE_SWITCHES (VIDEO_SWITCHES & ~SS_SCREEN)
+
+#define VISIBLE_SCANLINES (TEXT_ROWS*FONT_GLYPH_Y)
 
 A2Color_s colormap[256] = { { 0 } };
 video_backend_s *video_backend = NULL;
@@ -33,14 +48,19 @@ static uint8_t video__int_font[3][0x4000] = { { 0 } }; // interface font
 // Precalculated framebuffer offsets given VM addr
 unsigned int video__screen_addresses[8192] = { INT_MIN };
 uint8_t video__columns[8192] = { 0 };
+static uint8_t video__rows[8192] = { 0 }; // text row
 
-uint8_t *video__fb1 = NULL;
-uint8_t *video__fb2 = NULL;
+#if !MACHINE_CONTEXT
+uint8_t *video__fb1 = vga_mem_page_0;
+uint8_t *video__fb2 = vga_mem_page_1;
+#endif
 
 uint8_t video__hires_even[0x800] = { 0 };
 uint8_t video__hires_odd[0x800] = { 0 };
 
+#if !MACHINE_CONTEXT
 int video__current_page = 0; // current visual page
+#endif
 
 // Video constants -- sourced from AppleWin
 static const bool bVideoScannerNTSC = true;
@@ -317,6 +337,7 @@ static void _initialize_row_col_tables(void) {
             for (unsigned int x = 0; x < 40; x++) {
                 video__screen_addresses[video__line_offset[y] + (0x400*y2) + x] = ((y*FONT_HEIGHT_PIXELS + 2*y2) * SCANWIDTH) + (x*FONT_WIDTH_PIXELS) + _INTERPOLATED_PIXEL_ADJUSTMENT_PRE;
                 video__columns         [video__line_offset[y] + (0x400*y2) + x] = (uint8_t)x;
+                video__rows            [video__line_offset[y] + (0x400*y2) + x] = (uint8_t)y;
             }
         }
     }
@@ -720,28 +741,58 @@ static inline void _plot_block1(uint16_t ea, uint8_t b)
         } \
     } while(0)
 
+// Writes to the text/lores and hires pages only mark the byte dirty (when DRAW_TEXT()/DRAW_MIXED()/
+// _draw_hires_graphics() would plot it), video_composeFrame() plots the dirty bytes of a frame at once.  The marks are
+// only good for the display mode they were made with : a page is plotted in full after a mode switch (see
+// video_logSwitches()).
+//
+// NOTE : the plotting stays on the thread running the machine, at the end of the frame, rather than moving to the
+// renderer with the dirty bitmaps.  The renderer would need a copy of video memory as of the end of the frame (the
+// CPU writes on right away), which costs about as much as plotting the few dirty bytes of a typical frame.  And the
+// framebuffer must be plotted there anyway for the consumers without a renderer (batch and test SHAs, batch exit
+// conditions, run-ahead) and for the interface drawing over it.  The renderer only gets the bands that changed (see
+// video_presentFrame()).
+
+// text/lores byte would be plotted (see DRAW_TEXT()/DRAW_MIXED())
+#define TEXT_VISIBLE(SW, TEXTFLAGS) \
+    ((softswitches & (TEXTFLAGS)) ? ((softswitches & SS_80COL) || !(softswitches & (SW))) : !(softswitches & (SS_HIRES|(SW))))
+
+static inline void _mark_text(uint16_t off, uint8_t page) {
+    const unsigned int y = video__rows[off];
+    video__dirty[page].text[y] |= (1ULL << video__columns[off]);
+    video__dirty[page].rows |= (1U << y);
+}
+
 GLUE_C_WRITE(video__write_2e_text0)
 {
     base_textwrt[ea] = b;
-    DRAW_TEXT(0, SS_TEXTWRT);
+    if (TEXT_VISIBLE(SS_TEXTWRT, SS_TEXT)) {
+        _mark_text(ea-0x0400, 0);
+    }
 }
 
 GLUE_C_WRITE(video__write_2e_text0_mixed)
 {
     base_textwrt[ea] = b;
-    DRAW_MIXED(0, SS_TEXTWRT);
+    if (TEXT_VISIBLE(SS_TEXTWRT, SS_TEXT|SS_MIXED)) {
+        _mark_text(ea-0x0400, 0);
+    }
 }
 
 GLUE_C_WRITE(video__write_2e_text1)
 {
     base_ramwrt[ea] = b;
-    DRAW_TEXT(1, SS_RAMWRT);
+    if (TEXT_VISIBLE(SS_RAMWRT, SS_TEXT)) {
+        _mark_text(ea-0x0800, 1);
+    }
 }
 
 GLUE_C_WRITE(video__write_2e_text1_mixed)
 {
     base_ramwrt[ea] = b;
-    DRAW_MIXED(1, SS_RAMWRT);
+    if (TEXT_VISIBLE(SS_RAMWRT, SS_TEXT|SS_MIXED)) {
+        _mark_text(ea-0x0800, 1);
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -976,6 +1027,30 @@ static inline void _plot_hires(uint16_t ea, uint8_t b, bool is_even, uint8_t *fb
     _plot_hires_pixels(fb_ptr-4, color_buf);
 }
 
+// hires/dhires byte would be plotted (see _draw_hires_graphics())
+static inline bool _hires_visible(unsigned int ss_textflags) {
+    if (softswitches & ss_textflags) {
+        return false;
+    }
+    if (!(softswitches & SS_HIRES)) {
+        return false;
+    }
+    if ((softswitches & SS_80COL) && (softswitches & SS_DHIRES)) {
+        return true;
+    }
+    return !(softswitches & SS_HGRWRT);
+}
+
+static inline void _mark_hires(uint16_t ea, uint8_t page, unsigned int ss_textflags) {
+    if (!_hires_visible(ss_textflags)) {
+        return;
+    }
+    const uint16_t off = ea - (page ? 0x4000 : 0x2000);
+    const unsigned int y = video__rows[off];
+    video__dirty[page].hires[(y<<3) + (off>>10)] |= (1ULL << video__columns[off]);
+    video__dirty[page].rows |= (1U << y);
+}
+
 // DRAW_GRAPHICS
 static inline void _draw_hires_graphics(uint16_t ea, uint8_t b, bool is_even, uint8_t page, unsigned int ss_textflags) {
     if (softswitches & ss_textflags) {
@@ -1011,49 +1086,49 @@ static inline void _draw_hires_graphics(uint16_t ea, uint8_t b, bool is_even, ui
 GLUE_C_WRITE(video__write_2e_even0)
 {
     base_hgrwrt[ea] = b;
-    _draw_hires_graphics(ea, b, /*even*/true, 0, SS_TEXT);
+    _mark_hires(ea, 0, SS_TEXT);
 }
 
 GLUE_C_WRITE(video__write_2e_even0_mixed)
 {
     base_hgrwrt[ea] = b;
-    _draw_hires_graphics(ea, b, /*even*/true, 0, (SS_TEXT|SS_MIXED));
+    _mark_hires(ea, 0, (SS_TEXT|SS_MIXED));
 }
 
 GLUE_C_WRITE(video__write_2e_odd0)
 {
     base_hgrwrt[ea] = b;
-    _draw_hires_graphics(ea, b, /*even*/false, 0, SS_TEXT);
+    _mark_hires(ea, 0, SS_TEXT);
 }
 
 GLUE_C_WRITE(video__write_2e_odd0_mixed)
 {
     base_hgrwrt[ea] = b;
-    _draw_hires_graphics(ea, b, /*even*/false, 0, (SS_TEXT|SS_MIXED));
+    _mark_hires(ea, 0, (SS_TEXT|SS_MIXED));
 }
 
 GLUE_C_WRITE(video__write_2e_even1)
 {
     base_ramwrt[ea] = b;
-    _draw_hires_graphics(ea, b, /*even*/true, 1, SS_TEXT);
+    _mark_hires(ea, 1, SS_TEXT);
 }
 
 GLUE_C_WRITE(video__write_2e_even1_mixed)
 {
     base_ramwrt[ea] = b;
-    _draw_hires_graphics(ea, b, /*even*/true, 1, (SS_TEXT|SS_MIXED));
+    _mark_hires(ea, 1, (SS_TEXT|SS_MIXED));
 }
 
 GLUE_C_WRITE(video__write_2e_odd1)
 {
     base_ramwrt[ea] = b;
-    _draw_hires_graphics(ea, b, /*even*/false, 1, SS_TEXT);
+    _mark_hires(ea, 1, SS_TEXT);
 }
 
 GLUE_C_WRITE(video__write_2e_odd1_mixed)
 {
     base_ramwrt[ea] = b;
-    _draw_hires_graphics(ea, b, /*even*/false, 1, (SS_TEXT|SS_MIXED));
+    _mark_hires(ea, 1, (SS_TEXT|SS_MIXED));
 }
 
 // ----------------------------------------------------------------------------
@@ -1085,6 +1160,10 @@ void video_setpage(int p) {
 }
 
 const uint8_t * const video_current_framebuffer(void) {
+    const uint8_t *fb = runahead_framebuffer();
+    if (fb) {
+        return fb;
+    }
     return !video__current_page ? video__fb1 : video__fb2;
 }
 
@@ -1096,13 +1175,12 @@ void video_clear(void) {
 
 bool video_saveState(StateHelper_s *helper) {
     bool saved = false;
-    int fd = helper->fd;
 
     do {
         uint8_t state = 0x0;
 
         state = (uint8_t)video__current_page;
-        if (!helper->save(fd, &state, 1)) {
+        if (!helper->save(helper, &state, 1)) {
             break;
         }
         LOG("SAVE video__current_page = %02x", state);
@@ -1115,12 +1193,11 @@ bool video_saveState(StateHelper_s *helper) {
 
 bool video_loadState(StateHelper_s *helper) {
     bool loaded = false;
-    int fd = helper->fd;
 
     do {
         uint8_t state = 0x0;
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         video__current_page = state;
@@ -1134,59 +1211,376 @@ bool video_loadState(StateHelper_s *helper) {
     return loaded;
 }
 
+static void _rasterize_page(uint8_t page) {
+    video_dirty_t *dirty = &video__dirty[page];
+
+    for (uint32_t rows = dirty->rows; rows; rows &= rows-1) {
+        const unsigned int y = __builtin_ctz(rows);
+
+        // text/lores page
+        for (uint64_t cols = dirty->text[y]; cols; cols &= cols-1) {
+            const unsigned int x = __builtin_ctzll(cols);
+            uint16_t ea = video__line_offset[y] + x + (page ? 0x800 : 0x400);
+            uint8_t b = apple_ii_64k[0][ea];
+            if (y < BEGIN_MIX) {
+                if (page) {
+                    DRAW_TEXT(1, SS_RAMWRT);
+                } else {
+                    DRAW_TEXT(0, SS_TEXTWRT);
+                }
+            } else {
+                if (page) {
+                    DRAW_MIXED(1, SS_RAMWRT);
+                } else {
+                    DRAW_MIXED(0, SS_TEXTWRT);
+                }
+            }
+        }
+        dirty->text[y] = 0;
+
+        // hires/dhires page scanlines, bytes left to right
+        const unsigned int ss_textflags = (y < BEGIN_MIX) ? SS_TEXT : (SS_TEXT|SS_MIXED);
+        for (unsigned int i = 0; i < 8; i++) {
+            for (uint64_t cols = dirty->hires[(y<<3) + i]; cols; cols &= cols-1) {
+                const unsigned int x = __builtin_ctzll(cols);
+                uint16_t ea = video__line_offset[y] + (0x400*i) + x + (page ? 0x4000 : 0x2000);
+                _draw_hires_graphics(ea, apple_ii_64k[0][ea], /*even*/!(x & 1), page, ss_textflags);
+            }
+            dirty->hires[(y<<3) + i] = 0;
+        }
+    }
+    dirty->rows = 0;
+}
+
+// plot scanlines of a text row of a page with the current softswitches (bit per scanline, the text/lores bytes are
+// plotted for the whole row)
+static void _render_row(uint8_t page, unsigned int y, uint8_t scanlines) {
+
+    // text/lores page
+    for (unsigned int x = 0; x < TEXT_COLS; x++) {
+        uint16_t ea = video__line_offset[y] + x + (page ? 0x800 : 0x400);
+        uint8_t b = apple_ii_64k[0][ea];
+        if (y < BEGIN_MIX) {
+            if (page) {
+                DRAW_TEXT(1, SS_RAMWRT);
+            } else {
+                DRAW_TEXT(0, SS_TEXTWRT);
+            }
+        } else {
+            if (page) {
+                DRAW_MIXED(1, SS_RAMWRT);
+            } else {
+                DRAW_MIXED(0, SS_TEXTWRT);
+            }
+        }
+    }
+
+    // hires/dhires page scanlines
+    const unsigned int ss_textflags = (y < BEGIN_MIX) ? SS_TEXT : (SS_TEXT|SS_MIXED);
+    for (unsigned int i = 0; i < 8; i++) {
+        if (!(scanlines & (1 << i))) {
+            continue;
+        }
+        for (unsigned int x = 0; x < TEXT_COLS; x++) {
+            uint16_t ea = video__line_offset[y] + (0x400*i) + x + (page ? 0x4000 : 0x2000);
+            _draw_hires_graphics(ea, apple_ii_64k[0][ea], /*even*/!(x & 1), page, ss_textflags);
+        }
+    }
+}
+
+// bring a page up to date with the current softswitches
+static void _plot_page(uint8_t page) {
+    if (video__log.stale & (1 << page)) {
+        for (unsigned int y = 0; y < TEXT_ROWS; y++) {
+            _render_row(page, y, 0xFF);
+        }
+        memset(&video__dirty[page], 0x0, sizeof(video__dirty[page]));
+    } else {
+        if (video__dirty[page].rows) {
+            _rasterize_page(page);
+        }
+        for (uint32_t rows = video__log.mixed[page]; rows; rows &= rows-1) {
+            _render_row(page, __builtin_ctz(rows), 0xFF);
+        }
+    }
+    video__log.mixed[page] = 0x0;
+}
+
+void video_rasterize(void) {
+    const uint8_t page = video__current_page ? 1 : 0;
+
+    // the bytes are plotted from main memory as in video_redraw() (the marked ones were written there, or are
+    // dhires)
+    uint32_t softswitches_save = softswitches;
+    softswitches &= ~(SS_TEXTWRT|SS_HGRWRT|SS_RAMWRT);
+    _plot_page(page);
+    softswitches = softswitches_save;
+
+    if (!video__log.count) {
+        video__log.stale &= ~(1 << page);
+    } // else the frame is composed from the page as it was
+}
+
 void video_redraw(void) {
 
+    // everything is plotted below
+    memset(&video__dirty, 0x0, sizeof(video__dirty));
+    video__log.frame_switches = softswitches & VIDEO_SWITCHES;
+    video__log.switches = video__log.frame_switches;
+    video__log.count = 0;
+    video__log.stale = 0x0;
+    video__log.mixed[0] = 0x0;
+    video__log.mixed[1] = 0x0;
+
     // temporarily reset softswitches
     uint32_t softswitches_save = softswitches;
     softswitches &= ~(SS_TEXTWRT|SS_HGRWRT|SS_RAMWRT);
 
     for (unsigned int y = 0; y < TEXT_ROWS; y++) {
-        for (unsigned int x = 0; x < TEXT_COLS; x++) {
-            uint16_t ea = video__line_offset[y] + x + 0x400;
-            uint8_t b = apple_ii_64k[0][ea];
+        _render_row(0, y, 0xFF);
+        _render_row(1, y, 0xFF);
+    }
 
-            // text/lores pages
-            if (y < 20) {
-                DRAW_TEXT(0, SS_TEXTWRT);
-                ea += 0x400;
-                b = apple_ii_64k[0][ea];
-                DRAW_TEXT(1, SS_RAMWRT);
-            } else {
-                DRAW_MIXED(0, SS_TEXTWRT);
-                ea += 0x400;
-                b = apple_ii_64k[0][ea];
-                DRAW_MIXED(1, SS_RAMWRT);
+    softswitches = softswitches_save;
+    video_setDirty();
+}
+
+// ----------------------------------------------------------------------------
+// Mid-frame display changes
+//
+// Display softswitch changes are logged with the beam position, and the frame is plotted once it ends : the displayed
+// page is brought up to date with the softswitches the frame ends with, then only the scanlines the beam scanned with
+// other softswitches (before the last change) are plotted again, with the mode and from the page they were scanned
+// with.  Those are plotted in the framebuffer of their page and copied, that framebuffer is restored afterwards, and
+// the rows of the displayed page that got them are plotted again before the page is next displayed.  The font is not
+// per scanline (ALTCHAR is only logged so that the frame is plotted again).
+
+extern unsigned int CpuGetCyclesThisVideoFrame(void);
+
+static inline void _set_display_switches(uint32_t switches) {
+    softswitches = (softswitches & ~VIDEO_SWITCHES) | switches;
+}
+
+// first scanline displayed after the given cycle into the frame (the display of a line starts after its horizontal
+// blank, kHPEClock cycles before the next line)
+static inline unsigned int _scanline_after(unsigned int cycle) {
+    return MIN((cycle + kHPEClock) / kHClocks, VISIBLE_SCANLINES);
+}
+
+// plot the scanlines of the displayed page not scanned with the softswitches it was plotted with (`final`)
+static void _compose_scanlines(uint8_t page, const uint32_t *lines, uint32_t final) {
+    uint8_t *fbs[2] = { video__fb1, video__fb2 };
+    uint8_t saved[FONT_HEIGHT_PIXELS*SCANWIDTH];
+    uint8_t row[FONT_HEIGHT_PIXELS*SCANWIDTH];
+    const unsigned int row_size = FONT_HEIGHT_PIXELS*SCANWIDTH;
+    const unsigned int line_size = (FONT_HEIGHT_PIXELS/FONT_GLYPH_Y) * SCANWIDTH;
+
+    for (unsigned int y = 0; y < TEXT_ROWS; y++) {
+        const uint32_t *switches = lines + (y*FONT_GLYPH_Y);
+        uint8_t *fb_row = fbs[page] + (y*row_size);
+
+        uint8_t todo = 0x0;
+        for (unsigned int i = 0; i < FONT_GLYPH_Y; i++) {
+            if ((switches[i] != final) || (!!(switches[i] & SS_SCREEN) != page)) {
+                todo |= (1 << i);
             }
+        }
 
-            // hires/dhires pages
-            for (unsigned int i = 0; i < 8; i++) {
-                uint16_t ea0 = 0x2000 + video__line_offset[y] + (0x400*i) + x;
-                uint16_t ea1 = ea0+0x2000;
-                uint8_t b0 = apple_ii_64k[0][ea0];
-                uint8_t b1 = apple_ii_64k[0][ea1];
-                if (y < 20) {
-                    if (x & 1) {
-                        _draw_hires_graphics(ea0,       b0, /*even*/false, 0, SS_TEXT);
-                        _draw_hires_graphics(ea1,       b1, /*even*/false, 1, SS_TEXT);
-                    } else {
-                        _draw_hires_graphics(ea0,       b0, /*even*/true,  0, SS_TEXT);
-                        _draw_hires_graphics(ea1,       b1, /*even*/true,  1, SS_TEXT);
-                    }
-                } else {
-                    if (x & 1) {
-                        _draw_hires_graphics(ea0,       b0, /*even*/false, 0, (SS_TEXT|SS_MIXED));
-                        _draw_hires_graphics(ea1,       b1, /*even*/false, 1, (SS_TEXT|SS_MIXED));
-                    } else {
-                        _draw_hires_graphics(ea0,       b0, /*even*/true,  0, (SS_TEXT|SS_MIXED));
-                        _draw_hires_graphics(ea1,       b1, /*even*/true,  1, (SS_TEXT|SS_MIXED));
-                    }
+        while (todo) {
+            const uint32_t segment_switches = switches[__builtin_ctz(todo)];
+            uint8_t segment = 0x0;
+            for (unsigned int i = 0; i < FONT_GLYPH_Y; i++) {
+                if (switches[i] == segment_switches) {
+                    segment |= (1 << i);
                 }
             }
+            todo &= ~segment;
+
+            const uint8_t from = (segment_switches & SS_SCREEN) ? 1 : 0;
+            uint8_t *fb_from = fbs[from] + (y*row_size);
+            memcpy(saved, fb_from, row_size);
+            _set_display_switches(segment_switches);
+            _render_row(from, y, segment);
+            for (unsigned int i = 0; i < FONT_GLYPH_Y; i++) {
+                if (segment & (1 << i)) {
+                    memcpy(row + (i*line_size), fb_from + (i*line_size), line_size);
+                }
+            }
+            memcpy(fb_from, saved, row_size);
+            for (unsigned int i = 0; i < FONT_GLYPH_Y; i++) {
+                if (segment & (1 << i)) {
+                    memcpy(fb_row + (i*line_size), row + (i*line_size), line_size);
+                }
+            }
+            video__log.mixed[page] |= (1U << y);
+        }
+    }
+}
+
+void video_logSwitches(void) {
+    const uint32_t switches = softswitches & VIDEO_SWITCHES;
+    if (switches == video__log.switches) {
+        return;
+    }
+    if ((switches ^ video__log.switches) & VIDEO_MODE_SWITCHES) {
+        video__log.stale = 0x3; // bytes marked dirty (or not) for another mode
+    }
+    video__log.switches = switches;
+
+    if (video__log.count < VIDEO_SWITCH_LOG_MAX) {
+        video__log.changes[video__log.count].cycle = (uint16_t)MIN(CpuGetCyclesThisVideoFrame(), UINT16_MAX);
+        video__log.changes[video__log.count].switches = switches;
+    }
+    ++video__log.count;
+}
+
+void video_composeFrame(void) {
+    const uint8_t page = video__current_page ? 1 : 0;
+
+    // display softswitches of each scanline
+    uint32_t lines[VISIBLE_SCANLINES];
+    uint32_t switches = video__log.frame_switches;
+    unsigned int line = 0;
+    if (video__log.count > VIDEO_SWITCH_LOG_MAX) {
+        switches = video__log.switches; // changes missing from the log : the frame as it ends
+    } else {
+        for (unsigned int i = 0; i < video__log.count; i++) {
+            const unsigned int next = _scanline_after(video__log.changes[i].cycle);
+            while (line < next) {
+                lines[line++] = switches;
+            }
+            switches = video__log.changes[i].switches;
         }
     }
+    while (line < VISIBLE_SCANLINES) {
+        lines[line++] = switches;
+    }
+
+    const uint32_t final = video__log.switches;
+    video__log.frame_switches = final;
+    video__log.count = 0;
 
+    // plotted from main memory (see video_rasterize())
+    uint32_t softswitches_save = softswitches;
+    softswitches &= ~(SS_TEXTWRT|SS_HGRWRT|SS_RAMWRT);
+    _set_display_switches(final);
+    _plot_page(page);
+    video__log.stale &= ~(1 << page);
+    _compose_scanlines(page, lines, final);
     softswitches = softswitches_save;
-    video_setDirty();
+}
+
+// ----------------------------------------------------------------------------
+// Frame handoff to the video backend
+//
+// Triple buffer : the presenting thread owns the back buffer, the rendering thread the front buffer, and the ready
+// buffer is exchanged atomically by either side (the presenter swaps its filled back buffer in, the renderer swaps the
+// ready buffer for its front buffer when it is fresh).  Neither side ever waits for the other, and the renderer always
+// reads a complete frame.
+//
+// Frames are numbered, and the bands each one changed from the previous one are kept for the last FRAME_HISTORY
+// frames : the renderer ORs those of the frames it skipped, or takes all bands when they are no longer there (or being
+// overwritten while it reads them).  The presenter does the same to publish : the back buffer it gets back still holds
+// an earlier frame, and only the bands changed since are copied in before it is swapped in as the ready buffer.
+
+#define FRAME_INDEX 0x3
+#define FRAME_FRESH 0x4 // ready buffer presented and not acquired yet
+
+#define FRAME_HISTORY 16
+
+#define BAND_SIZE (SCANWIDTH*VIDEO_BAND_HEIGHT)
+
+static uint8_t video__frames[3][SCANWIDTH*SCANHEIGHT] = { { 0 } };
+static uint32_t frame_serials[3] = { 0 };
+static unsigned int frame_back = 0;
+static unsigned int frame_front = 1;
+static volatile unsigned int frame_ready = 2;
+static volatile unsigned int frame_presenting = 0;
+static volatile bool frames_acquired = false;
+
+static uint32_t frame_bands[FRAME_HISTORY] = { 0 };     // bands changed by a frame, by serial
+static volatile uint32_t frame_serial = 0;              // last frame presented ...
+static unsigned int frame_last = 2;                     // ... in this buffer (presenter side)
+static uint32_t frame_acquired = 0;                     // last frame acquired (renderer side)
+static bool frame_acquired_valid = false;
+
+void video_presentFrame(void) {
+    if (!frames_acquired) {
+        return; // no backend rendering frames (headless)
+    }
+    if (!__sync_bool_compare_and_swap(&frame_presenting, 0, 1)) {
+        return; // being presented by the other thread (CPU thread pausing)
+    }
+
+    do {
+        if (!(__sync_fetch_and_and(&_backend_vid_dirty, ~VIDEO_DIRTY_PRESENT) & VIDEO_DIRTY_PRESENT)) {
+            break;
+        }
+
+        const uint8_t *fb = video_current_framebuffer();
+        const uint8_t *last = video__frames[frame_last]; // (read only by the renderer)
+        uint32_t bands = 0x0;
+        for (unsigned int band = 0; band < TEXT_ROWS; band++) {
+            if (memcmp(fb + (band*BAND_SIZE), last + (band*BAND_SIZE), BAND_SIZE)) {
+                bands |= (1U << band);
+            }
+        }
+        if (!bands) {
+            break;
+        }
+
+        // the back buffer still holds the frame it was last published with : only bring in the bands changed since
+        const uint32_t serial = frame_serial + 1;
+        frame_bands[serial % FRAME_HISTORY] = bands;
+        uint32_t stale = VIDEO_BANDS_ALL;
+        const uint32_t back_serial = frame_serials[frame_back];
+        if (serial - back_serial <= FRAME_HISTORY) {
+            stale = 0x0;
+            for (uint32_t i = back_serial + 1; i != serial + 1; i++) {
+                stale |= frame_bands[i % FRAME_HISTORY];
+            }
+        }
+        uint8_t *back = video__frames[frame_back];
+        for (unsigned int band = 0; band < TEXT_ROWS; band++) {
+            if (stale & (1U << band)) {
+                memcpy(back + (band*BAND_SIZE), fb + (band*BAND_SIZE), BAND_SIZE);
+            }
+        }
+        frame_serials[frame_back] = serial;
+        __sync_synchronize(); // frame written before it is published
+        frame_serial = serial;
+        frame_last = frame_back;
+        frame_back = __sync_lock_test_and_set(&frame_ready, frame_back | FRAME_FRESH) & FRAME_INDEX;
+    } while (0);
+
+    __sync_lock_release(&frame_presenting);
+}
+
+const uint8_t *video_acquireFrame(uint32_t *bands) {
+    frames_acquired = true;
+    *bands = 0x0;
+
+    if (frame_ready & FRAME_FRESH) {
+        __sync_synchronize(); // done reading the front buffer before it is handed back
+        frame_front = __sync_lock_test_and_set(&frame_ready, frame_front) & FRAME_INDEX;
+
+        const uint32_t serial = frame_serials[frame_front];
+        if (frame_acquired_valid && (serial - frame_acquired < FRAME_HISTORY)) {
+            for (uint32_t i = frame_acquired + 1; i != serial + 1; i++) {
+                *bands |= frame_bands[i % FRAME_HISTORY];
+            }
+            __sync_synchronize();
+            if (frame_serial - frame_acquired >= FRAME_HISTORY) {
+                *bands = VIDEO_BANDS_ALL;
+            }
+        } else {
+            *bands = VIDEO_BANDS_ALL;
+        }
+        frame_acquired = serial;
+        frame_acquired_valid = true;
+    }
+
+    return video__frames[frame_front];
 }
 
 // ----------------------------------------------------------------------------
@@ -1195,7 +1589,6 @@ void video_redraw(void) {
 // References to Jim Sather's books are given as eg:
 // UTAIIe:5-7,P3 (Understanding the Apple IIe, chapter 5, page 7, Paragraph 3)
 
-extern unsigned int CpuGetCyclesThisVideoFrame(void);
 uint16_t video_scanner_get_address(bool *vblBarOut) {
     const bool SW_HIRES   = (softswitches & SS_HIRES);
     const bool SW_TEXT    = (softswitches & SS_TEXT);
@@ -1302,6 +1695,33 @@ uint16_t video_scanner_get_address(bool *vblBarOut) {
     return (uint16_t)nAddress;
 }
 
+static bool _vbl_bar(unsigned int nCycles) {
+    int nScanLines = bVideoScannerNTSC ? kNTSCScanLines : kPALScanLines;
+    int nVLine  = nCycles / kHClocks;
+    int nVState = kVLine0State + nVLine;
+    if (nVLine >= kVPresetLine) {
+        nVState -= nScanLines;
+    }
+    int v_3 = (nVState >> 6) & 1;
+    int v_4 = (nVState >> 7) & 1;
+    return !v_4 || !v_3;
+}
+
+unsigned int video_scanner_cycles_to_vbl_change(unsigned int maxCycles) {
+    unsigned int nCycles = CpuGetCyclesThisVideoFrame();
+    bool vblBar = _vbl_bar(nCycles);
+
+    // VBL' only changes state on a scanline boundary
+    unsigned int n = kHClocks - (nCycles % kHClocks);
+    while (n < maxCycles) {
+        if (_vbl_bar(nCycles + n) != vblBar) {
+            return n;
+        }
+        n += kHClocks;
+    }
+    return maxCycles;
+}
+
 uint8_t floating_bus(void) {
     uint16_t scanner_addr = video_scanner_get_address(NULL);
     return apple_ii_64k[0][scanner_addr];
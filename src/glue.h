@@ -17,17 +17,70 @@
 #   error assembler-specific glue code should be in the arch-specific area
 #endif
 
+#if CPU_C_CORE
+
+// The portable C core calls the vmem routines directly, so the glue is instantiated here rather than generated into an
+// arch-specific glue.S
+
+#define GLUE_BANK_READ(func,pointer) \
+    uint8_t func(uint16_t ea) { \
+        return pointer[ea]; \
+    } \
+    extern uint8_t func(uint16_t)
+
+#define GLUE_BANK_MAYBEREAD(func,pointer) \
+    uint8_t func(uint16_t ea) { \
+        if (!(softswitches & SS_CXROM)) { \
+            return ((uint8_t (*)(uint16_t))pointer)(ea); \
+        } \
+        return pointer[ea]; \
+    } \
+    extern uint8_t func(uint16_t)
+
+#define GLUE_BANK_WRITE(func,pointer) \
+    void func(uint16_t ea, uint8_t b) { \
+        pointer[ea] = b; \
+    } \
+    extern void func(uint16_t, uint8_t)
+
+#define GLUE_BANK_MAYBEWRITE(func,pointer) \
+    void func(uint16_t ea, uint8_t b) { \
+        if (pointer) { \
+            pointer[ea] = b; \
+        } \
+    } \
+    extern void func(uint16_t, uint8_t)
+
+#define _GLUE_C_WRITE_ENTRY(func) \
+    void c_##func(uint16_t ea, uint8_t b); \
+    void func(uint16_t ea, uint8_t b) { \
+        c_##func(ea, b); \
+    }
+
+#define _GLUE_C_READ_ENTRY(func) \
+    uint8_t c_##func(uint16_t ea); \
+    uint8_t func(uint16_t ea) { \
+        return c_##func(ea); \
+    }
+
+#else
+
 #define GLUE_BANK_READ(func,pointer) extern void func(void)
 #define GLUE_BANK_MAYBEREAD(func,pointer) extern void func(void)
 #define GLUE_BANK_WRITE(func,pointer) extern void func(void)
 #define GLUE_BANK_MAYBEWRITE(func,pointer) extern void func(void)
 
+#define _GLUE_C_WRITE_ENTRY(func) extern void func(uint16_t, uint8_t);
+#define _GLUE_C_READ_ENTRY(func) extern uint8_t func(uint16_t);
+
+#endif
+
 #define GLUE_EXTERN_C_READ(func) extern uint8_t func(uint16_t)
 
 #if VM_TRACING
 
 #define GLUE_C_WRITE(func) \
-    extern void func(uint16_t, uint8_t); \
+    _GLUE_C_WRITE_ENTRY(func) \
     void c__##func(uint16_t ea, uint8_t b); \
     void c_##func(uint16_t ea, uint8_t b) { \
         c__##func(ea, b); \
@@ -40,7 +93,7 @@
     void c__##func(uint16_t ea, uint8_t b)
 
 #define GLUE_C_READ(func) \
-    extern uint8_t func(uint16_t); \
+    _GLUE_C_READ_ENTRY(func) \
     uint8_t c__##func(uint16_t ea); \
     uint8_t c_##func(uint16_t ea) { \
         uint8_t b = c__##func(ea); \
@@ -56,11 +109,11 @@
 #else
 
 #define GLUE_C_WRITE(func) \
-    extern void func(uint16_t, uint8_t); \
+    _GLUE_C_WRITE_ENTRY(func) \
     void c_##func(uint16_t ea, uint8_t b)
 
 #define GLUE_C_READ(func) \
-    extern uint8_t func(uint16_t); \
+    _GLUE_C_READ_ENTRY(func) \
     uint8_t c_##func(uint16_t ea)
 
 #endif
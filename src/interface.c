@@ -743,7 +743,7 @@ void c_interface_parameters()
       "|                                                                              |",
       "| F1 F2: Insert Diskette in Slot6 Disk Drive A or Drive B                      |",
       "| F5   : Show Keyboard Layout                               F7 : 6502 Debugger |",
-      "| F9   : Toggle Between CPU% / ALT CPU% Speeds                                 |",
+      "| F9   : Toggle Between CPU% / ALT CPU% Speeds              F6 : Rewind 1 sec  |",
       "| F10  : Show This Menu                                                        |",
       "|                                                                              |",
       "|               For interface help press '?' ... ESC exits menu                |",
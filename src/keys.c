@@ -243,12 +243,21 @@ void c_keys_handle_input(int scancode, int pressed, int is_cooked)
 
             if (current_key < 128)
             {
-                apple_ii_64k[0][0xC000] = current_key | 0x80;
-                apple_ii_64k[1][0xC000] = current_key | 0x80;
+                replay_hostKey(current_key | 0x80);
                 break;
             }
 
 #ifdef INTERFACE_CLASSIC
+            if (current_key == kF6)
+            {
+                // rewind about a second of emulation per press (or as far as the ring goes)
+                const unsigned int second = 60 / REWIND_DEFAULT_FRAMES;
+                cpu_pause();
+                const unsigned int count = rewind_count();
+                rewind_back(count < second ? count : second);
+                cpu_resume();
+                break;
+            }
             if (current_key == kF9)
             {
                 cpu_pause();
@@ -330,7 +339,7 @@ void c_keys_handle_input(int scancode, int pressed, int is_cooked)
             {
                 if (key_pressed[ SCODE_L_CTRL ] || key_pressed[ SCODE_R_CTRL ])
                 {
-                    cpu65_interrupt(ResetSig);
+                    replay_hostReset();
                 }
                 break;
             }
@@ -0,0 +1,230 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+#ifndef _MACHINE_H_
+#define _MACHINE_H_
+
+/*
+ * Machine context
+ *
+ * With the portable C core (CPU_C_CORE), the state of an emulated Apple //e (memory, softswitches and bank pointers,
+ * 65c02 registers and vmem tables, cycle timeline and events, block cache and JIT code, Disk ][ controller, video
+ * pages) is gathered in a machine_t instead of being spread across globals, so several machines can run in one process,
+ * each on its own thread.
+ *
+ * Every thread works on its current machine, initially the default machine driven by the CPU thread (and shared with
+ * the UI, video and audio threads).  The historic global names below resolve to the fields of the current machine, so
+ * the CPU core, the vm.c/disk.c/display.c softswitch handlers and everything else operate on the machine selected by
+ * the calling thread.  (The names also shadow the machine_t members : select a machine to access its state.)
+ *
+ * The assembly cores address this state through absolute symbols and are limited to the default machine (no
+ * machine_t, the names remain plain globals).  Host-side state (video backend, audio, joystick, preferences, debugger)
+ * is not per machine, nor is the Mockingboard : only the default machine has one (slots 4 and 5 of the others are
+ * empty).
+ */
+
+#if CPU_C_CORE && !defined(__ASSEMBLER__)
+
+#define MACHINE_CONTEXT 1
+
+#if CPU_JIT
+#include "x86/jit.h"
+#endif
+
+typedef struct machine_t {
+
+    // vm.c
+    uint8_t apple_ii_64k[2][65536];
+    uint8_t language_card[2][8192];
+    uint8_t language_banks[2][8192];
+    uint32_t softswitches;
+    uint8_t *base_ramrd;
+    uint8_t *base_ramwrt;
+    uint8_t *base_textrd;
+    uint8_t *base_textwrt;
+    uint8_t *base_hgrrd;
+    uint8_t *base_hgrwrt;
+    uint8_t *base_stackzp;
+    uint8_t *base_d000_rd;
+    uint8_t *base_e000_rd;
+    uint8_t *base_d000_wrt;
+    uint8_t *base_e000_wrt;
+    uint8_t *base_c3rom;
+    uint8_t *base_c4rom;
+    uint8_t *base_c5rom;
+    uint8_t *base_cxrom;
+    unsigned long long gc_cycles_timer_0;
+    unsigned long long gc_cycles_timer_1;
+    uint8_t gc_button_0;
+    uint8_t gc_button_1;
+    uint16_t gc_paddle_0;
+    uint16_t gc_paddle_1;
+
+    // cpu-supp.c
+    uint16_t cpu65_pc;
+    uint8_t  cpu65_a;
+    uint8_t  cpu65_f;
+    uint8_t  cpu65_x;
+    uint8_t  cpu65_y;
+    uint8_t  cpu65_sp;
+    uint16_t cpu65_ea;
+    uint8_t  cpu65_d;
+    uint8_t  cpu65_rw;
+    uint8_t  cpu65_opcode;
+    uint8_t  cpu65_opcycles;
+    uint16_t cpu65_io_pc;
+    uint8_t  cpu65__signal;
+    unsigned long long *cpu65_opcode_counts;
+    void *cpu65_vmem_r[65536];
+    void *cpu65_vmem_w[65536];
+    uint8_t **cpu65_vmem_rpage[256];
+    uint8_t **cpu65_vmem_wpage[256];
+
+    // cpu.c
+    block_t blocks[BLOCK_CACHE_SIZE];
+    uint32_t block_page_gen[256];
+    uint8_t block_pages[256];
+#if CPU_JIT
+    uint8_t block_page_smc[256];
+
+    // x86/jit.c
+    jit65_state_t jit65_state;
+    uint8_t *jit_code;
+    uint8_t *jit_ptr;
+    uint8_t *jit_blocks;
+    uint8_t *jit_exit;
+    void (*jit_enter)(void *code);
+    const uint8_t *jit_code_pages;
+#endif
+
+    // timing.c
+    volatile uint8_t emul_reinitialize;
+    unsigned long long cycles_count_total;
+    int32_t cpu65_cycles_to_execute;
+    int32_t cpu65_cycle_count;
+    int32_t cycles_checkpoint_count;
+    unsigned long long frame_cycle;
+    timing_event_t frame_event;
+    timing_event_t *event_queue[MAX_TIMING_EVENTS];
+    unsigned int event_count;
+    timing_idle_loop_t idle_loop;
+    timing_profile_t *timing_profile;
+
+    // replay.c
+    replay_t replay;
+
+    // rewind.c
+    rewind_ring_t rewind_ring;
+
+    // runahead.c
+    runahead_t runahead;
+
+    // disk.c
+    drive_t disk6;
+    uint8_t disk_a[NIB_SIZE];
+    uint8_t disk_b[NIB_SIZE];
+    int stepper_phases;
+
+    // display.c
+    uint8_t vga_mem_page_0[SCANWIDTH*SCANHEIGHT];
+    uint8_t vga_mem_page_1[SCANWIDTH*SCANHEIGHT];
+    uint8_t *video__fb1;
+    uint8_t *video__fb2;
+    int video__current_page;
+    video_dirty_t video__dirty[2];
+    video_switch_log_t video__log;
+
+} machine_t;
+
+extern machine_t machine_default;
+extern __thread machine_t *current_machine;
+
+/*
+ * Allocate and power on a new machine (the calling thread's current machine is left unchanged).  Machines share the
+ * font and color tables initialized on the way, create them from one thread at a time.
+ */
+machine_t *machine_create(void);
+
+/*
+ * Release a machine created with machine_create() (ejects the disks), it must not be current on any thread
+ */
+void machine_destroy(machine_t *machine);
+
+/*
+ * Make machine the current machine of the calling thread, returns the previous one
+ */
+machine_t *machine_select(machine_t *machine);
+
+// vm.h
+#define apple_ii_64k        (current_machine->apple_ii_64k)
+#define language_card       (current_machine->language_card)
+#define language_banks      (current_machine->language_banks)
+#define softswitches        (current_machine->softswitches)
+#define base_ramrd          (current_machine->base_ramrd)
+#define base_ramwrt         (current_machine->base_ramwrt)
+#define base_textrd         (current_machine->base_textrd)
+#define base_textwrt        (current_machine->base_textwrt)
+#define base_hgrrd          (current_machine->base_hgrrd)
+#define base_hgrwrt         (current_machine->base_hgrwrt)
+#define base_stackzp        (current_machine->base_stackzp)
+#define base_d000_rd        (current_machine->base_d000_rd)
+#define base_e000_rd        (current_machine->base_e000_rd)
+#define base_d000_wrt       (current_machine->base_d000_wrt)
+#define base_e000_wrt       (current_machine->base_e000_wrt)
+#define base_c3rom          (current_machine->base_c3rom)
+#define base_c4rom          (current_machine->base_c4rom)
+#define base_c5rom          (current_machine->base_c5rom)
+#define base_cxrom          (current_machine->base_cxrom)
+#define gc_button_0         (current_machine->gc_button_0)
+#define gc_button_1         (current_machine->gc_button_1)
+#define gc_paddle_0         (current_machine->gc_paddle_0)
+#define gc_paddle_1         (current_machine->gc_paddle_1)
+
+// cpu.h
+#define cpu65_pc            (current_machine->cpu65_pc)
+#define cpu65_a             (current_machine->cpu65_a)
+#define cpu65_f             (current_machine->cpu65_f)
+#define cpu65_x             (current_machine->cpu65_x)
+#define cpu65_y             (current_machine->cpu65_y)
+#define cpu65_sp            (current_machine->cpu65_sp)
+#define cpu65_ea            (current_machine->cpu65_ea)
+#define cpu65_d             (current_machine->cpu65_d)
+#define cpu65_rw            (current_machine->cpu65_rw)
+#define cpu65_opcode        (current_machine->cpu65_opcode)
+#define cpu65_opcycles      (current_machine->cpu65_opcycles)
+#define cpu65_io_pc         (current_machine->cpu65_io_pc)
+#define cpu65__signal       (current_machine->cpu65__signal)
+#define cpu65_opcode_counts (current_machine->cpu65_opcode_counts)
+#define cpu65_vmem_r        (current_machine->cpu65_vmem_r)
+#define cpu65_vmem_w        (current_machine->cpu65_vmem_w)
+#define cpu65_vmem_rpage    (current_machine->cpu65_vmem_rpage)
+#define cpu65_vmem_wpage    (current_machine->cpu65_vmem_wpage)
+#define cpu65_cycle_count   (current_machine->cpu65_cycle_count)
+#define cpu65_cycles_to_execute (current_machine->cpu65_cycles_to_execute)
+#if CPU_JIT
+#define jit65_state         (current_machine->jit65_state)
+#endif
+
+// timing.h
+#define emul_reinitialize   (current_machine->emul_reinitialize)
+#define cycles_count_total  (current_machine->cycles_count_total)
+
+// disk.h
+#define disk6               (current_machine->disk6)
+
+// video/video.h
+#define video__fb1          (current_machine->video__fb1)
+#define video__fb2          (current_machine->video__fb2)
+#define video__current_page (current_machine->video__current_page)
+
+#endif // CPU_C_CORE && !defined(__ASSEMBLER__)
+
+#endif // whole file
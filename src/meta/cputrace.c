@@ -0,0 +1,187 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+// Offline decoding of the binary CPU trace (see cpu65_trace_begin())
+
+#include "common.h"
+#include <sys/mman.h>
+
+#if CPU_TRACING
+
+static void _decode_insn(const cpu65_trace_record_t *rec, FILE *out) {
+    const uint8_t opcode = rec->insn.opcode;
+    const uint16_t pc = rec->insn.pc;
+    const int8_t arg1 = (int8_t)rec->insn.arg1;
+    const int8_t arg2 = (int8_t)rec->insn.arg2;
+    const uint8_t mode = opcodes_65c02[opcode].mode;
+
+    switch (mode) {
+        case addr_implied:
+        case addr_accumulator:
+            fprintf(out, "%04X:%02X    ", pc, opcode);
+            break;
+        case addr_immediate:
+        case addr_zeropage:
+        case addr_zeropage_x:
+        case addr_zeropage_y:
+        case addr_indirect:
+        case addr_indirect_x:
+        case addr_indirect_y:
+        case addr_relative:
+            fprintf(out, "%04X:%02X%02X  ", pc, opcode, (uint8_t)arg1);
+            break;
+        case addr_absolute:
+        case addr_absolute_x:
+        case addr_absolute_y:
+        case addr_j_indirect:
+        case addr_j_indirect_x:
+            fprintf(out, "%04X:%02X%02X%02X", pc, opcode, (uint8_t)arg2, (uint8_t)arg1);
+            break;
+        default:
+            fprintf(out, "invalid opcode mode");
+            break;
+    }
+
+    fprintf(out, " SP:%02X X:%02X Y:%02X A:%02X", rec->insn.sp, rec->insn.x, rec->insn.y, rec->insn.a);
+
+    const uint8_t f = rec->insn.f;
+    char flags_buf[9] = {
+        (f & C_Flag_6502) ? 'C' : '-',
+        (f & X_Flag_6502) ? 'X' : '-',
+        (f & I_Flag_6502) ? 'I' : '-',
+        (f & V_Flag_6502) ? 'V' : '-',
+        (f & B_Flag_6502) ? 'B' : '-',
+        (f & D_Flag_6502) ? 'D' : '-',
+        (f & Z_Flag_6502) ? 'Z' : '-',
+        (f & N_Flag_6502) ? 'N' : '-',
+        '\0',
+    };
+
+    fprintf(out, " %s CYC:%u EA:%04X", flags_buf, rec->insn.cycles, rec->insn.ea);
+
+    char fmt[64];
+    sprintf(fmt, " %s %s", opcodes_65c02[opcode].mnemonic, disasm_templates[mode]);
+
+    switch (mode) {
+        case addr_implied:
+        case addr_accumulator:
+            fprintf(out, "%s", fmt);
+            break;
+        case addr_immediate:
+        case addr_zeropage:
+        case addr_zeropage_x:
+        case addr_zeropage_y:
+        case addr_indirect:
+        case addr_indirect_x:
+        case addr_indirect_y:
+            fprintf(out, fmt, (uint8_t)arg1);
+            break;
+        case addr_absolute:
+        case addr_absolute_x:
+        case addr_absolute_y:
+        case addr_j_indirect:
+        case addr_j_indirect_x:
+            fprintf(out, fmt, (uint8_t)arg1, (uint8_t)arg2);
+            break;
+        case addr_relative:
+            if (arg1 < 0) {
+                fprintf(out, fmt, pc + arg1 + 2, '-', (uint8_t)(-arg1));
+            } else {
+                fprintf(out, fmt, pc + arg1 + 2, '+', (uint8_t)arg1);
+            }
+            break;
+        default:
+            break;
+    }
+
+    fprintf(out, "%s", "\n");
+}
+
+bool cpu65_trace_decode(const char *trace_file, FILE *out) {
+    int fd = -1;
+    void *map = MAP_FAILED;
+    size_t len = 0;
+    bool decoded = false;
+
+    do {
+        TEMP_FAILURE_RETRY(fd = open(trace_file, O_RDONLY));
+        if (fd < 0) {
+            fprintf(stderr, "could not open %s : %s\n", trace_file, strerror(errno));
+            break;
+        }
+
+        struct stat stat_buf;
+        if (fstat(fd, &stat_buf) < 0 || (size_t)stat_buf.st_size < sizeof(cpu65_trace_header_t)) {
+            fprintf(stderr, "%s is not a CPU trace\n", trace_file);
+            break;
+        }
+        len = stat_buf.st_size;
+
+        map = mmap(NULL, len, PROT_READ, MAP_SHARED|MAP_FILE, fd, /*offset:*/0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "could not mmap %s : %s\n", trace_file, strerror(errno));
+            break;
+        }
+
+        const cpu65_trace_header_t *header = (const cpu65_trace_header_t *)map;
+        if (memcmp(header->magic, CPU_TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != CPU_TRACE_VERSION ||
+            header->record_size != sizeof(cpu65_trace_record_t) ||
+            !header->capacity ||
+            sizeof(cpu65_trace_header_t) + (header->capacity * sizeof(cpu65_trace_record_t)) > len)
+        {
+            fprintf(stderr, "%s is not a version %d CPU trace\n", trace_file, CPU_TRACE_VERSION);
+            break;
+        }
+
+        const cpu65_trace_record_t *ring = (const cpu65_trace_record_t *)(header+1);
+        const uint64_t count = header->count;
+        uint64_t begin = 0;
+        if (count > header->capacity) {
+            begin = count - header->capacity;
+            fprintf(out, "---%llu RECORDS OVERWRITTEN\n", (unsigned long long)begin);
+        }
+
+        for (uint64_t i = begin; i < count; i++) {
+            const cpu65_trace_record_t *rec = &ring[i % header->capacity];
+            if (rec->insn.kind == CPU_TRACE_CHECKPOINT) {
+                fprintf(out, "---TOTAL CYC:%lu\n", (unsigned long)rec->checkpoint.cycles_total);
+            } else {
+                _decode_insn(rec, out);
+            }
+        }
+
+        decoded = true;
+    } while (0);
+
+    if (map != MAP_FAILED) {
+        munmap(map, len);
+    }
+    if (fd >= 0) {
+        TEMP_FAILURE_RETRY(close(fd));
+    }
+
+    return decoded;
+}
+
+#if TRACEDUMP
+// Disassembles a binary CPU trace, e.g. : apple2ix-tracedump ~/a2_cputrace.bin > a2_cputrace.txt
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Please specify a CPU trace file on CLI, e.g. : %s path/to/a2_cputrace.bin\n", argv[0]);
+        exit(1);
+    }
+
+    return cpu65_trace_decode(argv[1], stdout) ? 0 : 1;
+}
+#endif
+
+#endif // CPU_TRACING
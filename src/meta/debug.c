@@ -2365,7 +2365,7 @@ YY_RULE_SETUP
 {
 #if CPU_TRACING
     char *buf = NULL;
-    asprintf(&buf, "%s/%s", getenv("HOME"), "cputrace.txt");
+    asprintf(&buf, "%s/%s", getenv("HOME"), "cputrace.bin");
     cpu65_trace_toggle(buf);
     free(buf);
 #else
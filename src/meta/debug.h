@@ -21,6 +21,35 @@
 
 #ifdef DEBUGGER
 extern volatile bool is_debugging;
+
+// 64K-bit maps of the breakpoint/watchpoint addresses (and a 256-bit map of the opcode breakpoints), kept in sync with
+// the breakpoints[]/watchpoints[]/op_breakpoints[] arrays.  The C core tests these inline so that a debugging session
+// only needs to single-step when actually stepping, otherwise it runs at full speed until something is hit.
+#define HALT_EXEC   0x1
+#define HALT_WATCH  0x2
+#define HALT_OP     0x4
+
+extern uint8_t halt_armed;                  // HALT_* kinds currently set
+extern uint8_t halt_exec_map[0x10000/8];
+extern uint8_t halt_watch_map[0x10000/8];
+extern uint8_t halt_op_map[0x100/8];
+extern uint8_t halt_exec_pages[0x100];      // count of breakpoints on each page
+
+#define HALT_MAP_TEST(map, addr) ((map)[(addr)>>3] & (1<<((addr)&0x7)))
+
+// Tests the state following an executed instruction against the halt maps
+static inline bool c_debugger_halt_hit(uint16_t pc, uint16_t ea, uint8_t rw, uint8_t op) {
+    if ((halt_armed & HALT_EXEC) && HALT_MAP_TEST(halt_exec_map, pc)) {
+        return true;
+    }
+    if ((halt_armed & HALT_WATCH) && rw && HALT_MAP_TEST(halt_watch_map, ea)) {
+        return true;
+    }
+    if ((halt_armed & HALT_OP) && HALT_MAP_TEST(halt_op_map, op)) {
+        return true;
+    }
+    return false;
+}
 #else
 #define is_debugging false
 #endif
@@ -87,8 +116,11 @@ void c_interface_debugging();
 
 void c_debugger_go(void);
 bool c_debugger_should_break(void);
+bool c_debugger_is_stepping(void);
 void c_debugger_set_timeout(const unsigned int secs);
 bool c_debugger_set_watchpoint(const uint16_t addr);
+bool c_debugger_set_breakpoint(const uint16_t addr);
+void c_debugger_clear_haltpoints(void);
 
 extern const struct opcode_struct opcodes_6502[256];
 extern const struct opcode_struct opcodes_65c02[256];
@@ -94,6 +94,12 @@ uint8_t current_opcode;
 
 int op_breakpoints[256];                /* opcode breakpoints */
 
+uint8_t halt_armed = 0;
+uint8_t halt_exec_map[0x10000/8] = { 0 };
+uint8_t halt_watch_map[0x10000/8] = { 0 };
+uint8_t halt_op_map[0x100/8] = { 0 };
+uint8_t halt_exec_pages[0x100] = { 0 };
+
 /* in debug.l */
 extern int yylex();
 extern void init_lex(char *buf, int size);
@@ -431,6 +437,8 @@ void set_lc_mem(int addrs, int lcbank, char *hexstr) {
         return;
     }
 
+    cpu65_invalidate_blocks();
+
     while (*hexstr)
     {
         strncpy(scratch, hexstr, 2);
@@ -764,6 +772,47 @@ static int will_branch() {
 }
 #endif
 
+/* -------------------------------------------------------------------------
+    sync_halt_maps () = rebuild the halt maps from the breakpoints, watchpoints,
+        and op_breakpoints arrays
+   ------------------------------------------------------------------------- */
+static void sync_halt_maps() {
+    uint8_t armed = 0;
+
+    memset(halt_exec_map, 0, sizeof(halt_exec_map));
+    memset(halt_watch_map, 0, sizeof(halt_watch_map));
+    memset(halt_op_map, 0, sizeof(halt_op_map));
+    memset(halt_exec_pages, 0, sizeof(halt_exec_pages));
+
+    for (int i = 0; i < MAX_BRKPTS; i++)
+    {
+        if (breakpoints[i] >= 0)
+        {
+            const uint16_t addr = breakpoints[i];
+            halt_exec_map[addr>>3] |= (1<<(addr&0x7));
+            ++halt_exec_pages[addr>>8];
+            armed |= HALT_EXEC;
+        }
+        if (watchpoints[i] >= 0)
+        {
+            const uint16_t addr = watchpoints[i];
+            halt_watch_map[addr>>3] |= (1<<(addr&0x7));
+            armed |= HALT_WATCH;
+        }
+    }
+
+    for (int i = 0; i < 0x100; i++)
+    {
+        if (op_breakpoints[i])
+        {
+            halt_op_map[i>>3] |= (1<<(i&0x7));
+            armed |= HALT_OP;
+        }
+    }
+
+    halt_armed = armed;
+}
+
 /* -------------------------------------------------------------------------
     set_halt () = set a breakpoint or watchpoint in memory
         type = points to "watchpoints" or "breakpoints" array
@@ -776,6 +825,7 @@ bool set_halt(int *type, int addrs) {
         if (type[i] == -1)
         {
             type[i] = addrs;
+            sync_halt_maps();
             sprintf(second_buf[num_buffer_lines++], "set at %04X", addrs);
             return true;
         }
@@ -800,10 +850,12 @@ void clear_halt(int *type, int pt) {
             type[i] = -1;
         }
 
+        sync_halt_maps();
         return;
     }
 
     type[pt-1] = -1;    /* unset single */
+    sync_halt_maps();
 }
 
 /* -------------------------------------------------------------------------
@@ -811,6 +863,7 @@ void clear_halt(int *type, int pt) {
    ------------------------------------------------------------------------- */
 void set_halt_opcode(uint8_t opcode) {
     op_breakpoints[opcode] = 1;
+    sync_halt_maps();
 }
 
 /* -------------------------------------------------------------------------
@@ -818,6 +871,7 @@ void set_halt_opcode(uint8_t opcode) {
    ------------------------------------------------------------------------- */
 void clear_halt_opcode(uint8_t opcode) {
     op_breakpoints[opcode] = 0;
+    sync_halt_maps();
 }
 
 /* -------------------------------------------------------------------------
@@ -872,41 +926,32 @@ int at_haltpt() {
 
     /* check op_breakpoints */
     uint8_t op = get_last_opcode();
-    if (op_breakpoints[op])
+    if (HALT_MAP_TEST(halt_op_map, op))
     {
         sprintf(second_buf[num_buffer_lines++], "stopped at %04X bank %d instruction %02X", cpu65_pc, c_get_current_rambank(cpu65_pc), op);
         ++count;
     }
 
-    for (int i = 0; i < MAX_BRKPTS; i++)
+    if (HALT_MAP_TEST(halt_exec_map, cpu65_pc))
     {
-        if (cpu65_pc == breakpoints[i])
-        {
-            sprintf(second_buf[num_buffer_lines++], "stopped at %04X bank %d", breakpoints[i], c_get_current_rambank(cpu65_pc));
-            ++count;
-        }
+        sprintf(second_buf[num_buffer_lines++], "stopped at %04X bank %d", cpu65_pc, c_get_current_rambank(cpu65_pc));
+        ++count;
     }
 
-    if (cpu65_rw)   /* only check watchpoints if read/write occured */
+    if (cpu65_rw && HALT_MAP_TEST(halt_watch_map, cpu65_ea))   /* only check watchpoints if read/write occured */
     {
-        for (int i = 0; i < MAX_BRKPTS; i++)
+        if (cpu65_rw & 0x2)
         {
-            if (cpu65_ea == watchpoints[i])
-            {
-                if (cpu65_rw & 0x2)
-                {
-                    sprintf(second_buf[num_buffer_lines++], "wrote: %04X: %02X", watchpoints[i], cpu65_d);
-                    ++count;
-                }
-                else
-                {
-                    sprintf(second_buf[num_buffer_lines++], "read: %04X", watchpoints[i]);
-                    ++count;
-                }
-
-                cpu65_rw = 0; /* only allow WP to trip once */
-            }
+            sprintf(second_buf[num_buffer_lines++], "wrote: %04X: %02X", cpu65_ea, cpu65_d);
+            ++count;
+        }
+        else
+        {
+            sprintf(second_buf[num_buffer_lines++], "read: %04X", cpu65_ea);
+            ++count;
         }
+
+        cpu65_rw = 0; /* only allow WP to trip once */
     }
 
     return count;    /* 0 indicates nothing happened */
@@ -1266,6 +1311,26 @@ bool c_debugger_should_break() {
     return stepping_struct.should_break;
 }
 
+/* -------------------------------------------------------------------------
+    c_debugger_is_stepping() - whether the CPU needs to be single-stepped to
+        evaluate the current stepping command.  Otherwise the CPU can run freely
+        as haltpoints are tested inline (see c_debugger_halt_hit())
+   ------------------------------------------------------------------------- */
+bool c_debugger_is_stepping() {
+#if CPU_C_CORE
+    switch (stepping_struct.step_type) {
+        case GOING:
+        case TYPING:
+        case LOADING:
+            return false;
+        default:
+            return true;
+    }
+#else
+    return true;
+#endif
+}
+
 /* -------------------------------------------------------------------------
     debugger_go () - step into or step over commands
    ------------------------------------------------------------------------- */
@@ -1526,3 +1591,16 @@ bool c_debugger_set_watchpoint(const uint16_t addr) {
     return set_halt(watchpoints, addr);
 }
 
+bool c_debugger_set_breakpoint(const uint16_t addr) {
+    return set_halt(breakpoints, addr);
+}
+
+void c_debugger_clear_haltpoints() {
+    clear_halt(breakpoints, 0);
+    clear_halt(watchpoints, 0);
+    for (unsigned int i=0; i<0x100; i++) {
+        op_breakpoints[i] = 0;
+    }
+    sync_halt_maps();
+}
+
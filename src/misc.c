@@ -15,8 +15,51 @@
 
 #include "common.h"
 
+/*
+ * Save state file :
+ *
+ * "A2VM" magick, format version (1 byte) and size of the state (4 bytes), then the state as one zlib stream.  The
+ * state is a sequence of chunks, one per module : 4 character tag, version of the module state (2 bytes), payload size
+ * (4 bytes) and the payload written by the module.  Loading skips unknown chunks and refuses module states newer than
+ * the emulator.  Multi-byte values are big-endian.
+ *
+ * Files of the original format are "A2VM\0" followed by the module states back to back (uncompressed, disk, VM, CPU
+ * then video) : the terminating NUL of their magick reads as version 0.
+ */
 #define SAVE_MAGICK "A2VM"
-#define SAVE_MAGICK_LEN sizeof(SAVE_MAGICK)
+#define SAVE_MAGICK_LEN (sizeof(SAVE_MAGICK)-1)
+#define SAVE_VERSION 2
+#define SAVE_VERSION_0 0                        // original unversioned stream
+#define SAVE_VERSION_0_CHUNKS 1                 // module states of the original stream, as in the first chunk versions
+#define SAVE_HEADER_LEN (SAVE_MAGICK_LEN + 1 + 4)
+#define SAVE_CHUNK_HEADER_LEN (4 + 2 + 4)
+#define SAVE_STATE_INITIAL (256*1024)           // a bit more than a whole //e state
+#define SAVE_STATE_MAX (16*1024*1024)           // sanity limit on a loaded state
+
+typedef struct save_chunk_s {
+    const char tag[5];
+    uint16_t version;                           // bump when the module state changes
+    bool (*save)(StateHelper_s *helper);
+    bool (*load)(StateHelper_s *helper);
+} save_chunk_s;
+
+static const save_chunk_s save_chunks[] = {
+    { "DSK6", 1, &disk6_saveState, &disk6_loadState },
+    { "VM  ", 1, &vm_saveState,    &vm_loadState },
+    { "CPU ", 1, &cpu65_saveState, &cpu65_loadState },
+    { "VID ", 1, &video_saveState, &video_loadState },
+};
+#define SAVE_CHUNK_COUNT (sizeof(save_chunks)/sizeof(save_chunks[0]))
+
+// background write of the last save state
+static pthread_mutex_t save_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t save_thread;
+static bool save_pending = false;
+static bool save_written = false;
+static volatile bool save_done = false;         // writer finished, it can be joined without blocking
+static char *save_path = NULL;
+static uint8_t *save_buf = NULL;
+static size_t save_size = 0;
 
 bool do_logging = true; // also controlled by NDEBUG
 FILE *error_log = NULL;
@@ -38,7 +81,21 @@ static void _init_common(void) {
 #endif
 }
 
-static bool _save_state(int fd, const uint8_t * outbuf, ssize_t outmax) {
+static void _put_be(uint8_t *buf, uint32_t val, unsigned int len) {
+    for (unsigned int i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(val >> (8 * (len-1-i)));
+    }
+}
+
+static uint32_t _get_be(const uint8_t *buf, unsigned int len) {
+    uint32_t val = 0;
+    for (unsigned int i = 0; i < len; i++) {
+        val = (val << 8) | buf[i];
+    }
+    return val;
+}
+
+static bool _write_all(int fd, const uint8_t * outbuf, size_t outmax) {
     ssize_t outlen = 0;
     do {
         if (TEMP_FAILURE_RETRY(outlen = write(fd, outbuf, outmax)) == -1) {
@@ -52,7 +109,7 @@ static bool _save_state(int fd, const uint8_t * outbuf, ssize_t outmax) {
     return outmax == 0;
 }
 
-static bool _load_state(int fd, uint8_t * inbuf, ssize_t inmax) {
+static bool _read_all(int fd, uint8_t * inbuf, size_t inmax) {
     ssize_t inlen = 0;
     do {
         if (TEMP_FAILURE_RETRY(inlen = read(fd, inbuf, inmax)) == -1) {
@@ -70,47 +127,81 @@ static bool _load_state(int fd, uint8_t * inbuf, ssize_t inmax) {
     return inmax == 0;
 }
 
-bool emulator_saveState(const char * const path) {
+// modules save into a growing memory buffer ...
+static bool _save_state(StateHelper_s *helper, const uint8_t * outbuf, ssize_t outmax) {
+    if (helper->pos + outmax > helper->size) {
+        size_t size = helper->size ? helper->size : SAVE_STATE_INITIAL;
+        while (size < helper->pos + outmax) {
+            size <<= 1;
+        }
+        uint8_t *buf = realloc(helper->buf, size);
+        if (!buf) {
+            ERRLOG("could not grow emulator save state buffer");
+            return false;
+        }
+        helper->buf = buf;
+        helper->size = size;
+    }
+    memcpy(helper->buf + helper->pos, outbuf, outmax);
+    helper->pos += outmax;
+
+    return true;
+}
+
+// ... and load from their chunk
+static bool _load_state(StateHelper_s *helper, uint8_t * inbuf, ssize_t inmax) {
+    if (helper->pos + inmax > helper->size) {
+        ERRLOG("error reading emulator save state (truncated chunk)");
+        return false;
+    }
+    memcpy(inbuf, helper->buf + helper->pos, inmax);
+    helper->pos += inmax;
+
+    return true;
+}
+
+static void *_save_write(void *ctx) {
     int fd = -1;
+    uint8_t *zbuf = NULL;
+    char tmp_path[PATH_MAX] = { 0 };
     bool saved = false;
 
-    assert(cpu_isPaused() && "should be paused to save state");
-
     do {
-        TEMP_FAILURE_RETRY(fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR));
-        if (fd < 0) {
-            break;
-        }
-        assert(fd != 0 && "crazy platform");
-
-        // save header
-        if (!_save_state(fd, SAVE_MAGICK, SAVE_MAGICK_LEN)) {
+        uLongf zlen = compressBound(save_size);
+        zbuf = malloc(SAVE_HEADER_LEN + zlen);
+        if (!zbuf) {
+            ERRLOG("could not allocate emulator save state buffer");
             break;
         }
 
-        StateHelper_s helper = {
-            .fd = fd,
-            .save = &_save_state,
-            .load = &_load_state,
-        };
+        memcpy(zbuf, SAVE_MAGICK, SAVE_MAGICK_LEN);
+        zbuf[SAVE_MAGICK_LEN] = SAVE_VERSION;
+        _put_be(zbuf + SAVE_MAGICK_LEN + 1, (uint32_t)save_size, 4);
 
-        if (!disk6_saveState(&helper)) {
+        int err = compress2(zbuf + SAVE_HEADER_LEN, &zlen, save_buf, save_size, Z_DEFAULT_COMPRESSION);
+        if (err != Z_OK) {
+            ERRLOG("could not compress emulator save state : %s", zError(err));
             break;
         }
 
-        if (!vm_saveState(&helper)) {
+        // write aside then rename, so a failure does not clobber a previous save state
+        snprintf(tmp_path, PATH_MAX-1, "%s.tmp", save_path);
+        TEMP_FAILURE_RETRY(fd = open(tmp_path, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR));
+        if (fd < 0) {
             break;
         }
-
-        if (!cpu65_saveState(&helper)) {
+        if (!_write_all(fd, zbuf, SAVE_HEADER_LEN + zlen)) {
             break;
         }
+        TEMP_FAILURE_RETRY(fsync(fd));
+        TEMP_FAILURE_RETRY(close(fd));
+        fd = -1;
 
-        if (!video_saveState(&helper)) {
+        if (rename(tmp_path, save_path) != 0) {
             break;
         }
 
-        TEMP_FAILURE_RETRY(fsync(fd));
+        LOG("saved emulator state to %s (%lu bytes, %lu compressed)", save_path, (unsigned long)save_size, (unsigned long)zlen);
         saved = true;
     } while (0);
 
@@ -120,18 +211,152 @@ bool emulator_saveState(const char * const path) {
 
     if (!saved) {
         ERRLOG("could not write to the emulator save state file");
-        unlink(path);
+        if (tmp_path[0]) {
+            unlink(tmp_path);
+        }
     }
 
-    return saved;
+    FREE(zbuf);
+    FREE(save_buf);
+    FREE(save_path);
+    save_written = saved;
+    __sync_synchronize();
+    save_done = true;
+
+    return NULL;
+}
+
+bool emulator_saveState(const char * const path) {
+    bool captured = false;
+
+    assert(cpu_isPaused() && "should be paused to save state");
+
+    emulator_waitSaveState(); // one save state in flight at a time
+
+    StateHelper_s helper = {
+        .save = &_save_state,
+        .load = &_load_state,
+    };
+
+    do {
+        unsigned int i = 0;
+        for (; i < SAVE_CHUNK_COUNT; i++) {
+            const save_chunk_s *chunk = &save_chunks[i];
+            uint8_t header[SAVE_CHUNK_HEADER_LEN] = { 0 };
+            memcpy(header, chunk->tag, 4);
+            _put_be(header + 4, chunk->version, 2);
+
+            const size_t at = helper.pos;
+            if (!_save_state(&helper, header, SAVE_CHUNK_HEADER_LEN)) {
+                break;
+            }
+            if (!chunk->save(&helper)) {
+                break;
+            }
+            _put_be(helper.buf + at + 6, (uint32_t)(helper.pos - at - SAVE_CHUNK_HEADER_LEN), 4);
+        }
+        if (i < SAVE_CHUNK_COUNT) {
+            break;
+        }
+
+        // compression and file I/O are done off the CPU thread, it may resume right away
+        pthread_mutex_lock(&save_mutex);
+        save_path = strdup(path);
+        save_buf = helper.buf;
+        save_size = helper.pos;
+        save_done = false;
+        if (pthread_create(&save_thread, NULL, &_save_write, NULL)) {
+            ERRLOG("OOPS, pthread_create failed");
+            save_buf = NULL;
+            FREE(save_path);
+            pthread_mutex_unlock(&save_mutex);
+            break;
+        }
+        helper.buf = NULL;
+        save_pending = true;
+        captured = true;
+        pthread_mutex_unlock(&save_mutex);
+    } while (0);
+
+    FREE(helper.buf);
+
+    if (!captured) {
+        ERRLOG("could not save emulator state");
+    }
+
+    return captured;
+}
+
+static void _save_join(void) {
+    if (pthread_join(save_thread, NULL)) {
+        ERRLOG("OOPS: pthread_join of save state thread ...");
+    }
+    save_pending = false;
+}
+
+bool emulator_waitSaveState(void) {
+    pthread_mutex_lock(&save_mutex);
+    if (save_pending) {
+        _save_join();
+    }
+    const bool written = save_written;
+    pthread_mutex_unlock(&save_mutex);
+    return written;
+}
+
+bool emulator_pollSaveState(bool *written) {
+    bool finished = false;
+    // never blocks : a thread waiting on the writer reports for itself
+    if (save_done && (pthread_mutex_trylock(&save_mutex) == 0)) {
+        if (save_pending) {
+            _save_join();
+            *written = save_written;
+            finished = true;
+        }
+        pthread_mutex_unlock(&save_mutex);
+    }
+    return finished;
+}
+
+static bool _load_state_v0(uint8_t *state, size_t state_size) {
+    StateHelper_s helper = {
+        .buf = state,
+        .size = state_size,
+        .version = SAVE_VERSION_0_CHUNKS,
+        .save = &_save_state,
+        .load = &_load_state,
+    };
+
+    // modules were written in the order of the chunks
+    for (unsigned int i = 0; i < SAVE_CHUNK_COUNT; i++) {
+        if (!save_chunks[i].load(&helper)) {
+            ERRLOG("corrupt version 0 emulator save state");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static const save_chunk_s *_save_chunk(const uint8_t *tag) {
+    for (unsigned int i = 0; i < SAVE_CHUNK_COUNT; i++) {
+        if (memcmp(save_chunks[i].tag, tag, 4) == 0) {
+            return &save_chunks[i];
+        }
+    }
+    return NULL;
 }
 
 bool emulator_loadState(const char * const path) {
     int fd = -1;
+    uint8_t *file = NULL;
+    uint8_t *state = NULL;
     bool loaded = false;
 
     assert(cpu_isPaused() && "should be paused to load state");
 
+    emulator_waitSaveState(); // could be loading the state just saved
+
     do {
         TEMP_FAILURE_RETRY(fd = open(path, O_RDONLY));
         if (fd < 0) {
@@ -139,37 +364,93 @@ bool emulator_loadState(const char * const path) {
         }
         assert(fd != 0 && "crazy platform");
 
-        // load header
-        uint8_t magick[SAVE_MAGICK_LEN] = { 0 };
-        if (!_load_state(fd, magick, SAVE_MAGICK_LEN)) {
+        struct stat stat_buf;
+        if ((fstat(fd, &stat_buf) < 0) || (stat_buf.st_size < SAVE_HEADER_LEN)) {
+            ERRLOG("emulator save state file is truncated");
+            break;
+        }
+        const size_t file_size = stat_buf.st_size;
+        file = malloc(file_size);
+        if (!file || !_read_all(fd, file, file_size)) {
             break;
         }
 
         // check header
-        if (memcmp(magick, SAVE_MAGICK, SAVE_MAGICK_LEN) != 0) {
+        if (memcmp(file, SAVE_MAGICK, SAVE_MAGICK_LEN) != 0) {
             ERRLOG("bad header magick in emulator save state file");
             break;
         }
-
-        StateHelper_s helper = {
-            .fd = fd,
-            .save = &_save_state,
-            .load = &_load_state,
-        };
-
-        if (!disk6_loadState(&helper)) {
+        if (file[SAVE_MAGICK_LEN] == SAVE_VERSION_0) {
+            loaded = _load_state_v0(file + SAVE_MAGICK_LEN + 1, file_size - SAVE_MAGICK_LEN - 1);
             break;
         }
-
-        if (!vm_loadState(&helper)) {
+        if (file[SAVE_MAGICK_LEN] != SAVE_VERSION) {
+            ERRLOG("unsupported emulator save state version %u", file[SAVE_MAGICK_LEN]);
+            break;
+        }
+        const size_t state_size = _get_be(file + SAVE_MAGICK_LEN + 1, 4);
+        if (!state_size || (state_size > SAVE_STATE_MAX)) {
+            ERRLOG("bad emulator save state size %lu", (unsigned long)state_size);
             break;
         }
 
-        if (!cpu65_loadState(&helper)) {
+        state = malloc(state_size);
+        if (!state) {
             break;
         }
+        uLongf len = state_size;
+        int err = uncompress(state, &len, file + SAVE_HEADER_LEN, file_size - SAVE_HEADER_LEN);
+        if ((err != Z_OK) || (len != state_size)) {
+            ERRLOG("could not uncompress emulator save state : %s", (err != Z_OK) ? zError(err) : "bad size");
+            break;
+        }
+
+        // load module chunks
+        uint32_t chunks_loaded = 0x0;
+        bool corrupt = false;
+        size_t pos = 0;
+        while (pos < state_size) {
+            corrupt = true;
+            if (state_size - pos < SAVE_CHUNK_HEADER_LEN) {
+                break;
+            }
+            const uint8_t *header = state + pos;
+            const uint16_t version = (uint16_t)_get_be(header + 4, 2);
+            const size_t size = _get_be(header + 6, 4);
+            pos += SAVE_CHUNK_HEADER_LEN;
+            if (size > state_size - pos) {
+                break;
+            }
 
-        if (!video_loadState(&helper)) {
+            const save_chunk_s *chunk = _save_chunk(header);
+            if (!chunk) {
+                LOG("skipping unknown emulator save state chunk '%.4s'", header);
+            } else if (version > chunk->version) {
+                ERRLOG("emulator save state chunk '%.4s' version %u is newer than supported", header, version);
+                break;
+            } else {
+                StateHelper_s helper = {
+                    .buf = state + pos,
+                    .size = size,
+                    .version = version,
+                    .save = &_save_state,
+                    .load = &_load_state,
+                };
+                if (!chunk->load(&helper)) {
+                    break;
+                }
+                chunks_loaded |= (1 << (chunk - save_chunks));
+            }
+            pos += size;
+            corrupt = false;
+        }
+
+        if (corrupt) {
+            ERRLOG("corrupt emulator save state");
+            break;
+        }
+        if (chunks_loaded != (1 << SAVE_CHUNK_COUNT) - 1) {
+            ERRLOG("incomplete emulator save state");
             break;
         }
 
@@ -179,6 +460,8 @@ bool emulator_loadState(const char * const path) {
     if (fd >= 0) {
         TEMP_FAILURE_RETRY(close(fd));
     }
+    FREE(file);
+    FREE(state);
 
     if (!loaded) {
         ERRLOG("could not load emulator save state file");
@@ -235,21 +518,53 @@ void emulator_start(void) {
 }
 
 void emulator_shutdown(void) {
+    emulator_waitSaveState();
     video_shutdown();
     timing_stopCPU();
+    disk6_shutdown();
     _shutdown_threads();
 }
 
-#if !TESTING && !defined(__APPLE__) && !defined(ANDROID)
+#if !TESTING && !HEADLESS && !defined(__APPLE__) && !defined(ANDROID)
 int main(int _argc, char **_argv) {
     argc = _argc;
     argv = _argv;
 
+    // --record FILE / --replay FILE : deterministic input record/replay from power on (see replay.h)
+    // --runahead FRAMES : display the machine FRAMES video frames ahead (see runahead.h)
+    // --rewind SECONDS : keep up to SECONDS of emulation to rewind to with F6 (see rewind.h)
+    // --churn-rate HZ : CPU thread execution periods per second (see timing.h)
+    for (int i = 1; i < argc-1; i++) {
+        if (strcmp(argv[i], "--record") == 0) {
+            if (!replay_startRecording(argv[++i])) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            if (!replay_startPlayback(argv[++i])) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--runahead") == 0) {
+            if (!runahead_start(atoi(argv[++i]))) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--rewind") == 0) {
+            const unsigned long seconds = strtoul(argv[++i], NULL, 10);
+            if (!rewind_start(REWIND_DEFAULT_FRAMES, (unsigned int)(seconds * (60 / REWIND_DEFAULT_FRAMES)))) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--churn-rate") == 0) {
+            if (!timing_setChurnRate(strtoul(argv[++i], NULL, 10))) {
+                return 1;
+            }
+        }
+    }
+
     emulator_start();
 
     // main loop ...
 
     emulator_shutdown();
+    replay_stopRecording();
 
     LOG("Emulator exit ...");
 
@@ -33,15 +33,27 @@ void emulator_shutdown(void);
 // Emulator state save/restore
 //
 
+// Modules save and load their state through a StateHelper_s into/from their own chunk of the save state (see misc.c)
 typedef struct StateHelper_s {
-    int fd;
-    bool (*save)(int fd, const uint8_t * outbuf, ssize_t outmax);
-    bool (*load)(int fd, uint8_t * inbuf, ssize_t inmax);
+    uint8_t *buf;
+    size_t size;
+    size_t pos;
+    uint16_t version;   // version of the chunk being loaded
+    bool (*save)(struct StateHelper_s *helper, const uint8_t * outbuf, ssize_t outmax);
+    bool (*load)(struct StateHelper_s *helper, uint8_t * inbuf, ssize_t inmax);
 } StateHelper_s;
 
-// save current emulator state
+// save current emulator state (CPU paused) : the state is captured in memory, then compressed and written to the save
+// path on a background thread
 bool emulator_saveState(const char * const path);
 
+// wait for the background write of the last save state, returns whether it succeeded
+bool emulator_waitSaveState(void);
+
+// without waiting : returns true once, when the background write of the last save state has finished, with whether it
+// succeeded in `written`
+bool emulator_pollSaveState(bool *written);
+
 // load emulator state from save path
 bool emulator_loadState(const char * const path);
 
@@ -0,0 +1,301 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+// Deterministic input record/replay (see replay.h)
+
+#include "common.h"
+
+#define REPLAY_HOST_KEYS 16
+
+#if MACHINE_CONTEXT
+#   define replay (current_machine->replay)
+#else
+static replay_t replay = { .event = TIMING_EVENT_INITIALIZER(NULL) };
+#endif
+
+// host input posted in between two samples (host state, not per machine)
+static unsigned long host_spinLock = SPINLOCK_INIT;
+static uint8_t host_keys[REPLAY_HOST_KEYS] = { 0 };
+static unsigned int host_key_count = 0;
+static struct timespec host_key_time = { 0 }; // first key pressed since the last sample (see runahead.h)
+static bool host_reset = false;
+
+static void _replay_schedule(void);
+
+// ----------------------------------------------------------------------------
+// Input events
+
+static void _replay_apply(uint8_t kind, uint16_t value) {
+    switch (kind) {
+        case REPLAY_KEY:
+            apple_ii_64k[0][0xC000] = (uint8_t)value;
+            apple_ii_64k[1][0xC000] = (uint8_t)value;
+            break;
+        case REPLAY_BUTTON0:
+            gc_button_0 = (uint8_t)value;
+            break;
+        case REPLAY_BUTTON1:
+            gc_button_1 = (uint8_t)value;
+            break;
+        case REPLAY_PADDLE0:
+            gc_paddle_0 = value;
+            break;
+        case REPLAY_PADDLE1:
+            gc_paddle_1 = value;
+            break;
+        case REPLAY_RESET:
+            cpu65_interrupt(ResetSig);
+            break;
+        default:
+            break;
+    }
+}
+
+static void _replay_record(unsigned long long cycle, uint8_t kind, uint16_t value) {
+    if (!replay.recording) {
+        return;
+    }
+    replay_record_t rec = { .cycle = cycle, .kind = kind, .value = value };
+    if (fwrite(&rec, sizeof(rec), 1, replay.record_fp) != 1) {
+        ERRLOG("OOPS, could not write input recording, stopping");
+        replay_stopRecording();
+    }
+}
+
+static void _replay_input(unsigned long long cycle, uint8_t kind, uint16_t value) {
+    _replay_record(cycle, kind, value);
+    _replay_apply(kind, value);
+}
+
+void replay_hostKey(uint8_t key) {
+    SPINLOCK_ACQUIRE(&host_spinLock);
+    if (!host_key_count) {
+        clock_gettime(CLOCK_MONOTONIC, &host_key_time);
+    }
+    if (host_key_count < REPLAY_HOST_KEYS) {
+        host_keys[host_key_count++] = key;
+    } else {
+        host_keys[REPLAY_HOST_KEYS-1] = key; // the latch only holds the last key anyway
+    }
+    SPINLOCK_RELINQUISH(&host_spinLock);
+}
+
+void replay_hostReset(void) {
+    SPINLOCK_ACQUIRE(&host_spinLock);
+    host_reset = true;
+    SPINLOCK_RELINQUISH(&host_spinLock);
+}
+
+void replay_sampleHostInput(void) {
+    uint8_t keys[REPLAY_HOST_KEYS];
+    unsigned int key_count = 0;
+    struct timespec key_time;
+    bool reset = false;
+
+    SPINLOCK_ACQUIRE(&host_spinLock);
+    if (host_key_count) {
+        key_count = host_key_count;
+        memcpy(keys, host_keys, key_count);
+        key_time = host_key_time;
+        host_key_count = 0;
+    }
+    reset = host_reset;
+    host_reset = false;
+    SPINLOCK_RELINQUISH(&host_spinLock);
+
+    if (replay.records) {
+        return; // host input is ignored while playing back
+    }
+
+    const unsigned long long cycle = timing_currentCycle();
+    bool changed = (key_count || reset);
+
+    // buttons and paddles first : Open-Apple Ctrl-Reset depends on the buttons held during the reset
+    if (UNLIKELY(gc_button_0 != joy_button0)) {
+        _replay_input(cycle, REPLAY_BUTTON0, joy_button0);
+        changed = true;
+    }
+    if (UNLIKELY(gc_button_1 != joy_button1)) {
+        _replay_input(cycle, REPLAY_BUTTON1, joy_button1);
+        changed = true;
+    }
+    if (UNLIKELY(gc_paddle_0 != joy_x)) {
+        _replay_input(cycle, REPLAY_PADDLE0, joy_x);
+        changed = true;
+    }
+    if (UNLIKELY(gc_paddle_1 != joy_y)) {
+        _replay_input(cycle, REPLAY_PADDLE1, joy_y);
+        changed = true;
+    }
+    for (unsigned int i = 0; i < key_count; i++) {
+        _replay_input(cycle, REPLAY_KEY, keys[i]);
+    }
+    if (key_count) {
+        runahead_keyLatched(&key_time);
+    }
+    if (reset) {
+        _replay_input(cycle, REPLAY_RESET, 0);
+    }
+
+    if (changed && replay.recording) {
+        fflush(replay.record_fp); // keep the recording usable should the emulator crash
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Recording
+
+bool replay_startRecording(const char *path) {
+    replay_stopRecording();
+
+    FILE *fp = TEMP_FAILURE_RETRY_FOPEN(fopen(path, "w"));
+    if (!fp) {
+        ERRLOG("could not open input recording %s", path);
+        return false;
+    }
+
+    replay_header_t header = { .version = REPLAY_VERSION, .record_size = sizeof(replay_record_t) };
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+        ERRLOG("could not write input recording %s", path);
+        TEMP_FAILURE_RETRY(fclose(fp));
+        return false;
+    }
+
+    replay.record_fp = fp;
+    replay.recording = false; // until the next power on
+    LOG("recording input to %s", path);
+
+    return true;
+}
+
+void replay_stopRecording(void) {
+    if (!replay.record_fp) {
+        return;
+    }
+    TEMP_FAILURE_RETRY(fclose(replay.record_fp));
+    replay.record_fp = NULL;
+    replay.recording = false;
+}
+
+// ----------------------------------------------------------------------------
+// Playback
+
+static void _replay_fire(timing_event_t *event) {
+    while ((replay.record_next < replay.record_count) &&
+           (replay.records[replay.record_next].kind != REPLAY_POWER) &&
+           (replay.records[replay.record_next].cycle <= cycles_count_total))
+    {
+        const replay_record_t *rec = &replay.records[replay.record_next++];
+        _replay_apply(rec->kind, rec->value);
+    }
+    _replay_schedule();
+}
+
+static void _replay_schedule(void) {
+    if (replay.record_next >= replay.record_count) {
+        LOG("input playback finished");
+        replay_stopPlayback();
+        return;
+    }
+
+    const replay_record_t *rec = &replay.records[replay.record_next];
+    if (rec->kind == REPLAY_POWER) {
+        return; // resumes once the machine powers on again
+    }
+    replay.event.fire = &_replay_fire;
+    timing_scheduleEvent(&replay.event, rec->cycle);
+}
+
+bool replay_startPlayback(const char *path) {
+    replay_stopPlayback();
+
+    FILE *fp = NULL;
+    replay_record_t *records = NULL;
+    bool loaded = false;
+
+    do {
+        fp = TEMP_FAILURE_RETRY_FOPEN(fopen(path, "r"));
+        if (!fp) {
+            ERRLOG("could not open input recording %s", path);
+            break;
+        }
+
+        struct stat stat_buf;
+        replay_header_t header;
+        if ((fstat(fileno(fp), &stat_buf) < 0) || (fread(&header, sizeof(header), 1, fp) != 1) ||
+            (memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0) ||
+            (header.version != REPLAY_VERSION) || (header.record_size != sizeof(replay_record_t)))
+        {
+            ERRLOG("%s is not a version %d input recording", path, REPLAY_VERSION);
+            break;
+        }
+
+        const unsigned long count = (stat_buf.st_size - sizeof(header)) / sizeof(replay_record_t);
+        records = malloc(count * sizeof(replay_record_t));
+        if (!count || !records || (fread(records, sizeof(replay_record_t), count, fp) != count)) {
+            ERRLOG("could not read input recording %s", path);
+            break;
+        }
+        if (records[0].kind != REPLAY_POWER) {
+            ERRLOG("input recording %s does not start at power on", path);
+            break;
+        }
+
+        replay.records = records;
+        replay.record_count = count;
+        replay.record_next = 0;
+        records = NULL;
+        loaded = true;
+        LOG("playing back input from %s (%lu events)", path, count);
+    } while (0);
+
+    if (fp) {
+        TEMP_FAILURE_RETRY(fclose(fp));
+    }
+    FREE(records);
+
+    return loaded;
+}
+
+void replay_stopPlayback(void) {
+    if (!replay.records) {
+        return;
+    }
+    timing_cancelEvent(&replay.event);
+    FREE(replay.records);
+    replay.record_count = 0;
+    replay.record_next = 0;
+}
+
+bool replay_isPlaying(void) {
+    return replay.records != NULL;
+}
+
+// ----------------------------------------------------------------------------
+
+void replay_reinitialize(void) {
+    if (replay.record_fp) {
+        replay.recording = true;
+        _replay_record(0, REPLAY_POWER, 0);
+        fflush(replay.record_fp);
+    }
+
+    if (replay.records) {
+        if (replay.records[replay.record_next].kind != REPLAY_POWER) {
+            ERRLOG("OOPS, machine powered on at odds with the input recording, stopping playback");
+            replay_stopPlayback();
+            return;
+        }
+        ++replay.record_next;
+        _replay_schedule();
+    }
+}
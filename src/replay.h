@@ -0,0 +1,114 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+/*
+ * Deterministic input record/replay.
+ *
+ * Host input (keyboard, joystick/paddles and buttons, Ctrl-Reset) does not reach the emulated machine directly : the
+ * input threads update the host state (joy_x, joy_y, joy_button0, joy_button1, see joystick.h) or post keys/resets
+ * through replay_hostKey()/replay_hostReset(), and the CPU thread transfers the changes to the machine in between
+ * cpu65_run() calls with replay_sampleHostInput().  Every input event therefore lands on a known cycle of the
+ * cycles_count_total timeline, which is what the recorder writes out.
+ *
+ * A recording starts at the next machine power on (timing_reinitializeMachine()) and runs until stopped, machine
+ * power cycles along the way are part of it.  Playing it back on a machine powered on with the same disk images
+ * injects each event at its cycle through the timing event queue, reproducing the session (and the disk writes) bit
+ * for bit, at any speed.  Host input is ignored while playing back.
+ */
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#define REPLAY_MAGIC "A2REPLAY"
+#define REPLAY_VERSION 1
+
+typedef enum replay_kind_t {
+    REPLAY_POWER = 0,   // machine powered on (cycles_count_total restarts at 0)
+    REPLAY_KEY,         // keyboard latch ($C000) set to value
+    REPLAY_BUTTON0,     // open apple/button 0 ($C061) set to value
+    REPLAY_BUTTON1,     // closed apple/button 1 ($C062) set to value
+    REPLAY_PADDLE0,     // paddle 0 ($C064) set to value
+    REPLAY_PADDLE1,     // paddle 1 ($C065) set to value
+    REPLAY_RESET,       // Ctrl-Reset
+} replay_kind_t;
+
+typedef struct replay_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} replay_header_t;
+
+typedef struct replay_record_t {
+    uint64_t cycle;     // cycles_count_total of the event
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t value;
+    uint32_t reserved2;
+} replay_record_t;
+
+/*
+ * Record/replay state of a machine (see machine.h)
+ */
+typedef struct replay_t {
+    FILE *record_fp;            // recording (or about to, until the next power on) when non-NULL
+    bool recording;
+    replay_record_t *records;   // playing back when non-NULL
+    unsigned long record_count;
+    unsigned long record_next;
+    timing_event_t event;       // next record due
+} replay_t;
+
+/*
+ * Record the input of the current machine from its next power on
+ */
+bool replay_startRecording(const char *path);
+
+/*
+ * Stop recording (flushes and closes the recording)
+ */
+void replay_stopRecording(void);
+
+/*
+ * Play back a recording on the current machine from its next power on
+ */
+bool replay_startPlayback(const char *path);
+
+/*
+ * Stop playing back
+ */
+void replay_stopPlayback(void);
+
+/*
+ * Is the current machine playing back a recording?
+ */
+bool replay_isPlaying(void);
+
+/*
+ * Post a key (keyboard latch value, i.e. with the high bit set) from a host input thread
+ */
+void replay_hostKey(uint8_t key);
+
+/*
+ * Post a Ctrl-Reset from a host input thread
+ */
+void replay_hostReset(void);
+
+/*
+ * Transfer the pending host input to the current machine (called by the CPU thread in between cpu65_run() calls)
+ */
+void replay_sampleHostInput(void);
+
+/*
+ * Machine power on hook (called by timing_reinitializeMachine() after the event queue is reset)
+ */
+void replay_reinitialize(void);
+
+#endif // whole file
@@ -0,0 +1,256 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+// Rewind ring of incremental snapshots (see rewind.h)
+
+#include "common.h"
+
+#define REWIND_PAGE_SIZE 0x100
+#define REWIND_PAGES ((sizeof(apple_ii_64k) + sizeof(language_card) + sizeof(language_banks)) / REWIND_PAGE_SIZE)
+#define REWIND_MAIN_PAGES (sizeof(apple_ii_64k) / REWIND_PAGE_SIZE)
+#define REWIND_LC_PAGES (sizeof(language_card) / REWIND_PAGE_SIZE)
+
+#if MACHINE_CONTEXT
+#   define ring (current_machine->rewind_ring)
+#else
+static rewind_ring_t ring = { .event = TIMING_EVENT_INITIALIZER(NULL) };
+#endif
+
+static void _rewind_capture(timing_event_t *event);
+
+// memory is tracked as one run of pages : main/aux memory, then language card, then language banks
+static inline uint8_t *_rewind_page(unsigned int page) {
+    if (page < REWIND_MAIN_PAGES) {
+        return apple_ii_64k[0] + (page * REWIND_PAGE_SIZE);
+    }
+    page -= REWIND_MAIN_PAGES;
+    if (page < REWIND_LC_PAGES) {
+        return language_card[0] + (page * REWIND_PAGE_SIZE);
+    }
+    page -= REWIND_LC_PAGES;
+    return language_banks[0] + (page * REWIND_PAGE_SIZE);
+}
+
+static void _rewind_copyMemory(uint8_t *dst) {
+    memcpy(dst, apple_ii_64k[0], sizeof(apple_ii_64k));
+    dst += sizeof(apple_ii_64k);
+    memcpy(dst, language_card[0], sizeof(language_card));
+    dst += sizeof(language_card);
+    memcpy(dst, language_banks[0], sizeof(language_banks));
+}
+
+static void _rewind_restoreMemory(const uint8_t *src) {
+    memcpy(apple_ii_64k[0], src, sizeof(apple_ii_64k));
+    src += sizeof(apple_ii_64k);
+    memcpy(language_card[0], src, sizeof(language_card));
+    src += sizeof(language_card);
+    memcpy(language_banks[0], src, sizeof(language_banks));
+}
+
+static inline rewind_snapshot_t *_rewind_snapshot(unsigned int idx) {
+    return &ring.snapshots[(ring.first + idx) % ring.capacity];
+}
+
+static void _rewind_schedule(unsigned long long cycle) {
+    ring.event.fire = &_rewind_capture;
+    timing_scheduleEvent(&ring.event, cycle + (ring.frames * REWIND_FRAME_CYCLES));
+}
+
+static void _rewind_reset(void) {
+    ring.first = 0;
+    ring.count = 0;
+    ring.pool_head = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+static void _rewind_capture(timing_event_t *event) {
+    if (ring.count == ring.capacity) {
+        ring.first = (ring.first + 1) % ring.capacity;
+        --ring.count;
+    }
+
+    rewind_snapshot_t *snap = _rewind_snapshot(ring.count);
+    snap->undo_begin = ring.pool_head;
+    snap->undo_count = 0;
+
+    if (ring.count == 0) {
+        _rewind_copyMemory(ring.shadow);
+    } else {
+        for (unsigned int page = 0; page < REWIND_PAGES; page++) {
+            const uint8_t *mem = _rewind_page(page);
+            uint8_t *shadow = ring.shadow + (page * REWIND_PAGE_SIZE);
+            if (LIKELY(memcmp(mem, shadow, REWIND_PAGE_SIZE) == 0)) {
+                continue;
+            }
+            const unsigned long slot = ring.pool_head % ring.pool_capacity;
+            memcpy(ring.pool + (slot * REWIND_PAGE_SIZE), shadow, REWIND_PAGE_SIZE);
+            ring.pool_pages[slot] = (uint16_t)page;
+            ++ring.pool_head;
+            ++snap->undo_count;
+            memcpy(shadow, mem, REWIND_PAGE_SIZE);
+        }
+    }
+
+    snap->cycle = cycles_count_total;
+    snap->switches = softswitches;
+    snap->ramrd = base_ramrd;
+    snap->ramwrt = base_ramwrt;
+    snap->textrd = base_textrd;
+    snap->textwrt = base_textwrt;
+    snap->hgrrd = base_hgrrd;
+    snap->hgrwrt = base_hgrwrt;
+    snap->stackzp = base_stackzp;
+    snap->d000_rd = base_d000_rd;
+    snap->e000_rd = base_e000_rd;
+    snap->d000_wrt = base_d000_wrt;
+    snap->e000_wrt = base_e000_wrt;
+    snap->c3rom = base_c3rom;
+    snap->c4rom = base_c4rom;
+    snap->c5rom = base_c5rom;
+    snap->cxrom = base_cxrom;
+    snap->pc = cpu65_pc;
+    snap->ea = cpu65_ea;
+    snap->a = cpu65_a;
+    snap->f = cpu65_f;
+    snap->x = cpu65_x;
+    snap->y = cpu65_y;
+    snap->sp = cpu65_sp;
+    snap->d = cpu65_d;
+    snap->rw = cpu65_rw;
+    snap->opcode = cpu65_opcode;
+    snap->opcycles = cpu65_opcycles;
+    snap->video_page = video__current_page;
+    disk6_copyState(&snap->disk);
+    ++ring.count;
+
+    // drop the snapshots that can no longer be reached (undo records overwritten in the pool)
+    while ((ring.count > 1) && (_rewind_snapshot(1)->undo_begin + ring.pool_capacity < ring.pool_head)) {
+        ring.first = (ring.first + 1) % ring.capacity;
+        --ring.count;
+    }
+
+    _rewind_schedule(event->cycle);
+}
+
+// ----------------------------------------------------------------------------
+
+bool rewind_start(unsigned int frames, unsigned int snapshots) {
+    rewind_stop();
+
+    if (!frames || !snapshots) {
+        return false;
+    }
+
+    ring.capacity = snapshots;
+    ring.frames = frames;
+    ring.pool_capacity = (unsigned long)snapshots * REWIND_POOL_PAGES_PER_SNAPSHOT;
+    ring.snapshots = calloc(snapshots, sizeof(rewind_snapshot_t));
+    ring.shadow = malloc(REWIND_PAGES * REWIND_PAGE_SIZE);
+    ring.pool = malloc(ring.pool_capacity * REWIND_PAGE_SIZE);
+    ring.pool_pages = malloc(ring.pool_capacity * sizeof(uint16_t));
+    if (!ring.snapshots || !ring.shadow || !ring.pool || !ring.pool_pages) {
+        ERRLOG("OOPS, could not allocate rewind ring");
+        rewind_stop();
+        return false;
+    }
+
+    _rewind_reset();
+    _rewind_schedule(timing_currentCycle());
+
+    return true;
+}
+
+void rewind_stop(void) {
+    timing_cancelEvent(&ring.event);
+    FREE(ring.snapshots);
+    FREE(ring.shadow);
+    FREE(ring.pool);
+    FREE(ring.pool_pages);
+    ring.capacity = 0;
+    _rewind_reset();
+}
+
+unsigned int rewind_count(void) {
+    return ring.count;
+}
+
+unsigned long long rewind_back(unsigned int snapshots) {
+    if (!ring.snapshots || !snapshots || (snapshots > ring.count)) {
+        return 0;
+    }
+
+    if (replay_isPlaying()) {
+        LOG("rewinding, input playback stopped");
+        replay_stopPlayback();
+    }
+    replay_stopRecording();
+
+    // back to the latest snapshot, then undo the later snapshots down to the requested one
+    _rewind_restoreMemory(ring.shadow);
+    const unsigned int target = ring.count - snapshots;
+    for (unsigned int idx = ring.count - 1; idx > target; idx--) {
+        const rewind_snapshot_t *snap = _rewind_snapshot(idx);
+        for (unsigned long i = 0; i < snap->undo_count; i++) {
+            const unsigned long slot = (snap->undo_begin + i) % ring.pool_capacity;
+            const uint8_t *undo = ring.pool + (slot * REWIND_PAGE_SIZE);
+            const unsigned int page = ring.pool_pages[slot];
+            memcpy(_rewind_page(page), undo, REWIND_PAGE_SIZE);
+            memcpy(ring.shadow + (page * REWIND_PAGE_SIZE), undo, REWIND_PAGE_SIZE);
+        }
+    }
+
+    const rewind_snapshot_t *snap = _rewind_snapshot(target);
+    ring.count = target + 1;
+    ring.pool_head = snap->undo_begin + snap->undo_count;
+
+    softswitches = snap->switches;
+    base_ramrd = snap->ramrd;
+    base_ramwrt = snap->ramwrt;
+    base_textrd = snap->textrd;
+    base_textwrt = snap->textwrt;
+    base_hgrrd = snap->hgrrd;
+    base_hgrwrt = snap->hgrwrt;
+    base_stackzp = snap->stackzp;
+    base_d000_rd = snap->d000_rd;
+    base_e000_rd = snap->e000_rd;
+    base_d000_wrt = snap->d000_wrt;
+    base_e000_wrt = snap->e000_wrt;
+    base_c3rom = snap->c3rom;
+    base_c4rom = snap->c4rom;
+    base_c5rom = snap->c5rom;
+    base_cxrom = snap->cxrom;
+    cpu65_pc = snap->pc;
+    cpu65_ea = snap->ea;
+    cpu65_a = snap->a;
+    cpu65_f = snap->f;
+    cpu65_x = snap->x;
+    cpu65_y = snap->y;
+    cpu65_sp = snap->sp;
+    cpu65_d = snap->d;
+    cpu65_rw = snap->rw;
+    cpu65_opcode = snap->opcode;
+    cpu65_opcycles = snap->opcycles;
+    video_setpage(snap->video_page);
+    disk6_restoreState(&snap->disk);
+
+    cpu65_invalidate_blocks();
+    video_redraw();
+
+    return cycles_count_total - snap->cycle;
+}
+
+void rewind_reinitialize(void) {
+    if (ring.snapshots) {
+        _rewind_reset();
+        _rewind_schedule(0);
+    }
+}
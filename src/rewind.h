@@ -0,0 +1,114 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+/*
+ * Rewind ring.
+ *
+ * Every few video frames a timing event snapshots the machine in memory : CPU registers, softswitches and bank
+ * pointers, video page and Disk ][ controller state, plus the 256-byte pages of main/aux memory, language card and
+ * language banks that changed since the previous snapshot.  Changed pages are found by comparing memory against a
+ * shadow copy of the latest snapshot (one pass over 160K, whatever the CPU core and without taxing the stores), and
+ * the previous contents of those pages go to a page pool as undo records.  Rewinding copies the shadow back and
+ * replays the undo records from the latest snapshot down to the requested one, i.e. a few memcpy() per snapshot.
+ *
+ * The ring keeps up to `snapshots` snapshots as long as their undo records fit in the page pool, software rewriting
+ * most of memory every frame shortens the horizon.  The cycle timeline (cycles_count_total, timing events) keeps
+ * running forward through a rewind, and disk contents are not rewound (only the head position).  A power on empties
+ * the ring.
+ */
+
+#ifndef _REWIND_H_
+#define _REWIND_H_
+
+#define REWIND_FRAME_CYCLES 17030           // video frame (see timing.c)
+#define REWIND_DEFAULT_FRAMES 6             // 10 snapshots per second
+#define REWIND_POOL_PAGES_PER_SNAPSHOT 64   // average undo pages budgeted per snapshot
+
+typedef struct rewind_snapshot_t {
+    unsigned long long cycle;
+    uint32_t switches;
+    uint8_t *ramrd;
+    uint8_t *ramwrt;
+    uint8_t *textrd;
+    uint8_t *textwrt;
+    uint8_t *hgrrd;
+    uint8_t *hgrwrt;
+    uint8_t *stackzp;
+    uint8_t *d000_rd;
+    uint8_t *e000_rd;
+    uint8_t *d000_wrt;
+    uint8_t *e000_wrt;
+    uint8_t *c3rom;
+    uint8_t *c4rom;
+    uint8_t *c5rom;
+    uint8_t *cxrom;
+    uint16_t pc;
+    uint16_t ea;
+    uint8_t a;
+    uint8_t f;
+    uint8_t x;
+    uint8_t y;
+    uint8_t sp;
+    uint8_t d;
+    uint8_t rw;
+    uint8_t opcode;
+    uint8_t opcycles;
+    int video_page;
+    disk6_state_t disk;
+    unsigned long undo_begin;   // undo records of the pages changed since the previous snapshot
+    unsigned long undo_count;
+} rewind_snapshot_t;
+
+/*
+ * Rewind state of a machine (see machine.h)
+ */
+typedef struct rewind_ring_t {
+    rewind_snapshot_t *snapshots;   // rewinding enabled when non-NULL
+    unsigned int capacity;
+    unsigned int first;             // oldest snapshot
+    unsigned int count;
+    unsigned int frames;            // video frames in between snapshots
+    uint8_t *shadow;                // memory as of the latest snapshot
+    uint8_t *pool;                  // undo records : previous contents of the changed pages ...
+    uint16_t *pool_pages;           // ... and their page numbers
+    unsigned long pool_capacity;
+    unsigned long pool_head;        // undo records written so far
+    timing_event_t event;
+} rewind_ring_t;
+
+/*
+ * Snapshot the current machine every `frames` video frames, keeping up to `snapshots` of them
+ */
+bool rewind_start(unsigned int frames, unsigned int snapshots);
+
+/*
+ * Stop snapshotting the current machine and free the ring
+ */
+void rewind_stop(void);
+
+/*
+ * Number of snapshots the current machine can be rewound to
+ */
+unsigned int rewind_count(void);
+
+/*
+ * Restore the current machine to the snapshot taken `snapshots` snapshots ago (1 : the latest one), dropping the
+ * later ones.  Returns the emulated cycles rewound, 0 when there is no such snapshot.  Call it on the CPU thread or
+ * with the CPU paused.  Rewinding stops recording or playing back input (see replay.h).
+ */
+unsigned long long rewind_back(unsigned int snapshots);
+
+/*
+ * Machine power on hook (called by timing_reinitializeMachine() after the event queue is reset)
+ */
+void rewind_reinitialize(void);
+
+#endif // whole file
@@ -0,0 +1,257 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+// Run-ahead and input latency (see runahead.h)
+
+#include "common.h"
+
+#define RUNAHEAD_FB_SIZE (SCANWIDTH*SCANHEIGHT)
+
+#if MACHINE_CONTEXT
+#   define runahead (current_machine->runahead)
+#else
+static runahead_t runahead = { 0 };
+#endif
+
+// ----------------------------------------------------------------------------
+// Input latency
+
+static void _runahead_measureLatency(void) {
+    if (!runahead.key_time.tv_sec && !runahead.key_time.tv_nsec) {
+        return;
+    }
+
+    ++runahead.key_frames;
+    const uint8_t * const fb = video_current_framebuffer();
+    if (memcmp(fb, runahead.key_fb, RUNAHEAD_FB_SIZE) == 0) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    bool negative = false;
+    const struct timespec deltat = timespec_diff(runahead.key_time, now, &negative);
+    const unsigned long nsecs = negative ? 0 : (deltat.tv_sec * NANOSECONDS_PER_SECOND) + deltat.tv_nsec;
+
+    runahead_latency_t *latency = &runahead.latency;
+    ++latency->samples;
+    latency->last_nsecs = nsecs;
+    latency->last_frames = runahead.key_frames;
+    latency->total_nsecs += nsecs;
+    if (latency->max_nsecs < nsecs) {
+        latency->max_nsecs = nsecs;
+    }
+    LOG("input latency : %lu usecs, %u frames", nsecs / 1000, runahead.key_frames);
+
+    runahead.key_time.tv_sec = 0;
+    runahead.key_time.tv_nsec = 0;
+}
+
+void runahead_keyLatched(const struct timespec *key_time) {
+    if (runahead.key_time.tv_sec || runahead.key_time.tv_nsec) {
+        return; // measuring the previous key
+    }
+    if (!runahead.key_fb) {
+        runahead.key_fb = malloc(RUNAHEAD_FB_SIZE);
+        if (!runahead.key_fb) {
+            ERRLOG("OOPS, could not allocate latency framebuffer");
+            return;
+        }
+    }
+    memcpy(runahead.key_fb, video_current_framebuffer(), RUNAHEAD_FB_SIZE);
+    runahead.key_time = *key_time;
+    runahead.key_frames = 0;
+}
+
+void runahead_getLatency(runahead_latency_t *latency) {
+    *latency = runahead.latency;
+}
+
+// ----------------------------------------------------------------------------
+// Run-ahead
+
+#if MACHINE_CONTEXT
+// the state copied to the speculative machine, as pointers into the current machine
+typedef struct runahead_fields_t {
+    uint8_t *mem;
+    uint8_t *lc;
+    uint8_t *lc_banks;
+    uint8_t *fb[2];
+    int *page;
+    uint32_t *switches;
+    uint8_t **banks[15];
+    uint8_t *bytes[12];
+    uint16_t *words[5];
+    unsigned long long *cycles[3];
+} runahead_fields_t;
+
+#define RUNAHEAD_FIELDS(f) (sizeof(f)/sizeof(f[0]))
+
+static void _runahead_fields(runahead_fields_t *fields) {
+    *fields = (runahead_fields_t){
+        .mem = apple_ii_64k[0],
+        .lc = language_card[0],
+        .lc_banks = language_banks[0],
+        .fb = { video__fb1, video__fb2 },
+        .page = &video__current_page,
+        .switches = &softswitches,
+        .banks = {
+            &base_ramrd, &base_ramwrt, &base_textrd, &base_textwrt, &base_hgrrd, &base_hgrwrt, &base_stackzp,
+            &base_d000_rd, &base_e000_rd, &base_d000_wrt, &base_e000_wrt, &base_c3rom, &base_c4rom, &base_c5rom,
+            &base_cxrom,
+        },
+        .bytes = {
+            &cpu65_a, &cpu65_f, &cpu65_x, &cpu65_y, &cpu65_sp, &cpu65_d, &cpu65_rw, &cpu65_opcode, &cpu65_opcycles,
+            &cpu65__signal, &gc_button_0, &gc_button_1,
+        },
+        .words = { &cpu65_pc, &cpu65_ea, &cpu65_io_pc, &gc_paddle_0, &gc_paddle_1, },
+        .cycles = { &cycles_count_total, &current_machine->gc_cycles_timer_0, &current_machine->gc_cycles_timer_1, },
+    };
+}
+
+// pointers into a machine are moved to the same place in the other machine (the others point to ROM or functions)
+static inline uint8_t *_runahead_rebase(uint8_t *ptr, const machine_t *from, const machine_t *to) {
+    const uint8_t *base = (const uint8_t *)from;
+    if ((ptr >= base) && (ptr < base + sizeof(machine_t))) {
+        return (uint8_t *)to + (ptr - base);
+    }
+    return ptr;
+}
+
+// copy the state of the current machine to its speculative machine, which is then current
+static void _runahead_sync(machine_t *ahead) {
+    machine_t *machine = current_machine;
+    runahead_fields_t from;
+    _runahead_fields(&from);
+
+    machine_select(ahead);
+    runahead_fields_t to;
+    _runahead_fields(&to);
+
+    memcpy(to.mem, from.mem, sizeof(apple_ii_64k));
+    memcpy(to.lc, from.lc, sizeof(language_card));
+    memcpy(to.lc_banks, from.lc_banks, sizeof(language_banks));
+    memcpy(to.fb[0], from.fb[0], RUNAHEAD_FB_SIZE);
+    memcpy(to.fb[1], from.fb[1], RUNAHEAD_FB_SIZE);
+    *to.page = *from.page;
+    *to.switches = *from.switches;
+    for (unsigned int i = 0; i < RUNAHEAD_FIELDS(from.banks); i++) {
+        *to.banks[i] = _runahead_rebase(*from.banks[i], machine, ahead);
+    }
+    for (unsigned int i = 0; i < RUNAHEAD_FIELDS(from.bytes); i++) {
+        *to.bytes[i] = *from.bytes[i];
+    }
+    for (unsigned int i = 0; i < RUNAHEAD_FIELDS(from.words); i++) {
+        *to.words[i] = *from.words[i];
+    }
+    for (unsigned int i = 0; i < RUNAHEAD_FIELDS(from.cycles); i++) {
+        *to.cycles[i] = *from.cycles[i];
+    }
+
+    // same place on the cycle timeline (cycles_count_total copied above)
+    memcpy(ahead->video__dirty, machine->video__dirty, sizeof(machine->video__dirty));
+    ahead->video__log = machine->video__log;
+    ahead->frame_cycle = machine->frame_cycle;
+    timing_scheduleEvent(&ahead->frame_event, machine->frame_event.cycle);
+    memset(&ahead->idle_loop, 0x0, sizeof(ahead->idle_loop));
+
+    cpu65_invalidate_blocks();
+}
+
+bool runahead_start(unsigned int frames) {
+    runahead_stop();
+
+    if (!frames || (frames > RUNAHEAD_MAX_FRAMES)) {
+        ERRLOG("run-ahead frames must be within 1 .. %d", RUNAHEAD_MAX_FRAMES);
+        return false;
+    }
+
+    runahead.fb = malloc(RUNAHEAD_FB_SIZE);
+    runahead.ahead = machine_create();
+    if (!runahead.fb || !runahead.ahead) {
+        ERRLOG("OOPS, could not allocate run-ahead machine");
+        runahead_stop();
+        return false;
+    }
+
+    machine_t *machine = machine_select(runahead.ahead);
+    runahead.speculative = true;
+    vm_disconnectAudio();
+    machine_select(machine);
+
+    runahead.frames = frames;
+    runahead.fb_valid = false;
+    LOG("running %u frames ahead", frames);
+
+    return true;
+}
+
+void runahead_stop(void) {
+    runahead.frames = 0;
+    runahead.fb_valid = false;
+    if (runahead.ahead) {
+        machine_destroy(runahead.ahead);
+        runahead.ahead = NULL;
+    }
+    FREE(runahead.fb);
+    runahead.key_time.tv_sec = 0;
+    runahead.key_time.tv_nsec = 0;
+    FREE(runahead.key_fb);
+}
+
+static void _runahead_run(void) {
+    if (!disk6.motor_off) {
+        runahead.fb_valid = false; // not while loading, the speculative machine has no disk
+        return;
+    }
+
+    machine_t *machine = current_machine;
+    const unsigned long long frame_len = machine->frame_event.cycle - machine->frame_cycle;
+    const unsigned long long target = machine->frame_event.cycle + ((runahead.frames - 1) * frame_len);
+
+    _runahead_sync(runahead.ahead);
+    timing_runHeadless((int32_t)(target - cycles_count_total)); // ends with the frame event of the target frame
+    const uint8_t * const fb = video_current_framebuffer();
+    machine_select(machine);
+
+    memcpy(runahead.fb, fb, RUNAHEAD_FB_SIZE);
+    runahead.fb_valid = true;
+    video_setDirty();
+}
+#else
+bool runahead_start(unsigned int frames) {
+    ERRLOG("run-ahead requires the C core");
+    return false;
+}
+
+void runahead_stop(void) {
+    runahead.key_time.tv_sec = 0;
+    runahead.key_time.tv_nsec = 0;
+    FREE(runahead.key_fb);
+}
+#endif
+
+const uint8_t *runahead_framebuffer(void) {
+    return runahead.fb_valid ? runahead.fb : NULL;
+}
+
+bool runahead_isSpeculative(void) {
+    return runahead.speculative;
+}
+
+void runahead_endOfFrame(void) {
+#if MACHINE_CONTEXT
+    if (runahead.frames) {
+        _runahead_run();
+    }
+#endif
+    _runahead_measureLatency();
+}
@@ -0,0 +1,90 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+/*
+ * Run-ahead and input latency.
+ *
+ * Software that polls input once per frame and draws the result a frame or two later shows a key press that much
+ * after it was made, on top of the host latency.  With run-ahead, at the end of every video frame of the machine, its
+ * state is copied into a second (speculative) machine that runs `frames` frames further with the current input held,
+ * and the framebuffer of that machine is displayed instead.  The speculative machine has no audio, Mockingboard or
+ * disk : run-ahead is suspended while the Disk ][ motor is on.  The machine itself runs exactly as it would without
+ * run-ahead, it is only read from.  Run-ahead requires the C core (machine context, see machine.h).
+ *
+ * The latency counter measures, with or without run-ahead, the time from a host key press (see replay_hostKey()) to
+ * the end of the first frame whose displayed framebuffer differs from the one at the time the key was seen by the
+ * machine.
+ */
+
+#ifndef _RUNAHEAD_H_
+#define _RUNAHEAD_H_
+
+#define RUNAHEAD_MAX_FRAMES 8
+
+typedef struct runahead_latency_t {
+    unsigned long samples;
+    unsigned long last_nsecs;
+    unsigned long max_nsecs;
+    unsigned long long total_nsecs;
+    unsigned int last_frames;   // frame ends from the key press to the framebuffer change (1 : the next one)
+} runahead_latency_t;
+
+/*
+ * Run-ahead state of a machine (see machine.h)
+ */
+typedef struct runahead_t {
+    unsigned int frames;            // run-ahead enabled when non-zero
+    struct machine_t *ahead;        // speculative machine
+    uint8_t *fb;                    // displayed framebuffer ...
+    bool fb_valid;                  // ... when valid
+    bool speculative;               // this is a speculative machine
+    struct timespec key_time;       // pending latency measurement (tv_sec and tv_nsec 0 : none)
+    unsigned int key_frames;
+    uint8_t *key_fb;                // displayed framebuffer when the key was seen
+    runahead_latency_t latency;
+} runahead_t;
+
+/*
+ * Display the current machine `frames` video frames ahead (1 .. RUNAHEAD_MAX_FRAMES)
+ */
+bool runahead_start(unsigned int frames);
+
+/*
+ * Display the current machine as it runs (ends a latency measurement in progress)
+ */
+void runahead_stop(void);
+
+/*
+ * Framebuffer of the run-ahead frame to be displayed, NULL when not running ahead (see video_current_framebuffer())
+ */
+const uint8_t *runahead_framebuffer(void);
+
+/*
+ * True for the speculative machine of another machine
+ */
+bool runahead_isSpeculative(void);
+
+/*
+ * End of a video frame of the current machine (called from the frame timing event)
+ */
+void runahead_endOfFrame(void);
+
+/*
+ * A host key pressed at `key_time` was just latched by the current machine : start a latency measurement
+ */
+void runahead_keyLatched(const struct timespec *key_time);
+
+/*
+ * Input latency statistics of the current machine
+ */
+void runahead_getLatency(runahead_latency_t *latency);
+
+#endif // whole file
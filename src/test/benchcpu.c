@@ -0,0 +1,502 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+//
+// Microbenchmarks of the virtual 65c02 CPU (opcodes and addressing modes)
+//
+// Every opcode of cpu65__opcodes runs in isolation in a loop built in emulated RAM : BENCH_COPIES copies of the
+// instruction, then TXS and JMP back to the first copy.  Operands point at RAM set up so that every copy executes the
+// same way (branches branch to the next copy, JMP/JSR jump to it, RTS/RTI return to it from a prefilled stack, ...).
+// A loop is first stepped one instruction at a time to count its instructions and cycles, then run for a fixed cycle
+// budget with a single cpu65_run() (as the CPU thread does), timed with CLOCK_MONOTONIC.  The best of the timed runs
+// is kept.
+//
+// Besides the plain variant of every opcode, ADC/SBC also run in decimal mode, indexed (abs,X abs,Y (zp),Y) accesses
+// also cross a page, and branches run both taken and not taken.  BRK (through the ROM interrupt vector) is not run.
+//
+// The table is printed as tab-separated rows, keyed by opcode and variant, so that the tables of two builds/commits can
+// be compared (-b prints the change against a previous table) :
+//
+//      benchcpu [-c cycles] [-r runs] [-o table.tsv] [-b baseline.tsv]
+//
+
+#include "common.h"
+
+#include <getopt.h>
+
+#define BENCH_COPIES 64                 // instructions under test in a loop iteration
+#define BENCH_LOOP_CYCLES 5             // TXS + JMP abs ending an iteration
+#define BENCH_CODE_LOC 0x6000           // loop (clear of the text/hires pages and their video hooks)
+#define BENCH_DATA_LOC 0x7000           // absolute operands
+#define BENCH_JMP_TABLE 0x7400          // JMP (abs) pointers
+#define BENCH_ZP 0x86                   // zero page operand (zp, zp,X, zp,Y)
+#define BENCH_ZP_PTR 0x80               // (zp), (zp,X) pointer
+#define BENCH_ZP_PTR_Y 0x82             // (zp),Y pointer
+#define BENCH_ZP_PTR_Y_CROSS 0x84       // (zp),Y pointer crossing a page with Y
+#define BENCH_INDEX 0x10                // X and Y
+#define BENCH_SP 0x10                   // SP set by the TXS ending an iteration
+#define BENCH_FILL 0x13                 // memory operands (valid BCD)
+#define BENCH_A 0x25                    // (valid BCD)
+
+#define BENCH_DEFAULT_CYCLES 2000000     // ~2 seconds of emulated time per timed run
+#define BENCH_DEFAULT_RUNS 5
+#define BENCH_MAX_STEPS (BENCH_COPIES * 4)
+#define BENCH_MAX_BASELINE 1024
+
+#define ALL_FLAGS_6502 (N_Flag_6502|V_Flag_6502|Z_Flag_6502|C_Flag_6502)
+
+#if CPU_JIT
+#   define BENCH_CORE "c+jit"
+#elif CPU_C_CORE
+#   define BENCH_CORE "c"
+#elif defined(__arm__)
+#   define BENCH_CORE "arm"
+#else
+#   define BENCH_CORE "x86"
+#endif
+
+typedef struct bench_case_t {
+    uint8_t opcode;
+    const char *variant;
+    uint8_t flags;      // 6502 flags at the start of the loop
+    bool cross;         // indexed access crossing a page
+} bench_case_t;
+
+typedef struct bench_result_t {
+    unsigned int insns;         // instructions of a loop iteration ...
+    unsigned int cycles;        // ... and their cycles
+    double op_cycles;           // cycles of the instruction under test
+    double nsecs;               // host time per instruction (loop overhead amortized)
+    double mhz;                 // emulated clock rate
+} bench_result_t;
+
+typedef struct bench_baseline_t {
+    unsigned int opcode;
+    char variant[16];
+    double nsecs;
+} bench_baseline_t;
+
+static const char *mode_names[] = {
+    [addr_implied]      = "implied",
+    [addr_accumulator]  = "acc",
+    [addr_immediate]    = "imm",
+    [addr_zeropage]     = "zp",
+    [addr_zeropage_x]   = "zp,x",
+    [addr_zeropage_y]   = "zp,y",
+    [addr_absolute]     = "abs",
+    [addr_absolute_x]   = "abs,x",
+    [addr_absolute_y]   = "abs,y",
+    [addr_indirect]     = "(zp)",
+    [addr_indirect_x]   = "(zp,x)",
+    [addr_indirect_y]   = "(zp),y",
+    [addr_j_indirect]   = "(abs)",
+    [addr_j_indirect_x] = "(abs,x)",
+    [addr_relative]     = "rel",
+};
+
+static bench_baseline_t baseline[BENCH_MAX_BASELINE];
+static unsigned int baseline_count = 0;
+
+// ----------------------------------------------------------------------------
+// Stubs (no audio, as the tests)
+
+uint8_t c_MB_Read(uint16_t addr) {
+    return 0x0;
+}
+
+void c_MB_Write(uint16_t addr, uint8_t byte) {
+}
+
+uint8_t c_PhasorIO(uint16_t addr) {
+    return 0x0;
+}
+
+void c_speaker_toggle(void) {
+}
+
+void c_interface_print(int x, int y, const int cs, const char *s) {
+}
+
+void testing_video_sync(void) {
+}
+
+// ----------------------------------------------------------------------------
+// Loops
+
+static unsigned int _bench_length(uint8_t opcode) {
+    switch (opcodes_65c02[opcode].mode) {
+        case addr_implied:
+        case addr_accumulator:
+            return 1; // including the unimplemented opcodes (1-byte NOPs in all the cores)
+        case addr_absolute:
+        case addr_absolute_x:
+        case addr_absolute_y:
+        case addr_j_indirect:
+        case addr_j_indirect_x:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+static bool _bench_isDecimal(uint8_t opcode) {
+    const char *mnemonic = opcodes_65c02[opcode].mnemonic;
+    return (strcmp(mnemonic, "ADC") == 0) || (strcmp(mnemonic, "SBC") == 0);
+}
+
+static bool _bench_isIndexed(uint8_t opcode) {
+    const addressing_mode_t mode = opcodes_65c02[opcode].mode;
+    return (mode == addr_absolute_x) || (mode == addr_absolute_y) || (mode == addr_indirect_y);
+}
+
+static void _bench_operands(const bench_case_t *bench, unsigned int copy, uint16_t next, uint8_t *lo, uint8_t *hi) {
+    uint16_t w = 0;
+    switch (bench->opcode) {
+        case 0x20: // JSR
+        case 0x4C: // JMP abs
+            w = next;
+            break;
+        case 0x6C: // JMP (abs)
+            w = BENCH_JMP_TABLE + (copy * 2);
+            break;
+        case 0x7C: // JMP (abs,X)
+            w = BENCH_JMP_TABLE + (copy * 2) - BENCH_INDEX;
+            break;
+        default:
+            switch (opcodes_65c02[bench->opcode].mode) {
+                case addr_immediate:
+                    w = BENCH_FILL;
+                    break;
+                case addr_zeropage:
+                    w = BENCH_ZP;
+                    break;
+                case addr_zeropage_x:
+                case addr_zeropage_y:
+                    w = BENCH_ZP - BENCH_INDEX;
+                    break;
+                case addr_absolute:
+                    w = BENCH_DATA_LOC + 0x20;
+                    break;
+                case addr_absolute_x:
+                case addr_absolute_y:
+                    w = BENCH_DATA_LOC + (bench->cross ? 0xF8 : 0x10);
+                    break;
+                case addr_indirect:
+                    w = BENCH_ZP_PTR;
+                    break;
+                case addr_indirect_x:
+                    w = BENCH_ZP_PTR - BENCH_INDEX;
+                    break;
+                case addr_indirect_y:
+                    w = bench->cross ? BENCH_ZP_PTR_Y_CROSS : BENCH_ZP_PTR_Y;
+                    break;
+                case addr_relative:
+                    w = 0x00; // the next copy, taken or not
+                    break;
+                default:
+                    break;
+            }
+            break;
+    }
+    *lo = (uint8_t)w;
+    *hi = (uint8_t)(w >> 8);
+}
+
+static void _bench_setup(const bench_case_t *bench) {
+    uint8_t * const mem = apple_ii_64k[0];
+    const unsigned int len = _bench_length(bench->opcode);
+
+    // zero page and stack
+    memset(mem, BENCH_FILL, 0x100);
+    memset(mem+0x100, 0x0, 0x100);
+    mem[BENCH_ZP_PTR]           = (uint8_t)(BENCH_DATA_LOC + 0x20);
+    mem[BENCH_ZP_PTR+1]         = (uint8_t)(BENCH_DATA_LOC >> 8);
+    mem[BENCH_ZP_PTR_Y]         = (uint8_t)(BENCH_DATA_LOC + 0x10);
+    mem[BENCH_ZP_PTR_Y+1]       = (uint8_t)(BENCH_DATA_LOC >> 8);
+    mem[BENCH_ZP_PTR_Y_CROSS]   = (uint8_t)(BENCH_DATA_LOC + 0xF8);
+    mem[BENCH_ZP_PTR_Y_CROSS+1] = (uint8_t)(BENCH_DATA_LOC >> 8);
+    memset(mem+BENCH_DATA_LOC, BENCH_FILL, 0x200);
+
+    // the loop
+    uint16_t pc = BENCH_CODE_LOC;
+    for (unsigned int copy = 0; copy < BENCH_COPIES; copy++) {
+        const uint16_t next = pc + len;
+        uint8_t lo = 0;
+        uint8_t hi = 0;
+        _bench_operands(bench, copy, next, &lo, &hi);
+        mem[pc] = bench->opcode;
+        if (len > 1) {
+            mem[pc+1] = lo;
+        }
+        if (len > 2) {
+            mem[pc+2] = hi;
+        }
+
+        mem[BENCH_JMP_TABLE + (copy * 2)] = (uint8_t)next;
+        mem[BENCH_JMP_TABLE + (copy * 2) + 1] = (uint8_t)(next >> 8);
+
+        // returns to the next copy from the stack (the TXS ending an iteration resets SP)
+        if (bench->opcode == 0x60) { // RTS
+            const uint16_t sp = 0x100 + BENCH_SP + 1 + (copy * 2);
+            mem[sp] = (uint8_t)(next-1);
+            mem[sp+1] = (uint8_t)((next-1) >> 8);
+        } else if (bench->opcode == 0x40) { // RTI
+            const uint16_t sp = 0x100 + BENCH_SP + 1 + (copy * 3);
+            mem[sp] = bench->flags;
+            mem[sp+1] = (uint8_t)next;
+            mem[sp+2] = (uint8_t)(next >> 8);
+        }
+
+        pc = next;
+    }
+    mem[pc++] = 0x9A; // TXS
+    mem[pc++] = 0x4C; // JMP BENCH_CODE_LOC
+    mem[pc++] = (uint8_t)BENCH_CODE_LOC;
+    mem[pc++] = (uint8_t)(BENCH_CODE_LOC >> 8);
+
+    cpu65_invalidate_blocks();
+}
+
+static void _bench_reset(const bench_case_t *bench) {
+    cpu65_uninterrupt(0xff);
+    cpu65_cycle_count = 0;
+    cpu65_pc = BENCH_CODE_LOC;
+    cpu65_a = BENCH_A;
+    cpu65_x = BENCH_INDEX;
+    cpu65_y = BENCH_INDEX;
+    cpu65_f = bench->flags;
+    cpu65_sp = BENCH_SP;
+}
+
+// ----------------------------------------------------------------------------
+// Runs
+
+static bool _bench_calibrate(const bench_case_t *bench, bench_result_t *result) {
+    _bench_setup(bench);
+    _bench_reset(bench);
+
+    unsigned int steps = 0;
+    do {
+        cpu65_cycles_to_execute = 1;
+        cpu65_run();
+        ++steps;
+    } while ((cpu65_pc != BENCH_CODE_LOC) && (steps < BENCH_MAX_STEPS));
+
+    if (cpu65_pc != BENCH_CODE_LOC) {
+        return false;
+    }
+
+    result->insns = steps;
+    result->cycles = cpu65_cycle_count;
+    result->op_cycles = (result->cycles - BENCH_LOOP_CYCLES) / (double)BENCH_COPIES;
+    return true;
+}
+
+// the loop is left in place from the calibration, so decoded blocks and native code carry over from run to run
+static double _bench_time(const bench_case_t *bench, const bench_result_t *result, int32_t cycles) {
+    _bench_reset(bench);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    cpu65_cycles_to_execute = cycles;
+    cpu65_run();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    bool negative = false;
+    const struct timespec dt = timespec_diff(t0, t1, &negative);
+    const double nsecs = negative ? 0 : (dt.tv_sec * (double)NANOSECONDS_PER_SECOND) + dt.tv_nsec;
+    const double insns = (double)cpu65_cycle_count * result->insns / result->cycles;
+    return nsecs / insns;
+}
+
+static bool _bench_run(const bench_case_t *bench, int32_t cycles, unsigned int runs, bench_result_t *result) {
+    if (!_bench_calibrate(bench, result)) {
+        return false;
+    }
+
+    _bench_time(bench, result, cycles); // warm up (caches, decoded blocks, native code)
+    result->nsecs = 0;
+    for (unsigned int i = 0; i < runs; i++) {
+        const double nsecs = _bench_time(bench, result, cycles);
+        if (!i || (nsecs < result->nsecs)) {
+            result->nsecs = nsecs;
+        }
+    }
+    if (result->nsecs > 0) {
+        result->mhz = (result->cycles / (double)result->insns) / result->nsecs * 1000.0;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Table
+
+static bool _bench_loadBaseline(const char *path) {
+    FILE *fp = TEMP_FAILURE_RETRY_FOPEN(fopen(path, "r"));
+    if (!fp) {
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp) && (baseline_count < BENCH_MAX_BASELINE)) {
+        if (line[0] == '#') {
+            continue;
+        }
+        bench_baseline_t *b = &baseline[baseline_count];
+        // opcode mnemonic mode variant cycles nsecs ...
+        if (sscanf(line, "%x\t%*s\t%*s\t%15s\t%*f\t%lf", &b->opcode, b->variant, &b->nsecs) == 3) {
+            ++baseline_count;
+        }
+    }
+
+    fclose(fp);
+    return true;
+}
+
+static const bench_baseline_t *_bench_findBaseline(const bench_case_t *bench) {
+    for (unsigned int i = 0; i < baseline_count; i++) {
+        if ((baseline[i].opcode == bench->opcode) && (strcmp(baseline[i].variant, bench->variant) == 0)) {
+            return &baseline[i];
+        }
+    }
+    return NULL;
+}
+
+static void _bench_printRow(FILE *fp, const bench_case_t *bench, const bench_result_t *result, bool ran) {
+    const struct opcode_struct *op = &opcodes_65c02[bench->opcode];
+    fprintf(fp, "%02X\t%s\t%s\t%s\t", bench->opcode, op->mnemonic, mode_names[op->mode], bench->variant);
+    if (!ran) {
+        fprintf(fp, "-\t-\t-%s\n", baseline_count ? "\t-" : "");
+        return;
+    }
+    fprintf(fp, "%.2f\t%.3f\t%.1f", result->op_cycles, result->nsecs, result->mhz);
+    if (baseline_count) {
+        const bench_baseline_t *b = _bench_findBaseline(bench);
+        if (b && (b->nsecs > 0)) {
+            fprintf(fp, "\t%+.1f%%", 100.0 * (result->nsecs - b->nsecs) / b->nsecs);
+        } else {
+            fprintf(fp, "\t-");
+        }
+    }
+    fprintf(fp, "\n");
+}
+
+static void _bench_case(FILE *fp, uint8_t opcode, const char *variant, uint8_t flags, bool cross, int32_t cycles,
+        unsigned int runs)
+{
+    const bench_case_t bench = {
+        .opcode = opcode,
+        .variant = variant,
+        .flags = flags,
+        .cross = cross,
+    };
+    bench_result_t result = { 0 };
+    const bool ran = (opcode != 0x00) && _bench_run(&bench, cycles, runs, &result); // no BRK
+    _bench_printRow(fp, &bench, &result, ran);
+    fflush(fp);
+}
+
+static void _bench_opcode(FILE *fp, uint8_t opcode, int32_t cycles, unsigned int runs) {
+    if (opcodes_65c02[opcode].mode == addr_relative) {
+        if (opcode == 0x80) { // BRA
+            _bench_case(fp, opcode, "taken", 0x0, false, cycles, runs);
+            return;
+        }
+        // Bxx with bit 5 set branch on a set flag (BMI, BVS, BCS, BEQ)
+        const bool on_set = (opcode & 0x20);
+        _bench_case(fp, opcode, "taken", on_set ? ALL_FLAGS_6502 : 0x0, false, cycles, runs);
+        _bench_case(fp, opcode, "not-taken", on_set ? 0x0 : ALL_FLAGS_6502, false, cycles, runs);
+        return;
+    }
+
+    _bench_case(fp, opcode, "-", 0x0, false, cycles, runs);
+    if (_bench_isIndexed(opcode)) {
+        _bench_case(fp, opcode, "cross", 0x0, true, cycles, runs);
+    }
+    if (_bench_isDecimal(opcode)) {
+        _bench_case(fp, opcode, "decimal", D_Flag_6502, false, cycles, runs);
+        if (_bench_isIndexed(opcode)) {
+            _bench_case(fp, opcode, "decimal-cross", D_Flag_6502, true, cycles, runs);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+static void _bench_usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c cycles] [-r runs] [-o table.tsv] [-b baseline.tsv]\n", name);
+}
+
+int main(int argc, char **argv) {
+    int32_t cycles = BENCH_DEFAULT_CYCLES;
+    unsigned int runs = BENCH_DEFAULT_RUNS;
+    const char *table_path = NULL;
+    const char *baseline_path = NULL;
+    do_logging = false;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "c:r:o:b:")) != -1) {
+        switch (opt) {
+            case 'c':
+                cycles = (int32_t)strtol(optarg, NULL, /*base:*/0);
+                break;
+            case 'r':
+                runs = (unsigned int)strtoul(optarg, NULL, /*base:*/10);
+                break;
+            case 'o':
+                table_path = optarg;
+                break;
+            case 'b':
+                baseline_path = optarg;
+                break;
+            default:
+                _bench_usage(argv[0]);
+                return 2;
+        }
+    }
+    if ((optind != argc) || (cycles < 1000) || (runs < 1)) {
+        _bench_usage(argv[0]);
+        return 2;
+    }
+    if (baseline_path && !_bench_loadBaseline(baseline_path)) {
+        ERRLOG("Could not load baseline %s", baseline_path);
+        return 2;
+    }
+
+    FILE *fp = stdout;
+    if (table_path) {
+        fp = TEMP_FAILURE_RETRY_FOPEN(fopen(table_path, "w"));
+        if (!fp) {
+            ERRLOG("Could not open %s", table_path);
+            return 2;
+        }
+    }
+
+    video_init();
+    cpu_scale_factor = CPU_SCALE_FASTEST;
+    cpu_altscale_factor = CPU_SCALE_FASTEST;
+    timing_initialize();
+    extern void reinitialize(void);
+    reinitialize();
+    emul_reinitialize = 0;
+
+    fprintf(fp, "# benchcpu : %s core, %d cycles per run, best of %u runs, %d copies per loop\n",
+            BENCH_CORE, cycles, runs, BENCH_COPIES);
+    fprintf(fp, "# opcode\tmnemonic\tmode\tvariant\tcycles\tns/insn\tMHz%s\n", baseline_count ? "\tvs-baseline" : "");
+    for (unsigned int opcode = 0; opcode < 256; opcode++) {
+        _bench_opcode(fp, (uint8_t)opcode, cycles, runs);
+    }
+
+    if (fp != stdout) {
+        fclose(fp);
+    }
+    return 0;
+}
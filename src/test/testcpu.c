@@ -52,8 +52,6 @@
 static void testcpu_setup(void *arg) {
 
     cpu65_uninterrupt(0xff);
-    extern int32_t cpu65_cycles_to_execute;
-    extern int32_t cpu65_cycle_count;
     cpu65_cycle_count = 0;
     cpu65_cycles_to_execute = 1;
 
@@ -75,6 +73,7 @@ static void testcpu_setup(void *arg) {
 
     // clear prog memory and absolute addressing test locations
     memset(((void*)apple_ii_64k)+TEST_LOC, 0x0, 0x300);
+    cpu65_invalidate_blocks();
 }
 
 static void testcpu_teardown(void *arg) {
@@ -1797,6 +1796,1315 @@ TEST test_IRQ() {
     PASS();
 }
 
+// FIXME TODO : this also tests the Apple //e vm ...
+TEST test_ALTZP_paging() {
+    // page-granular dispatch should follow the zpage/stack bank (ALTZP) without rebuilding the page tables
+    testcpu_set_opcode3(0xa5/*LDA*/, 0x24, 0x85/*STA*/);
+    apple_ii_64k[0][TEST_LOC+3] = 0x25;
+
+    apple_ii_64k[0][0x24] = 0x55;
+    apple_ii_64k[1][0x24] = 0xaa;
+    apple_ii_64k[1][0x25] = 0x00;
+
+    ASSERT(cpu65_vmem_rpage[0x00] == &base_stackzp);
+    ASSERT(cpu65_vmem_wpage[0x00] == &base_stackzp);
+    ASSERT(cpu65_vmem_rpage[0xc0] == NULL);
+    ASSERT(cpu65_vmem_wpage[0xc0] == NULL);
+
+    uint8_t *save_base_stackzp = base_stackzp;
+    base_stackzp = apple_ii_64k[1];
+
+    cpu65_run();
+    cpu65_run();
+
+    base_stackzp = save_base_stackzp;
+
+    ASSERT(cpu65_pc == TEST_LOC+4);
+    ASSERT(cpu65_a  == 0xaa);
+    ASSERT(apple_ii_64k[0][0x25] == 0x00);
+    ASSERT(apple_ii_64k[1][0x25] == 0xaa);
+
+    PASS();
+}
+
+TEST test_page_tables_follow_handlers() {
+    // swapping per-address handlers after vm_initialize() should not leave stale bank pointers in the page tables
+    void *vmem_r[0x600];
+    void *vmem_w[0x600];
+    uint8_t **rpages[0x100];
+    uint8_t **wpages[0x100];
+    memcpy(vmem_r, &cpu65_vmem_r[0xc000], sizeof(vmem_r));
+    memcpy(vmem_w, &cpu65_vmem_w[0xc000], sizeof(vmem_w));
+    memcpy(rpages, cpu65_vmem_rpage, sizeof(rpages));
+    memcpy(wpages, cpu65_vmem_wpage, sizeof(wpages));
+
+    cpu65_vmem_rpage[0xc4] = &base_cxrom;
+    cpu65_vmem_wpage[0xc4] = &base_ramwrt;
+    cpu65_vmem_rpage[0xc5] = &base_cxrom;
+    cpu65_vmem_wpage[0xc5] = &base_ramwrt;
+    vm_disconnectAudio();
+
+    ASSERT(cpu65_vmem_rpage[0xc0] == NULL);
+    ASSERT(cpu65_vmem_wpage[0xc0] == NULL);
+    ASSERT(cpu65_vmem_rpage[0xc4] == NULL);
+    ASSERT(cpu65_vmem_wpage[0xc4] == NULL);
+    ASSERT(cpu65_vmem_rpage[0xc5] == NULL);
+    ASSERT(cpu65_vmem_wpage[0xc5] == NULL);
+    ASSERT(cpu65_vmem_rpage[0x00] == &base_stackzp);
+
+    // reconnecting rebuilds them as well
+    memcpy(&cpu65_vmem_r[0xc000], vmem_r, sizeof(vmem_r));
+    memcpy(&cpu65_vmem_w[0xc000], vmem_w, sizeof(vmem_w));
+    vm_reinitializeAudio();
+    ASSERT(memcmp(rpages, cpu65_vmem_rpage, sizeof(rpages)) == 0);
+    ASSERT(memcmp(wpages, cpu65_vmem_wpage, sizeof(wpages)) == 0);
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// Decoded block execution (C core) must be indistinguishable from single-stepping
+
+#define BLOCK_LOC 0x1000
+static const uint8_t block_prog[] = {
+    0xf8,               // 1000 : SED
+    0xa2, 0x00,         // 1001 : LDX #$00
+    0xa0, 0x10,         // 1003 : LDY #$10
+    0x18,               // 1005 : CLC
+    0xa9, 0x00,         // 1006 : LDA #$00
+    0x7d, 0xf8, 0x11,   // 1008 : ADC $11F8,X (decimal, crosses page)
+    0x9d, 0x00, 0x12,   // 100B : STA $1200,X
+    0x2c, 0x00, 0xc0,   // 100E : BIT $C000 (I/O)
+    0xe8,               // 1011 : INX
+    0x88,               // 1012 : DEY
+    0xd0, 0xf3,         // 1013 : BNE $1008
+    0xd8,               // 1015 : CLD
+    0xee, 0x1a, 0x10,   // 1016 : INC $101A (self-modifying)
+    0xa9, 0x41,         // 1019 : LDA #$41
+    0x8d, 0x00, 0x13,   // 101B : STA $1300
+    0x4c, 0x16, 0x10,   // 101E : JMP $1016
+};
+
+static void testcpu_block_setup(void) {
+    memset(((void*)apple_ii_64k)+BLOCK_LOC, 0x0, 0x400);
+    memcpy(((void*)apple_ii_64k)+BLOCK_LOC, block_prog, sizeof(block_prog));
+    for (unsigned int i = 0; i < 0x10; i++) {
+        apple_ii_64k[0][0x11F8+i] = (i % 9) + 1;
+    }
+    cpu65_invalidate_blocks();
+
+    cpu65_cycle_count = 0;
+    cpu65_pc = BLOCK_LOC;
+    cpu65_a  = 0x00;
+    cpu65_x  = 0x00;
+    cpu65_y  = 0x00;
+    cpu65_f  = 0x00;
+    cpu65_sp = 0xff;
+}
+
+TEST test_block_cache(int32_t budget) {
+
+    // reference : one instruction at a time
+    testcpu_block_setup();
+    while (cpu65_cycle_count < budget) {
+        cpu65_cycles_to_execute = 1;
+        cpu65_run();
+    }
+
+    const int32_t cycle_count = cpu65_cycle_count;
+    const uint16_t pc = cpu65_pc;
+    const uint16_t ea = cpu65_ea;
+    const uint8_t a = cpu65_a;
+    const uint8_t x = cpu65_x;
+    const uint8_t y = cpu65_y;
+    const uint8_t f = cpu65_f;
+    const uint8_t sp = cpu65_sp;
+    const uint8_t opcode = cpu65_opcode;
+    const uint8_t opcycles = cpu65_opcycles;
+    uint8_t mem[0x400];
+    memcpy(mem, ((void*)apple_ii_64k)+BLOCK_LOC, sizeof(mem));
+
+    // same budget in one go
+    testcpu_block_setup();
+    cpu65_cycles_to_execute = budget;
+    cpu65_run();
+
+    ASSERT(cpu65_cycle_count == cycle_count);
+    ASSERT(cpu65_pc       == pc);
+    ASSERT(cpu65_ea       == ea);
+    ASSERT(cpu65_a        == a);
+    ASSERT(cpu65_x        == x);
+    ASSERT(cpu65_y        == y);
+    ASSERT(cpu65_f        == f);
+    ASSERT(cpu65_sp       == sp);
+    ASSERT(cpu65_opcode   == opcode);
+    ASSERT(cpu65_opcycles == opcycles);
+    ASSERT(memcmp(mem, ((void*)apple_ii_64k)+BLOCK_LOC, sizeof(mem)) == 0);
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// Hot loops (compiled to native code with CPU_JIT) must be indistinguishable from single-stepping
+
+#define HOT_LOC 0x2000
+static const uint8_t hot_prog[] = {
+    0xa0, 0x40,           // 2000 : LDY #$40
+    0x20, 0x31, 0x20,     // 2002 : JSR $2031
+    0x98,                 // 2005 : TYA
+    0x18,                 // 2006 : CLC
+    0x65, 0x80,           // 2007 : ADC $80
+    0x85, 0x80,           // 2009 : STA $80
+    0x26, 0x81,           // 200B : ROL $81
+    0xb1, 0x82,           // 200D : LDA ($82),Y
+    0x49, 0x5a,           // 200F : EOR #$5A
+    0x91, 0x84,           // 2011 : STA ($84),Y
+    0xa2, 0x02,           // 2013 : LDX #$02
+    0xa1, 0x84,           // 2015 : LDA ($84,X)
+    0x12, 0x82,           // 2017 : ORA ($82)
+    0x92, 0x86,           // 2019 : STA ($86)
+    0x20, 0xf8, 0x20,     // 201B : JSR $20F8
+    0x88,                 // 201E : DEY
+    0xd0, 0xe1,           // 201F : BNE $2002
+    0xf8,                 // 2021 : SED
+    0xa9, 0x19,           // 2022 : LDA #$19
+    0x69, 0x28,           // 2024 : ADC #$28 (decimal)
+    0x85, 0x88,           // 2026 : STA $88
+    0xd8,                 // 2028 : CLD
+    0xee, 0x66, 0x20,     // 2029 : INC $2066 (self-modifying)
+    0xe6, 0x89,           // 202C : INC $89
+    0x4c, 0x00, 0x20,     // 202E : JMP $2000
+    0x48,                 // 2031 : PHA
+    0x5a,                 // 2032 : PHY
+    0x08,                 // 2033 : PHP
+    0xa2, 0x03,           // 2034 : LDX #$03
+    0xad, 0x00, 0xc0,     // 2036 : LDA $C000 (I/O)
+    0x24, 0x8a,           // 2039 : BIT $8A
+    0x89, 0x80,           // 203B : BIT #$80
+    0x2c, 0x00, 0x22,     // 203D : BIT $2200
+    0x04, 0x8b,           // 2040 : TSB $8B
+    0x14, 0x8c,           // 2042 : TRB $8C
+    0x0a,                 // 2044 : ASL A
+    0x46, 0x8d,           // 2045 : LSR $8D
+    0x7e, 0x00, 0x22,     // 2047 : ROR $2200,X
+    0x2e, 0x01, 0x22,     // 204A : ROL $2201
+    0xd6, 0x8e,           // 204D : DEC $8E,X
+    0xfe, 0x01, 0x22,     // 204F : INC $2201,X
+    0xe9, 0x11,           // 2052 : SBC #$11
+    0xe0, 0x02,           // 2054 : CPX #$02
+    0xc4, 0x81,           // 2056 : CPY $81
+    0x64, 0x8f,           // 2058 : STZ $8F
+    0xb9, 0xf8, 0x22,     // 205A : LDA $22F8,Y
+    0x9d, 0x00, 0x23,     // 205D : STA $2300,X
+    0x28,                 // 2060 : PLP
+    0x7a,                 // 2061 : PLY
+    0x68,                 // 2062 : PLA
+    0xba,                 // 2063 : TSX
+    0x9a,                 // 2064 : TXS
+    0xa9, 0x00,           // 2065 : LDA #$00
+    0x99, 0x80, 0x22,     // 2067 : STA $2280,Y
+    0x60,                 // 206A : RTS
+};
+
+static void testcpu_hot_setup(void) {
+    memset(((void*)apple_ii_64k)+HOT_LOC, 0x0, 0x400);
+    memcpy(((void*)apple_ii_64k)+HOT_LOC, hot_prog, sizeof(hot_prog));
+
+    // sub2 : a branch crossing into the next page
+    apple_ii_64k[0][0x20F8] = 0x18; // 20F8 : CLC
+    apple_ii_64k[0][0x20F9] = 0x90; // 20F9 : BCC $2105
+    apple_ii_64k[0][0x20FA] = 0x0a;
+    apple_ii_64k[0][0x2105] = 0x60; // 2105 : RTS
+
+    for (unsigned int i = 0; i < 0x100; i++) {
+        apple_ii_64k[0][0x2200+i] = (uint8_t)(i * 7 + 3);
+    }
+    memset(apple_ii_64k[0]+0x80, 0x0, 0x20);
+    apple_ii_64k[0][0x82] = 0xf0; // ($82) -> $22F0
+    apple_ii_64k[0][0x83] = 0x22;
+    apple_ii_64k[0][0x84] = 0x00; // ($84) -> $2300
+    apple_ii_64k[0][0x85] = 0x23;
+    apple_ii_64k[0][0x86] = 0x80; // ($86) -> $2380
+    apple_ii_64k[0][0x87] = 0x23;
+    apple_ii_64k[0][0x8a] = 0xc1;
+    apple_ii_64k[0][0x8b] = 0x0f;
+    apple_ii_64k[0][0x8c] = 0xf0;
+    apple_ii_64k[0][0x8d] = 0x81;
+    cpu65_invalidate_blocks();
+
+    cpu65_cycle_count = 0;
+    cpu65_pc = HOT_LOC;
+    cpu65_a  = 0x00;
+    cpu65_x  = 0x00;
+    cpu65_y  = 0x00;
+    cpu65_f  = 0x00;
+    cpu65_sp = 0xff;
+}
+
+TEST test_hot_loop(int32_t budget) {
+
+    // reference : one instruction at a time
+    unsigned long long counts[256] = { 0 };
+    unsigned long long instructions = 0;
+    testcpu_hot_setup();
+    cpu65_opcode_counts = counts;
+    while (cpu65_cycle_count < budget) {
+        cpu65_cycles_to_execute = 1;
+        cpu65_run();
+        ++instructions;
+    }
+    cpu65_opcode_counts = NULL;
+
+    const int32_t cycle_count = cpu65_cycle_count;
+    const uint16_t pc = cpu65_pc;
+    const uint16_t ea = cpu65_ea;
+    const uint8_t a = cpu65_a;
+    const uint8_t x = cpu65_x;
+    const uint8_t y = cpu65_y;
+    const uint8_t f = cpu65_f;
+    const uint8_t sp = cpu65_sp;
+    const uint8_t d = cpu65_d;
+    const uint8_t rw = cpu65_rw;
+    const uint8_t opcode = cpu65_opcode;
+    const uint8_t opcycles = cpu65_opcycles;
+    uint8_t zpage[0x200];
+    uint8_t mem[0x400];
+    memcpy(zpage, apple_ii_64k[0], sizeof(zpage));
+    memcpy(mem, ((void*)apple_ii_64k)+HOT_LOC, sizeof(mem));
+
+    // same budget in one go
+    unsigned long long block_counts[256] = { 0 };
+    testcpu_hot_setup();
+    cpu65_opcode_counts = block_counts;
+    cpu65_cycles_to_execute = budget;
+    cpu65_run();
+    cpu65_opcode_counts = NULL;
+
+#if CPU_C_CORE
+    // instructions are counted once whether interpreted, run from a decoded block or from native code
+    unsigned long long counted = 0;
+    for (unsigned int op = 0; op < 256; op++) {
+        counted += counts[op];
+    }
+    ASSERT(counted == instructions);
+    ASSERT(memcmp(block_counts, counts, sizeof(counts)) == 0);
+#endif
+
+    ASSERT(cpu65_cycle_count == cycle_count);
+    ASSERT(cpu65_pc       == pc);
+    ASSERT(cpu65_ea       == ea);
+    ASSERT(cpu65_a        == a);
+    ASSERT(cpu65_x        == x);
+    ASSERT(cpu65_y        == y);
+    ASSERT(cpu65_f        == f);
+    ASSERT(cpu65_sp       == sp);
+    ASSERT(cpu65_d        == d);
+    ASSERT(cpu65_rw       == rw);
+    ASSERT(cpu65_opcode   == opcode);
+    ASSERT(cpu65_opcycles == opcycles);
+    ASSERT(memcmp(zpage, apple_ii_64k[0], sizeof(zpage)) == 0);
+    ASSERT(memcmp(mem, ((void*)apple_ii_64k)+HOT_LOC, sizeof(mem)) == 0);
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// Skipping a keyboard polling loop must be indistinguishable from spinning in it
+
+static void testcpu_idle_setup(uint16_t loc, bool counting) {
+    memset(apple_ii_64k[0]+loc-0x10, 0x0, 0x20);
+    uint8_t *p = apple_ii_64k[0]+loc;
+    if (counting) {
+        *p++ = 0xe6; *p++ = 0x4e;       // loc+0 : INC $4E
+        *p++ = 0xd0; *p++ = 0x02;       // loc+2 : BNE loc+6
+        *p++ = 0xe6; *p++ = 0x4f;       // loc+4 : INC $4F
+    }
+    *p++ = 0x2c; *p++ = 0x00; *p++ = 0xc0; // BIT $C000
+    *p++ = 0x10;                        // BPL loc
+    *p = (uint8_t)(loc - (p + 1 - apple_ii_64k[0]));
+    apple_ii_64k[0][0x4e] = 0xf0;
+    apple_ii_64k[0][0x4f] = 0x12;
+    apple_ii_64k[0][0xC000] = 0x00;
+    apple_ii_64k[1][0xC000] = 0x00;
+    cpu65_invalidate_blocks();
+
+    cpu65_cycle_count = 0;
+    cpu65_pc = loc;
+    cpu65_a  = 0x00;
+    cpu65_x  = 0x00;
+    cpu65_y  = 0x00;
+    cpu65_f  = 0x00;
+    cpu65_sp = 0xff;
+}
+
+TEST test_idle_loop(uint16_t loc, bool counting, int32_t budget) {
+    extern void timing_skipIdleLoop(int32_t budget);
+
+    // detect the loop and skip ahead
+    testcpu_idle_setup(loc, counting);
+    cpu65_cycles_to_execute = budget;
+    cpu65_run();
+    ASSERT(cpu65_cycle_count < 32);
+    timing_skipIdleLoop(budget - cpu65_cycle_count);
+    ASSERT(cpu65_cycle_count <= budget);
+    ASSERT(cpu65_cycle_count > budget - 32);
+
+    const int32_t cycle_count = cpu65_cycle_count;
+    const uint16_t pc = cpu65_pc;
+    const uint8_t a = cpu65_a;
+    const uint8_t f = cpu65_f;
+    const uint8_t rndl = apple_ii_64k[0][0x4e];
+    const uint8_t rndh = apple_ii_64k[0][0x4f];
+
+    // reference : spin one instruction at a time
+    testcpu_idle_setup(loc, counting);
+    while (cpu65_cycle_count < cycle_count) {
+        cpu65_cycles_to_execute = 1;
+        cpu65_run();
+    }
+
+    ASSERT(cpu65_cycle_count == cycle_count);
+    ASSERT(cpu65_pc == pc);
+    ASSERT(cpu65_a  == a);
+    ASSERT(cpu65_f  == f);
+    ASSERT(apple_ii_64k[0][0x4e] == rndl);
+    ASSERT(apple_ii_64k[0][0x4f] == rndh);
+
+    PASS();
+}
+
+#if MACHINE_CONTEXT
+// ----------------------------------------------------------------------------
+// Machines running on their own threads must not interfere with each other (nor with the default machine)
+
+#define TEST_MACHINES 4
+
+typedef struct testcpu_machine_t {
+    machine_t *machine;
+    int32_t budget;
+} testcpu_machine_t;
+
+static void testcpu_machine_run(int32_t budget) {
+    memset(apple_ii_64k, 0x0, 0x200); // a new machine does not start out of testcpu_setup()
+    testcpu_hot_setup();
+    cpu65_cycles_to_execute = budget;
+    cpu65_run();
+}
+
+static void *testcpu_machine_thread(void *arg) {
+    testcpu_machine_t *tm = (testcpu_machine_t *)arg;
+    machine_select(tm->machine);
+    testcpu_machine_run(tm->budget);
+    return NULL;
+}
+
+TEST test_machine_threads(int32_t budget) {
+
+    // reference : default machine
+    testcpu_machine_run(budget);
+
+    const int32_t cycle_count = cpu65_cycle_count;
+    const uint16_t pc = cpu65_pc;
+    const uint8_t a = cpu65_a;
+    const uint8_t x = cpu65_x;
+    const uint8_t y = cpu65_y;
+    const uint8_t f = cpu65_f;
+    const uint8_t sp = cpu65_sp;
+    uint8_t zpage[0x200];
+    uint8_t mem[0x400];
+    memcpy(zpage, apple_ii_64k[0], sizeof(zpage));
+    memcpy(mem, ((void*)apple_ii_64k)+HOT_LOC, sizeof(mem));
+
+    testcpu_machine_t tms[TEST_MACHINES];
+    pthread_t threads[TEST_MACHINES];
+    for (unsigned int i = 0; i < TEST_MACHINES; i++) {
+        tms[i].machine = machine_create();
+        tms[i].budget = budget;
+        ASSERT(tms[i].machine);
+    }
+    for (unsigned int i = 0; i < TEST_MACHINES; i++) {
+        pthread_create(&threads[i], NULL, testcpu_machine_thread, &tms[i]);
+    }
+    for (unsigned int i = 0; i < TEST_MACHINES; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // default machine untouched
+    ASSERT(cpu65_cycle_count == cycle_count);
+    ASSERT(cpu65_pc == pc);
+    ASSERT(memcmp(zpage, apple_ii_64k[0], sizeof(zpage)) == 0);
+    ASSERT(memcmp(mem, ((void*)apple_ii_64k)+HOT_LOC, sizeof(mem)) == 0);
+
+    // each machine ran the same program
+    for (unsigned int i = 0; i < TEST_MACHINES; i++) {
+        machine_t *prev = machine_select(tms[i].machine);
+        const bool same =
+            cpu65_cycle_count == cycle_count &&
+            cpu65_pc == pc &&
+            cpu65_a  == a &&
+            cpu65_x  == x &&
+            cpu65_y  == y &&
+            cpu65_f  == f &&
+            cpu65_sp == sp &&
+            memcmp(zpage, apple_ii_64k[0], sizeof(zpage)) == 0 &&
+            memcmp(mem, ((void*)apple_ii_64k)+HOT_LOC, sizeof(mem)) == 0;
+        machine_select(prev);
+        machine_destroy(tms[i].machine);
+        ASSERT(same);
+    }
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// Input recorded on the cycle timeline must play back identically, whatever the slicing of the runs
+
+#define TEST_REPLAY_SLICES 200
+#define REPLAY_LOC 0x2000
+
+static uint8_t replay_prog[] = {
+    0xAD, 0x00, 0xC0,   // 2000 LDA $C000     keyboard
+    0x10, 0x03,         // 2003 BPL $2008
+    0x8D, 0x10, 0xC0,   // 2005 STA $C010     clear strobe
+    0x45, 0x80,         // 2008 EOR $80
+    0x4D, 0x61, 0xC0,   // 200A EOR $C061     button 0
+    0x85, 0x80,         // 200D STA $80
+    0xAD, 0x70, 0xC0,   // 200F LDA $C070     paddle strobe
+    0xA0, 0x00,         // 2012 LDY #$00
+    0xAD, 0x64, 0xC0,   // 2014 LDA $C064     paddle 0 timer
+    0x10, 0x03,         // 2017 BPL $201C
+    0xC8,               // 2019 INY
+    0xD0, 0xF8,         // 201A BNE $2014
+    0x98,               // 201C TYA
+    0x9D, 0x00, 0x30,   // 201D STA $3000,X
+    0xA5, 0x80,         // 2020 LDA $80
+    0x9D, 0x00, 0x31,   // 2022 STA $3100,X
+    0xE8,               // 2025 INX
+    0x4C, 0x00, 0x20,   // 2026 JMP $2000
+};
+
+static void testcpu_replay_setup(void) {
+    memset(apple_ii_64k[0], 0x0, 0x200);
+    memset(apple_ii_64k[0]+0x3000, 0x0, 0x200);
+    memcpy(apple_ii_64k[0]+REPLAY_LOC, replay_prog, sizeof(replay_prog));
+    cpu65_pc = REPLAY_LOC;
+    cpu65_a = 0x0;
+    cpu65_x = 0x0;
+    cpu65_y = 0x0;
+    cpu65_f = 0x0;
+    cpu65_sp = 0xFF;
+}
+
+TEST test_replay(int32_t slice) {
+    char path[] = "/tmp/testcpu-replay-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    TEMP_FAILURE_RETRY(close(fd));
+
+    // record : host input sampled in between irregular runs
+    machine_t *machine = machine_create();
+    ASSERT(machine);
+    machine_t *prev = machine_select(machine);
+    ASSERT(replay_startRecording(path));
+    timing_reinitializeMachine();
+    testcpu_replay_setup();
+    for (unsigned int i = 0; i < TEST_REPLAY_SLICES; i++) {
+        if ((i % 7) == 3) {
+            replay_hostKey(0x80 | ('A' + (i % 26)));
+        }
+        if ((i % 11) == 5) {
+            joy_button0 = joy_button0 ? 0x0 : 0xFF;
+        }
+        if ((i % 5) == 0) {
+            joy_x = (i * 37) & 0xFF;
+        }
+        replay_sampleHostInput();
+        timing_runHeadless(slice + (i % 3) * 97);
+    }
+    replay_stopRecording();
+
+    const unsigned long long cycles = cycles_count_total;
+    const uint16_t pc = cpu65_pc;
+    const uint8_t a = cpu65_a;
+    const uint8_t x = cpu65_x;
+    const uint8_t y = cpu65_y;
+    const uint8_t f = cpu65_f;
+    uint8_t mem[0x200];
+    memcpy(mem, apple_ii_64k[0]+0x3000, sizeof(mem));
+    const uint8_t acc = apple_ii_64k[0][0x80];
+    machine_select(prev);
+    machine_destroy(machine);
+
+    // play back in one go
+    machine = machine_create();
+    ASSERT(machine);
+    prev = machine_select(machine);
+    ASSERT(replay_startPlayback(path));
+    timing_reinitializeMachine();
+    testcpu_replay_setup();
+    timing_runHeadless((int32_t)cycles);
+
+    const bool same =
+        cycles_count_total == cycles &&
+        cpu65_pc == pc &&
+        cpu65_a  == a &&
+        cpu65_x  == x &&
+        cpu65_y  == y &&
+        cpu65_f  == f &&
+        apple_ii_64k[0][0x80] == acc &&
+        memcmp(mem, apple_ii_64k[0]+0x3000, sizeof(mem)) == 0;
+    const bool finished = !replay_isPlaying();
+    replay_stopPlayback();
+    machine_select(prev);
+    machine_destroy(machine);
+    unlink(path);
+
+    ASSERT(same);
+    ASSERT(finished);
+
+    PASS();
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Rewinding must restore the machine as it was at the snapshot
+
+#define TEST_REWIND_SNAPSHOTS 40
+#define TEST_REWIND_FRAMES 60
+#define TEST_REWIND_CONTINUE 20000
+#define REWIND_LOC 0x2000
+
+static uint8_t rewind_prog[] = {
+    0xE6, 0x80,         // 2000 INC $80
+    0xD0, 0x02,         // 2002 BNE $2006
+    0xE6, 0x81,         // 2004 INC $81
+    0xA5, 0x81,         // 2006 LDA $81
+    0x29, 0x1F,         // 2008 AND #$1F
+    0x09, 0x40,         // 200A ORA #$40      HGR page 2
+    0x85, 0x83,         // 200C STA $83
+    0xA5, 0x80,         // 200E LDA $80
+    0x85, 0x82,         // 2010 STA $82
+    0xA0, 0x00,         // 2012 LDY #$00
+    0x8A,               // 2014 TXA
+    0x91, 0x82,         // 2015 STA ($82),Y
+    0xE8,               // 2017 INX
+    0x4C, 0x00, 0x20,   // 2018 JMP $2000
+};
+
+typedef struct testcpu_rewind_state_t {
+    uint16_t pc;
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t f;
+    uint8_t sp;
+    uint8_t zpage[0x100];
+    uint8_t hgr[0x2000];
+} testcpu_rewind_state_t;
+
+typedef struct testcpu_rewind_result_t {
+    unsigned long long rewound_cycles;
+    unsigned long long snapshot_cycle;
+    unsigned int count;                 // snapshots left after rewinding
+    testcpu_rewind_state_t rewound;     // at the snapshot ...
+    testcpu_rewind_state_t expected;    // ... and once run on from there
+    int32_t continued;
+} testcpu_rewind_result_t;
+
+static testcpu_rewind_result_t rewind_result;
+
+// load the program into the current (powered on) machine
+static void testcpu_rewind_load(void) {
+    memset(apple_ii_64k[0], 0x0, 0x200);
+    memset(apple_ii_64k[0]+0x4000, 0x0, 0x2000);
+    memcpy(apple_ii_64k[0]+REWIND_LOC, rewind_prog, sizeof(rewind_prog));
+    cpu65_pc = REWIND_LOC;
+    cpu65_a = 0x0;
+    cpu65_x = 0x0;
+    cpu65_y = 0x0;
+    cpu65_f = 0x0;
+    cpu65_sp = 0xFF;
+}
+
+static void testcpu_rewind_getState(testcpu_rewind_state_t *state) {
+    state->pc = cpu65_pc;
+    state->a = cpu65_a;
+    state->x = cpu65_x;
+    state->y = cpu65_y;
+    state->f = cpu65_f;
+    state->sp = cpu65_sp;
+    memcpy(state->zpage, apple_ii_64k[0], sizeof(state->zpage));
+    memcpy(state->hgr, apple_ii_64k[0]+0x4000, sizeof(state->hgr));
+}
+
+// run the program on the current machine, rewind it, then run on from there
+static bool testcpu_rewind_run(unsigned int back, testcpu_rewind_result_t *result) {
+    if (!rewind_start(/*frames:*/1, TEST_REWIND_SNAPSHOTS)) {
+        return false;
+    }
+    for (unsigned int i = 0; i < TEST_REWIND_FRAMES; i++) {
+        timing_runHeadless(REWIND_FRAME_CYCLES + (i * 7));
+    }
+    const bool filled = (rewind_count() == TEST_REWIND_SNAPSHOTS) && (rewind_back(TEST_REWIND_SNAPSHOTS+1) == 0);
+
+    result->rewound_cycles = rewind_back(back);
+    result->snapshot_cycle = cycles_count_total - result->rewound_cycles;
+    result->count = rewind_count();
+    testcpu_rewind_getState(&result->rewound);
+    timing_runHeadless(TEST_REWIND_CONTINUE);
+    testcpu_rewind_getState(&result->expected);
+    result->continued = cpu65_cycle_count;
+    rewind_stop();
+
+    return filled;
+}
+
+// reference : the same program run straight to the snapshot (and on from there) on the current machine
+static bool testcpu_rewind_sameRewound(const testcpu_rewind_result_t *result) {
+    timing_runHeadless((int32_t)result->snapshot_cycle);
+    return
+        cycles_count_total == result->snapshot_cycle &&
+        cpu65_pc == result->rewound.pc &&
+        cpu65_a  == result->rewound.a &&
+        cpu65_x  == result->rewound.x &&
+        cpu65_y  == result->rewound.y &&
+        cpu65_f  == result->rewound.f &&
+        cpu65_sp == result->rewound.sp &&
+        memcmp(result->rewound.zpage, apple_ii_64k[0], sizeof(result->rewound.zpage)) == 0 &&
+        memcmp(result->rewound.hgr, apple_ii_64k[0]+0x4000, sizeof(result->rewound.hgr)) == 0;
+}
+
+static bool testcpu_rewind_sameContinued(const testcpu_rewind_result_t *result) {
+    timing_runHeadless(result->continued);
+    return
+        cpu65_pc == result->expected.pc &&
+        cpu65_x  == result->expected.x &&
+        memcmp(result->expected.zpage, apple_ii_64k[0], sizeof(result->expected.zpage)) == 0 &&
+        memcmp(result->expected.hgr, apple_ii_64k[0]+0x4000, sizeof(result->expected.hgr)) == 0;
+}
+
+#if MACHINE_CONTEXT
+static machine_t *testcpu_rewind_machine(void) {
+    machine_t *machine = machine_create();
+    if (machine) {
+        machine_t *prev = machine_select(machine);
+        testcpu_rewind_load();
+        machine_select(prev);
+    }
+    return machine;
+}
+
+TEST test_rewind(unsigned int back) {
+    testcpu_rewind_result_t *result = &rewind_result;
+
+    machine_t *machine = testcpu_rewind_machine();
+    ASSERT(machine);
+    machine_t *prev = machine_select(machine);
+    const bool filled = testcpu_rewind_run(back, result);
+    machine_select(prev);
+    machine_destroy(machine);
+
+    ASSERT(filled);
+    ASSERT(result->rewound_cycles > 0);
+    ASSERT(result->count == TEST_REWIND_SNAPSHOTS - back + 1);
+
+    machine = testcpu_rewind_machine();
+    ASSERT(machine);
+    prev = machine_select(machine);
+    const bool same_rewound = testcpu_rewind_sameRewound(result);
+    const bool same_continued = testcpu_rewind_sameContinued(result);
+    machine_select(prev);
+    machine_destroy(machine);
+
+    ASSERT(same_rewound);
+    ASSERT(same_continued);
+
+    PASS();
+}
+#endif
+
+// the default machine, on the CPU core of the build (the only machine of the assembly cores)
+TEST test_rewind_default(unsigned int back) {
+    testcpu_rewind_result_t *result = &rewind_result;
+
+    cpu65_cycles_to_execute = 0; // not within cpu65_run() until timing_runHeadless()
+    timing_reinitializeMachine();
+    testcpu_rewind_load();
+    const bool filled = testcpu_rewind_run(back, result);
+
+    timing_reinitializeMachine();
+    testcpu_rewind_load();
+    const bool same_rewound = testcpu_rewind_sameRewound(result);
+    const bool same_continued = testcpu_rewind_sameContinued(result);
+    timing_reinitializeMachine();
+
+    ASSERT(filled);
+    ASSERT(result->rewound_cycles > 0);
+    ASSERT(result->count == TEST_REWIND_SNAPSHOTS - back + 1);
+    ASSERT(same_rewound);
+    ASSERT(same_continued);
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// Frames handed to the renderer must match the framebuffer, whichever bands were brought into the back buffer
+
+TEST test_frame_handoff() {
+    static uint8_t saved[SCANWIDTH*SCANHEIGHT];
+    uint8_t *fb = (uint8_t *)video_current_framebuffer();
+    memcpy(saved, fb, sizeof(saved));
+
+    uint32_t bands = 0x0;
+    video_acquireFrame(&bands); // renderer up : frames are presented from now on
+
+    bool same = true;
+    bool marked = true;
+    uint32_t changed = 0x0;
+    for (unsigned int i = 0; i < 64; i++) {
+        const unsigned int band = (i * 7) % TEXT_ROWS;
+        fb[(band * SCANWIDTH * VIDEO_BAND_HEIGHT) + (i * 13)] = (uint8_t)(i + 1);
+        changed |= (1U << band);
+        video_setDirty();
+        video_presentFrame();
+        if ((i % 3) == 1) {
+            continue; // frame skipped by the renderer
+        }
+        const uint8_t *frame = video_acquireFrame(&bands);
+        same = same && (memcmp(frame, fb, sizeof(saved)) == 0);
+        marked = marked && ((bands & changed) == changed);
+        changed = 0x0;
+    }
+
+    memcpy(fb, saved, sizeof(saved));
+    video_setDirty();
+
+    ASSERT(same);
+    ASSERT(marked);
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// A display mode change in the middle of a frame splits it at the scanline the beam was on, and the frame after is
+// plotted whole with the new mode
+
+#define SPLIT_LOC 0x2000
+#define SPLIT_LINE_SIZE (SCANWIDTH*(FONT_HEIGHT_PIXELS/FONT_GLYPH_Y))
+
+static uint8_t split_prog[] = {
+    0xA0, 0x06,         // 2000 LDY #$06
+    0xA2, 0x00,         // 2002 LDX #$00
+    0xCA,               // 2004 DEX
+    0xD0, 0xFD,         // 2005 BNE $2004
+    0x88,               // 2007 DEY
+    0xD0, 0xF8,         // 2008 BNE $2002
+    0xAD, 0x50, 0xC0,   // 200A LDA $C050     graphics (lores) from about scanline 120
+    0x4C, 0x0D, 0x20,   // 200D JMP $200D
+};
+
+TEST test_mid_frame_switch() {
+    static uint8_t split[SCANWIDTH*SCANHEIGHT];
+    static uint8_t after[SCANWIDTH*SCANHEIGHT];
+    static uint8_t text[SCANWIDTH*SCANHEIGHT];
+    static uint8_t lores[SCANWIDTH*SCANHEIGHT];
+
+    cpu65_cycles_to_execute = 0; // not within cpu65_run() until timing_runHeadless()
+    timing_reinitializeMachine();
+    for (unsigned int i = 0; i < 0x400; i++) {
+        apple_ii_64k[0][0x400+i] = (uint8_t)((i * 7) + (i >> 5));
+    }
+    memcpy(apple_ii_64k[0]+SPLIT_LOC, split_prog, sizeof(split_prog));
+    cpu65_pc = SPLIT_LOC;
+    video_redraw();
+
+    timing_runHeadless(REWIND_FRAME_CYCLES);
+    memcpy(split, video_current_framebuffer(), sizeof(split));
+    timing_runHeadless(REWIND_FRAME_CYCLES);
+    memcpy(after, video_current_framebuffer(), sizeof(after));
+
+    // references : the whole screen in either mode
+    const uint32_t softswitches_save = softswitches;
+    softswitches |= SS_TEXT;
+    video_redraw();
+    memcpy(text, video_current_framebuffer(), sizeof(text));
+    softswitches &= ~SS_TEXT;
+    video_redraw();
+    memcpy(lores, video_current_framebuffer(), sizeof(lores));
+    softswitches = softswitches_save;
+    timing_reinitializeMachine();
+
+#define SAME_LINE(fb, ref) (memcmp((fb) + (line*SPLIT_LINE_SIZE), (ref) + (line*SPLIT_LINE_SIZE), SPLIT_LINE_SIZE) == 0)
+    unsigned int line = 0;
+    while ((line < SCANHEIGHT/2) && SAME_LINE(split, text)) {
+        ++line;
+    }
+    const unsigned int split_line = line;
+    while ((line < SCANHEIGHT/2) && SAME_LINE(split, lores)) {
+        ++line;
+    }
+#undef SAME_LINE
+
+    ASSERT(memcmp(text, lores, sizeof(text)) != 0);
+    ASSERT(split_line > 100);
+    ASSERT(split_line < 140);
+    ASSERT(line == SCANHEIGHT/2);
+    ASSERT(memcmp(after, lores, sizeof(after)) == 0);
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// Save state must round trip through the compressed file written in the background, and files of the original
+// unversioned format must still load
+
+#define TEST_STATE_V0_MAX (256*1024)
+
+static uint8_t testcpu_state_mem[0x2000];
+static uint8_t testcpu_state_aux[0x2000];
+
+static void testcpu_state_setup(void) {
+    for (unsigned int i = 0; i < 0x2000; i++) {
+        apple_ii_64k[0][0x4000+i] = (uint8_t)(i * 7);
+        apple_ii_64k[1][0x2000+i] = (uint8_t)(i >> 3);
+    }
+    cpu65_pc = 0x1234;
+    cpu65_a = 0x56;
+    cpu65_x = 0x78;
+    cpu65_y = 0x9A;
+    cpu65_f = 0xBC;
+    cpu65_sp = 0xDE;
+    memcpy(testcpu_state_mem, apple_ii_64k[0]+0x4000, sizeof(testcpu_state_mem));
+    memcpy(testcpu_state_aux, apple_ii_64k[1]+0x2000, sizeof(testcpu_state_aux));
+}
+
+static void testcpu_state_clobber(void) {
+    memset(apple_ii_64k[0]+0x4000, 0x0, 0x2000);
+    memset(apple_ii_64k[1]+0x2000, 0x0, 0x2000);
+    cpu65_pc = 0x0;
+    cpu65_a = 0x0;
+    cpu65_x = 0x0;
+    cpu65_y = 0x0;
+    cpu65_f = 0x0;
+    cpu65_sp = 0x0;
+}
+
+static bool testcpu_state_same(void) {
+    return
+        cpu65_pc == 0x1234 &&
+        cpu65_a  == 0x56 &&
+        cpu65_x  == 0x78 &&
+        cpu65_y  == 0x9A &&
+        cpu65_f  == 0xBC &&
+        cpu65_sp == 0xDE &&
+        memcmp(testcpu_state_mem, apple_ii_64k[0]+0x4000, sizeof(testcpu_state_mem)) == 0 &&
+        memcmp(testcpu_state_aux, apple_ii_64k[1]+0x2000, sizeof(testcpu_state_aux)) == 0;
+}
+
+static bool testcpu_state_save_v0(StateHelper_s *helper, const uint8_t *outbuf, ssize_t outmax) {
+    if (helper->pos + outmax > helper->size) {
+        return false;
+    }
+    memcpy(helper->buf + helper->pos, outbuf, outmax);
+    helper->pos += outmax;
+    return true;
+}
+
+// writes the current state as the original format did : "A2VM\0" then the module states back to back, uncompressed
+static bool testcpu_state_write_v0(const char *path) {
+    static uint8_t buf[TEST_STATE_V0_MAX];
+    StateHelper_s helper = {
+        .buf = buf,
+        .size = sizeof(buf),
+        .save = &testcpu_state_save_v0,
+    };
+    memcpy(buf, "A2VM", 5);
+    helper.pos = 5;
+    if (!disk6_saveState(&helper) || !vm_saveState(&helper) || !cpu65_saveState(&helper) || !video_saveState(&helper)) {
+        return false;
+    }
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return false;
+    }
+    const bool written = (fwrite(buf, 1, helper.pos, fp) == helper.pos);
+    fclose(fp);
+    return written;
+}
+
+TEST test_save_state() {
+    char path[] = "/tmp/testcpu-state-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    TEMP_FAILURE_RETRY(close(fd));
+
+    testcpu_state_setup();
+
+    cpu_pause();
+    ASSERT(emulator_saveState(path));
+
+    // the state is already captured, the machine can carry on while it is written
+    testcpu_state_clobber();
+
+    ASSERT(emulator_waitSaveState());
+    struct stat stat_buf;
+    ASSERT(stat(path, &stat_buf) == 0);
+    ASSERT(stat_buf.st_size < sizeof(apple_ii_64k)/4);
+
+    const bool loaded = emulator_loadState(path);
+    const bool same = testcpu_state_same();
+
+    // the outcome of a write can also be collected without waiting, once
+    ASSERT(emulator_saveState(path));
+    bool written = false;
+    while (!emulator_pollSaveState(&written)) {
+        static struct timespec ts = { .tv_sec=0, .tv_nsec=1000000 };
+        nanosleep(&ts, NULL);
+    }
+    bool written_again = false;
+    const bool polled_again = emulator_pollSaveState(&written_again);
+
+    // original unversioned format
+    testcpu_state_setup();
+    const bool written_v0 = testcpu_state_write_v0(path);
+    testcpu_state_clobber();
+    const bool loaded_v0 = written_v0 && emulator_loadState(path);
+    const bool same_v0 = testcpu_state_same();
+
+    // ... truncated
+    FILE *fp = fopen(path, "w");
+    ASSERT(fp);
+    fwrite("A2VM\0\0\0\0\0\0\0\0", 1, 12, fp);
+    fclose(fp);
+    const bool loaded_truncated = emulator_loadState(path);
+    cpu_resume();
+    unlink(path);
+
+    ASSERT(loaded);
+    ASSERT(same);
+    ASSERT(written);
+    ASSERT(!polled_again);
+    ASSERT(written_v0);
+    ASSERT(loaded_v0);
+    ASSERT(same_v0);
+    ASSERT(!loaded_truncated);
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// The CPU thread must be paused, resumed and power cycled through its mailbox, and acknowledge the commands waited on
+
+TEST test_cpu_mailbox() {
+    const struct timespec ms = { .tv_sec=0, .tv_nsec=1000000 };
+
+    timing_startCPU();
+    while (cycles_count_total < 20 * CLK_6502_INT) {
+        nanosleep(&ms, NULL);
+    }
+
+    // paused upon return
+    cpu_pause();
+    const unsigned long long paused_cycles = cycles_count_total;
+    for (unsigned int i = 0; i < 20; i++) {
+        nanosleep(&ms, NULL);
+    }
+    const bool stayed_paused = (cycles_count_total == paused_cycles);
+
+    // not serviced while paused (no waiting on a paused CPU thread) ...
+    const bool serviced_paused = timing_postCommands(CPU_CMD_REINIT, /*wait:*/true);
+
+    // ... a resume immediately followed by a pause is acknowledged as well
+    for (unsigned int i = 0; i < 100; i++) {
+        cpu_resume();
+        cpu_pause();
+    }
+    cpu_resume();
+
+    // serviced after the resume : power cycled
+    while (cycles_count_total >= paused_cycles) {
+        nanosleep(&ms, NULL);
+    }
+    while (cycles_count_total < 20 * CLK_6502_INT) {
+        nanosleep(&ms, NULL);
+    }
+
+    const unsigned long long reinit_cycles = cycles_count_total;
+    const bool serviced = timing_postCommands(CPU_CMD_REINIT, /*wait:*/true);
+    cpu_pause();
+    const bool power_cycled = (cycles_count_total < reinit_cycles);
+    cpu_resume();
+
+    timing_stopCPU();
+    const bool serviced_stopped = timing_postCommands(CPU_CMD_REINIT, /*wait:*/true);
+
+    ASSERT(stayed_paused);
+    ASSERT(!serviced_paused);
+    ASSERT(serviced);
+    ASSERT(power_cycled);
+    ASSERT(!serviced_stopped);
+
+    PASS();
+}
+
+#if MACHINE_CONTEXT
+// ----------------------------------------------------------------------------
+// Run-ahead must show the reaction to a key press earlier, without changing the course of the machine
+
+#define TEST_RUNAHEAD_FRAMES 10
+#define TEST_RUNAHEAD_FRAME_CYCLES 17030
+#define RUNAHEAD_LOC 0x2000
+
+static uint8_t runahead_prog[] = {
+    0xE6, 0x80,         // 2000 INC $80       count the polls
+    0xAD, 0x00, 0xC0,   // 2002 LDA $C000     keyboard
+    0x10, 0xF9,         // 2005 BPL $2000
+    0x8D, 0x10, 0xC0,   // 2007 STA $C010     clear strobe
+    0xA2, 0x1B,         // 200A LDX #$1B      about two frames of delay
+    0xA0, 0x00,         // 200C LDY #$00
+    0x88,               // 200E DEY
+    0xD0, 0xFD,         // 200F BNE $200E
+    0xCA,               // 2011 DEX
+    0xD0, 0xFA,         // 2012 BNE $200E
+    0x8D, 0x00, 0x04,   // 2014 STA $0400     show the key
+    0x4C, 0x00, 0x20,   // 2017 JMP $2000
+};
+
+typedef struct testcpu_runahead_result_t {
+    runahead_latency_t latency;
+    unsigned long long cycles;
+    uint16_t pc;
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t f;
+    uint8_t sp;
+    uint8_t mem[2][0x10000];
+} testcpu_runahead_result_t;
+
+static testcpu_runahead_result_t runahead_results[2];
+
+static bool testcpu_runahead(unsigned int frames, testcpu_runahead_result_t *result) {
+    machine_t *machine = machine_create();
+    if (!machine) {
+        return false;
+    }
+    machine_t *prev = machine_select(machine);
+    bool started = !frames || runahead_start(frames);
+
+    memcpy(apple_ii_64k[0]+RUNAHEAD_LOC, runahead_prog, sizeof(runahead_prog));
+    apple_ii_64k[0][0x0400] = 0xA0;
+    cpu65_pc = RUNAHEAD_LOC;
+    cpu65_sp = 0xFF;
+    timing_runHeadless(2 * TEST_RUNAHEAD_FRAME_CYCLES);
+
+    replay_hostKey(0x80 | 'A');
+    replay_sampleHostInput();
+    for (unsigned int i = 0; i < TEST_RUNAHEAD_FRAMES; i++) {
+        timing_runHeadless(TEST_RUNAHEAD_FRAME_CYCLES);
+    }
+
+    runahead_getLatency(&result->latency);
+    result->cycles = cycles_count_total;
+    result->pc = cpu65_pc;
+    result->a = cpu65_a;
+    result->x = cpu65_x;
+    result->y = cpu65_y;
+    result->f = cpu65_f;
+    result->sp = cpu65_sp;
+    memcpy(result->mem, apple_ii_64k, sizeof(result->mem));
+    machine_select(prev);
+    machine_destroy(machine);
+
+    return started;
+}
+
+TEST test_runahead(unsigned int frames) {
+    testcpu_runahead_result_t *plain = &runahead_results[0];
+    testcpu_runahead_result_t *ahead = &runahead_results[1];
+    ASSERT(testcpu_runahead(0, plain));
+    ASSERT(testcpu_runahead(frames, ahead));
+
+    ASSERT(plain->latency.samples == 1);
+    ASSERT(ahead->latency.samples == 1);
+    ASSERT(plain->latency.last_frames >= 3);
+    const unsigned int expected = (plain->latency.last_frames > frames) ? plain->latency.last_frames - frames : 1;
+    ASSERT(ahead->latency.last_frames == expected);
+
+    const bool same =
+        ahead->cycles == plain->cycles &&
+        ahead->pc == plain->pc &&
+        ahead->a  == plain->a &&
+        ahead->x  == plain->x &&
+        ahead->y  == plain->y &&
+        ahead->f  == plain->f &&
+        ahead->sp == plain->sp &&
+        memcmp(ahead->mem, plain->mem, sizeof(plain->mem)) == 0;
+    ASSERT(same);
+    ASSERT(plain->mem[0][0x0400] == (0x80 | 'A'));
+
+    PASS();
+}
+
+// ----------------------------------------------------------------------------
+// An event scheduled from an I/O handler during cpu65_run() ends the run when it is due
+
+#define EVENT_LOC 0x2000
+#define EVENT_IO 0xC0F0
+#define EVENT_RUN_CYCLES 10000 // less than a video frame : only the event cuts the run short
+
+static uint8_t event_prog[] = {
+    0xAD, 0xF0, 0xC0,   // 2000 LDA $C0F0     schedule the event
+    0xE8,               // 2003 INX
+    0x4C, 0x03, 0x20,   // 2004 JMP $2003
+};
+
+static unsigned long long event_delay = 0;
+static unsigned long long event_due = 0;
+static bool event_scheduled = false;
+static unsigned long long event_fired = 0;
+
+static void testcpu_event_fire(timing_event_t *event) {
+    event_fired = timing_currentCycle();
+}
+
+static timing_event_t testcpu_event = TIMING_EVENT_INITIALIZER(testcpu_event_fire);
+
+static uint8_t testcpu_event_read(uint16_t ea) {
+    event_due = timing_currentCycle() + event_delay;
+    event_scheduled = true;
+    timing_scheduleEvent(&testcpu_event, event_due);
+    return 0x00;
+}
+
+TEST test_io_event(unsigned long long delay) {
+    machine_t *machine = machine_create();
+    ASSERT(machine);
+    machine_t *prev = machine_select(machine);
+    void *io_read = cpu65_vmem_r[EVENT_IO];
+    cpu65_vmem_r[EVENT_IO] = testcpu_event_read;
+
+    memcpy(apple_ii_64k[0]+EVENT_LOC, event_prog, sizeof(event_prog));
+    cpu65_pc = EVENT_LOC;
+    cpu65_sp = 0xFF;
+    event_delay = delay;
+    event_scheduled = false;
+    event_fired = 0;
+    timing_runHeadless(EVENT_RUN_CYCLES);
+
+    cpu65_vmem_r[EVENT_IO] = io_read;
+    timing_cancelEvent(&testcpu_event);
+    machine_select(prev);
+    machine_destroy(machine);
+
+    ASSERT(event_scheduled);
+    ASSERT(event_fired >= event_due);
+    ASSERT(event_fired < event_due + 7); // within an instruction
+
+    PASS();
+}
+#endif
+
+#if CPU_C_CORE && defined(DEBUGGER)
+// ----------------------------------------------------------------------------
+// Debugging at full speed must halt exactly where single-stepping does
+
+#define TEST_HALTS 3
+
+TEST test_haltpoints(uint16_t addr, bool watch, int32_t budget) {
+    extern int num_buffer_lines;
+
+    c_debugger_clear_haltpoints();
+    num_buffer_lines = 0;
+    if (watch) {
+        c_debugger_set_watchpoint(addr);
+    } else {
+        c_debugger_set_breakpoint(addr);
+    }
+    is_debugging = true;
+
+    // reference : one instruction at a time, testing after each
+    int32_t cycle_counts[TEST_HALTS];
+    uint16_t pcs[TEST_HALTS];
+    uint16_t eas[TEST_HALTS];
+    uint8_t as[TEST_HALTS];
+    testcpu_hot_setup();
+    for (unsigned int i = 0; i < TEST_HALTS; i++) {
+        const int32_t begin = cpu65_cycle_count;
+        do {
+            cpu65_cycles_to_execute = 1;
+            cpu65_run();
+        } while (!c_debugger_halt_hit(cpu65_pc, cpu65_ea, cpu65_rw, cpu65_opcode) && (cpu65_cycle_count - begin < budget));
+        cycle_counts[i] = cpu65_cycle_count;
+        pcs[i] = cpu65_pc;
+        eas[i] = cpu65_ea;
+        as[i] = cpu65_a;
+    }
+
+    // free running, halting inline
+    testcpu_hot_setup();
+    for (unsigned int i = 0; i < TEST_HALTS; i++) {
+        cpu65_cycles_to_execute = budget;
+        cpu65_run();
+        const bool same =
+            cpu65_cycle_count == cycle_counts[i] &&
+            cpu65_pc == pcs[i] &&
+            cpu65_ea == eas[i] &&
+            cpu65_a  == as[i];
+        ASSERT(same);
+    }
+
+    is_debugging = false;
+    c_debugger_clear_haltpoints();
+    num_buffer_lines = 0;
+
+    PASS();
+}
+#endif
+
+#if defined(DEBUGGER)
+// ----------------------------------------------------------------------------
+// A headless run must end on the instruction at a breakpoint (as the batch runner's exit_pc), whatever the CPU core
+
+#define TEST_HEADLESS_HALT_CYCLES 100000
+
+TEST test_headless_halt(uint16_t addr) {
+    extern int num_buffer_lines;
+
+    // reference : one instruction at a time
+    testcpu_hot_setup();
+    do {
+        cpu65_cycles_to_execute = 1;
+        cpu65_run();
+    } while ((cpu65_pc != addr) && (cpu65_cycle_count < TEST_HEADLESS_HALT_CYCLES));
+    const int32_t cycle_count = cpu65_cycle_count;
+    const uint8_t a = cpu65_a;
+    ASSERT(cpu65_pc == addr);
+
+    c_debugger_clear_haltpoints();
+    c_debugger_set_breakpoint(addr);
+    num_buffer_lines = 0;
+    is_debugging = true;
+
+    cpu65_cycles_to_execute = 0; // not within cpu65_run() until timing_runHeadless()
+    timing_reinitializeMachine();
+    testcpu_hot_setup();
+    timing_runHeadless(TEST_HEADLESS_HALT_CYCLES);
+    const bool same = (cpu65_pc == addr) && (cpu65_cycle_count == cycle_count) && (cpu65_a == a);
+
+    is_debugging = false;
+    c_debugger_clear_haltpoints();
+    num_buffer_lines = 0;
+    timing_reinitializeMachine();
+
+    ASSERT(same);
+
+    PASS();
+}
+#endif
+
 // ----------------------------------------------------------------------------
 // CLx operands
 
@@ -7315,7 +8623,6 @@ GREATEST_SUITE(test_suite_cpu) {
     extern void reinitialize(void);
     reinitialize();
 
-    extern volatile uint8_t emul_reinitialize;
     emul_reinitialize = 0;
 
     test_func_t *func=NULL, *tmp=NULL;
@@ -7323,6 +8630,8 @@ GREATEST_SUITE(test_suite_cpu) {
     // --------------------------------
     A2_ADD_TEST(test_BRK);
     A2_ADD_TEST(test_IRQ);
+    A2_ADD_TEST(test_ALTZP_paging);
+    A2_ADD_TEST(test_page_tables_follow_handlers);
     A2_ADD_TEST(test_CLC);
     A2_ADD_TEST(test_CLD);
     A2_ADD_TEST(test_CLI);
@@ -7340,6 +8649,75 @@ GREATEST_SUITE(test_suite_cpu) {
         A2_REMOVE_TEST(func);
     }
 
+    // ------------------------------------------------------------------------
+    // Decoded blocks
+    fprintf(GREATEST_STDOUT, "\ntest_block_cache :\n");
+    for (int32_t budget = 1; budget < 2000; budget += 37) {
+        RUN_TESTp(test_block_cache, budget);
+    }
+    fprintf(GREATEST_STDOUT, "\ntest_hot_loop :\n");
+    for (int32_t budget = 1; budget < 100000; budget += 1499) {
+        RUN_TESTp(test_hot_loop, budget);
+    }
+    fprintf(GREATEST_STDOUT, "\ntest_idle_loop :\n");
+    for (int32_t budget = 100; budget < 20000; budget += 997) {
+        RUN_TESTp(test_idle_loop, 0x1f00, /*counting:*/false, budget);
+        RUN_TESTp(test_idle_loop, 0x1efd, /*counting:*/false, budget);
+        RUN_TESTp(test_idle_loop, 0x1f00, /*counting:*/true, budget);
+        RUN_TESTp(test_idle_loop, 0x1efa, /*counting:*/true, budget);
+    }
+#if CPU_C_CORE && defined(DEBUGGER)
+    fprintf(GREATEST_STDOUT, "\ntest_haltpoints :\n");
+    for (int32_t budget = 100; budget < 20000; budget *= 2) {
+        RUN_TESTp(test_haltpoints, 0x2031, /*watch:*/false, budget); // subroutine on the page of the loop
+        RUN_TESTp(test_haltpoints, 0x2105, /*watch:*/false, budget); // reached by a branch crossing pages
+        RUN_TESTp(test_haltpoints, 0x2201, /*watch:*/true, budget);  // read-modify-write
+        RUN_TESTp(test_haltpoints, 0x0088, /*watch:*/true, budget);  // zero page store
+    }
+#endif
+#if defined(DEBUGGER)
+    fprintf(GREATEST_STDOUT, "\ntest_headless_halt :\n");
+    RUN_TESTp(test_headless_halt, 0x2031); // subroutine on the page of the loop
+    RUN_TESTp(test_headless_halt, 0x2105); // reached by a branch crossing pages
+#endif
+#if MACHINE_CONTEXT
+    fprintf(GREATEST_STDOUT, "\ntest_machine_threads :\n");
+    for (int32_t budget = 1000; budget < 400000; budget *= 3) {
+        RUN_TESTp(test_machine_threads, budget);
+    }
+    fprintf(GREATEST_STDOUT, "\ntest_replay :\n");
+    for (int32_t slice = 100; slice < 20000; slice *= 3) {
+        RUN_TESTp(test_replay, slice);
+    }
+    fprintf(GREATEST_STDOUT, "\ntest_rewind :\n");
+    RUN_TESTp(test_rewind, 1);
+    RUN_TESTp(test_rewind, 2);
+    RUN_TESTp(test_rewind, 17);
+    RUN_TESTp(test_rewind, TEST_REWIND_SNAPSHOTS);
+    fprintf(GREATEST_STDOUT, "\ntest_runahead :\n");
+    RUN_TESTp(test_runahead, 1);
+    RUN_TESTp(test_runahead, 2);
+    RUN_TESTp(test_runahead, 3);
+    RUN_TESTp(test_runahead, RUNAHEAD_MAX_FRAMES);
+    fprintf(GREATEST_STDOUT, "\ntest_io_event :\n");
+    RUN_TESTp(test_io_event, 0);
+    RUN_TESTp(test_io_event, 1);
+    RUN_TESTp(test_io_event, 100);
+    RUN_TESTp(test_io_event, 5000);
+#endif
+    fprintf(GREATEST_STDOUT, "\ntest_rewind_default :\n");
+    RUN_TESTp(test_rewind_default, 1);
+    RUN_TESTp(test_rewind_default, 17);
+    RUN_TESTp(test_rewind_default, TEST_REWIND_SNAPSHOTS);
+    fprintf(GREATEST_STDOUT, "\ntest_save_state :\n");
+    RUN_TESTp(test_save_state);
+    fprintf(GREATEST_STDOUT, "\ntest_mid_frame_switch :\n");
+    RUN_TESTp(test_mid_frame_switch);
+    fprintf(GREATEST_STDOUT, "\ntest_frame_handoff :\n");
+    RUN_TESTp(test_frame_handoff);
+    fprintf(GREATEST_STDOUT, "\ntest_cpu_mailbox :\n");
+    RUN_TESTp(test_cpu_mailbox);
+
     // ------------------------------------------------------------------------
     // Branch tests :
     // NOTE : these should be a comprehensive exercise of the branching logic
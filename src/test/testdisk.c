@@ -18,8 +18,6 @@
 
 static bool test_thread_running = false;
 
-extern pthread_mutex_t interface_mutex; // TODO FIXME : raw access to CPU mutex because stepping debugger ...
-
 static void testdisk_setup(void *arg) {
     test_common_setup();
     apple_ii_64k[0][MIXSWITCH_ADDR] = 0x00;
@@ -1427,7 +1425,7 @@ GREATEST_SUITE(test_suite_disk) {
 
     // ...
     disk6_eject(0);
-    pthread_mutex_unlock(&interface_mutex);
+    cpu_resume();
 }
 
 SUITE(test_suite_disk);
@@ -1449,7 +1447,7 @@ void test_disk(int argc, char **argv) {
     test_argc = argc;
     test_argv = argv;
 
-    pthread_mutex_lock(&interface_mutex);
+    cpu_pause();
 
     test_common_init();
 
@@ -13,8 +13,6 @@
 
 static bool test_thread_running = false;
 
-extern pthread_mutex_t interface_mutex; // TODO FIXME : raw access to CPU mutex because stepping debugger ...
-
 static void testdisplay_setup(void *arg) {
     test_common_setup();
     apple_ii_64k[0][MIXSWITCH_ADDR] = 0x00;
@@ -321,7 +319,7 @@ TEST test_80col_hires() {
 // Test Suite
 
 GREATEST_SUITE(test_suite_display) {
-    pthread_mutex_lock(&interface_mutex);
+    cpu_pause();
 
     GREATEST_SET_SETUP_CB(testdisplay_setup, NULL);
     GREATEST_SET_TEARDOWN_CB(testdisplay_teardown, NULL);
@@ -434,7 +432,7 @@ GREATEST_SUITE(test_suite_display) {
 
     // ...
     disk6_eject(0);
-    pthread_mutex_unlock(&interface_mutex);
+    cpu_resume();
 }
 
 SUITE(test_suite_display);
@@ -21,8 +21,6 @@
 
 static bool test_thread_running = false;
 
-extern pthread_mutex_t interface_mutex; // TODO FIXME : raw access to CPU mutex because stepping debugger ...
-
 static void testtrace_setup(void *arg) {
     test_common_setup();
     apple_ii_64k[0][MIXSWITCH_ADDR] = 0x00;
@@ -38,6 +36,24 @@ static void testtrace_setup(void *arg) {
 static void testtrace_teardown(void *arg) {
 }
 
+// the binary trace (recorded in place of the output file) is disassembled back into the output file
+#define TESTTRACE_CPU_RECORDS (32*1024*1024) // large enough for the whole trace
+
+static void testtrace_cpu_end(const char *output) {
+    cpu65_trace_end();
+
+    char *trace = NULL;
+    asprintf(&trace, "%s.bin", output);
+    rename(output, trace);
+    FILE *fp = fopen(output, "w");
+    if (fp) {
+        cpu65_trace_decode(trace, fp);
+        fclose(fp);
+    }
+    unlink(trace);
+    FREE(trace);
+}
+
 // ----------------------------------------------------------------------------
 // Disk TESTS ...
 
@@ -52,13 +68,13 @@ TEST test_boot_disk_cputrace() {
     asprintf(&output, "%s/a2_cputrace.txt", homedir);
     if (output) {
         unlink(output);
-        cpu65_trace_begin(output);
+        cpu65_trace_begin(output, TESTTRACE_CPU_RECORDS);
     }
 
     srandom(0);
     BOOT_TO_DOS();
 
-    cpu65_trace_end();
+    testtrace_cpu_end(output);
     disk6_eject(0);
 
     do {
@@ -101,7 +117,7 @@ TEST test_cputrace_hello_dsk() {
     asprintf(&output, "%s/a2_cputrace_hello_dsk.txt", homedir);
     if (output) {
         unlink(output);
-        cpu65_trace_begin(output);
+        cpu65_trace_begin(output, TESTTRACE_CPU_RECORDS);
     }
 
     srandom(0);
@@ -109,7 +125,7 @@ TEST test_cputrace_hello_dsk() {
     test_type_input("RUN HELLO\r");
     c_debugger_go();
 
-    cpu65_trace_end();
+    testtrace_cpu_end(output);
     disk6_eject(0);
 
     do {
@@ -151,7 +167,7 @@ TEST test_cputrace_hello_nib() {
     asprintf(&output, "%s/a2_cputrace_hello_nib.txt", homedir);
     if (output) {
         unlink(output);
-        cpu65_trace_begin(output);
+        cpu65_trace_begin(output, TESTTRACE_CPU_RECORDS);
     }
 
     srandom(0);
@@ -159,7 +175,7 @@ TEST test_cputrace_hello_nib() {
     test_type_input("RUN HELLO\r");
     c_debugger_go();
 
-    cpu65_trace_end();
+    testtrace_cpu_end(output);
     disk6_eject(0);
 
     do {
@@ -201,7 +217,7 @@ TEST test_cputrace_hello_po() {
     asprintf(&output, "%s/a2_cputrace_hello_po.txt", homedir);
     if (output) {
         unlink(output);
-        cpu65_trace_begin(output);
+        cpu65_trace_begin(output, TESTTRACE_CPU_RECORDS);
     }
 
     srandom(0);
@@ -209,7 +225,7 @@ TEST test_cputrace_hello_po() {
     test_type_input("RUN HELLO\r");
     c_debugger_go();
 
-    cpu65_trace_end();
+    testtrace_cpu_end(output);
     disk6_eject(0);
 
     do {
@@ -385,7 +401,7 @@ TEST test_boot_disk_vmtrace_po() {
 // Test Suite
 
 GREATEST_SUITE(test_suite_trace) {
-    pthread_mutex_lock(&interface_mutex);
+    cpu_pause();
 
     GREATEST_SET_SETUP_CB(testtrace_setup, NULL);
     GREATEST_SET_TEARDOWN_CB(testtrace_teardown, NULL);
@@ -409,7 +425,7 @@ GREATEST_SUITE(test_suite_trace) {
 
     // ...
     disk6_eject(0);
-    pthread_mutex_unlock(&interface_mutex);
+    cpu_resume();
 }
 
 SUITE(test_suite_trace);
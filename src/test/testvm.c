@@ -13,8 +13,6 @@
 
 static bool test_thread_running = false;
 
-extern pthread_mutex_t interface_mutex; // TODO FIXME : raw access to CPU mutex because stepping debugger ...
-
 static void testvm_setup(void *arg) {
     test_common_setup();
     apple_ii_64k[0][MIXSWITCH_ADDR] = 0x00;
@@ -3262,7 +3260,7 @@ TEST test_check_cxrom(bool flag_cxrom) {
 // Test Suite
 
 GREATEST_SUITE(test_suite_vm) {
-    pthread_mutex_lock(&interface_mutex);
+    cpu_pause();
 
     GREATEST_SET_SETUP_CB(testvm_setup, NULL);
     GREATEST_SET_TEARDOWN_CB(testvm_teardown, NULL);
@@ -3453,7 +3451,7 @@ GREATEST_SUITE(test_suite_vm) {
 
     // ...
     disk6_eject(0);
-    pthread_mutex_unlock(&interface_mutex);
+    cpu_resume();
 }
 
 SUITE(test_suite_vm);
@@ -17,9 +17,9 @@
  * ..{...+....[....|..................|.........]....^....|....^....^....}......
  *  ti  MBB       CHK                CHK            MBE  CHX  SPK  MBX  tj   ZZZ
  *
- *      - ti  : timing sample begin (lock out interface thread)
- *      - tj  : timing sample end   (unlock interface thread)
- *      -  [  : cpu65_run()
+ *      - ti  : timing sample begin (commands from the mailbox serviced, interface thread locked out if paused)
+ *      - tj  : timing sample end   (unlock interface thread if paused)
+ *      -  [  : cpu65_run() (split at each due timing event)
  *      -  ]  : cpu65_run() finished
  *      - CHK : incoming timing_checkpoint_cycles() call from IO (bumps cycles_count_total)
  *      - CHX : update remainder of timing_checkpoint_cycles() for execution period
@@ -50,38 +50,53 @@
 
 // cycle counting
 double cycles_persec_target = CLK_6502;
-unsigned long long cycles_count_total = 0;
 int cycles_speaker_feedback = 0;
+#if MACHINE_CONTEXT
+#   define cycles_checkpoint_count (current_machine->cycles_checkpoint_count)
+#   define frame_cycle (current_machine->frame_cycle)
+#else
+unsigned long long cycles_count_total = 0;
 int32_t cpu65_cycles_to_execute = 0;            // cycles-to-execute by cpu65_run()
 int32_t cpu65_cycle_count = 0;                  // cycles currently excuted by cpu65_run()
 static int32_t cycles_checkpoint_count = 0;
-static unsigned int g_dwCyclesThisFrame = 0;
+static unsigned long long frame_cycle = 0;      // cycle at which the current video frame began
+#endif
 
 // scaling and speed adjustments
 #if !MOBILE_DEVICE
 static bool auto_adjust_speed = true;
 #endif
-static bool is_paused = false;
-static unsigned long _pause_spinLock = 0;
+static volatile bool is_paused = false;
 
 double cpu_scale_factor = 1.0;
 double cpu_altscale_factor = 1.0;
 bool is_fullspeed = false;
 bool alt_speed_enabled = false;
 
+// pacing
+#define PACING_JITTER_SMOOTHING 16 // jitter estimator gain 1/16 (as RFC 3550 interarrival jitter)
+static volatile unsigned long churn_rate = EXECUTION_CHURN_RATE;
+static timing_pacing_stats_t pacing_stats = { 0 };
+
 // misc
+#if !MACHINE_CONTEXT
 volatile uint8_t emul_reinitialize = 1;
-#ifdef AUDIO_ENABLED
-static bool emul_reinitialize_audio = true;
-static bool emul_pause_audio = false;
-static bool emul_resume_audio = false;
 #endif
-static bool cpu_shutting_down = false;
+static bool cpu_thread_running = false;         // (mailbox_mutex)
+static bool cpu_parked = false;                 // CPU thread acquiring interface_mutex (mailbox_mutex)
+static volatile bool pause_acknowledged = false; // (written by the CPU thread)
 pthread_t cpu_thread_id = 0;
 pthread_mutex_t interface_mutex = { 0 };
 pthread_cond_t dbg_thread_cond = PTHREAD_COND_INITIALIZER;
 pthread_cond_t cpu_thread_cond = PTHREAD_COND_INITIALIZER;
 
+// CPU thread mailbox
+static volatile uint32_t cpu_mailbox = 0;       // pending cpu_command_t bits
+static unsigned long mailbox_posted = 0;        // posts to the mailbox ... (mailbox_mutex)
+static unsigned long mailbox_serviced = 0;      // ... serviced by the CPU thread (mailbox_mutex)
+static pthread_mutex_t mailbox_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mailbox_cond = PTHREAD_COND_INITIALIZER;
+
 // -----------------------------------------------------------------------------
 
 __attribute__((constructor(CTOR_PRIORITY_LATE)))
@@ -129,7 +144,7 @@ struct timespec timespec_diff(struct timespec start, struct timespec end, bool *
 static inline struct timespec timespec_add(struct timespec start, unsigned long nsecs) {
 
     start.tv_nsec += nsecs;
-    if (start.tv_nsec > NANOSECONDS_PER_SECOND)
+    if (start.tv_nsec >= NANOSECONDS_PER_SECOND)
     {
         start.tv_sec += (start.tv_nsec / NANOSECONDS_PER_SECOND);
         start.tv_nsec %= NANOSECONDS_PER_SECOND;
@@ -138,6 +153,383 @@ static inline struct timespec timespec_add(struct timespec start, unsigned long
     return start;
 }
 
+// ----------------------------------------------------------------------------
+// Pacing
+//
+// The CPU thread sleeps to absolute deadlines on the monotonic clock, one period apart.  A period that ends past its
+// deadline is an overrun : the next one starts right away (no sleep) until the thread has caught up, unless it fell
+// too far behind (or was paused), in which case the deadline is reset to the current time.
+
+static void _timing_sleepUntil(const struct timespec *deadline) {
+    TRACE_CPU_BEGIN("sleep");
+#if defined(__APPLE__)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    bool negative = false;
+    struct timespec deltat = timespec_diff(now, *deadline, &negative);
+    if (!negative) {
+        nanosleep(&deltat, NULL);
+    }
+#else
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) == EINTR) {
+        // interrupted, sleep the rest
+    }
+#endif
+    TRACE_CPU_END();
+}
+
+static void _timing_sampleWakeup(unsigned long late_nsecs) {
+    static unsigned long prev_late_nsecs = 0;
+    if (pacing_stats.wakeups) {
+        const long delta = (long)late_nsecs - (long)prev_late_nsecs;
+        const long deviation = (delta < 0 ? -delta : delta) - (long)pacing_stats.jitter_nsecs;
+        pacing_stats.jitter_nsecs += deviation / PACING_JITTER_SMOOTHING;
+    }
+    prev_late_nsecs = late_nsecs;
+
+    ++pacing_stats.wakeups;
+    pacing_stats.late_total_nsecs += late_nsecs;
+    if (pacing_stats.late_max_nsecs < late_nsecs) {
+        pacing_stats.late_max_nsecs = late_nsecs;
+    }
+}
+
+bool timing_setChurnRate(unsigned long rate) {
+    if ((rate < EXECUTION_CHURN_RATE_MIN) || (rate > EXECUTION_CHURN_RATE_MAX)) {
+        ERRLOG("churn rate must be within %lu .. %lu", EXECUTION_CHURN_RATE_MIN, EXECUTION_CHURN_RATE_MAX);
+        return false;
+    }
+    churn_rate = rate;
+    return true;
+}
+
+unsigned long timing_getChurnRate(void) {
+    return churn_rate;
+}
+
+void timing_getPacingStats(timing_pacing_stats_t *stats) {
+    *stats = pacing_stats;
+    stats->churn_rate = churn_rate;
+}
+
+void timing_resetPacingStats(void) {
+    memset(&pacing_stats, 0x0, sizeof(pacing_stats));
+}
+
+// ----------------------------------------------------------------------------
+// Event queue
+//
+// Devices schedule their work at an absolute cycle on the cycles_count_total timeline (6522 timer underflow, end of
+// video frame, ...).  The queue is a binary min-heap ordered by cycle : the CPU thread hands cpu65_run() at most the
+// cycles up to the earliest event and fires the due events in between runs, so the CPU cores only ever count down
+// cpu65_cycles_to_execute whatever the number of pending events.
+
+#if MACHINE_CONTEXT
+#   define event_queue (current_machine->event_queue)
+#   define event_count (current_machine->event_count)
+#else
+static timing_event_t *event_queue[MAX_TIMING_EVENTS] = { 0 };
+static unsigned int event_count = 0;
+#endif
+
+static inline void _event_swap(unsigned int i, unsigned int j) {
+    timing_event_t *event = event_queue[i];
+    event_queue[i] = event_queue[j];
+    event_queue[j] = event;
+    event_queue[i]->slot = i;
+    event_queue[j]->slot = j;
+}
+
+static void _event_siftUp(unsigned int i) {
+    while (i > 0) {
+        unsigned int parent = (i - 1) >> 1;
+        if (event_queue[parent]->cycle <= event_queue[i]->cycle) {
+            break;
+        }
+        _event_swap(i, parent);
+        i = parent;
+    }
+}
+
+static void _event_siftDown(unsigned int i) {
+    do {
+        unsigned int least = i;
+        unsigned int child = (i << 1) + 1;
+        if (child < event_count && event_queue[child]->cycle < event_queue[least]->cycle) {
+            least = child;
+        }
+        ++child;
+        if (child < event_count && event_queue[child]->cycle < event_queue[least]->cycle) {
+            least = child;
+        }
+        if (least == i) {
+            break;
+        }
+        _event_swap(i, least);
+        i = least;
+    } while (1);
+}
+
+static void _event_remove(unsigned int i) {
+    event_queue[i]->slot = -1;
+    --event_count;
+    if (i != event_count) {
+        timing_event_t *moved = event_queue[event_count];
+        event_queue[i] = moved;
+        moved->slot = i;
+        _event_siftDown(i);
+        _event_siftUp(moved->slot);
+    }
+    event_queue[event_count] = NULL;
+}
+
+void timing_scheduleEvent(timing_event_t *event, unsigned long long cycle) {
+    event->cycle = cycle;
+    if (event->slot < 0) {
+        if (event_count >= MAX_TIMING_EVENTS) {
+            ERRLOG("OOPS, timing event queue is full");
+            return;
+        }
+        event->slot = event_count;
+        event_queue[event_count++] = event;
+    } else {
+        _event_siftDown(event->slot);
+    }
+    _event_siftUp(event->slot);
+
+    // scheduled from an I/O handler within cpu65_run() (the budget is only positive while running) : end the run once
+    // the new earliest event is due, not at the end of the budget handed to it
+    if ((event->slot == 0) && (cpu65_cycles_to_execute > 0)) {
+        timing_checkpoint_cycles();
+        const int32_t cycles = (cycle > cycles_count_total) ? (int32_t)MIN(cycle - cycles_count_total, INT32_MAX) : 0;
+        if (cycles < cpu65_cycles_to_execute) {
+            cpu65_cycles_to_execute = cycles;
+        }
+    }
+}
+
+void timing_cancelEvent(timing_event_t *event) {
+    if (event->slot >= 0) {
+        _event_remove(event->slot);
+    }
+}
+
+unsigned long long timing_currentCycle(void) {
+    return cycles_count_total + (cpu65_cycle_count - cycles_checkpoint_count);
+}
+
+// clamp a cpu65_run() budget so that it ends when the earliest event is due
+static int32_t _timing_cyclesToNextEvent(int32_t cycles) {
+    if (event_count) {
+        const unsigned long long now = timing_currentCycle();
+        const unsigned long long due = event_queue[0]->cycle;
+        if (due <= now) {
+            return 1;
+        }
+        if (due - now < (unsigned long long)cycles) {
+            cycles = (int32_t)(due - now);
+        }
+    }
+    return cycles;
+}
+
+static void _timing_fireEvents(void) {
+    timing_checkpoint_cycles();
+    while (event_count && (event_queue[0]->cycle <= cycles_count_total)) {
+        timing_event_t *event = event_queue[0];
+        _event_remove(0);
+        event->fire(event);
+    }
+}
+
+static void _timing_endOfFrame(timing_event_t *event) {
+    frame_cycle = event->cycle;
+    timing_scheduleEvent(event, frame_cycle + dwClksPerFrame);
+#ifdef AUDIO_ENABLED
+    if (!runahead_isSpeculative()) {
+        MB_EndOfVideoFrame();
+    }
+#endif
+    struct timespec t0;
+    bool profiled = timing_profileDeviceBegin(&t0);
+    video_composeFrame();
+    if (UNLIKELY(profiled)) {
+        timing_profileDeviceEnd(&t0, TIMING_DEVICE_VIDEO);
+    }
+    runahead_endOfFrame();
+    if (!runahead_isSpeculative()) {
+        profiled = timing_profileDeviceBegin(&t0);
+        video_presentFrame();
+        if (UNLIKELY(profiled)) {
+            timing_profileDeviceEnd(&t0, TIMING_DEVICE_VIDEO);
+        }
+    }
+}
+
+#if MACHINE_CONTEXT
+#   define frame_event (current_machine->frame_event)
+#else
+static timing_event_t frame_event = TIMING_EVENT_INITIALIZER(_timing_endOfFrame);
+#endif
+
+static void _timing_resetEvents(void) {
+    while (event_count) {
+        _event_remove(event_count - 1);
+    }
+    frame_cycle = 0;
+    frame_event.fire = _timing_endOfFrame;
+    timing_scheduleEvent(&frame_event, dwClksPerFrame);
+}
+
+// ----------------------------------------------------------------------------
+// Idle loop detection
+//
+// Software waiting for a keypress or for the vertical blank spins on $C000/$C019.  When the softswitch read comes
+// from one of the loops below (and the value read keeps it spinning), cpu65_run() is cut short after the read and
+// the spin is fast-forwarded by whole loop iterations in the CPU thread : the thread sleeps through the rest of the
+// execution period at configured speed, and skips ahead to the next timing event (at the latest the end of the video
+// frame) at full speed.
+//
+//      poll    LDA|LDX|LDY|BIT $C0xx               loop    INC zp          ; Monitor KEYIN (RNDL/RNDH)
+//              BPL|BMI poll                                BNE poll
+//                                                          INC zp+1
+//                                                  poll    BIT|LDA $C000
+//                                                          BPL loop
+
+#if MACHINE_CONTEXT
+#   define idle_loop (current_machine->idle_loop)
+#else
+static timing_idle_loop_t idle_loop = { 0 };
+#endif
+
+static inline bool _idle_peek(uint16_t addr, uint8_t *b) {
+    uint8_t **bank = cpu65_vmem_rpage[addr >> 8];
+    if (!bank || (addr >> 8) <= 0x01) {
+        return false;
+    }
+    *b = (*bank)[addr];
+    return true;
+}
+
+static inline unsigned int _branch_cycles(uint16_t next, uint16_t target) {
+    return ((next ^ target) & 0xFF00) ? 4 : 3;
+}
+
+void timing_checkIdlePoll(uint16_t ea, uint8_t b) {
+    if (is_debugging) {
+        return;
+    }
+#if CPU_TRACING
+    if (cpu65_trace_is_enabled()) {
+        return;
+    }
+#endif
+
+    // cpu65_io_pc is the address following the polling instruction, expected to be the loop branch
+    const uint16_t pc = cpu65_io_pc;
+    uint8_t code[5];
+    for (unsigned int i = 0; i < 5; i++) {
+        if (!_idle_peek(pc - 3 + i, &code[i])) {
+            return;
+        }
+    }
+    switch (code[0]) {
+        case 0x2C: // BIT abs
+        case 0xAC: // LDY abs
+        case 0xAD: // LDA abs
+        case 0xAE: // LDX abs
+            break;
+        default:
+            return;
+    }
+    if ((code[1] | (code[2] << 8)) != ea) {
+        return;
+    }
+    uint8_t spin_bit7 = 0;
+    if (code[3] == 0x30) { // BMI
+        spin_bit7 = 0x80;
+    } else if (code[3] != 0x10) { // BPL
+        return;
+    }
+    if ((b & 0x80) != spin_bit7) {
+        return; // leaving the loop
+    }
+
+    const uint16_t next = pc + 2;
+    const uint16_t target = next + (int8_t)code[4];
+    unsigned int cycles = 4 + _branch_cycles(next, target);
+    if (target == pc - 3) {
+        idle_loop.counting = false;
+        idle_loop.carry_cycles = 0;
+    } else if (target == pc - 9 && ea == 0xC000) {
+        uint8_t inc[6];
+        for (unsigned int i = 0; i < 6; i++) {
+            if (!_idle_peek(target + i, &inc[i])) {
+                return;
+            }
+        }
+        if (inc[0] != 0xE6 || inc[2] != 0xD0 || inc[3] != 0x02 || inc[4] != 0xE6 || inc[5] != (uint8_t)(inc[1] + 1)) {
+            return;
+        }
+        const unsigned int bne_cycles = _branch_cycles(target + 4, target + 6);
+        cycles += 5 + bne_cycles;
+        idle_loop.counting = true;
+        idle_loop.carry_cycles = (2 + 5) - bne_cycles;
+        idle_loop.counter_lo = inc[1];
+        idle_loop.counter_hi = inc[5];
+    } else {
+        return;
+    }
+
+    if (cpu65_cycles_to_execute <= (int32_t)(cycles<<1)) {
+        return; // not worth it
+    }
+
+    idle_loop.poll_ea = ea;
+    idle_loop.spin_bit7 = spin_bit7;
+    idle_loop.cycles = cycles;
+    cpu65_cycles_to_execute = 0; // end cpu65_run() after the current instruction
+}
+
+#if !TESTING
+static
+#endif
+void timing_skipIdleLoop(int32_t budget) {
+    const uint16_t ea = idle_loop.poll_ea;
+    idle_loop.poll_ea = 0;
+    if (!ea || budget <= 0) {
+        return;
+    }
+
+    if (ea == 0xC019) {
+        unsigned int vbl_change = video_scanner_cycles_to_vbl_change(budget);
+        if (vbl_change < (unsigned int)budget) {
+            budget = vbl_change - 1;
+        }
+    } else if ((apple_ii_64k[0][0xC000] & 0x80) != idle_loop.spin_bit7) {
+        return; // key pressed since the poll
+    }
+
+    unsigned int n = budget / idle_loop.cycles;
+    unsigned int carries = 0;
+    unsigned int skip = n * idle_loop.cycles;
+    if (idle_loop.counting) {
+        const uint8_t lo = base_stackzp[idle_loop.counter_lo];
+        for (;;) {
+            carries = (lo + n) >> 8;
+            skip = n * idle_loop.cycles + carries * idle_loop.carry_cycles;
+            if (skip <= (unsigned int)budget) {
+                break;
+            }
+            --n;
+        }
+        base_stackzp[idle_loop.counter_lo] = (uint8_t)(lo + n);
+        base_stackzp[idle_loop.counter_hi] += (uint8_t)carries;
+    }
+
+    cpu65_cycle_count += skip;
+}
+
 static void _timing_initialize(double scale) {
     is_fullspeed = (scale >= CPU_SCALE_FASTEST);
     if (!is_fullspeed) {
@@ -157,7 +549,22 @@ void reinitialize(void) {
     assert(pthread_self() == cpu_thread_id);
 #endif
 
+    timing_reinitializeMachine();
+
+    timing_initialize();
+
+#ifdef AUDIO_ENABLED
+    MB_Reset();
+#endif
+}
+
+void timing_reinitializeMachine(void) {
     cycles_count_total = 0;
+    cycles_checkpoint_count = cpu65_cycle_count; // now is cycle 0, whatever cpu65_run() counted so far
+    idle_loop.poll_ea = 0;
+    _timing_resetEvents();
+    replay_reinitialize();
+    rewind_reinitialize();
 
     vm_initialize();
 
@@ -168,12 +575,6 @@ void reinitialize(void) {
     video_redraw();
 
     cpu65_init();
-
-    timing_initialize();
-
-#ifdef AUDIO_ENABLED
-    MB_Reset();
-#endif
 }
 
 void timing_initialize(void) {
@@ -189,66 +590,147 @@ void timing_toggleCPUSpeed(void) {
     timing_initialize();
 }
 
+// ----------------------------------------------------------------------------
+// CPU thread mailbox
+//
+// Other threads OR commands into cpu_mailbox, which the CPU thread reads in between execution periods (a plain load
+// when empty, no lock taken).  The CPU thread takes all pending commands at once, services them, then acknowledges
+// all posts up to the one it took, waking the threads waiting for theirs.
+//
+// Pausing keeps the interface_mutex handoff : the pausing thread holds interface_mutex, and the CPU thread, once it
+// has acknowledged the pause, blocks acquiring it for every period until the CPU is resumed (or runs the periods the
+// debugger lets it run through dbg_thread_cond/cpu_thread_cond).  While it is blocked there (parked), it does not
+// service the mailbox, so waiting for a post returns at once : a pause is already in effect, and other commands are
+// serviced after the resume.
+
+bool timing_postCommands(uint32_t commands, bool wait) {
+    bool serviced = false;
+
+    pthread_mutex_lock(&mailbox_mutex);
+    const unsigned long ticket = ++mailbox_posted;
+    __sync_fetch_and_or(&cpu_mailbox, commands);
+    if (wait && cpu_thread_running) {
+        assert(pthread_self() != cpu_thread_id);
+        while ((mailbox_serviced < ticket) && !cpu_parked) {
+            pthread_cond_wait(&mailbox_cond, &mailbox_mutex);
+        }
+        serviced = (mailbox_serviced >= ticket);
+    }
+    pthread_mutex_unlock(&mailbox_mutex);
+
+    return serviced;
+}
+
+static void _timing_ackCommands(unsigned long ticket) {
+    pthread_mutex_lock(&mailbox_mutex);
+    mailbox_serviced = ticket;
+    pthread_cond_broadcast(&mailbox_cond);
+    pthread_mutex_unlock(&mailbox_mutex);
+}
+
+static void _timing_lockInterface(void) {
+    pthread_mutex_lock(&mailbox_mutex);
+    cpu_parked = true;
+    pthread_cond_broadcast(&mailbox_cond);
+    pthread_mutex_unlock(&mailbox_mutex);
+
+    pthread_mutex_lock(&interface_mutex);
+
+    pthread_mutex_lock(&mailbox_mutex);
+    cpu_parked = false;
+    pthread_mutex_unlock(&mailbox_mutex);
+}
+
+// returns false when the CPU thread is to shut down
+static bool _timing_serviceCommands(void) {
+
+    pthread_mutex_lock(&mailbox_mutex);
+    const uint32_t commands = __sync_fetch_and_and(&cpu_mailbox, 0);
+    const unsigned long ticket = mailbox_posted;
+    pthread_mutex_unlock(&mailbox_mutex);
+
+    if (commands & CPU_CMD_SHUTDOWN) {
+        return false; // acknowledged on exit
+    }
+
+#ifdef AUDIO_ENABLED
+    if (commands & CPU_CMD_REINIT_AUDIO) {
+        speaker_destroy();
+        MB_Destroy();
+        audio_shutdown();
+
+        audio_init();
+        speaker_init();
+        MB_Initialize();
+        if (pause_acknowledged) {
+            audio_pause();
+        }
+    }
+#endif
+
+    // a pause and a resume posted in between two periods cancel out
+    if ((commands & (CPU_CMD_PAUSE|CPU_CMD_RESUME)) && (pause_acknowledged != is_paused)) {
+        pause_acknowledged = is_paused;
+#ifdef AUDIO_ENABLED
+        if (pause_acknowledged) {
+            audio_pause();
+        } else {
+            audio_resume();
+        }
+#endif
+    }
+
+    if (commands & CPU_CMD_REINIT) {
+        reinitialize();
+    }
+
+    _timing_ackCommands(ticket);
+
+    return true;
+}
+
 #ifdef AUDIO_ENABLED
 void timing_reinitializeAudio(void) {
-    SPINLOCK_ACQUIRE(&_pause_spinLock);
     assert(pthread_self() != cpu_thread_id);
     assert(cpu_isPaused());
-    emul_reinitialize_audio = true;
-    emul_pause_audio = false;
-    emul_resume_audio = false;
-    SPINLOCK_RELINQUISH(&_pause_spinLock);
+    timing_postCommands(CPU_CMD_REINIT_AUDIO, /*wait:*/false);
 }
 #endif
 
 void cpu_pause(void) {
     assert(pthread_self() != cpu_thread_id);
 
-    SPINLOCK_ACQUIRE(&_pause_spinLock);
-    do {
-        if (is_paused) {
-            break;
-        }
+    if (!__sync_bool_compare_and_swap(&is_paused, false, true)) {
+        return;
+    }
 
-        // CPU thread will be paused when it next tries to acquire interface_mutex
-        LOG("PAUSING CPU...");
-#ifdef AUDIO_ENABLED
-        if (!emul_reinitialize_audio) {
-            emul_pause_audio = true;
-        }
-#endif
-        pthread_mutex_lock(&interface_mutex);
-        is_paused = true;
-    } while (0);
-    SPINLOCK_RELINQUISH(&_pause_spinLock);
+    // CPU thread will be paused when it next tries to acquire interface_mutex, after acknowledging the pause
+    LOG("PAUSING CPU...");
+    pthread_mutex_lock(&interface_mutex);
+    timing_postCommands(CPU_CMD_PAUSE, /*wait:*/true);
 }
 
 void cpu_resume(void) {
     assert(pthread_self() != cpu_thread_id);
 
-    SPINLOCK_ACQUIRE(&_pause_spinLock);
-    do {
-        if (!is_paused) {
-            break;
-        }
+    if (!__sync_bool_compare_and_swap(&is_paused, true, false)) {
+        return;
+    }
 
-        // CPU thread will be unblocked to acquire interface_mutex
-#ifdef AUDIO_ENABLED
-        if (!emul_reinitialize_audio) {
-            emul_resume_audio = true;
-        }
-#endif
-        LOG("RESUMING CPU...");
-        pthread_mutex_unlock(&interface_mutex);
-        is_paused = false;
-    } while (0);
-    SPINLOCK_RELINQUISH(&_pause_spinLock);
+    // CPU thread will be unblocked to acquire interface_mutex
+    LOG("RESUMING CPU...");
+    timing_postCommands(CPU_CMD_RESUME, /*wait:*/false);
+    pthread_mutex_unlock(&interface_mutex);
 }
 
 bool cpu_isPaused(void) {
     return is_paused;
 }
 
+bool cpu_isPauseAcknowledged(void) {
+    return is_paused && pause_acknowledged;
+}
+
 #if !MOBILE_DEVICE
 bool timing_shouldAutoAdjustSpeed(void) {
     double speed = alt_speed_enabled ? cpu_altscale_factor : cpu_scale_factor;
@@ -264,14 +746,14 @@ static void *cpu_thread(void *dummyptr) {
 
     struct timespec deltat;
 #if !MOBILE_DEVICE
-    struct timespec disk_motor_time;
+    struct timespec disk_motor_time = { 0 };
 #endif
-    struct timespec t0;         // the target timer
+    struct timespec deadline;   // end of the current period
     struct timespec ti, tj;     // actual time samples
     bool negative = false;
-    long drift_adj_nsecs = 0;   // generic drift adjustment between target and actual
+    bool slept = false;         // the previous period slept to its deadline
+    double cycles_owed = 0.0;   // cycles of the current period, with the remainder of the previous ones
 
-    int debugging_cycles0 = 0;
     int debugging_cycles = 0;
 
 #if DEBUG_TIMING
@@ -281,93 +763,94 @@ static void *cpu_thread(void *dummyptr) {
     unsigned int dbg_cycles_executed = 0;
 #endif
 
+    bool running = true;
     do
     {
-#ifdef AUDIO_ENABLED
-        LOG("CPUTHREAD %lu LOCKING FOR MAYBE INITIALIZING AUDIO ...", cpu_thread_id);
-        pthread_mutex_lock(&interface_mutex);
-        if (emul_reinitialize_audio) {
-            emul_reinitialize_audio = false;
-
-            speaker_destroy();
-            MB_Destroy();
-            audio_shutdown();
-
-            audio_init();
-            speaker_init();
-            MB_Initialize();
-        }
-        pthread_mutex_unlock(&interface_mutex);
-        LOG("UNLOCKING FOR MAYBE INITIALIZING AUDIO ...");
-#endif
-
         if (emul_reinitialize) {
             reinitialize();
         }
 
         LOG("cpu_thread : begin main loop ...");
 
-        clock_gettime(CLOCK_MONOTONIC, &t0);
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        slept = false;
+        cycles_owed = 0.0;
 
         do {
             SCOPE_TRACE_CPU("CPU mainloop");
-            // -LOCK----------------------------------------------------------------------------------------- SAMPLE ti
-#ifdef AUDIO_ENABLED
-            if (UNLIKELY(emul_pause_audio)) {
-                emul_pause_audio = false;
-                audio_pause();
+            if (UNLIKELY(cpu_mailbox)) {
+                running = _timing_serviceCommands();
+                if (UNLIKELY(!running)) {
+                    break;
+                }
             }
-#endif
-            pthread_mutex_lock(&interface_mutex);
-#ifdef AUDIO_ENABLED
-            if (UNLIKELY(emul_resume_audio)) {
-                emul_resume_audio = false;
-                audio_resume();
+
+            // -LOCK (paused)-------------------------------------------------------------------------------- SAMPLE ti
+            const bool locked = pause_acknowledged || is_debugging;
+            if (UNLIKELY(locked)) {
+                _timing_lockInterface();
             }
-#endif
             clock_gettime(CLOCK_MONOTONIC, &ti);
 
-            deltat = timespec_diff(t0, ti, &negative);
-            if (deltat.tv_sec)
-            {
-                if (!is_fullspeed) {
-                    TIMING_LOG("NOTE : serious divergence from target time ...");
-                }
-                t0 = ti;
-                deltat = timespec_diff(t0, ti, &negative);
+            const unsigned long rate = churn_rate;
+            const unsigned long period_nsecs = NANOSECONDS_PER_SECOND / rate;
+
+            deltat = timespec_diff(deadline, ti, &negative);
+            if (is_fullspeed) {
+                deadline = ti;
+            } else if (deltat.tv_sec && !negative) {
+                TIMING_LOG("NOTE : serious divergence from target time ...");
+                ++pacing_stats.resyncs;
+                deadline = ti;
+            } else if (slept) {
+                _timing_sampleWakeup(negative ? 0 : deltat.tv_nsec);
             }
-            t0 = timespec_add(t0, EXECUTION_PERIOD_NSECS); // expected interval
-            drift_adj_nsecs = negative ? ~deltat.tv_nsec : deltat.tv_nsec;
-
-            // set up increment & decrement counters
-            cpu65_cycles_to_execute = (cycles_persec_target / 1000); // cycles_persec_target * EXECUTION_PERIOD_NSECS / NANOSECONDS_PER_SECOND
-            if (!is_fullspeed) {
-                cpu65_cycles_to_execute += cycles_speaker_feedback;
+            deadline = timespec_add(deadline, period_nsecs);
+
+            // set up increment & decrement counters (speaker feedback is expressed per default period)
+            const double cycles_per_period = cycles_persec_target / rate;
+            int32_t cycles_feedback = 0;
+            if (is_fullspeed || is_debugging) {
+                cycles_owed = 0.0;
+            } else {
+                cycles_feedback = (int32_t)(((long)cycles_speaker_feedback * (long)EXECUTION_CHURN_RATE) / (long)rate);
             }
-            if (cpu65_cycles_to_execute < 0)
+            cycles_owed += cycles_per_period;
+            int32_t cycles_period = (int32_t)cycles_owed + cycles_feedback;
+            if (cycles_period < 0)
             {
-                cpu65_cycles_to_execute = 0;
+                cycles_period = 0;
             }
 
 #ifdef AUDIO_ENABLED
             MB_StartOfCpuExecute();
 #endif
             if (is_debugging) {
-                debugging_cycles0 = cpu65_cycles_to_execute;
-                debugging_cycles  = cpu65_cycles_to_execute;
+                debugging_cycles = cycles_period;
             }
 
+            cpu65_cycle_count = 0;
+            cycles_checkpoint_count = 0;
             do {
+                const int32_t cycles_run = cpu65_cycle_count;
+                replay_sampleHostInput(); // host input lands in between runs, on a known cycle
                 if (is_debugging) {
-                    cpu65_cycles_to_execute = 1;
+                    // haltpoints are tested inline, so only single-step when the stepping command requires it
+                    cpu65_cycles_to_execute = c_debugger_is_stepping() ? 1 : _timing_cyclesToNextEvent(debugging_cycles);
+                } else {
+                    cpu65_cycles_to_execute = _timing_cyclesToNextEvent(cycles_period - cpu65_cycle_count);
                 }
 
-                cpu65_cycle_count = 0;
-                cycles_checkpoint_count = 0;
                 cpu65_run(); // run emulation for cpu65_cycles_to_execute cycles ...
 
+                if (UNLIKELY(idle_loop.poll_ea)) {
+                    int32_t idle_cycles = is_fullspeed ? INT32_MAX : (cycles_period - cpu65_cycle_count);
+                    timing_skipIdleLoop(_timing_cyclesToNextEvent(idle_cycles));
+                }
+                _timing_fireEvents();
+
                 if (is_debugging) {
-                    debugging_cycles -= cpu65_cycle_count;
+                    debugging_cycles -= cpu65_cycle_count - cycles_run;
                     if (c_debugger_should_break() || (debugging_cycles <= 0)) {
                         int err = 0;
                         if ((err = pthread_cond_signal(&dbg_thread_cond))) {
@@ -377,7 +860,6 @@ static void *cpu_thread(void *dummyptr) {
                             ERRLOG("pthread_cond_wait : %d", err);
                         }
                         if (debugging_cycles <= 0) {
-                            cpu65_cycle_count = debugging_cycles0 - debugging_cycles/*<=0*/;
                             break;
                         }
                     }
@@ -385,11 +867,19 @@ static void *cpu_thread(void *dummyptr) {
                 if (emul_reinitialize) {
                     reinitialize();
                 }
-            } while (is_debugging);
+            } while (is_debugging || ((cpu65_cycle_count < cycles_period) && !emul_reinitialize));
+
+            // carry over the remainder (and the overshoot of the last instruction) to the next period
+            cycles_owed -= cpu65_cycle_count - cycles_feedback;
+            if (cycles_owed < -cycles_per_period) {
+                cycles_owed = -cycles_per_period;
+            } else if (cycles_owed > cycles_per_period) {
+                cycles_owed = cycles_per_period;
+            }
+
 #if DEBUG_TIMING
             dbg_cycles_executed += cpu65_cycle_count;
 #endif
-            g_dwCyclesThisFrame += cpu65_cycle_count;
 
 #ifdef AUDIO_ENABLED
             MB_UpdateCycles(); // update 6522s (NOTE: do this before updating cycles_count_total)
@@ -404,16 +894,11 @@ static void *cpu_thread(void *dummyptr) {
             speaker_flush(); // play audio
 #endif
 
-            if (g_dwCyclesThisFrame >= dwClksPerFrame) {
-                g_dwCyclesThisFrame -= dwClksPerFrame;
-#ifdef AUDIO_ENABLED
-                MB_EndOfVideoFrame();
-#endif
-            }
-
             clock_gettime(CLOCK_MONOTONIC, &tj);
-            pthread_mutex_unlock(&interface_mutex);
-            // -UNLOCK--------------------------------------------------------------------------------------- SAMPLE tj
+            if (UNLIKELY(locked)) {
+                pthread_mutex_unlock(&interface_mutex);
+            }
+            // -UNLOCK (paused)------------------------------------------------------------------------------ SAMPLE tj
 
 #if !MOBILE_DEVICE
             if (timing_shouldAutoAdjustSpeed()) {
@@ -431,32 +916,25 @@ static void *cpu_thread(void *dummyptr) {
             }
 #endif
 
+            slept = false;
             if (!is_fullspeed) {
-                deltat = timespec_diff(ti, tj, &negative);
-                assert(!negative);
-                long sleepfor = 0;
-                if (!deltat.tv_sec)
-                {
-                    sleepfor = EXECUTION_PERIOD_NSECS - drift_adj_nsecs - deltat.tv_nsec;
-                }
-
-                if (sleepfor <= 0)
+                ++pacing_stats.periods;
+                deltat = timespec_diff(tj, deadline, &negative);
+                if (negative || (!deltat.tv_sec && !deltat.tv_nsec))
                 {
                     // lagging ...
+                    ++pacing_stats.overruns;
                     static time_t throttle_warning = 0;
-                    if (t0.tv_sec - throttle_warning > 0)
+                    if (deadline.tv_sec - throttle_warning > 0)
                     {
                         TIMING_LOG("not sleeping to catch up ... %ld . %ld", deltat.tv_sec, deltat.tv_nsec);
-                        throttle_warning = t0.tv_sec;
+                        throttle_warning = deadline.tv_sec;
                     }
                 }
                 else
                 {
-                    deltat.tv_sec = 0;
-                    deltat.tv_nsec = sleepfor;
-                    TRACE_CPU_BEGIN("sleep");
-                    nanosleep(&deltat, NULL);
-                    TRACE_CPU_END();
+                    _timing_sleepUntil(&deadline);
+                    slept = true;
                 }
 
 #if DEBUG_TIMING
@@ -470,10 +948,10 @@ static void *cpu_thread(void *dummyptr) {
                     speaker_pos_feedback = cycles_speaker_feedback;
                 }
 
-                dbg_ticks += EXECUTION_PERIOD_NSECS;
-                if ((dbg_ticks % NANOSECONDS_PER_SECOND) == 0)
+                dbg_ticks += period_nsecs;
+                if (dbg_ticks >= NANOSECONDS_PER_SECOND)
                 {
-                    TIMING_LOG("tick:(%ld.%ld) real:(%ld.%ld) cycles exe: %d ... speaker feedback: %d/%d", t0.tv_sec, t0.tv_nsec, ti.tv_sec, ti.tv_nsec, dbg_cycles_executed, speaker_neg_feedback, speaker_pos_feedback);
+                    TIMING_LOG("tick:(%ld.%ld) real:(%ld.%ld) cycles exe: %d ... speaker feedback: %d/%d", deadline.tv_sec, deadline.tv_nsec, ti.tv_sec, ti.tv_nsec, dbg_cycles_executed, speaker_neg_feedback, speaker_pos_feedback);
                     dbg_cycles_executed = 0;
                     dbg_ticks = 0;
                     speaker_neg_feedback = 0;
@@ -502,58 +980,192 @@ static void *cpu_thread(void *dummyptr) {
             if (UNLIKELY(emul_reinitialize)) {
                 break;
             }
+        } while (1);
+    } while (running);
 
 #ifdef AUDIO_ENABLED
-            if (UNLIKELY(emul_reinitialize_audio)) {
-                break;
-            }
+    speaker_destroy();
+    MB_Destroy();
+    audio_shutdown();
 #endif
 
-            if (UNLIKELY(cpu_shutting_down)) {
-                break;
+    // acknowledge the shutdown and whatever was posted along with it
+    pause_acknowledged = false;
+    pthread_mutex_lock(&mailbox_mutex);
+    cpu_thread_running = false;
+    mailbox_serviced = mailbox_posted;
+    pthread_cond_broadcast(&mailbox_cond);
+    pthread_mutex_unlock(&mailbox_mutex);
+
+    return NULL;
+}
+
+#if MACHINE_CONTEXT
+#   define timing_profile (current_machine->timing_profile)
+#else
+static timing_profile_t *timing_profile = NULL;
+#endif
+
+static inline unsigned long long _timing_nsecsSince(struct timespec *t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    bool negative = false;
+    const struct timespec deltat = timespec_diff(*t0, t1, &negative);
+    *t0 = t1;
+    return negative ? 0 : (deltat.tv_sec * NANOSECONDS_PER_SECOND) + deltat.tv_nsec;
+}
+
+static inline unsigned long long _timing_deviceNsecs(const timing_profile_t *profile) {
+    unsigned long long nsecs = 0;
+    for (unsigned int i = 0; i < NUM_TIMING_DEVICES; i++) {
+        nsecs += profile->device_nsecs[i];
+    }
+    return nsecs;
+}
+
+// host time since t0, less the time accounted to the devices meanwhile
+static unsigned long long _timing_profileSplit(const timing_profile_t *profile, struct timespec *t0,
+        unsigned long long *device_nsecs) {
+    const unsigned long long nsecs = _timing_nsecsSince(t0);
+    const unsigned long long devices = _timing_deviceNsecs(profile);
+    const unsigned long long in_devices = devices - *device_nsecs;
+    *device_nsecs = devices;
+    return (nsecs > in_devices) ? nsecs - in_devices : 0;
+}
+
+bool timing_profileDeviceBegin(struct timespec *t0) {
+    if (LIKELY(timing_profile == NULL)) {
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, t0);
+    return true;
+}
+
+void timing_profileDeviceEnd(const struct timespec *t0, timing_device_t device) {
+    struct timespec t1 = *t0;
+    timing_profile->device_nsecs[device] += _timing_nsecsSince(&t1);
+}
+
+void timing_setProfile(timing_profile_t *profile) {
+    timing_profile = profile;
+    cpu65_opcode_counts = profile ? profile->opcodes : NULL;
+}
+
+void timing_runHeadless(int32_t cycles) {
+    // the calling thread stands in for the CPU thread of the default machine (the other machines have none)
+#if MACHINE_CONTEXT
+    const bool stand_in = (current_machine == &machine_default);
+#else
+    const bool stand_in = true;
+#endif
+    const pthread_t cpu_thread = cpu_thread_id;
+    if (stand_in) {
+        assert(!cpu_thread_running);
+        cpu_thread_id = pthread_self();
+    }
+
+    timing_profile_t *profile = timing_profile;
+    struct timespec t0 = { 0 };
+    unsigned long long device_nsecs = 0;
+    if (UNLIKELY(profile != NULL)) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        device_nsecs = _timing_deviceNsecs(profile);
+    }
+
+    cpu65_cycle_count = 0;
+    cycles_checkpoint_count = 0;
+    do {
+        if (UNLIKELY(emul_reinitialize)) {
+            timing_reinitializeMachine(); // cpu65_run() then resets the CPU
+        }
+
+#ifdef DEBUGGER
+        const bool halting = UNLIKELY(halt_armed) && is_debugging;
+#endif
+        cpu65_cycles_to_execute = _timing_cyclesToNextEvent(cycles - cpu65_cycle_count);
+#if defined(DEBUGGER) && !CPU_C_CORE
+        if (halting) {
+            cpu65_cycles_to_execute = 1; // the assembly cores do not test haltpoints inline
+        }
+#endif
+        cpu65_run();
+        if (UNLIKELY(profile != NULL)) {
+            ++profile->runs;
+            profile->cpu_nsecs += _timing_profileSplit(profile, &t0, &device_nsecs);
+        }
+
+        if (UNLIKELY(idle_loop.poll_ea)) {
+            const int32_t cycle_count = cpu65_cycle_count;
+            timing_skipIdleLoop(_timing_cyclesToNextEvent(INT32_MAX));
+            if (UNLIKELY(profile != NULL)) {
+                profile->idle_cycles += cpu65_cycle_count - cycle_count;
+                profile->idle_nsecs += _timing_profileSplit(profile, &t0, &device_nsecs);
             }
-        } while (1);
+        }
 
-        if (UNLIKELY(cpu_shutting_down)) {
-            break;
+        _timing_fireEvents();
+        if (UNLIKELY(profile != NULL)) {
+            profile->events_nsecs += _timing_profileSplit(profile, &t0, &device_nsecs);
         }
-    } while (1);
 
-#ifdef AUDIO_ENABLED
-    speaker_destroy();
-    MB_Destroy();
-    audio_shutdown();
+#ifdef DEBUGGER
+        if (halting && c_debugger_halt_hit(cpu65_pc, cpu65_ea, cpu65_rw, cpu65_opcode)) {
+            cpu65_cycles_to_execute = 0; // left over by the halted cpu65_run(), no longer running
+            break;
+        }
 #endif
+    } while (cpu65_cycle_count < cycles);
+    timing_checkpoint_cycles();
 
-    return NULL;
+    if (stand_in) {
+        cpu_thread_id = cpu_thread;
+    }
 }
 
 void timing_startCPU(void) {
-    cpu_shutting_down = false;
+    pthread_mutex_lock(&mailbox_mutex);
+    cpu_thread_running = true;
+    pthread_mutex_unlock(&mailbox_mutex);
+#ifdef AUDIO_ENABLED
+    timing_postCommands(CPU_CMD_REINIT_AUDIO, /*wait:*/false);
+#endif
     int err = TEMP_FAILURE_RETRY(pthread_create(&cpu_thread_id, NULL, (void *)&cpu_thread, (void *)NULL));
     if (err) {
+        pthread_mutex_lock(&mailbox_mutex);
+        cpu_thread_running = false;
+        pthread_mutex_unlock(&mailbox_mutex);
         RELEASE_ERRLOG("pthread_create failed!");
         RELEASE_BREAK();
     }
 }
 
 void timing_stopCPU(void) {
-    cpu_shutting_down = true;
+    timing_postCommands(CPU_CMD_SHUTDOWN, /*wait:*/false);
 
     LOG("Emulator waiting for CPU thread clean up...");
     if (pthread_join(cpu_thread_id, NULL)) {
         ERRLOG("OOPS: pthread_join of CPU thread ...");
     }
+
+    timing_pacing_stats_t stats;
+    timing_getPacingStats(&stats);
+    LOG("CPU pacing : %lu Hz, %llu periods, %llu overruns, %lu resyncs, wakeup lateness mean %llu max %lu jitter %lu usecs",
+            stats.churn_rate, stats.periods, stats.overruns, stats.resyncs,
+            stats.wakeups ? (stats.late_total_nsecs / stats.wakeups) / 1000 : 0, stats.late_max_nsecs / 1000,
+            stats.jitter_nsecs / 1000);
 }
 
 unsigned int CpuGetCyclesThisVideoFrame(void) {
-    timing_checkpoint_cycles();
-    return g_dwCyclesThisFrame + cycles_checkpoint_count;
+    return (unsigned int)(timing_currentCycle() - frame_cycle);
 }
 
 // Called when an IO-reg is accessed & accurate global cycle count info is needed
 void timing_checkpoint_cycles(void) {
+#if MACHINE_CONTEXT
+    assert((current_machine != &machine_default) || (pthread_self() == cpu_thread_id)); // other machines run headless
+#else
     assert(pthread_self() == cpu_thread_id);
+#endif
 
     const int32_t d = cpu65_cycle_count - cycles_checkpoint_count;
     assert(d >= 0);
@@ -23,14 +23,23 @@
 #define NANOSECONDS_PER_SECOND 1000000000UL
 #endif
 
-// At a rate of ~1000x/sec, the emulator will (1) determine the number X of 65c02 instructions to execute and then
-// executes them, (2) perform post-instruction-churn bookkeeping, and (3) sleep for a calculated interval.
+// At the churn rate (~1000x/sec by default), the emulator will (1) determine the number X of 65c02 cycles to execute
+// and then executes them, (2) perform post-instruction-churn bookkeeping, and (3) sleep until the next period.
 //
-// * The actual wall clock time to perform the emulated churn and bookkeeping is used to determine the sleep interval
+// * Periods are paced by absolute deadlines (the previous deadline + the period), so the time spent churning and the
+//   wakeup latency of the host do not accumulate into drift
+//
+// * The fraction of a cycle left over by each period (and the cycles overshot by the last instruction) is carried over
+//   to the next one, so X averages out to exactly the cycles of the period
 //
 // * The speaker provides feedback to the calculation of X (the number of instructions to churn)
-#define EXECUTION_CHURN_RATE   1000UL
-#define EXECUTION_PERIOD_NSECS 1000000UL // NANOSECONDS_PER_SECOND / EXECUTION_CHURN_RATE
+//
+// A lower churn rate means fewer host wakeups (less power on a busy host) at the cost of coarser audio/input timing.
+#define EXECUTION_CHURN_RATE     1000UL    // default
+#define EXECUTION_CHURN_RATE_MIN 30UL
+#define EXECUTION_CHURN_RATE_MAX 20000UL
+#define EXECUTION_CHURN_RATE_FRAME 60UL     // ~ once per video frame
+#define EXECUTION_CHURN_RATE_SCANLINES(lines) ((unsigned long)(CLK_6502 / (65 * (lines)))) // once per group of lines
 
 // timing values cribbed from AppleWin ... reference: Sather's _Understanding the Apple IIe_
 // TODO: revisit this if/when attempting to actually sync up VBL/VSYNC to actual device vsync
@@ -62,6 +71,72 @@ extern bool alt_speed_enabled;
 
 extern READONLY pthread_t cpu_thread_id;
 
+extern volatile uint8_t emul_reinitialize;  // power cycle the machine at the next cpu65_run()
+
+/*
+ * Event scheduled on the emulated cycle timeline.  Events are owned by the scheduling device (along with the rest of
+ * its state in the machine context for the devices of the emulated machine, see machine.h).
+ */
+typedef struct timing_event_t {
+    unsigned long long cycle;                   // cycle (cycles_count_total timeline) at which the event is due
+    void (*fire)(struct timing_event_t *event); // called from the CPU thread in between cpu65_run() calls
+    int slot;                                   // position in the event queue, -1 when not scheduled
+} timing_event_t;
+
+#define TIMING_EVENT_INITIALIZER(func) { .cycle = 0, .fire = (func), .slot = -1 }
+
+#define MAX_TIMING_EVENTS 32
+
+/*
+ * Polling loop recognized by timing_checkIdlePoll() (private to timing.c)
+ */
+typedef struct timing_idle_loop_t {
+    uint16_t poll_ea;       // polled softswitch, 0 when no loop was detected
+    uint8_t spin_bit7;      // bit 7 of the value read that keeps the loop spinning
+    uint8_t cycles;         // cycles of a loop iteration
+    uint8_t carry_cycles;   // extra cycles of an iteration carrying into the counter high byte
+    uint8_t counter_lo;     // zpage counter (counting loops only)
+    uint8_t counter_hi;
+    bool counting;
+} timing_idle_loop_t;
+
+/*
+ * Pacing statistics of the CPU thread (periods run at full speed are not paced and not counted)
+ */
+typedef struct timing_pacing_stats_t {
+    unsigned long churn_rate;               // periods per second
+    unsigned long long periods;
+    unsigned long long overruns;            // periods that ended past their deadline (no sleep, catching up)
+    unsigned long resyncs;                  // deadline reset after falling a second or more behind (or a pause)
+    unsigned long long wakeups;             // sleeps to a deadline ...
+    unsigned long late_max_nsecs;           // ... wakeup lateness past the deadline : maximum ...
+    unsigned long long late_total_nsecs;    // ... and sum (mean = late_total_nsecs / wakeups)
+    unsigned long jitter_nsecs;             // smoothed variation of the lateness from one wakeup to the next
+} timing_pacing_stats_t;
+
+/*
+ * Devices timed apart in profiled headless runs (see timing_profileDeviceBegin())
+ */
+typedef enum timing_device_t {
+    TIMING_DEVICE_DISK = 0,                 // loading and writing back disk tracks
+    TIMING_DEVICE_VIDEO,                    // composing and presenting video frames
+    TIMING_DEVICE_SPEAKER,                  // generating speaker samples
+    NUM_TIMING_DEVICES,
+} timing_device_t;
+
+/*
+ * Profile of headless runs (see timing_setProfile()), accumulated over the runs
+ */
+typedef struct timing_profile_t {
+    unsigned long long opcodes[256];        // instructions executed per opcode (C CPU core only)
+    unsigned long long cpu_nsecs;           // in cpu65_run() (including the light I/O done inline by instructions) ...
+    unsigned long long events_nsecs;        // ... firing timing events (Mockingboard timers, rewind snapshots, ...) ...
+    unsigned long long idle_nsecs;          // ... skipping idle loops ...
+    unsigned long long device_nsecs[NUM_TIMING_DEVICES]; // ... and in the devices, from I/O handlers or events
+    unsigned long long idle_cycles;         // cycles skipped in idle loops
+    unsigned long long runs;                // cpu65_run() calls
+} timing_profile_t;
+
 /*
  * calculate the difference between two timespec structures
  */
@@ -82,6 +157,27 @@ void timing_stopCPU(void);
  */
 void timing_toggleCPUSpeed(void);
 
+/*
+ * Set the execution periods per second of the CPU thread (EXECUTION_CHURN_RATE_MIN .. EXECUTION_CHURN_RATE_MAX),
+ * effective from the next period
+ */
+bool timing_setChurnRate(unsigned long rate);
+
+/*
+ * Execution periods per second of the CPU thread
+ */
+unsigned long timing_getChurnRate(void);
+
+/*
+ * Pacing statistics since the CPU thread started (or the last reset), sampled without locking
+ */
+void timing_getPacingStats(timing_pacing_stats_t *stats);
+
+/*
+ * Reset the pacing statistics
+ */
+void timing_resetPacingStats(void);
+
 #if !MOBILE_DEVICE
 /*
  * check whether automatic adjusting of CPU speed is configured.
@@ -94,6 +190,38 @@ bool timing_shouldAutoAdjustSpeed(void);
  */
 void timing_initialize(void);
 
+/*
+ * Power cycle the current machine : memory, softswitches, CPU registers and pending events (the CPU thread does this
+ * for its machine when emul_reinitialize is set)
+ */
+void timing_reinitializeMachine(void);
+
+/*
+ * Run the current machine at full speed on the calling thread (no CPU thread, pacing, audio or video output) until at
+ * least the given number of cycles have executed.  Timing events fire and idle loops are skipped as in the CPU thread.
+ * While debugging, the run ends early on the instruction hitting a haltpoint (see debug.h).  The calling thread stands
+ * in for the CPU thread of the default machine, which must then not be running.
+ */
+void timing_runHeadless(int32_t cycles);
+
+/*
+ * Profile the headless runs of the current machine into `profile` (not reset), NULL to stop profiling
+ */
+void timing_setProfile(timing_profile_t *profile);
+
+/*
+ * Account host time to a device in profiled headless runs (out of the CPU/events time it is spent in) :
+ *
+ *      struct timespec t0;
+ *      const bool profiled = timing_profileDeviceBegin(&t0); // false when not profiling
+ *      ...
+ *      if (UNLIKELY(profiled)) {
+ *          timing_profileDeviceEnd(&t0, TIMING_DEVICE_DISK);
+ *      }
+ */
+bool timing_profileDeviceBegin(struct timespec *t0);
+void timing_profileDeviceEnd(const struct timespec *t0, timing_device_t device);
+
 #ifdef AUDIO_ENABLED
 /*
  * force audio reinitialization
@@ -101,11 +229,30 @@ void timing_initialize(void);
 void timing_reinitializeAudio(void);
 #endif
 
+/*
+ * Commands to the CPU thread, serviced in between execution periods (see timing_postCommands())
+ */
+typedef enum cpu_command_t {
+    CPU_CMD_PAUSE           = (1 << 0), // (see cpu_pause())
+    CPU_CMD_RESUME          = (1 << 1), // (see cpu_resume())
+    CPU_CMD_REINIT          = (1 << 2), // power cycle the machine
+    CPU_CMD_REINIT_AUDIO    = (1 << 3), // (see timing_reinitializeAudio())
+    CPU_CMD_SHUTDOWN        = (1 << 4), // (see timing_stopCPU())
+} cpu_command_t;
+
+/*
+ * Post commands (cpu_command_t bits) to the mailbox of the CPU thread, which it polls once per execution period
+ * without locking.  With `wait`, blocks until the CPU thread has serviced them (at most an execution period when it is
+ * running), and returns whether it did : it does not when the CPU thread is not running or is paused, in which case
+ * the commands are serviced once it runs.
+ */
+bool timing_postCommands(uint32_t commands, bool wait);
+
 /*
  * Pause timing/CPU thread.
  *
- * This may block for a short amount of time to grab the appropriate mutex.  CPU thread is blocked upon function return,
- * until call to cpu_resume() is made.
+ * This blocks until the CPU thread acknowledges the pause at the end of its execution period.  CPU thread is blocked
+ * upon function return (holding off on interface_mutex), until call to cpu_resume() is made.
  */
 void cpu_pause(void);
 
@@ -119,9 +266,38 @@ void cpu_resume(void);
  */
 bool cpu_isPaused(void);
 
+/*
+ * Is the CPU paused, and has the CPU thread acknowledged it (it is then done with the current frame and leaves the
+ * framebuffer alone until resumed)?
+ */
+bool cpu_isPauseAcknowledged(void);
+
+/*
+ * Called from the keyboard/VBL softswitch reads : recognizes a polling loop and ends the current cpu65_run() so the
+ * CPU thread can skip the rest of the spin
+ */
+void timing_checkIdlePoll(uint16_t ea, uint8_t b);
+
 /*
  * checkpoints current cycle count and updates total (for timing-dependent I/O)
  */
 void timing_checkpoint_cycles(void);
 
+/*
+ * Current cycle on the cycles_count_total timeline (including the cycles of the running cpu65_run())
+ */
+unsigned long long timing_currentCycle(void);
+
+/*
+ * (Re)schedule an event to fire once the given cycle is reached.  The CPU thread ends cpu65_run() at the earliest
+ * pending event, so events fire within an instruction of their cycle (also when scheduled from an I/O handler during
+ * cpu65_run()).  All scheduled events are dropped when the machine is reinitialized.
+ */
+void timing_scheduleEvent(timing_event_t *event, unsigned long long cycle);
+
+/*
+ * Unschedule a pending event (no-op if not scheduled)
+ */
+void timing_cancelEvent(timing_event_t *event);
+
 #endif // whole file
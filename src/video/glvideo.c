@@ -38,6 +38,16 @@ static GLenum crtElementType = UNINITIALIZED_GL;
 static GLuint crtNumElements = UNINITIALIZED_GL;
 
 static GLuint a2TextureName = UNINITIALIZED_GL;
+static bool a2TextureStale = true; // (re)created texture, upload all bands
+#if USE_PBO
+static GLuint a2PixelBufferName = UNINITIALIZED_GL;
+#endif
+static GLuint a2PaletteName = UNINITIALIZED_GL;
+static bool a2PaletteStale = true;
+static PIXEL_TYPE a2Palette[256] = { 0 }; // as uploaded
+static GLint uniformIndexedIdx = UNINITIALIZED_GL;
+static GLint uniformPaletteIdx = UNINITIALIZED_GL;
+static GLint uniformTextureSizeIdx = UNINITIALIZED_GL;
 static GLuint defaultFBO = UNINITIALIZED_GL;
 
 static GLuint crtVAOName = UNINITIALIZED_GL;
@@ -242,24 +252,150 @@ static GLuint _create_CRT_texture(void) {
     glActiveTexture(TEXTURE_ACTIVE_FRAMEBUFFER);
     glBindTexture(GL_TEXTURE_2D, texName);
 
-    // Set up filter and wrap modes for this texture object
+    // Set up filter and wrap modes for this texture object (texels are color indexes, filtered by the shader once
+    // looked up in the palette)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
     // Indicate that pixel rows are tightly packed (defaults to a stride of sizeof(PIXEL_TYPE) which is good for RGBA or
     // FLOAT data types)
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
     // Allocate and load image data into texture
-    glTexImage2D(GL_TEXTURE_2D, /*level*/0, TEX_FORMAT_INTERNAL, SCANWIDTH, SCANHEIGHT, /*border*/0, TEX_FORMAT, TEX_TYPE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, /*level*/0, TEX_FORMAT_INDEXED_INTERNAL, SCANWIDTH, SCANHEIGHT, /*border*/0, TEX_FORMAT_INDEXED, GL_UNSIGNED_BYTE, NULL);
 
     GL_ERRLOG("finished creating CRT texture");
 
+    a2TextureStale = true;
+
+    return texName;
+}
+
+static GLuint _create_CRT_palette(void) {
+    GLuint texName;
+
+    glGenTextures(1, &texName);
+    glActiveTexture(TEXTURE_ACTIVE_PALETTE);
+    glBindTexture(GL_TEXTURE_2D, texName);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    glTexImage2D(GL_TEXTURE_2D, /*level*/0, TEX_FORMAT_INTERNAL, 256, 1, /*border*/0, TEX_FORMAT, TEX_TYPE, NULL);
+
+    GL_ERRLOG("finished creating CRT palette");
+
+    a2PaletteStale = true;
+
     return texName;
 }
 
+// Upload the bands of the indexed-color Apple //e internal framebuffer to the bound texture, a glTexSubImage2D() per
+// run of consecutive bands.  `fb` is the whole framebuffer, in client memory or at offset 0 of the bound pixel buffer
+// (NULL).
+static void _upload_CRT_bands(const uint8_t *fb, uint32_t bands) {
+    SCOPE_TRACE_VIDEO("glvideo texSubImage2D");
+    unsigned int band = 0;
+    while (band < TEXT_ROWS) {
+        if (!(bands & (1U << band))) {
+            ++band;
+            continue;
+        }
+        unsigned int end = band + 1;
+        while ((end < TEXT_ROWS) && (bands & (1U << end))) {
+            ++end;
+        }
+        const unsigned int y = band * VIDEO_BAND_HEIGHT;
+        glTexSubImage2D(GL_TEXTURE_2D, /*level*/0, /*xoffset*/0, y, SCANWIDTH, (end - band) * VIDEO_BAND_HEIGHT, TEX_FORMAT_INDEXED, GL_UNSIGNED_BYTE, (const GLvoid *)((uintptr_t)fb + (y * SCANWIDTH)));
+        band = end;
+    }
+}
+
+// Update the bound CRT texture with the bands of the framebuffer that changed
+static void _update_CRT_texture(const uint8_t *fb, uint32_t bands) {
+    if (hackAroundBrokenAdreno205) {
+        // texture recreated, all of it uploaded
+        _HACKAROUND_GLTEXIMAGE2D_PRE(TEXTURE_ACTIVE_FRAMEBUFFER, a2TextureName);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, /*level*/0, TEX_FORMAT_INDEXED_INTERNAL, SCANWIDTH, SCANHEIGHT, /*border*/0, TEX_FORMAT_INDEXED, GL_UNSIGNED_BYTE, (GLvoid *)fb);
+        return;
+    }
+
+#if USE_PBO
+    if (a2PixelBufferName != UNINITIALIZED_GL) {
+        // Copy the bands into the pixel buffer : the upload to the texture is then asynchronous.  The previous storage is
+        // orphaned so that mapping does not wait on an upload still in flight (only the bands written are uploaded).
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, a2PixelBufferName);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, SCANWIDTH * SCANHEIGHT, NULL, GL_STREAM_DRAW);
+        uint8_t *pixels = (uint8_t *)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        bool mapped = false;
+        if (pixels) {
+            for (unsigned int band = 0; band < TEXT_ROWS; band++) {
+                if (bands & (1U << band)) {
+                    const unsigned int offset = band * SCANWIDTH * VIDEO_BAND_HEIGHT;
+                    memcpy(pixels + offset, fb + offset, SCANWIDTH * VIDEO_BAND_HEIGHT);
+                }
+            }
+            mapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER); // (contents lost when false)
+        }
+        if (mapped) {
+            _upload_CRT_bands(NULL, bands);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (mapped) {
+            return;
+        }
+        GL_ERRLOG("mapping CRT pixel buffer");
+    }
+#endif
+
+    _upload_CRT_bands(fb, bands);
+}
+
+// Update the palette texture from the colormap, when it changed.  The flashing text colors are swapped every other
+// FLASH_NSECS (at the cadence of the X11 driver) : flashing only costs a palette upload.
+#define FLASH_NSECS (NANOSECONDS_PER_SECOND / 10)
+static void _update_CRT_palette(void) {
+    PIXEL_TYPE palette[256];
+    for (unsigned int i = 0; i < 256; i++) {
+        palette[i] = (PIXEL_TYPE)(
+                                  ((PIXEL_TYPE)(colormap[i].red)   << SHIFT_R) |
+                                  ((PIXEL_TYPE)(colormap[i].green) << SHIFT_G) |
+                                  ((PIXEL_TYPE)(colormap[i].blue)  << SHIFT_B) |
+                                  ((PIXEL_TYPE)MAX_SATURATION      << SHIFT_A)
+                                  );
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((((unsigned long long)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec) / FLASH_NSECS) & 0x1) {
+        PIXEL_TYPE black = palette[COLOR_FLASHING_BLACK];
+        palette[COLOR_FLASHING_BLACK] = palette[COLOR_FLASHING_WHITE];
+        palette[COLOR_FLASHING_WHITE] = black;
+    }
+
+    if (!a2PaletteStale && !memcmp(palette, a2Palette, sizeof(palette))) {
+        return;
+    }
+    a2PaletteStale = false;
+    memcpy(a2Palette, palette, sizeof(palette));
+
+    SCOPE_TRACE_VIDEO("glvideo palette");
+    if (hackAroundBrokenAdreno205) {
+        _HACKAROUND_GLTEXIMAGE2D_PRE(TEXTURE_ACTIVE_PALETTE, a2PaletteName);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, /*level*/0, TEX_FORMAT_INTERNAL, 256, 1, /*border*/0, TEX_FORMAT, TEX_TYPE, (GLvoid *)&a2Palette[0]);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, /*level*/0, /*xoffset*/0, /*yoffset*/0, 256, 1, TEX_FORMAT, TEX_TYPE, (GLvoid *)&a2Palette[0]);
+    }
+}
+
 static GLuint _build_program(demoSource *vertexSource, demoSource *fragmentSource, bool hasNormal, bool hasTexcoord) {
     GLuint prgName;
 
@@ -455,6 +591,27 @@ static GLuint _build_program(demoSource *vertexSource, demoSource *fragmentSourc
         LOG("OOPS, no texture selector in shader : %d", alphaValue);
     }
 
+    uniformIndexedIdx = glGetUniformLocation(prgName, "aIndexed");
+    if (uniformIndexedIdx < 0) {
+        LOG("OOPS, no indexed texture selector in shader : %d", uniformIndexedIdx);
+    } else {
+        glUniform1i(uniformIndexedIdx, false);
+    }
+
+    uniformPaletteIdx = glGetUniformLocation(prgName, "aPalette");
+    if (uniformPaletteIdx < 0) {
+        LOG("OOPS, no palette in shader : %d", uniformPaletteIdx);
+    } else {
+        glUniform1i(uniformPaletteIdx, TEXTURE_ID_PALETTE);
+    }
+
+    uniformTextureSizeIdx = glGetUniformLocation(prgName, "aTextureSize");
+    if (uniformTextureSizeIdx < 0) {
+        LOG("OOPS, no texture size in shader : %d", uniformTextureSizeIdx);
+    } else {
+        glUniform2f(uniformTextureSizeIdx, SCANWIDTH, SCANHEIGHT);
+    }
+
     GL_ERRLOG("build program");
 
     return prgName;
@@ -618,6 +775,18 @@ static void gldriver_init_common(void) {
     // Build a default texture object with our image data
     a2TextureName = _create_CRT_texture();
 
+#if USE_PBO
+    // Pixel buffer the texture is updated from
+    glGenBuffers(1, &a2PixelBufferName);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, a2PixelBufferName);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, SCANWIDTH * SCANHEIGHT, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GL_ERRLOG("finished creating CRT pixel buffer");
+#endif
+
+    // Colors of the indexes of the texture
+    a2PaletteName = _create_CRT_palette();
+
     // ----------------------------
     // Load/setup shaders
 
@@ -670,6 +839,18 @@ static void _gldriver_shutdown(void) {
         a2TextureName = UNINITIALIZED_GL;
     }
 
+    if (a2PaletteName != UNINITIALIZED_GL) {
+        glDeleteTextures(1, &a2PaletteName);
+        a2PaletteName = UNINITIALIZED_GL;
+    }
+
+#if USE_PBO
+    if (a2PixelBufferName != UNINITIALIZED_GL) {
+        glDeleteBuffers(1, &a2PixelBufferName);
+        a2PixelBufferName = UNINITIALIZED_GL;
+    }
+#endif
+
     if (crtVAOName != UNINITIALIZED_GL) {
         _destroy_VAO(crtVAOName);
         crtVAOName = UNINITIALIZED_GL;
@@ -741,10 +922,12 @@ static void gldriver_update(int unused) {
 static void gldriver_render(void) {
     SCOPE_TRACE_VIDEO("glvideo render");
 
-    const uint8_t * const fb = video_current_framebuffer();
-    if (UNLIKELY(!fb)) {
-        return;
+    if (cpu_isPauseAcknowledged()) {
+        video_presentFrame(); // interface drawn straight into the framebuffer (the CPU thread no longer composes frames)
     }
+    uint32_t bands = 0x0;
+    const uint8_t * const fb = video_acquireFrame(&bands);
+    video_clearDirty();
 
     if (UNLIKELY(renderer_shutting_down)) {
         return;
@@ -780,32 +963,20 @@ static void gldriver_render(void) {
     // that we calculated above
     glUniformMatrix4fv(uniformMVPIdx, 1, GL_FALSE, mvp);
 
-    unsigned long wasDirty = video_clearDirty();
-
-    char pixels[SCANWIDTH * SCANHEIGHT * sizeof(PIXEL_TYPE)]; // HACK FIXME TODO ... are we sure this does not overflow max stack buffer size?
-    if (wasDirty) {
-        SCOPE_TRACE_VIDEO("pixel convert");
-        // Update texture from indexed-color Apple //e internal framebuffer
-        unsigned int count = SCANWIDTH * SCANHEIGHT;
-        for (unsigned int i=0, j=0; i<count; i++, j+=sizeof(PIXEL_TYPE)) {
-            uint8_t index = *(fb + i);
-            *( (PIXEL_TYPE*)(pixels + j) ) = (PIXEL_TYPE)(
-                                                      ((PIXEL_TYPE)(colormap[index].red)   << SHIFT_R) |
-                                                      ((PIXEL_TYPE)(colormap[index].green) << SHIFT_G) |
-                                                      ((PIXEL_TYPE)(colormap[index].blue)  << SHIFT_B) |
-                                                      ((PIXEL_TYPE)MAX_SATURATION          << SHIFT_A)
-                                                      );
-        }
-    }
-
     glActiveTexture(TEXTURE_ACTIVE_FRAMEBUFFER);
     glBindTexture(GL_TEXTURE_2D, a2TextureName);
     glUniform1i(texSamplerLoc, TEXTURE_ID_FRAMEBUFFER);
-    if (wasDirty) {
-        SCOPE_TRACE_VIDEO("glvideo texImage2D");
-        _HACKAROUND_GLTEXIMAGE2D_PRE(TEXTURE_ACTIVE_FRAMEBUFFER, a2TextureName);
-        glTexImage2D(GL_TEXTURE_2D, /*level*/0, TEX_FORMAT_INTERNAL, SCANWIDTH, SCANHEIGHT, /*border*/0, TEX_FORMAT, TEX_TYPE, (GLvoid *)&pixels[0]);
+    if (a2TextureStale) {
+        a2TextureStale = false;
+        bands = VIDEO_BANDS_ALL;
     }
+    if (bands) {
+        _update_CRT_texture(fb, bands);
+    }
+
+    glActiveTexture(TEXTURE_ACTIVE_PALETTE);
+    glBindTexture(GL_TEXTURE_2D, a2PaletteName);
+    _update_CRT_palette();
 
     // Bind our vertex array object
 #if USE_VAO
@@ -846,9 +1017,11 @@ static void gldriver_render(void) {
     // with an inverted matrix
     //glCullFace(GL_BACK);
 
-    // Draw the CRT object and others
+    // Draw the CRT object (indexed colors) and others
+    glUniform1i(uniformIndexedIdx, true);
     _HACKAROUND_GLDRAW_PRE();
     glDrawElements(GL_TRIANGLES, crtNumElements, crtElementType, 0);
+    glUniform1i(uniformIndexedIdx, false);
 
     // Render HUD nodes
     glnode_renderNodes();
@@ -21,6 +21,7 @@
 
 enum {
     TEXTURE_ID_FRAMEBUFFER=0,
+    TEXTURE_ID_PALETTE,
     TEXTURE_ID_MESSAGE,
 #if INTERFACE_TOUCH
     TEXTURE_ID_TOUCHJOY_AXIS,
@@ -33,12 +34,13 @@ enum {
 
 enum {
     TEXTURE_ACTIVE_FRAMEBUFFER     = GL_TEXTURE0,
-    TEXTURE_ACTIVE_MESSAGE         = GL_TEXTURE1,
+    TEXTURE_ACTIVE_PALETTE         = GL_TEXTURE1,
+    TEXTURE_ACTIVE_MESSAGE         = GL_TEXTURE2,
 #if INTERFACE_TOUCH
-    TEXTURE_ACTIVE_TOUCHJOY_AXIS   = GL_TEXTURE2,
-    TEXTURE_ACTIVE_TOUCHJOY_BUTTON = GL_TEXTURE3,
-    TEXTURE_ACTIVE_TOUCHKBD        = GL_TEXTURE4,
-    TEXTURE_ACTIVE_TOUCHMENU       = GL_TEXTURE5,
+    TEXTURE_ACTIVE_TOUCHJOY_AXIS   = GL_TEXTURE3,
+    TEXTURE_ACTIVE_TOUCHJOY_BUTTON = GL_TEXTURE4,
+    TEXTURE_ACTIVE_TOUCHKBD        = GL_TEXTURE5,
+    TEXTURE_ACTIVE_TOUCHMENU       = GL_TEXTURE6,
 #endif
     TEXTURE_ACTIVE_MAX,
 };
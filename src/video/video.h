@@ -116,6 +116,28 @@ void video_loadfont(int first, int qty, const uint8_t *data, int mode);
  */
 void video_redraw(void);
 
+/*
+ * Plot the text/lores/hires bytes written since the last call (or redraw) on the displayed page, with the current
+ * display mode.  Video memory writes only mark the bytes dirty : this is called before reading the framebuffer outside
+ * of the video backend (see video_current_framebuffer()), the end of each video frame plots them with
+ * video_composeFrame().  The bytes written on the other page are plotted once it is displayed.
+ */
+void video_rasterize(void);
+
+/*
+ * Log a change of the display softswitches (text/mixed/hires/80col/dhires/altchar/page) at the current beam
+ * position.  This only appends to the log of the frame, video_composeFrame() plots the frame from it.
+ */
+void video_logSwitches(void);
+
+/*
+ * End of a video frame (called from the frame timing event, on the thread running the machine) : plot the displayed
+ * page, scanline by scanline with the display mode and page that were current when the beam scanned them.  A change
+ * takes effect from the first scanline whose display starts after it, changes made during the vertical blank from the
+ * next frame.
+ */
+void video_composeFrame(void);
+
 /*
  * Clear the current display.
  */
@@ -133,28 +155,50 @@ void video_setpage(int page);
  */
 const uint8_t * const video_current_framebuffer();
 
+/*
+ * Hand the displayed framebuffer (see video_current_framebuffer()) over to the video backend if it changed since the
+ * last time : the bands changed since the back buffer of a triple buffer was last published are copied into it, and
+ * it is then published with an atomic swap.  Called from the CPU thread at the end of each video frame, and by the
+ * video backend once the CPU thread has acknowledged a pause (see cpu_isPauseAcknowledged(), the interface then draws
+ * straight into the framebuffer).  Never blocks, and does nothing until the backend acquires a frame.
+ */
+void video_presentFrame(void);
+
+#define VIDEO_BAND_HEIGHT FONT_HEIGHT_PIXELS          // framebuffer rows per band (a text row)
+#define VIDEO_BANDS_ALL ((1U << TEXT_ROWS) - 1)
+
+/*
+ * Latest frame presented, for the video backend : it is complete and not written to until the next call.  `bands` is
+ * set to the bands (bit per VIDEO_BAND_HEIGHT framebuffer rows) that changed since the frame of the previous call
+ * (VIDEO_BANDS_ALL for the first one), 0 when there is no new frame.  Never blocks.
+ */
+const uint8_t *video_acquireFrame(uint32_t *bands);
+
 // do not access directly, but through inline accessor methods
 extern volatile unsigned long _backend_vid_dirty;
 
+#define VIDEO_DIRTY_RENDER  0x1UL   // changed and not yet drawn
+#define VIDEO_DIRTY_PRESENT 0x2UL   // changed and not yet presented (see video_presentFrame())
+
 /*
  * True if anything changed in framebuffer and not yet drawn
  */
 static inline bool video_isDirty(void) {
-    return _backend_vid_dirty;
+    return (_backend_vid_dirty & VIDEO_DIRTY_RENDER);
 }
 
 /*
  * Atomically set dirty bit, return previous value
  */
 static inline unsigned long video_setDirty(void) {
-    return __sync_fetch_and_or(&_backend_vid_dirty, 1UL);
+    return __sync_fetch_and_or(&_backend_vid_dirty, VIDEO_DIRTY_RENDER|VIDEO_DIRTY_PRESENT) & VIDEO_DIRTY_RENDER;
 }
 
 /*
  * Atomically clear dirty bit, return previous value
  */
 static inline unsigned long video_clearDirty(void) {
-    return __sync_fetch_and_and(&_backend_vid_dirty, 0UL);
+    return __sync_fetch_and_and(&_backend_vid_dirty, ~VIDEO_DIRTY_RENDER) & VIDEO_DIRTY_RENDER;
 }
 
 extern bool video_saveState(StateHelper_s *helper);
@@ -169,6 +213,11 @@ uint16_t video_scanner_get_address(bool *vblBarOut);
 uint8_t floating_bus(void);
 uint8_t floating_bus_hibit(const bool hibit);
 
+/*
+ * Cycles from the current scanner position until VBL' next changes state (at most maxCycles)
+ */
+unsigned int video_scanner_cycles_to_vbl_change(unsigned int maxCycles);
+
 #define TEXT_ROWS 24
 #define BEGIN_MIX 20
 #define TEXT_COLS 40
@@ -274,6 +323,33 @@ uint8_t floating_bus_hibit(const bool hibit);
     generic graphics globals
    ---------------------------------- */
 
+/*
+ * Video memory bytes written and not plotted yet, per page (see video_rasterize())
+ */
+typedef struct video_dirty_t {
+    uint32_t rows;                              // text rows with dirty bytes below
+    uint64_t text[TEXT_ROWS];                   // text/lores bytes, bit per column, per text row
+    uint64_t hires[TEXT_ROWS*FONT_GLYPH_Y];     // hires/dhires bytes, bit per column, per scanline
+} video_dirty_t;
+
+#define VIDEO_SWITCH_LOG_MAX 64
+
+/*
+ * Display softswitch changes of the current video frame (see video_logSwitches())
+ */
+typedef struct video_switch_log_t {
+    uint32_t frame_switches;                    // display softswitches at the beginning of the frame ...
+    uint32_t switches;                          // ... and after the last change
+    unsigned int count;                         // changes this frame (more than VIDEO_SWITCH_LOG_MAX : not all logged)
+    struct {
+        uint16_t cycle;                         // beam position : cycles into the frame
+        uint32_t switches;
+    } changes[VIDEO_SWITCH_LOG_MAX];
+    uint8_t stale;                              // pages to plot in full before they are displayed (bit per page)
+    uint32_t mixed[2];                          // rows of each page holding scanlines scanned with other softswitches
+                                                // (plotted again before the page is displayed), bit per text row
+} video_switch_log_t;
+
 /*
  * Pointers to framebuffer (can be VGA memory or host buffer)
  */
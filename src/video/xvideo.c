@@ -339,7 +339,12 @@ static int keysym_to_scancode(void) {
 
 static void post_image() {
     // copy Apple //e video memory into XImage uint32_t buffer
-    uint8_t *fb = !video__current_page ? video__fb1 : video__fb2;
+    if (cpu_isPauseAcknowledged()) {
+        video_presentFrame(); // interface drawn straight into the framebuffer (the CPU thread no longer composes frames)
+    }
+    uint32_t bands = 0x0; // (posted regardless, the flashing colors change)
+    const uint8_t *fb = video_acquireFrame(&bands);
+    video_clearDirty();
     uint8_t index;
 
     unsigned int count = SCANWIDTH * SCANHEIGHT;
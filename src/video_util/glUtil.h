@@ -19,6 +19,8 @@
 #   import <CoreFoundation/CoreFoundation.h>
 #   import <TargetConditionals.h>
 #   if TARGET_OS_IPHONE
+#       define USE_PBO 0
+#       define TEX_FORMAT_INDEXED GL_LUMINANCE
 #       import <OpenGLES/ES2/gl.h>
 #       import <OpenGLES/ES2/glext.h>
 #   else
@@ -32,6 +34,9 @@
 // NOTE : 2015/04/01 ... Certain Android and Android-ish devices (*cough* Kindle *cough*) have buggy OpenGL VAO support,
 // so don't rely on it.  Is it the future yet?
 #   define USE_VAO 0
+// Pixel buffer objects (and glMapBuffer()) are not in OpenGL ES 2.0
+#   define USE_PBO 0
+#   define TEX_FORMAT_INDEXED GL_LUMINANCE
 #   include <GLES2/gl2.h>
 #   include <GLES2/gl2ext.h>
 #else
@@ -45,10 +50,23 @@
 #define USE_VAO 1
 #endif
 
+#if !defined(USE_PBO)
+#define USE_PBO 1
+#endif
+
 // Global unified texture format constants ...
 
 #define TEX_FORMAT GL_RGBA
 
+// 8bit-indexed color (single channel, sampled as red) : OpenGL ES 2.0 has no GL_RED textures, core profiles no
+// GL_LUMINANCE textures
+#if !defined(TEX_FORMAT_INDEXED)
+#   define TEX_FORMAT_INDEXED GL_RED
+#   define TEX_FORMAT_INDEXED_INTERNAL GL_R8
+#else
+#   define TEX_FORMAT_INDEXED_INTERNAL TEX_FORMAT_INDEXED
+#endif
+
 #if USE_RGBA4444
 #   define PIXEL_TYPE uint16_t
 #   define MAX_SATURATION 0xf
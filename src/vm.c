@@ -10,9 +10,19 @@
  */
 
 #include "common.h"
+#include <sys/mman.h>
 
 extern const uint8_t apple_iie_rom[32768]; // rom.c
 
+#if MACHINE_CONTEXT
+machine_t machine_default = { 0 };
+
+__thread machine_t *current_machine = &machine_default;
+
+// joystick timers (cycle at which each paddle timer resets)
+#define gc_cycles_timer_0 (current_machine->gc_cycles_timer_0)
+#define gc_cycles_timer_1 (current_machine->gc_cycles_timer_1)
+#else
 uint8_t apple_ii_64k[2][65536] = { { 0 } };
 uint8_t language_card[2][8192] = { { 0 } };
 uint8_t language_banks[2][8192] = { { 0 } };
@@ -38,9 +48,16 @@ uint8_t *base_c4rom = NULL;
 uint8_t *base_c5rom = NULL;
 uint8_t *base_cxrom = NULL;
 
-// joystick timer values
-int gc_cycles_timer_0 = 0;
-int gc_cycles_timer_1 = 0;
+// joystick timers (cycle at which each paddle timer resets)
+static unsigned long long gc_cycles_timer_0 = 0;
+static unsigned long long gc_cycles_timer_1 = 0;
+
+// game controller state seen by the machine (see replay.h)
+uint8_t gc_button_0 = 0;
+uint8_t gc_button_1 = 0;
+uint16_t gc_paddle_0 = HALF_JOY_RANGE;
+uint16_t gc_paddle_1 = HALF_JOY_RANGE;
+#endif
 
 #if VM_TRACING
 FILE *test_vm_fp = NULL;
@@ -103,6 +120,9 @@ GLUE_C_READ(read_keyboard)
         readCallback();
     }
 #endif
+    if (ea == 0xC000) {
+        timing_checkIdlePoll(ea, b);
+    }
     return b;
 }
 
@@ -136,6 +156,7 @@ GLUE_C_READ(iie_page2_off)
     }
 
     video_setpage(0);
+    video_logSwitches();
 
     return floating_bus();
 }
@@ -160,6 +181,7 @@ GLUE_C_READ(iie_page2_on)
     } else {
         softswitches |= SS_SCREEN;
         video_setpage(1);
+        video_logSwitches();
     }
 
     return floating_bus();
@@ -174,7 +196,7 @@ GLUE_C_READ(read_switch_graphics)
 {
     if (softswitches & SS_TEXT) {
         softswitches &= ~SS_TEXT;
-        video_redraw();
+        video_logSwitches();
     }
     return floating_bus();
 }
@@ -183,7 +205,7 @@ GLUE_C_READ(read_switch_text)
 {
     if (!(softswitches & SS_TEXT)) {
         softswitches |= SS_TEXT;
-        video_redraw();
+        video_logSwitches();
     }
     return floating_bus();
 }
@@ -197,7 +219,7 @@ GLUE_C_READ(read_switch_no_mixed)
 {
     if (softswitches & SS_MIXED) {
         softswitches &= ~SS_MIXED;
-        video_redraw();
+        video_logSwitches();
     }
     return floating_bus();
 }
@@ -206,7 +228,7 @@ GLUE_C_READ(read_switch_mixed)
 {
     if (!(softswitches & SS_MIXED)) {
         softswitches |= SS_MIXED;
-        video_redraw();
+        video_logSwitches();
     }
     return floating_bus();
 }
@@ -244,7 +266,7 @@ GLUE_C_READ(iie_hires_off)
         softswitches |= SS_HGRWRT;
     }
 
-    video_redraw();
+    video_logSwitches();
     return floating_bus();
 }
 
@@ -268,7 +290,7 @@ GLUE_C_READ(iie_hires_on)
         }
     }
 
-    video_redraw();
+    video_logSwitches();
     return floating_bus();
 }
 
@@ -285,12 +307,12 @@ GLUE_C_READ(iie_check_hires)
 
 GLUE_C_READ(read_button0)
 {
-    return joy_button0;
+    return gc_button_0;
 }
 
 GLUE_C_READ(read_button1)
 {
-    return joy_button1;
+    return gc_button_1;
 }
 
 GLUE_C_READ(read_button2)
@@ -305,13 +327,16 @@ GLUE_C_READ(read_gc_strobe)
     //  * 7-29, discussing PREAD : "The timer duration will vary between 2 and 3302 usecs"
     //  * 7-30, timer reset : "But the timer pulse may still be high from the previous [strobe access] and the timers are
     //  not retriggered by C07X' if they have not yet reset from the previous trigger"
-    if (gc_cycles_timer_0 <= 0)
+    const unsigned long long now = timing_currentCycle();
+    if (gc_cycles_timer_0 <= now)
     {
-        gc_cycles_timer_0 = (int)((joy_x-5) * JOY_STEP_CYCLES);
+        int cycles = (int)((gc_paddle_0-5) * JOY_STEP_CYCLES);
+        gc_cycles_timer_0 = now + (cycles > 0 ? cycles : 0);
     }
-    if (gc_cycles_timer_1 <= 0)
+    if (gc_cycles_timer_1 <= now)
     {
-        gc_cycles_timer_1 = (int)(joy_y * JOY_STEP_CYCLES) + 2;
+        int cycles = (int)(gc_paddle_1 * JOY_STEP_CYCLES) + 2;
+        gc_cycles_timer_1 = now + (cycles > 0 ? cycles : 0);
     }
 
     // NOTE (possible TODO FIXME): unimplemented GC2 and GC3 timers since they were not wired on the //e ...
@@ -320,9 +345,8 @@ GLUE_C_READ(read_gc_strobe)
 
 GLUE_C_READ(read_gc0)
 {
-    if (gc_cycles_timer_0 <= 0)
+    if (gc_cycles_timer_0 <= timing_currentCycle())
     {
-        gc_cycles_timer_0 = 0;
         return 0;
     }
     return 0xFF;
@@ -330,9 +354,8 @@ GLUE_C_READ(read_gc0)
 
 GLUE_C_READ(read_gc1)
 {
-    if (gc_cycles_timer_1 <= 0)
+    if (gc_cycles_timer_1 <= timing_currentCycle())
     {
-        gc_cycles_timer_1 = 0;
         return 0;
     }
     return 0xFF;
@@ -543,6 +566,7 @@ GLUE_C_READ(iie_80store_off)
     if (softswitches & SS_PAGE2) {
         softswitches |= SS_SCREEN;
         video_setpage(1);
+        video_logSwitches();
     }
 
     return floating_bus();
@@ -578,6 +602,7 @@ GLUE_C_READ(iie_80store_on)
 
     softswitches &= ~SS_SCREEN;
     video_setpage(0);
+    video_logSwitches();
     return floating_bus();
 }
 
@@ -739,9 +764,7 @@ GLUE_C_READ(iie_80col_off)
 
     softswitches &= ~SS_80COL;
 
-    if (softswitches & (SS_TEXT|SS_MIXED|SS_DHIRES)) {
-        video_redraw();
-    }
+    video_logSwitches();
 
     return floating_bus();
 }
@@ -754,9 +777,7 @@ GLUE_C_READ(iie_80col_on)
 
     softswitches |= SS_80COL;
 
-    if (softswitches & (SS_TEXT|SS_MIXED|SS_DHIRES)) {
-        video_redraw();
-    }
+    video_logSwitches();
 
     return floating_bus();
 }
@@ -771,7 +792,7 @@ GLUE_C_READ(iie_altchar_off)
     if (softswitches & SS_ALTCHAR) {
         softswitches &= ~SS_ALTCHAR;
         video_loadfont(0x40,0x40,ucase_glyphs,3);
-        video_redraw();
+        video_logSwitches();
     }
     return floating_bus();
 }
@@ -782,7 +803,7 @@ GLUE_C_READ(iie_altchar_on)
         softswitches |= SS_ALTCHAR;
         video_loadfont(0x40,0x20,mousetext_glyphs,1);
         video_loadfont(0x60,0x20,lcase_glyphs,2);
-        video_redraw();
+        video_logSwitches();
     }
     return floating_bus();
 }
@@ -814,7 +835,7 @@ GLUE_C_READ(iie_dhires_on)
 {
     if (!(softswitches & SS_DHIRES)) {
         softswitches |= SS_DHIRES;
-        video_redraw();
+        video_logSwitches();
     }
     return floating_bus();
 }
@@ -823,7 +844,7 @@ GLUE_C_READ(iie_dhires_off)
 {
     if (softswitches & SS_DHIRES) {
         softswitches &= ~SS_DHIRES;
-        video_redraw();
+        video_logSwitches();
     }
     return floating_bus();
 }
@@ -839,7 +860,9 @@ GLUE_C_READ(iie_check_vbl)
     bool vbl_bar = false;
     video_scanner_get_address(&vbl_bar);
     uint8_t key = apple_ii_64k[0][0xC000];
-    return (key & ~0x80) | (vbl_bar ? 0x80 : 0x00);
+    uint8_t b = (key & ~0x80) | (vbl_bar ? 0x80 : 0x00);
+    timing_checkIdlePoll(ea, b);
+    return b;
 }
 
 GLUE_C_READ(iie_c3rom_peripheral)
@@ -1197,6 +1220,64 @@ static void _initialize_tables(void) {
 #endif
 }
 
+// ----------------------------------------------------------------------------
+// page-granular dispatch
+
+typedef struct vm_page_bank_t {
+    void *func;
+    uint8_t **bank;
+} vm_page_bank_t;
+
+static uint8_t **_page_bank(void **vmem, unsigned int page, const vm_page_bank_t *banks, unsigned int count) {
+    const unsigned int addr = page << 8;
+    void *func = vmem[addr];
+    for (unsigned int i = 1; i < 0x100; i++) {
+        if (vmem[addr+i] != func) {
+            return NULL; // page has softswitch/peripheral/video hooks
+        }
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        if (banks[i].func == func) {
+            return banks[i].bank;
+        }
+    }
+    return NULL;
+}
+
+// Bind each page whose accessors are uniformly a plain bank accessor to the backing base_* pointer.  Since the page
+// tables reference the base_* variables themselves, softswitch bank changes need not touch them ... only changes to
+// the cpu65_vmem_r/cpu65_vmem_w handlers do, so anything swapping handlers after vm_initialize() rebuilds them.
+static void _initialize_page_tables(void) {
+    // plain bank accessors that can be bypassed by indexing the bank pointer (of the current machine) directly.
+    // NOTE : the MAYBEREAD slot4/slot5 accessors are excluded since their bank pointer may be a function
+    const vm_page_bank_t vm_page_banks_r[] = {
+        { (void *)iie_read_ram_default,          &base_ramrd   },
+        { (void *)read_ram_bank,                 &base_d000_rd },
+        { (void *)read_ram_lc,                   &base_e000_rd },
+        { (void *)iie_read_ram_text_page0,       &base_textrd  },
+        { (void *)iie_read_ram_hires_page0,      &base_hgrrd   },
+        { (void *)iie_read_ram_zpage_and_stack,  &base_stackzp },
+        { (void *)iie_read_slot3,                &base_c3rom   },
+        { (void *)iie_read_slotx,                &base_cxrom   },
+    };
+
+    // NOTE : the MAYBEWRITE accessors are included, the CPU falls back to the per-address handler when the bank is
+    // NULL
+    const vm_page_bank_t vm_page_banks_w[] = {
+        { (void *)iie_write_ram_default,               &base_ramwrt   },
+        { (void *)write_ram_bank,                      &base_d000_wrt },
+        { (void *)write_ram_lc,                        &base_e000_wrt },
+        { (void *)iie_write_screen_hole_text_page0,    &base_textwrt  },
+        { (void *)iie_write_screen_hole_hires_page0,   &base_hgrwrt   },
+        { (void *)iie_write_ram_zpage_and_stack,       &base_stackzp  },
+    };
+
+    for (unsigned int page = 0; page < 0x100; page++) {
+        cpu65_vmem_rpage[page] = _page_bank(cpu65_vmem_r, page, vm_page_banks_r, sizeof(vm_page_banks_r)/sizeof(vm_page_banks_r[0]));
+        cpu65_vmem_wpage[page] = _page_bank(cpu65_vmem_w, page, vm_page_banks_w, sizeof(vm_page_banks_w)/sizeof(vm_page_banks_w[0]));
+    }
+}
+
 // ----------------------------------------------------------------------------
 
 void vm_initialize(void) {
@@ -1205,9 +1286,77 @@ void vm_initialize(void) {
     _initialize_tables();
     vm_reinitializeAudio();
     disk6_init();
+    _initialize_page_tables();
+    cpu65_invalidate_blocks();
     _initialize_iie_switches();
     c_joystick_reset();
+    gc_cycles_timer_0 = 0;
+    gc_cycles_timer_1 = 0;
+    gc_button_0 = 0;
+    gc_button_1 = 0;
+    gc_paddle_0 = HALF_JOY_RANGE;
+    gc_paddle_1 = HALF_JOY_RANGE;
+}
+
+#if MACHINE_CONTEXT
+machine_t *machine_create(void) {
+    machine_t *machine = calloc(1, sizeof(machine_t));
+    if (!machine) {
+        ERRLOG("OOPS, could not allocate machine");
+        return NULL;
+    }
+
+    // what _init_machine_default() and the module constructors do for machine_default
+    machine->frame_event = (timing_event_t)TIMING_EVENT_INITIALIZER(NULL);
+    machine->replay.event = (timing_event_t)TIMING_EVENT_INITIALIZER(NULL);
+    machine->rewind_ring.event = (timing_event_t)TIMING_EVENT_INITIALIZER(NULL);
+
+    machine_t *prev = machine_select(machine);
+    for (unsigned int drive = 0; drive < 2; drive++) {
+        disk6.disk[drive].fd = -1;
+        disk6.disk[drive].mmap_image = MAP_FAILED;
+    }
+    video__fb1 = machine->vga_mem_page_0;
+    video__fb2 = machine->vga_mem_page_1;
+    timing_reinitializeMachine();
+    machine_select(prev);
+
+    return machine;
+}
+
+void machine_destroy(machine_t *machine) {
+    if (!machine || machine == &machine_default) {
+        return;
+    }
+    assert(machine != current_machine);
+
+    machine_t *prev = machine_select(machine);
+    disk6_eject(0);
+    disk6_eject(1);
+    rewind_stop();
+    runahead_stop();
+#if CPU_JIT
+    jit65_shutdown();
+#endif
+    machine_select(prev);
+
+    FREE(machine);
+}
+
+machine_t *machine_select(machine_t *machine) {
+    machine_t *prev = current_machine;
+    current_machine = machine;
+    return prev;
+}
+
+__attribute__((constructor(CTOR_PRIORITY_FIRST)))
+static void _init_machine_default(void) {
+    machine_default.frame_event = (timing_event_t)TIMING_EVENT_INITIALIZER(NULL);
+    machine_default.replay.event = (timing_event_t)TIMING_EVENT_INITIALIZER(NULL);
+    machine_default.rewind_ring.event = (timing_event_t)TIMING_EVENT_INITIALIZER(NULL);
+    emul_reinitialize = 1;
 }
+#endif
 
 void vm_reinitializeAudio(void) {
 #ifdef AUDIO_ENABLED
@@ -1221,12 +1370,25 @@ void vm_reinitializeAudio(void) {
 #endif
             ram_nop;
     }
+    _initialize_page_tables();
 #warning TODO FIXME ... should unset MB/Phasor hooks if volume is zero ...
 }
 
+void vm_disconnectAudio(void) {
+    for (unsigned int i = 0xC030; i < 0xC040; i++) {
+        cpu65_vmem_r[i] = cpu65_vmem_w[i] = ram_nop;
+    }
+    for (unsigned int i = 0xC0C0; i < 0xC0E0; i++) {
+        cpu65_vmem_r[i] = cpu65_vmem_w[i] = ram_nop;
+    }
+    for (unsigned int i = 0xC400; i < 0xC600; i++) {
+        cpu65_vmem_r[i] = cpu65_vmem_w[i] = ram_nop;
+    }
+    _initialize_page_tables();
+}
+
 bool vm_saveState(StateHelper_s *helper) {
     bool saved = false;
-    int fd = helper->fd;
 
     do {
         uint8_t serialized[8] = { 0 };
@@ -1236,22 +1398,22 @@ bool vm_saveState(StateHelper_s *helper) {
         serialized[2] = (uint8_t)((softswitches & 0xFF00    ) >>  8);
         serialized[3] = (uint8_t)((softswitches & 0xFF      ) >>  0);
         LOG("SAVE softswitches = %08x", softswitches);
-        if (!helper->save(fd, serialized, sizeof(softswitches))) {
+        if (!helper->save(helper, serialized, sizeof(softswitches))) {
             break;
         }
 
         // save main/aux memory state
-        if (!helper->save(fd, apple_ii_64k[0], sizeof(apple_ii_64k))) {
+        if (!helper->save(helper, apple_ii_64k[0], sizeof(apple_ii_64k))) {
             break;
         }
 
         // save language card
-        if (!helper->save(fd, language_card[0], sizeof(language_card))) {
+        if (!helper->save(helper, language_card[0], sizeof(language_card))) {
             break;
         }
 
         // save language banks
-        if (!helper->save(fd, language_banks[0], sizeof(language_banks))) {
+        if (!helper->save(helper, language_banks[0], sizeof(language_banks))) {
             break;
         }
 
@@ -1263,65 +1425,65 @@ bool vm_saveState(StateHelper_s *helper) {
         serialized[4] = 0x4;
         serialized[5] = 0x5;
         LOG("SAVE base_ramrd = %d", (base_ramrd == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_ramrd == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_ramrd == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
         LOG("SAVE base_ramwrt = %d", (base_ramwrt == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_ramwrt == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_ramwrt == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
         LOG("SAVE base_textrd = %d", (base_textrd == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_textrd == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_textrd == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
         LOG("SAVE base_textwrt = %d", (base_textwrt == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_textwrt == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_textwrt == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
         LOG("SAVE base_hgrrd = %d", (base_hgrrd == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_hgrrd == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_hgrrd == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
         LOG("SAVE base_hgrwrt = %d", (base_hgrwrt == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_hgrwrt == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_hgrwrt == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
         LOG("SAVE base_stackzp = %d", (base_stackzp == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_stackzp == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_stackzp == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
         LOG("SAVE base_c3rom = %d", (base_c3rom == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_c3rom == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_c3rom == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
         LOG("SAVE base_cxrom = %d", (base_cxrom == apple_ii_64k[0]) ? serialized[0] : serialized[1]);
-        if (!helper->save(fd, (base_cxrom == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
+        if (!helper->save(helper, (base_cxrom == apple_ii_64k[0]) ? &serialized[0] : &serialized[1], 1)) {
             break;
         }
 
         if (base_d000_rd == apple_ii_64k[0]) {
             LOG("SAVE base_d000_rd = %d", serialized[0]);
-            if (!helper->save(fd, &serialized[0], 1)) { // base_d000_rd --> //e ROM
+            if (!helper->save(helper, &serialized[0], 1)) { // base_d000_rd --> //e ROM
                 break;
             }
         } else if (base_d000_rd == language_banks[0] - 0xD000) {
             LOG("SAVE base_d000_rd = %d", serialized[2]);
-            if (!helper->save(fd, &serialized[2], 1)) { // base_d000_rd --> main LC mem
+            if (!helper->save(helper, &serialized[2], 1)) { // base_d000_rd --> main LC mem
                 break;
             }
         } else if (base_d000_rd == language_banks[0] - 0xC000) {
             LOG("SAVE base_d000_rd = %d", serialized[3]);
-            if (!helper->save(fd, &serialized[3], 1)) { // base_d000_rd --> main LC mem
+            if (!helper->save(helper, &serialized[3], 1)) { // base_d000_rd --> main LC mem
                 break;
             }
         } else if (base_d000_rd == language_banks[1] - 0xD000) {
             LOG("SAVE base_d000_rd = %d", serialized[4]);
-            if (!helper->save(fd, &serialized[4], 1)) { // base_d000_rd --> aux  LC mem
+            if (!helper->save(helper, &serialized[4], 1)) { // base_d000_rd --> aux  LC mem
                 break;
             }
         } else if (base_d000_rd == language_banks[1] - 0xC000) {
             LOG("SAVE base_d000_rd = %d", serialized[5]);
-            if (!helper->save(fd, &serialized[5], 1)) { // base_d000_rd --> aux  LC mem
+            if (!helper->save(helper, &serialized[5], 1)) { // base_d000_rd --> aux  LC mem
                 break;
             }
         } else {
@@ -1331,27 +1493,27 @@ bool vm_saveState(StateHelper_s *helper) {
 
         if (base_d000_wrt == 0) {
             LOG("SAVE base_d000_wrt = %d", serialized[0]);
-            if (!helper->save(fd, &serialized[0], 1)) { // base_d000_wrt --> no write
+            if (!helper->save(helper, &serialized[0], 1)) { // base_d000_wrt --> no write
                 break;
             }
         } else if (base_d000_wrt == language_banks[0] - 0xD000) {
             LOG("SAVE base_d000_wrt = %d", serialized[2]);
-            if (!helper->save(fd, &serialized[2], 1)) { // base_d000_wrt --> main LC mem
+            if (!helper->save(helper, &serialized[2], 1)) { // base_d000_wrt --> main LC mem
                 break;
             }
         } else if (base_d000_wrt == language_banks[0] - 0xC000) {
             LOG("SAVE base_d000_wrt = %d", serialized[3]);
-            if (!helper->save(fd, &serialized[3], 1)) { // base_d000_wrt --> main LC mem
+            if (!helper->save(helper, &serialized[3], 1)) { // base_d000_wrt --> main LC mem
                 break;
             }
         } else if (base_d000_wrt == language_banks[1] - 0xD000) {
             LOG("SAVE base_d000_wrt = %d", serialized[4]);
-            if (!helper->save(fd, &serialized[4], 1)) { // base_d000_wrt --> aux  LC mem
+            if (!helper->save(helper, &serialized[4], 1)) { // base_d000_wrt --> aux  LC mem
                 break;
             }
         } else if (base_d000_wrt == language_banks[1] - 0xC000) {
             LOG("SAVE base_d000_wrt = %d", serialized[5]);
-            if (!helper->save(fd, &serialized[5], 1)) { // base_d000_wrt --> aux  LC mem
+            if (!helper->save(helper, &serialized[5], 1)) { // base_d000_wrt --> aux  LC mem
                 break;
             }
         } else {
@@ -1361,17 +1523,17 @@ bool vm_saveState(StateHelper_s *helper) {
 
         if (base_e000_rd == apple_ii_64k[0]) {
             LOG("SAVE base_e000_rd = %d", serialized[0]);
-            if (!helper->save(fd, &serialized[0], 1)) { // base_e000_rd --> //e ROM
+            if (!helper->save(helper, &serialized[0], 1)) { // base_e000_rd --> //e ROM
                 break;
             }
         } else if (base_e000_rd == language_card[0] - 0xE000) {
             LOG("SAVE base_e000_rd = %d", serialized[2]);
-            if (!helper->save(fd, &serialized[2], 1)) { // base_e000_rd --> main LC mem
+            if (!helper->save(helper, &serialized[2], 1)) { // base_e000_rd --> main LC mem
                 break;
             }
         } else if (base_e000_rd == language_card[0] - 0xC000) {
             LOG("SAVE base_e000_rd = %d", serialized[3]);
-            if (!helper->save(fd, &serialized[3], 1)) { // base_e000_rd --> aux  LC mem
+            if (!helper->save(helper, &serialized[3], 1)) { // base_e000_rd --> aux  LC mem
                 break;
             }
         } else {
@@ -1381,17 +1543,17 @@ bool vm_saveState(StateHelper_s *helper) {
 
         if (base_e000_wrt == 0) {
             LOG("SAVE base_e000_wrt = %d", serialized[0]);
-            if (!helper->save(fd, &serialized[0], 1)) { // base_e000_wrt --> no write
+            if (!helper->save(helper, &serialized[0], 1)) { // base_e000_wrt --> no write
                 break;
             }
         } else if (base_e000_wrt == language_card[0] - 0xE000) {
             LOG("SAVE base_e000_wrt = %d", serialized[2]);
-            if (!helper->save(fd, &serialized[2], 1)) { // base_e000_wrt --> main LC mem
+            if (!helper->save(helper, &serialized[2], 1)) { // base_e000_wrt --> main LC mem
                 break;
             }
         } else if (base_e000_wrt == language_card[0] - 0xC000) {
             LOG("SAVE base_e000_wrt = %d", serialized[3]);
-            if (!helper->save(fd, &serialized[3], 1)) { // base_e000_wrt --> aux  LC mem
+            if (!helper->save(helper, &serialized[3], 1)) { // base_e000_wrt --> aux  LC mem
                 break;
             }
         } else {
@@ -1407,13 +1569,12 @@ bool vm_saveState(StateHelper_s *helper) {
 
 bool vm_loadState(StateHelper_s *helper) {
     bool loaded = false;
-    int fd = helper->fd;
 
     do {
 
         uint8_t serialized[4] = { 0 };
 
-        if (!helper->load(fd, serialized, sizeof(uint32_t))) {
+        if (!helper->load(helper, serialized, sizeof(uint32_t))) {
             break;
         }
         softswitches  = (uint32_t)(serialized[0] << 24);
@@ -1423,71 +1584,71 @@ bool vm_loadState(StateHelper_s *helper) {
         LOG("LOAD softswitches = %08x", softswitches);
 
         // load main/aux memory state
-        if (!helper->load(fd, apple_ii_64k[0], sizeof(apple_ii_64k))) {
+        if (!helper->load(helper, apple_ii_64k[0], sizeof(apple_ii_64k))) {
             break;
         }
 
         // load language card
-        if (!helper->load(fd, language_card[0], sizeof(language_card))) {
+        if (!helper->load(helper, language_card[0], sizeof(language_card))) {
             break;
         }
 
         // load language banks
-        if (!helper->load(fd, language_banks[0], sizeof(language_banks))) {
+        if (!helper->load(helper, language_banks[0], sizeof(language_banks))) {
             break;
         }
 
         // load offsets
         uint8_t state = 0x0;
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_ramrd = %d", state);
         base_ramrd = state == 0x0 ? apple_ii_64k[0] : apple_ii_64k[1];
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_ramwrt = %d", state);
         base_ramwrt = state == 0x0 ? apple_ii_64k[0] : apple_ii_64k[1];
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_textrd = %d", state);
         base_textrd = state == 0x0 ? apple_ii_64k[0] : apple_ii_64k[1];
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_textwrt = %d", state);
         base_textwrt = state == 0x0 ? apple_ii_64k[0] : apple_ii_64k[1];
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_hgrrd = %d", state);
         base_hgrrd = state == 0x0 ? apple_ii_64k[0] : apple_ii_64k[1];
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_hgrwrt = %d", state);
         base_hgrwrt = state == 0x0 ? apple_ii_64k[0] : apple_ii_64k[1];
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_stackzp = %d", state);
         base_stackzp = state == 0x0 ? apple_ii_64k[0] : apple_ii_64k[1];
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_c3rom = %d", state);
         base_c3rom = state == 0x0 ? apple_ii_64k[0] : apple_ii_64k[1];
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         LOG("LOAD base_cxrom = %d", state);
@@ -1507,7 +1668,7 @@ bool vm_loadState(StateHelper_s *helper) {
             base_c5rom = apple_ii_64k[1];
         }
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         switch (state) {
@@ -1533,7 +1694,7 @@ bool vm_loadState(StateHelper_s *helper) {
         }
         LOG("LOAD base_d000_rd = %d", state);
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         switch (state) {
@@ -1559,7 +1720,7 @@ bool vm_loadState(StateHelper_s *helper) {
         }
         LOG("LOAD base_d000_wrt = %d", state);
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         switch (state) {
@@ -1579,7 +1740,7 @@ bool vm_loadState(StateHelper_s *helper) {
         }
         LOG("LOAD base_e000_rd = %d", state);
 
-        if (!helper->load(fd, &state, 1)) {
+        if (!helper->load(helper, &state, 1)) {
             break;
         }
         switch (state) {
@@ -1602,6 +1763,8 @@ bool vm_loadState(StateHelper_s *helper) {
         loaded = true;
     } while (0);
 
+    cpu65_invalidate_blocks();
+
     return loaded;
 }
 
@@ -143,10 +143,19 @@ extern uint8_t *base_c4rom; // points to function or memory vector
 extern uint8_t *base_c5rom; // points to function or memory vector
 extern uint8_t *base_cxrom;
 
+// game controller buttons and paddles as seen by the machine, fed from the host joystick state (see replay.h)
+extern uint8_t gc_button_0;
+extern uint8_t gc_button_1;
+extern uint16_t gc_paddle_0;
+extern uint16_t gc_paddle_1;
+
 void vm_initialize(void);
 
 void vm_reinitializeAudio(void);
 
+// disconnect the speaker and the Mockingboard/Phasor of slots 4 & 5 from the current machine (see runahead.h)
+void vm_disconnectAudio(void);
+
 extern bool vm_saveState(StateHelper_s *helper);
 extern bool vm_loadState(StateHelper_s *helper);
 
@@ -83,6 +83,7 @@ ENTRY(func)             pushLQ  XY_Reg_X; \
                         pushLQ  AF_Reg_X; \
                         pushLQ  SP_Reg_X; \
                         pushLQ  PC_Reg_X; \
+                        movw    PC_Reg, SYM(cpu65_io_pc); \
                         pushLQ  _XAX; /* HACK: works around mysterious issue with generated mov(_XAX), _XAX ... */ \
                         pushLQ  EffectiveAddr_X; /* ea is arg0 (and preserved) */ \
                         callLQ  CALL(c_##func); \
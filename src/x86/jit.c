@@ -0,0 +1,1107 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+/*
+ * x86-64 dynamic recompiler for the portable C 65c02 core
+ *
+ * Hot basic blocks (see the block cache in cpu.c) are translated to straight-line native code.  Only the common
+ * subset of instructions is translated; a block is compiled up to its first unsupported instruction and exits back
+ * to cpu65_run() there.  Decimal mode ADC/SBC also exit back to the interpreter at runtime.
+ *
+ * Register usage of native blocks :
+ *
+ *      %rbx : &jit65_state
+ *      %r12d : A
+ *      %r13d : X
+ *      %r14d : Y
+ *      %r15d : flags (6502 bit order, same as the C core)
+ *      %ebp : extra cycles of the completed instructions of the block
+ *
+ * Registers hold zero-extended 8-bit values.  The scratch registers (%rax, %rcx, %rdx, %rsi, %rdi) are clobbered by
+ * the c_jit65_read()/c_jit65_write() callouts.
+ */
+
+#include "common.h"
+
+#if CPU_JIT
+
+#include "x86/jit.h"
+#include <stddef.h>
+#include <sys/mman.h>
+
+#define JIT_CODE_SIZE (4 * 1024 * 1024)
+#define JIT_MAX_INSNS 32 // at least BLOCK_MAX_INSNS of the block cache
+#define JIT_BLOCK_RESERVE (16 * 1024) // more than the native code of any block
+
+extern uint8_t cpu65__opcycles[256];
+
+// per-machine code buffer (native code embeds the addresses of the machine state it was compiled for)
+#define jit_code (current_machine->jit_code)            // executable code buffer
+#define jit_ptr (current_machine->jit_ptr)              // emit cursor
+#define jit_blocks (current_machine->jit_blocks)        // start of block code (past the entry/exit trampolines)
+#define jit_exit (current_machine->jit_exit)
+#define jit_enter (current_machine->jit_enter)
+#define jit_code_pages (current_machine->jit_code_pages)
+
+/* -------------------------------------------------------------------------
+    Instruction selection
+   ------------------------------------------------------------------------- */
+
+enum {
+    M_IMP = 1,  // implied/accumulator
+    M_IMM,
+    M_ZP,
+    M_ZPX,
+    M_ZPY,
+    M_ABS,
+    M_ABSX,     // +1 cycle on page boundary
+    M_ABSY,     // +1 cycle on page boundary
+    M_ABSX_ST,
+    M_ABSY_ST,
+    M_IND,
+    M_INDX,
+    M_INDY,     // +1 cycle on page boundary
+    M_INDY_ST,
+    M_REL,
+};
+
+enum {
+    J_LDA = 1, J_LDX, J_LDY, J_STA, J_STX, J_STY, J_STZ,
+    J_ADC, J_SBC, J_AND, J_ORA, J_EOR, J_CMP, J_CPX, J_CPY, J_BIT,
+    J_ASL, J_LSR, J_ROL, J_ROR, J_INC, J_DEC, J_TSB, J_TRB,
+    J_BPL, J_BMI, J_BVC, J_BVS, J_BCC, J_BCS, J_BNE, J_BEQ, J_BRA,
+    J_JMP, J_JSR, J_RTS,
+    J_PHA, J_PHX, J_PHY, J_PHP, J_PLA, J_PLX, J_PLY,
+    J_TAX, J_TAY, J_TXA, J_TYA, J_TSX, J_TXS,
+    J_INX, J_INY, J_DEX, J_DEY,
+    J_CLC, J_SEC, J_CLD, J_SED, J_CLV, J_SEI, J_NOP,
+};
+
+#define OP(op, mode) (((J_ ## op) << 8) | (M_ ## mode))
+
+static const uint16_t jit_ops[256] = {
+    [0x01] = OP(ORA, INDX), [0x04] = OP(TSB, ZP),   [0x05] = OP(ORA, ZP),   [0x06] = OP(ASL, ZP),
+    [0x08] = OP(PHP, IMP),  [0x09] = OP(ORA, IMM),  [0x0A] = OP(ASL, IMP),  [0x0C] = OP(TSB, ABS),
+    [0x0D] = OP(ORA, ABS),  [0x0E] = OP(ASL, ABS),
+    [0x10] = OP(BPL, REL),  [0x11] = OP(ORA, INDY), [0x12] = OP(ORA, IND),  [0x14] = OP(TRB, ZP),
+    [0x15] = OP(ORA, ZPX),  [0x16] = OP(ASL, ZPX),  [0x18] = OP(CLC, IMP),  [0x19] = OP(ORA, ABSY),
+    [0x1A] = OP(INC, IMP),  [0x1C] = OP(TRB, ABS),  [0x1D] = OP(ORA, ABSX), [0x1E] = OP(ASL, ABSX),
+    [0x20] = OP(JSR, ABS),  [0x21] = OP(AND, INDX), [0x24] = OP(BIT, ZP),   [0x25] = OP(AND, ZP),
+    [0x26] = OP(ROL, ZP),   [0x29] = OP(AND, IMM),  [0x2A] = OP(ROL, IMP),  [0x2C] = OP(BIT, ABS),
+    [0x2D] = OP(AND, ABS),  [0x2E] = OP(ROL, ABS),
+    [0x30] = OP(BMI, REL),  [0x31] = OP(AND, INDY), [0x32] = OP(AND, IND),  [0x34] = OP(BIT, ZPX),
+    [0x35] = OP(AND, ZPX),  [0x36] = OP(ROL, ZPX),  [0x38] = OP(SEC, IMP),  [0x39] = OP(AND, ABSY),
+    [0x3A] = OP(DEC, IMP),  [0x3C] = OP(BIT, ABSX), [0x3D] = OP(AND, ABSX), [0x3E] = OP(ROL, ABSX),
+    [0x41] = OP(EOR, INDX), [0x45] = OP(EOR, ZP),   [0x46] = OP(LSR, ZP),   [0x48] = OP(PHA, IMP),
+    [0x49] = OP(EOR, IMM),  [0x4A] = OP(LSR, IMP),  [0x4C] = OP(JMP, ABS),  [0x4D] = OP(EOR, ABS),
+    [0x4E] = OP(LSR, ABS),
+    [0x50] = OP(BVC, REL),  [0x51] = OP(EOR, INDY), [0x52] = OP(EOR, IND),  [0x55] = OP(EOR, ZPX),
+    [0x56] = OP(LSR, ZPX),  [0x59] = OP(EOR, ABSY), [0x5A] = OP(PHY, IMP),  [0x5D] = OP(EOR, ABSX),
+    [0x5E] = OP(LSR, ABSX),
+    [0x60] = OP(RTS, IMP),  [0x61] = OP(ADC, INDX), [0x64] = OP(STZ, ZP),   [0x65] = OP(ADC, ZP),
+    [0x66] = OP(ROR, ZP),   [0x68] = OP(PLA, IMP),  [0x69] = OP(ADC, IMM),  [0x6A] = OP(ROR, IMP),
+    [0x6D] = OP(ADC, ABS),  [0x6E] = OP(ROR, ABS),
+    [0x70] = OP(BVS, REL),  [0x71] = OP(ADC, INDY), [0x72] = OP(ADC, IND),  [0x74] = OP(STZ, ZPX),
+    [0x75] = OP(ADC, ZPX),  [0x76] = OP(ROR, ZPX),  [0x78] = OP(SEI, IMP),  [0x79] = OP(ADC, ABSY),
+    [0x7A] = OP(PLY, IMP),  [0x7D] = OP(ADC, ABSX), [0x7E] = OP(ROR, ABSX),
+    [0x80] = OP(BRA, REL),  [0x81] = OP(STA, INDX), [0x84] = OP(STY, ZP),   [0x85] = OP(STA, ZP),
+    [0x86] = OP(STX, ZP),   [0x88] = OP(DEY, IMP),  [0x89] = OP(BIT, IMM),  [0x8A] = OP(TXA, IMP),
+    [0x8C] = OP(STY, ABS),  [0x8D] = OP(STA, ABS),  [0x8E] = OP(STX, ABS),
+    [0x90] = OP(BCC, REL),  [0x91] = OP(STA, INDY_ST), [0x92] = OP(STA, IND), [0x94] = OP(STY, ZPX),
+    [0x95] = OP(STA, ZPX),  [0x96] = OP(STX, ZPY),  [0x98] = OP(TYA, IMP),  [0x99] = OP(STA, ABSY_ST),
+    [0x9A] = OP(TXS, IMP),  [0x9C] = OP(STZ, ABS),  [0x9D] = OP(STA, ABSX_ST), [0x9E] = OP(STZ, ABSX_ST),
+    [0xA0] = OP(LDY, IMM),  [0xA1] = OP(LDA, INDX), [0xA2] = OP(LDX, IMM),  [0xA4] = OP(LDY, ZP),
+    [0xA5] = OP(LDA, ZP),   [0xA6] = OP(LDX, ZP),   [0xA8] = OP(TAY, IMP),  [0xA9] = OP(LDA, IMM),
+    [0xAA] = OP(TAX, IMP),  [0xAC] = OP(LDY, ABS),  [0xAD] = OP(LDA, ABS),  [0xAE] = OP(LDX, ABS),
+    [0xB0] = OP(BCS, REL),  [0xB1] = OP(LDA, INDY), [0xB2] = OP(LDA, IND),  [0xB4] = OP(LDY, ZPX),
+    [0xB5] = OP(LDA, ZPX),  [0xB6] = OP(LDX, ZPY),  [0xB8] = OP(CLV, IMP),  [0xB9] = OP(LDA, ABSY),
+    [0xBA] = OP(TSX, IMP),  [0xBC] = OP(LDY, ABSX), [0xBD] = OP(LDA, ABSX), [0xBE] = OP(LDX, ABSY),
+    [0xC0] = OP(CPY, IMM),  [0xC1] = OP(CMP, INDX), [0xC4] = OP(CPY, ZP),   [0xC5] = OP(CMP, ZP),
+    [0xC6] = OP(DEC, ZP),   [0xC8] = OP(INY, IMP),  [0xC9] = OP(CMP, IMM),  [0xCA] = OP(DEX, IMP),
+    [0xCC] = OP(CPY, ABS),  [0xCD] = OP(CMP, ABS),  [0xCE] = OP(DEC, ABS),
+    [0xD0] = OP(BNE, REL),  [0xD1] = OP(CMP, INDY), [0xD2] = OP(CMP, IND),  [0xD5] = OP(CMP, ZPX),
+    [0xD6] = OP(DEC, ZPX),  [0xD8] = OP(CLD, IMP),  [0xD9] = OP(CMP, ABSY), [0xDA] = OP(PHX, IMP),
+    [0xDD] = OP(CMP, ABSX), [0xDE] = OP(DEC, ABSX),
+    [0xE0] = OP(CPX, IMM),  [0xE1] = OP(SBC, INDX), [0xE4] = OP(CPX, ZP),   [0xE5] = OP(SBC, ZP),
+    [0xE6] = OP(INC, ZP),   [0xE8] = OP(INX, IMP),  [0xE9] = OP(SBC, IMM),  [0xEA] = OP(NOP, IMP),
+    [0xEC] = OP(CPX, ABS),  [0xED] = OP(SBC, ABS),  [0xEE] = OP(INC, ABS),
+    [0xF0] = OP(BEQ, REL),  [0xF1] = OP(SBC, INDY), [0xF2] = OP(SBC, IND),  [0xF5] = OP(SBC, ZPX),
+    [0xF6] = OP(INC, ZPX),  [0xF8] = OP(SED, IMP),  [0xF9] = OP(SBC, ABSY), [0xFA] = OP(PLX, IMP),
+    [0xFD] = OP(SBC, ABSX), [0xFE] = OP(INC, ABSX),
+};
+
+#undef OP
+
+typedef struct jit_insn_t {
+    unsigned int index;
+    uint16_t addr;      // address of the opcode
+    uint16_t next;      // address of the following instruction
+    uint16_t operand;
+    uint16_t ea;        // effective address when not computed at runtime
+    uint16_t cycles;    // base cycles of the preceding instructions in the block
+    uint8_t opcode;
+    uint8_t op;
+    uint8_t mode;
+    uint8_t rw;         // cpu65_rw so far
+    bool extra;         // may take an extra cycle (stored in jit65_state.opx)
+    bool dynamic_ea;    // ea stored in jit65_state.ea by native code
+    bool io;            // may call out to an I/O handler (check jit65_state.brk after the instruction)
+} jit_insn_t;
+
+/* -------------------------------------------------------------------------
+    x86-64 encoding
+   ------------------------------------------------------------------------- */
+
+enum { RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15, NOREG = -1 };
+
+#define REG_ST RBX
+#define REG_A  R12
+#define REG_X  R13
+#define REG_Y  R14
+#define REG_F  R15
+#define REG_XC RBP
+
+// group 1 opcode extensions (0x81 /ext) and matching "op r/m32, r32" opcodes
+#define ALU_ADD 0
+#define ALU_OR  1
+#define ALU_AND 4
+#define ALU_SUB 5
+#define ALU_XOR 6
+#define ALU_CMP 7
+#define ALU_RR(ext) (((ext) << 3) | 0x1)
+
+#define SHIFT_SHL 4
+#define SHIFT_SHR 5
+
+#define CC_E  0x4
+#define CC_NE 0x5
+#define CC_AE 0x3
+
+#define OP_W    0x1 // REX.W
+#define OP_BYTE 0x2 // byte register operand : always emit REX to address %sil/%dil/%bpl
+
+#define ST(field) ((int32_t)offsetof(jit65_state_t, field))
+
+static inline void _e8(uint8_t v) {
+    *jit_ptr++ = v;
+}
+
+static inline void _e32(uint32_t v) {
+    memcpy(jit_ptr, &v, sizeof(v));
+    jit_ptr += sizeof(v);
+}
+
+static inline void _e64(uint64_t v) {
+    memcpy(jit_ptr, &v, sizeof(v));
+    jit_ptr += sizeof(v);
+}
+
+static void _rex(int flags, int reg, int index, int base) {
+    uint8_t rex = 0x40;
+    if (flags & OP_W) {
+        rex |= 0x08;
+    }
+    if (reg > 7) {
+        rex |= 0x04;
+    }
+    if (index > 7) {
+        rex |= 0x02;
+    }
+    if (base > 7) {
+        rex |= 0x01;
+    }
+    if (rex != 0x40 || (flags & OP_BYTE)) {
+        _e8(rex);
+    }
+}
+
+static void _opcode(int op) {
+    if (op > 0xFF) {
+        _e8(op >> 8);
+    }
+    _e8(op & 0xFF);
+}
+
+// op reg, rm (register direct)
+static void _rr(int op, int flags, int reg, int rm) {
+    _rex(flags, reg, NOREG, rm);
+    _opcode(op);
+    _e8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// op reg, [base + index*(1<<scale) + disp32]
+static void _rm(int op, int flags, int reg, int base, int index, int scale, int32_t disp) {
+    _rex(flags, reg, index, base);
+    _opcode(op);
+    _e8(0x84 | ((reg & 7) << 3)); // mod=10 (disp32) rm=100 (SIB)
+    _e8((scale << 6) | ((((index == NOREG) ? RSP : index) & 7) << 3) | (base & 7));
+    _e32((uint32_t)disp);
+}
+
+static void _mov_rr(int dst, int src) {
+    _rr(0x89, 0, src, dst);
+}
+
+static void _alu_rr(int ext, int dst, int src) {
+    _rr(ALU_RR(ext), 0, src, dst);
+}
+
+static void _alu_ri(int ext, int dst, uint32_t imm) {
+    _rr(0x81, 0, ext, dst);
+    _e32(imm);
+}
+
+static void _test_rr(int dst, int src) {
+    _rr(0x85, 0, src, dst);
+}
+
+static void _test64_rr(int dst, int src) {
+    _rr(0x85, OP_W, src, dst);
+}
+
+static void _test_ri(int dst, uint32_t imm) {
+    _rr(0xF7, 0, 0, dst);
+    _e32(imm);
+}
+
+static void _not_r(int dst) {
+    _rr(0xF7, 0, 2, dst);
+}
+
+static void _shift_ri(int ext, int dst, uint8_t n) {
+    _rr(0xC1, 0, ext, dst);
+    _e8(n);
+}
+
+static void _movzx8_rr(int dst, int src) {
+    _rr(0x0FB6, OP_BYTE, dst, src);
+}
+
+static void _movzx16_rr(int dst, int src) {
+    _rr(0x0FB7, 0, dst, src);
+}
+
+static void _setcc(int cc, int dst) {
+    _rr(0x0F90 | cc, OP_BYTE, 0, dst);
+}
+
+static void _mov_ri(int dst, uint32_t imm) {
+    _rex(0, NOREG, NOREG, dst);
+    _e8(0xB8 | (dst & 7));
+    _e32(imm);
+}
+
+static void _mov_ri64(int dst, const void *p) {
+    _rex(OP_W, NOREG, NOREG, dst);
+    _e8(0xB8 | (dst & 7));
+    _e64((uintptr_t)p);
+}
+
+static void _load8(int dst, int base, int index, int32_t disp) {
+    _rm(0x0FB6, 0, dst, base, index, 0, disp);
+}
+
+static void _load32(int dst, int base, int32_t disp) {
+    _rm(0x8B, 0, dst, base, NOREG, 0, disp);
+}
+
+static void _load64(int dst, int base, int index, int scale, int32_t disp) {
+    _rm(0x8B, OP_W, dst, base, index, scale, disp);
+}
+
+static void _store8(int src, int base, int index, int32_t disp) {
+    _rm(0x88, OP_BYTE, src, base, index, 0, disp);
+}
+
+static void _store32(int src, int base, int32_t disp) {
+    _rm(0x89, 0, src, base, NOREG, 0, disp);
+}
+
+static void _store8i(uint8_t imm, int base, int index, int32_t disp) {
+    _rm(0xC6, 0, 0, base, index, 0, disp);
+    _e8(imm);
+}
+
+static void _store32i(uint32_t imm, int base, int32_t disp) {
+    _rm(0xC7, 0, 0, base, NOREG, 0, disp);
+    _e32(imm);
+}
+
+static void _alu8_mi(int ext, uint8_t imm, int base, int index, int32_t disp) {
+    _rm(0x80, 0, ext, base, index, 0, disp);
+    _e8(imm);
+}
+
+static void _alu_rm(int ext, int dst, int base, int32_t disp) {
+    _rm(ALU_RR(ext) | 0x2, 0, dst, base, NOREG, 0, disp);
+}
+
+static void _push(int reg) {
+    _rex(0, NOREG, NOREG, reg);
+    _e8(0x50 | (reg & 7));
+}
+
+static void _pop(int reg) {
+    _rex(0, NOREG, NOREG, reg);
+    _e8(0x58 | (reg & 7));
+}
+
+// returns the end of the jump for _patch()
+static uint8_t *_jcc(int cc) {
+    _e8(0x0F);
+    _e8(0x80 | cc);
+    _e32(0);
+    return jit_ptr;
+}
+
+static uint8_t *_jmp(void) {
+    _e8(0xE9);
+    _e32(0);
+    return jit_ptr;
+}
+
+static void _patch(uint8_t *jump, const uint8_t *target) {
+    int32_t rel = (int32_t)(target - jump);
+    memcpy(jump - sizeof(rel), &rel, sizeof(rel));
+}
+
+static void _call(const void *fn) {
+    _mov_ri64(RAX, fn);
+    _rr(0xFF, 0, 2, RAX);
+}
+
+/* -------------------------------------------------------------------------
+    65c02 building blocks
+   ------------------------------------------------------------------------- */
+
+// f = (f & ~(N_Flag|Z_Flag)) | nz[reg]
+static void _emit_nz(int reg) {
+    _alu_ri(ALU_AND, REG_F, (uint8_t)~(N_Flag|Z_Flag));
+    _load8(RCX, REG_ST, reg, ST(nz));
+    _alu_rr(ALU_OR, REG_F, RCX);
+}
+
+// f = (f & ~Z_Flag) | ((reg1 & reg2) ? 0 : Z_Flag)
+static void _emit_z_and(int reg1, int reg2) {
+    _test_rr(reg1, reg2);
+    _setcc(CC_E, RCX);
+    _movzx8_rr(RCX, RCX);
+    _shift_ri(SHIFT_SHL, RCX, 1); // Z_Flag
+    _alu_ri(ALU_AND, REG_F, (uint8_t)~Z_Flag);
+    _alu_rr(ALU_OR, REG_F, RCX);
+}
+
+// leave the block after instruction done (NULL : before the first instruction) resuming at pc (or pc_reg)
+static void _emit_exit(const jit_insn_t *done, int pc_reg, uint16_t pc, int opcycles, bool side_exit) {
+    if (done) {
+        _store32i(done->index, REG_ST, ST(last));
+        if (opcycles >= 0) {
+            _store32i(opcycles, REG_ST, ST(opcycles));
+        } else if (done->extra) {
+            _load32(RCX, REG_ST, ST(opx));
+            _store32(RCX, REG_ST, ST(opcycles));
+        } else {
+            _store32i(0, REG_ST, ST(opcycles));
+        }
+        _store8i(done->rw, REG_ST, NOREG, ST(rw));
+        if (!done->dynamic_ea) {
+            _store32i(done->ea, REG_ST, ST(ea));
+        }
+    } else {
+        _store32i((uint32_t)-1, REG_ST, ST(last));
+    }
+    if (pc_reg != NOREG) {
+        _store32(pc_reg, REG_ST, ST(pc));
+    } else {
+        _store32i(pc, REG_ST, ST(pc));
+    }
+    _store8i(side_exit, REG_ST, NOREG, ST(side_exit));
+    uint8_t *jump = _jmp();
+    _patch(jump, jit_exit);
+}
+
+// record the current instruction for a callout to the C core
+static void _emit_callout(jit_insn_t *in, const void *fn) {
+    _store32i(in->cycles | (in->opcode << 16) | (in->rw << 24), REG_ST, ST(cur));
+    _store32i(in->next, REG_ST, ST(pc));
+    _store32(REG_XC, REG_ST, ST(xcycles));
+    _rr(0x89, OP_W, REG_ST, RDI); // mov %rbx, %rdi
+    _call(fn);
+    in->io = true;
+}
+
+// %eax = memory[%esi], page is the page of the address when known at compile time (-1 otherwise)
+static void _emit_read(jit_insn_t *in, int page) {
+    uint8_t *slow = NULL;
+    uint8_t *done = NULL;
+
+    if (page >= 0) {
+        uint8_t **bank = cpu65_vmem_rpage[page];
+        if (bank) {
+            _mov_ri64(RAX, bank);
+            _load64(RAX, RAX, NOREG, 0, 0);
+            _load8(RAX, RAX, RSI, 0);
+            in->rw |= MEM_READ_FLAG;
+            return;
+        }
+    } else {
+        _mov_rr(RCX, RSI);
+        _shift_ri(SHIFT_SHR, RCX, 8);
+        _mov_ri64(RAX, cpu65_vmem_rpage);
+        _load64(RAX, RAX, RCX, 3, 0);
+        _test64_rr(RAX, RAX);
+        slow = _jcc(CC_E);
+        _load64(RAX, RAX, NOREG, 0, 0);
+        _load8(RAX, RAX, RSI, 0);
+        done = _jmp();
+        _patch(slow, jit_ptr);
+    }
+
+    _emit_callout(in, c_jit65_read);
+    _movzx8_rr(RAX, RAX);
+    if (done) {
+        _patch(done, jit_ptr);
+    }
+    in->rw |= MEM_READ_FLAG;
+}
+
+// memory[%esi] = %dl, page is the page of the address when known at compile time (-1 otherwise)
+static void _emit_write(jit_insn_t *in, int page) {
+    uint8_t *slow[3] = { NULL, NULL, NULL };
+    uint8_t *done = NULL;
+
+    _store8(RDX, REG_ST, NOREG, ST(d));
+
+    if (page >= 0) {
+        uint8_t **bank = cpu65_vmem_wpage[page];
+        if (bank) {
+            if (page > 0x01) { // NOTE : no code is decoded from zpage/stack
+                _mov_ri64(RAX, &jit_code_pages[page]);
+                _alu8_mi(ALU_CMP, 0, RAX, NOREG, 0);
+                slow[0] = _jcc(CC_NE);
+            }
+            _mov_ri64(RAX, bank);
+            _load64(RAX, RAX, NOREG, 0, 0);
+            _test64_rr(RAX, RAX);
+            slow[1] = _jcc(CC_E);
+            _store8(RDX, RAX, RSI, 0);
+            done = _jmp();
+        }
+    } else {
+        _mov_rr(RCX, RSI);
+        _shift_ri(SHIFT_SHR, RCX, 8);
+        _mov_ri64(RAX, jit_code_pages);
+        _alu8_mi(ALU_CMP, 0, RAX, RCX, 0);
+        slow[0] = _jcc(CC_NE);
+        _mov_ri64(RAX, cpu65_vmem_wpage);
+        _load64(RAX, RAX, RCX, 3, 0);
+        _test64_rr(RAX, RAX);
+        slow[1] = _jcc(CC_E);
+        _load64(RAX, RAX, NOREG, 0, 0);
+        _test64_rr(RAX, RAX);
+        slow[2] = _jcc(CC_E);
+        _store8(RDX, RAX, RSI, 0);
+        done = _jmp();
+    }
+
+    for (unsigned int i = 0; i < 3; i++) {
+        if (slow[i]) {
+            _patch(slow[i], jit_ptr);
+        }
+    }
+    _emit_callout(in, c_jit65_write);
+    if (done) {
+        _patch(done, jit_ptr);
+    }
+    in->rw |= MEM_WRITE_FLAG;
+}
+
+// %ecx = ((uint8_t)base + index) >> 8 : the page boundary extra cycle
+static void _emit_page_cross(int base, int index) {
+    _movzx8_rr(RCX, base);
+    _alu_rr(ALU_ADD, RCX, index);
+    _shift_ri(SHIFT_SHR, RCX, 8);
+    _store32(RCX, REG_ST, ST(opx));
+}
+
+// %eax = word at zpage[%esi] (wrapping in the zpage)
+static void _emit_read_zpage_word(jit_insn_t *in) {
+    _store32(RSI, REG_ST, ST(tmp));
+    _alu_ri(ALU_ADD, RSI, 1);
+    _movzx8_rr(RSI, RSI);
+    _emit_read(in, 0); // high byte first, as the interpreter does
+    _load32(RSI, REG_ST, ST(tmp));
+    _store32(RAX, REG_ST, ST(tmp));
+    _emit_read(in, 0);
+    _load32(RCX, REG_ST, ST(tmp));
+    _shift_ri(SHIFT_SHL, RCX, 8);
+    _alu_rr(ALU_OR, RAX, RCX);
+}
+
+/* %esi = effective address of a memory operand (also stored in jit65_state.ea).  Returns the page of the address
+   when known at compile time, -1 otherwise */
+static int _emit_ea(jit_insn_t *in) {
+    int page = -1;
+    const uint8_t zp = (uint8_t)in->operand;
+
+    switch (in->mode) {
+        case M_ZP:
+            _mov_ri(RSI, zp);
+            page = 0;
+            break;
+
+        case M_ZPX:
+        case M_ZPY:
+            _mov_rr(RSI, (in->mode == M_ZPX) ? REG_X : REG_Y);
+            _alu_ri(ALU_ADD, RSI, zp);
+            _movzx8_rr(RSI, RSI);
+            page = 0;
+            break;
+
+        case M_ABS:
+            _mov_ri(RSI, in->operand);
+            page = in->operand >> 8;
+            break;
+
+        case M_ABSX:
+        case M_ABSY:
+        case M_ABSX_ST:
+        case M_ABSY_ST:
+        {
+            const int index = (in->mode == M_ABSX || in->mode == M_ABSX_ST) ? REG_X : REG_Y;
+            _mov_ri(RSI, in->operand);
+            if (in->extra) {
+                _emit_page_cross(RSI, index);
+            }
+            _alu_rr(ALU_ADD, RSI, index);
+            _movzx16_rr(RSI, RSI);
+            break;
+        }
+
+        case M_IND:
+        case M_INDX:
+        case M_INDY:
+        case M_INDY_ST:
+            if (in->mode == M_INDX) {
+                _mov_rr(RSI, REG_X);
+                _alu_ri(ALU_ADD, RSI, zp);
+                _movzx8_rr(RSI, RSI);
+            } else {
+                _mov_ri(RSI, zp);
+            }
+            _emit_read_zpage_word(in);
+            _mov_rr(RSI, RAX);
+            if (in->mode == M_INDY || in->mode == M_INDY_ST) {
+                if (in->extra) {
+                    _emit_page_cross(RSI, REG_Y);
+                }
+                _alu_rr(ALU_ADD, RSI, REG_Y);
+                _movzx16_rr(RSI, RSI);
+            }
+            break;
+
+        default:
+            assert(false);
+            break;
+    }
+
+    _store32(RSI, REG_ST, ST(ea));
+    return page;
+}
+
+// %eax = operand value
+static void _emit_operand(jit_insn_t *in) {
+    if (in->mode == M_IMM) {
+        _mov_ri(RAX, (uint8_t)in->operand);
+        in->rw |= MEM_READ_FLAG;
+        return;
+    }
+    _emit_read(in, _emit_ea(in));
+}
+
+// ASL/LSR/ROL/ROR/INC/DEC of %eax
+static void _emit_rmw_op(jit_insn_t *in) {
+    switch (in->op) {
+        case J_ASL:
+        case J_ROL:
+            _mov_rr(RDX, RAX);
+            _shift_ri(SHIFT_SHR, RDX, 7);
+            _shift_ri(SHIFT_SHL, RAX, 1);
+            if (in->op == J_ROL) {
+                _mov_rr(RCX, REG_F);
+                _alu_ri(ALU_AND, RCX, C_Flag);
+                _alu_rr(ALU_OR, RAX, RCX);
+            }
+            _movzx8_rr(RAX, RAX);
+            break;
+
+        case J_LSR:
+        case J_ROR:
+            _mov_rr(RDX, RAX);
+            _alu_ri(ALU_AND, RDX, 0x01);
+            _shift_ri(SHIFT_SHR, RAX, 1);
+            if (in->op == J_ROR) {
+                _mov_rr(RCX, REG_F);
+                _alu_ri(ALU_AND, RCX, C_Flag);
+                _shift_ri(SHIFT_SHL, RCX, 7);
+                _alu_rr(ALU_OR, RAX, RCX);
+            }
+            break;
+
+        case J_INC:
+        case J_DEC:
+            _alu_ri((in->op == J_INC) ? ALU_ADD : ALU_SUB, RAX, 1);
+            _movzx8_rr(RAX, RAX);
+            _emit_nz(RAX);
+            return;
+
+        default:
+            assert(false);
+            break;
+    }
+
+    // carry in %edx
+    _alu_ri(ALU_AND, REG_F, (uint8_t)~(N_Flag|Z_Flag|C_Flag));
+    _alu_rr(ALU_OR, REG_F, RDX);
+    _load8(RCX, REG_ST, RAX, ST(nz));
+    _alu_rr(ALU_OR, REG_F, RCX);
+}
+
+static void _emit_push(int reg) {
+    _mov_ri64(RAX, &base_stackzp);
+    _load64(RAX, RAX, NOREG, 0, 0);
+    _load8(RCX, REG_ST, NOREG, ST(sp));
+    _store8(reg, RAX, RCX, 0x100);
+    _alu8_mi(ALU_SUB, 1, REG_ST, NOREG, ST(sp));
+}
+
+static void _emit_pop(int reg) {
+    _alu8_mi(ALU_ADD, 1, REG_ST, NOREG, ST(sp));
+    _mov_ri64(RAX, &base_stackzp);
+    _load64(RAX, RAX, NOREG, 0, 0);
+    _load8(RCX, REG_ST, NOREG, ST(sp));
+    _load8(reg, RAX, RCX, 0x100);
+}
+
+// branch, jump and return instructions end the block
+static void _emit_block_end(jit_insn_t *in) {
+    uint8_t flag = 0;
+    bool set = false;
+
+    switch (in->op) {
+        case J_JMP:
+            _emit_exit(in, NOREG, in->operand, -1, false);
+            return;
+
+        case J_JSR:
+        {
+            const uint16_t w = in->next - 1;
+            _mov_ri(RDX, w >> 8);
+            _emit_push(RDX);
+            _mov_ri(RDX, w & 0xFF);
+            _emit_push(RDX);
+            _emit_exit(in, NOREG, in->operand, -1, false);
+            return;
+        }
+
+        case J_RTS:
+            _emit_pop(RDX);
+            _store32(RDX, REG_ST, ST(tmp));
+            _emit_pop(RAX);
+            _shift_ri(SHIFT_SHL, RAX, 8);
+            _alu_rm(ALU_OR, RAX, REG_ST, ST(tmp));
+            _alu_ri(ALU_ADD, RAX, 1);
+            _movzx16_rr(RAX, RAX);
+            _emit_exit(in, RAX, 0, -1, false);
+            return;
+
+        case J_BPL: flag = N_Flag; set = false; break;
+        case J_BMI: flag = N_Flag; set = true; break;
+        case J_BVC: flag = V_Flag; set = false; break;
+        case J_BVS: flag = V_Flag; set = true; break;
+        case J_BCC: flag = C_Flag; set = false; break;
+        case J_BCS: flag = C_Flag; set = true; break;
+        case J_BNE: flag = Z_Flag; set = false; break;
+        case J_BEQ: flag = Z_Flag; set = true; break;
+        case J_BRA: break;
+
+        default:
+            assert(false);
+            return;
+    }
+
+    const uint16_t target = in->next + (int8_t)in->operand;
+    const int taken_cycles = ((target ^ in->next) & 0xFF00) ? 2 : 1;
+
+    if (flag) {
+        _test_ri(REG_F, flag);
+        uint8_t *taken = _jcc(set ? CC_NE : CC_E);
+        _emit_exit(in, NOREG, in->next, 0, false);
+        _patch(taken, jit_ptr);
+    }
+    _alu_ri(ALU_ADD, REG_XC, taken_cycles);
+    _emit_exit(in, NOREG, target, taken_cycles, false);
+}
+
+static void _emit_insn(jit_insn_t *in, const jit_insn_t *prev) {
+    switch (in->op) {
+        case J_LDA:
+        case J_LDX:
+        case J_LDY:
+        {
+            const int reg = (in->op == J_LDA) ? REG_A : (in->op == J_LDX) ? REG_X : REG_Y;
+            _emit_operand(in);
+            _mov_rr(reg, RAX);
+            _emit_nz(reg);
+            break;
+        }
+
+        case J_STA:
+        case J_STX:
+        case J_STY:
+        case J_STZ:
+        {
+            const int page = _emit_ea(in);
+            if (in->op == J_STZ) {
+                _alu_rr(ALU_XOR, RDX, RDX);
+            } else {
+                _mov_rr(RDX, (in->op == J_STA) ? REG_A : (in->op == J_STX) ? REG_X : REG_Y);
+            }
+            _emit_write(in, page);
+            break;
+        }
+
+        case J_ADC:
+        case J_SBC:
+        {
+            // decimal mode is left to the interpreter
+            _test_ri(REG_F, D_Flag);
+            uint8_t *binary = _jcc(CC_E);
+            _emit_exit(prev, NOREG, in->addr, -1, true);
+            _patch(binary, jit_ptr);
+
+            _emit_operand(in);
+            if (in->op == J_SBC) {
+                _alu_ri(ALU_XOR, RAX, 0xFF);
+            }
+            // w = a + v + carry
+            _mov_rr(RDX, REG_F);
+            _alu_ri(ALU_AND, RDX, C_Flag);
+            _alu_rr(ALU_ADD, RDX, REG_A);
+            _alu_rr(ALU_ADD, RDX, RAX);
+            // overflow = ~(a ^ v) & (a ^ w) & 0x80
+            _mov_rr(RCX, REG_A);
+            _alu_rr(ALU_XOR, RCX, RAX);
+            _not_r(RCX);
+            _mov_rr(RSI, REG_A);
+            _alu_rr(ALU_XOR, RSI, RDX);
+            _alu_rr(ALU_AND, RCX, RSI);
+            _alu_ri(ALU_AND, RCX, 0x80);
+            _shift_ri(SHIFT_SHR, RCX, 1); // V_Flag
+            _alu_ri(ALU_AND, REG_F, (uint8_t)~(N_Flag|V_Flag|Z_Flag|C_Flag));
+            _alu_rr(ALU_OR, REG_F, RCX);
+            _mov_rr(RCX, RDX);
+            _shift_ri(SHIFT_SHR, RCX, 8); // C_Flag
+            _alu_ri(ALU_AND, RCX, C_Flag);
+            _alu_rr(ALU_OR, REG_F, RCX);
+            _movzx8_rr(REG_A, RDX);
+            _load8(RCX, REG_ST, REG_A, ST(nz));
+            _alu_rr(ALU_OR, REG_F, RCX);
+            break;
+        }
+
+        case J_AND:
+        case J_ORA:
+        case J_EOR:
+            _emit_operand(in);
+            _alu_rr((in->op == J_AND) ? ALU_AND : (in->op == J_ORA) ? ALU_OR : ALU_XOR, REG_A, RAX);
+            _emit_nz(REG_A);
+            break;
+
+        case J_CMP:
+        case J_CPX:
+        case J_CPY:
+        {
+            const int reg = (in->op == J_CMP) ? REG_A : (in->op == J_CPX) ? REG_X : REG_Y;
+            _emit_operand(in);
+            _alu_rr(ALU_XOR, RDX, RDX);
+            _alu_rr(ALU_CMP, reg, RAX);
+            _setcc(CC_AE, RDX); // C_Flag
+            _mov_rr(RCX, reg);
+            _alu_rr(ALU_SUB, RCX, RAX);
+            _movzx8_rr(RCX, RCX);
+            _alu_ri(ALU_AND, REG_F, (uint8_t)~(N_Flag|Z_Flag|C_Flag));
+            _alu_rr(ALU_OR, REG_F, RDX);
+            _load8(RCX, REG_ST, RCX, ST(nz));
+            _alu_rr(ALU_OR, REG_F, RCX);
+            break;
+        }
+
+        case J_BIT:
+            _emit_operand(in);
+            if (in->mode != M_IMM) {
+                _mov_rr(RCX, RAX);
+                _alu_ri(ALU_AND, RCX, N_Flag|V_Flag);
+                _alu_ri(ALU_AND, REG_F, (uint8_t)~(N_Flag|V_Flag));
+                _alu_rr(ALU_OR, REG_F, RCX);
+            }
+            _emit_z_and(REG_A, RAX);
+            break;
+
+        case J_ASL:
+        case J_LSR:
+        case J_ROL:
+        case J_ROR:
+        case J_INC:
+        case J_DEC:
+            if (in->mode == M_IMP) {
+                _mov_rr(RAX, REG_A);
+                _emit_rmw_op(in);
+                _mov_rr(REG_A, RAX);
+            } else {
+                _emit_operand(in);
+                _emit_rmw_op(in);
+                _mov_rr(RDX, RAX);
+                _load32(RSI, REG_ST, ST(ea));
+                _emit_write(in, (in->mode == M_ABS) ? (in->operand >> 8) : (in->mode == M_ABSX) ? -1 : 0);
+            }
+            break;
+
+        case J_TSB:
+        case J_TRB:
+            _emit_operand(in);
+            _emit_z_and(REG_A, RAX);
+            if (in->op == J_TSB) {
+                _alu_rr(ALU_OR, RAX, REG_A);
+            } else {
+                _mov_rr(RCX, REG_A);
+                _not_r(RCX);
+                _alu_rr(ALU_AND, RAX, RCX);
+            }
+            _mov_rr(RDX, RAX);
+            _load32(RSI, REG_ST, ST(ea));
+            _emit_write(in, (in->mode == M_ABS) ? (in->operand >> 8) : 0);
+            break;
+
+        case J_PHA: _emit_push(REG_A); break;
+        case J_PHX: _emit_push(REG_X); break;
+        case J_PHY: _emit_push(REG_Y); break;
+        case J_PHP:
+            _mov_ri64(RDX, cpu65_flags_encode);
+            _load8(RDX, RDX, REG_F, 0);
+            _emit_push(RDX);
+            break;
+        case J_PLA: _emit_pop(REG_A); _emit_nz(REG_A); break;
+        case J_PLX: _emit_pop(REG_X); _emit_nz(REG_X); break;
+        case J_PLY: _emit_pop(REG_Y); _emit_nz(REG_Y); break;
+
+        case J_TAX: _mov_rr(REG_X, REG_A); _emit_nz(REG_X); break;
+        case J_TAY: _mov_rr(REG_Y, REG_A); _emit_nz(REG_Y); break;
+        case J_TXA: _mov_rr(REG_A, REG_X); _emit_nz(REG_A); break;
+        case J_TYA: _mov_rr(REG_A, REG_Y); _emit_nz(REG_A); break;
+        case J_TSX: _load8(REG_X, REG_ST, NOREG, ST(sp)); _emit_nz(REG_X); break;
+        case J_TXS: _store8(REG_X, REG_ST, NOREG, ST(sp)); break;
+
+        case J_INX:
+        case J_INY:
+        case J_DEX:
+        case J_DEY:
+        {
+            const int reg = (in->op == J_INX || in->op == J_DEX) ? REG_X : REG_Y;
+            _alu_ri((in->op == J_INX || in->op == J_INY) ? ALU_ADD : ALU_SUB, reg, 1);
+            _movzx8_rr(reg, reg);
+            _emit_nz(reg);
+            break;
+        }
+
+        case J_CLC: _alu_ri(ALU_AND, REG_F, (uint8_t)~C_Flag); break;
+        case J_SEC: _alu_ri(ALU_OR, REG_F, C_Flag); break;
+        case J_CLD: _alu_ri(ALU_AND, REG_F, (uint8_t)~D_Flag); break;
+        case J_SED: _alu_ri(ALU_OR, REG_F, D_Flag); break;
+        case J_CLV: _alu_ri(ALU_AND, REG_F, (uint8_t)~V_Flag); break;
+        case J_SEI: _alu_ri(ALU_OR, REG_F, I_Flag); break;
+        case J_NOP: break;
+
+        default:
+            _emit_block_end(in);
+            return;
+    }
+
+    if (in->extra) {
+        _alu_rm(ALU_ADD, REG_XC, REG_ST, ST(opx));
+    }
+}
+
+/* -------------------------------------------------------------------------
+    Code buffer
+   ------------------------------------------------------------------------- */
+
+static void _emit_trampolines(void) {
+    static const int saved[] = { RBX, RBP, R12, R13, R14, R15 };
+
+    // void jit_enter(void *code)
+    jit_enter = (void (*)(void *))jit_ptr;
+    for (unsigned int i = 0; i < sizeof(saved)/sizeof(saved[0]); i++) {
+        _push(saved[i]);
+    }
+    _rr(0x83, OP_W, ALU_SUB, RSP); // keep the stack 16-byte aligned for callouts
+    _e8(8);
+    _mov_ri64(REG_ST, &jit65_state);
+    _load8(REG_A, REG_ST, NOREG, ST(a));
+    _load8(REG_X, REG_ST, NOREG, ST(x));
+    _load8(REG_Y, REG_ST, NOREG, ST(y));
+    _load8(REG_F, REG_ST, NOREG, ST(f));
+    _load32(REG_XC, REG_ST, ST(xcycles));
+    _store8i(0, REG_ST, NOREG, ST(brk));
+    _rr(0xFF, 0, 4, RDI); // jmp *%rdi
+
+    jit_exit = jit_ptr;
+    _store8(REG_A, REG_ST, NOREG, ST(a));
+    _store8(REG_X, REG_ST, NOREG, ST(x));
+    _store8(REG_Y, REG_ST, NOREG, ST(y));
+    _store8(REG_F, REG_ST, NOREG, ST(f));
+    _store32(REG_XC, REG_ST, ST(xcycles));
+    _rr(0x83, OP_W, ALU_ADD, RSP);
+    _e8(8);
+    for (int i = sizeof(saved)/sizeof(saved[0]) - 1; i >= 0; i--) {
+        _pop(saved[i]);
+    }
+    _e8(0xC3); // ret
+}
+
+bool jit65_init(const uint8_t *code_pages) {
+    if (jit_code) {
+        return true;
+    }
+
+    void *code = mmap(NULL, JIT_CODE_SIZE, PROT_READ|PROT_WRITE|PROT_EXEC, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        ERRLOG("Could not allocate JIT code buffer, running interpreter only");
+        return false;
+    }
+
+    for (unsigned int v = 0; v < 0x100; v++) {
+        jit65_state.nz[v] = (v & 0x80) ? N_Flag : (v ? 0 : Z_Flag);
+    }
+
+    jit_code_pages = code_pages;
+    jit_code = code;
+    jit_ptr = jit_code;
+    _emit_trampolines();
+    jit_blocks = jit_ptr;
+
+    LOG("65c02 JIT enabled");
+    return true;
+}
+
+void jit65_flush(void) {
+    jit_ptr = jit_blocks;
+}
+
+void jit65_shutdown(void) {
+    if (!jit_code) {
+        return;
+    }
+    if (munmap(jit_code, JIT_CODE_SIZE)) {
+        ERRLOG("Error munmap()ping JIT code buffer");
+    }
+    jit_code = NULL;
+    jit_ptr = NULL;
+    jit_blocks = NULL;
+}
+
+void jit65_run(void *code) {
+    jit_enter(code);
+}
+
+void *jit65_compile(uint16_t pc, const uint8_t *bank, unsigned int count, bool *full) {
+    jit_insn_t insns[JIT_MAX_INSNS];
+    unsigned int n = 0;
+    unsigned int cycles = 0;
+
+    *full = false;
+    if (!jit_code || count > JIT_MAX_INSNS) {
+        return NULL;
+    }
+    if (jit_ptr + JIT_BLOCK_RESERVE > jit_code + JIT_CODE_SIZE) {
+        *full = true;
+        return NULL;
+    }
+
+    // decode the supported prefix of the block
+    for (n = 0; n < count; n++) {
+        const uint8_t opcode = bank[pc];
+        const uint16_t info = jit_ops[opcode];
+        if (!info) {
+            break;
+        }
+
+        jit_insn_t *in = &insns[n];
+        memset(in, 0, sizeof(*in));
+        in->index = n;
+        in->addr = pc;
+        in->opcode = opcode;
+        in->op = info >> 8;
+        in->mode = info & 0xFF;
+        in->cycles = cycles;
+        in->extra = (in->mode == M_ABSX || in->mode == M_ABSY || in->mode == M_INDY);
+
+        unsigned int len = 1;
+        if (in->mode == M_ABS || in->mode == M_ABSX || in->mode == M_ABSY || in->mode == M_ABSX_ST || in->mode == M_ABSY_ST) {
+            len = 3;
+            in->operand = bank[(uint16_t)(pc + 1)] | (bank[(uint16_t)(pc + 2)] << 8);
+        } else if (in->mode != M_IMP) {
+            len = 2;
+            in->operand = bank[(uint16_t)(pc + 1)];
+        }
+        in->next = pc + len;
+
+        // ea left by instructions without a memory operand
+        if (in->op == J_JMP || in->op == J_JSR) {
+            in->ea = in->operand;
+        } else if (in->mode == M_IMP) {
+            in->ea = in->addr;
+        } else if (in->mode == M_IMM || in->mode == M_REL) {
+            in->ea = in->addr + 1;
+        } else {
+            in->dynamic_ea = true;
+        }
+
+        cycles += cpu65__opcycles[opcode];
+        pc = in->next;
+    }
+
+    if (n == 0) {
+        return NULL;
+    }
+
+    uint8_t *code = jit_ptr;
+    for (unsigned int i = 0; i < n; i++) {
+        jit_insn_t *in = &insns[i];
+        _emit_insn(in, i ? &insns[i-1] : NULL);
+        if (in->op >= J_BPL && in->op <= J_RTS) {
+            break; // exits emitted
+        }
+        if (i == n - 1) {
+            _emit_exit(in, NOREG, in->next, -1, false); // end of block, or next instruction left to the interpreter
+        } else if (in->io) {
+            _alu8_mi(ALU_CMP, 0, REG_ST, NOREG, ST(brk));
+            uint8_t *cont = _jcc(CC_E);
+            _emit_exit(in, NOREG, in->next, -1, false);
+            _patch(cont, jit_ptr);
+        }
+    }
+
+    assert(jit_ptr <= code + JIT_BLOCK_RESERVE);
+    return code;
+}
+
+#endif // CPU_JIT
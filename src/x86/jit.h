@@ -0,0 +1,81 @@
+/*
+ * Apple // emulator for *ix
+ *
+ * This software package is subject to the GNU General Public License
+ * version 3 or later (your choice) as published by the Free Software
+ * Foundation.
+ *
+ * Copyright 2013-2015 Aaron Culliney
+ *
+ */
+
+#ifndef _JIT_H_
+#define _JIT_H_
+
+/*
+ * x86-64 dynamic recompiler for hot basic blocks of the portable C 65c02 core (CPU_JIT).
+ *
+ * The code buffer and jit65_state belong to the current machine (machine.h), compiled code only runs on the machine
+ * it was compiled for.
+ *
+ * Native blocks run with the 65c02 registers held in host registers and exchange state with cpu65_run() through
+ * jit65_state.  Flags are kept in the same (6502 bit order) layout as the C core.  Plain RAM/ROM pages are accessed
+ * inline through cpu65_vmem_rpage/cpu65_vmem_wpage, everything else (I/O pages, writes to pages holding decoded
+ * code) calls out to c_jit65_read()/c_jit65_write() which dispatch to the cpu65_vmem_r/cpu65_vmem_w handlers.
+ */
+
+typedef struct jit65_state_t {
+    // 65c02 registers (in/out)
+    uint32_t pc;
+    uint32_t ea;
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t f;
+    uint8_t sp;
+    uint8_t d;          // last data byte written (cpu65_d)
+
+    // block exit (out)
+    uint8_t rw;         // cpu65_rw of the last completed instruction
+    uint8_t side_exit;  // exited ahead of an instruction the native block could not execute
+    int32_t last;       // index of the last completed instruction, -1 if none
+    int32_t opcycles;   // extra cycles of the last completed instruction
+
+    // cycle accounting (in/out)
+    int32_t xcycles;    // extra cycles of the completed instructions
+    int32_t committed;  // block cycles already accounted by c_jit65_read()/c_jit65_write()
+
+    // scratch used by native code
+    uint8_t brk;        // set by I/O or code-page accesses : exit after the current instruction
+    uint8_t pad[3];
+    uint32_t cur;       // base cycles | opcode << 16 | rw << 24 of the instruction calling out
+    int32_t opx;        // extra cycles of the current instruction
+    uint32_t tmp;
+
+    uint8_t nz[256];    // N_Flag|Z_Flag for each result value
+} jit65_state_t;
+
+// jit65_state : state of the current machine (machine.h)
+
+/* Allocate the code buffer on first use, code_pages flags the pages holding decoded blocks (writes to those go
+ * through c_jit65_write()) */
+bool jit65_init(const uint8_t *code_pages);
+
+/* Compile the first instructions (up to count) of the basic block at pc.  Returns NULL when the block does not start
+ * with a supported instruction, or when the code buffer is exhausted (*full is set, call jit65_flush()) */
+void *jit65_compile(uint16_t pc, const uint8_t *bank, unsigned int count, bool *full);
+
+/* Drop all compiled code */
+void jit65_flush(void);
+
+/* Release the code buffer */
+void jit65_shutdown(void);
+
+/* Run a compiled block against jit65_state */
+void jit65_run(void *code);
+
+/* Slow path memory accesses from native code (implemented by the C core) */
+uint8_t c_jit65_read(jit65_state_t *st, uint16_t ea);
+void c_jit65_write(jit65_state_t *st, uint16_t ea, uint8_t b);
+
+#endif /* _JIT_H_ */